@@ -28,7 +28,7 @@
 #include "Actor.h"
 #line 30 "Actor.cc"
 
-Actor::Actor()
+Actor::Actor() : msgrcv(NULL), msgbatchsize(0), msgbatchpos(0)
 {
 }
 
@@ -40,13 +40,33 @@ void Actor::init(Topology::actorIdentity *myIdentityArg)
 {
     myIdentity=*myIdentityArg;
     delete myIdentityArg;
+    myIdentity.mbox->actortype=myIdentity.type;
     mboxes.nodeid=myIdentity.address.nodeid;
     mboxes.update(myTopology, myIdentity.instance);
 }
 
 void Actor::getmsg(int timeout)
 {
-    msgrcv=myIdentity.mbox->receive(timeout);
+    if (msgbatchpos==msgbatchsize)
+    {
+        msgbatchsize=myIdentity.mbox->receiveBatch(msgbatch,
+                                                   MSGRECEIVEBATCHSIZE,
+                                                   timeout);
+        msgbatchpos=0;
+
+        if (msgbatchsize==0)
+        {
+            msgrcv=NULL;
+            return;
+        }
+    }
+
+    msgrcv=msgbatch[msgbatchpos++];
+    if (msgbatchpos < msgbatchsize)
+    {
+        __builtin_prefetch(msgbatch[msgbatchpos]);
+    }
+
     if (msgrcv != NULL && msgrcv->messageStruct.topic==TOPIC_SERIALIZED)
     {
         SerializedMessage serobj(((class MessageSerialized *)msgrcv)->data);
@@ -110,15 +130,9 @@ void Actor::getmsg(int timeout)
         break;
         case PAYLOADSUBTRANSACTION:
         {
-            reuseMessageSubtransactionCmd=MessageSubtransactionCmd();
-            reuseMessageSubtransactionCmd.unpack(serobj);
-            if (serobj.data->size() != serobj.pos)
-            {
-                fprintf(logfile, "unpack %i size %lu pos %lu\n",
-                        serobj.getpayloadtype(),
-                        (unsigned long)serobj.data->size(),
-                        (unsigned long)serobj.pos);
-            }
+            // keeps serobj.data, bulky members decoded on demand
+            reuseMessageSubtransactionCmd.clear();
+            reuseMessageSubtransactionCmd.unpackView(serobj);
             msgrcv=&reuseMessageSubtransactionCmd;
         }
         break;
@@ -56,13 +56,17 @@ public:
     /** 
      * @brief get and deserialize next message from mbox
      *
-     * deserialize messages from remote nodes
+     * deserialize messages from remote nodes. Messages are taken from the
+     * mbox in batches with Mbox::receiveBatch and handed out one per call.
      *
      * @param timeout timeout parameter to MboxProducer::send
 0     */
     void getmsg(int timeout);
     
     class Message *msgrcv;
+    class Message *msgbatch[MSGRECEIVEBATCHSIZE];
+    size_t msgbatchsize;
+    size_t msgbatchpos;
     class Mboxes mboxes;
     Topology::actorIdentity myIdentity;
     class Topology myTopology;
@@ -56,6 +56,7 @@ Ast::Ast(class Ast *parentarg,
 Ast::Ast(class Ast *parentarg, string &operandarg) : parent(parentarg),
                                rightchild(NULL), leftchild(NULL),
                                isoperator(false),
+                               operatortype(OPERATOR_NONE),
                                operand(operandarg)
 {
 }
@@ -134,6 +135,56 @@ bool Ast::evaluate(class Ast **nextAstNode, class Statement *statementPtr)
         return true;
     }
 
+    if (operatortype==OPERATOR_OR)
+    {
+        vector<class Ast *> equalities;
+        vector<fieldValue_s> orValues;
+
+        if (statementPtr->orEqualities(this, equalities, orValues)==true)
+        {
+            // search as IN, each Engine gets only its own values
+            string fieldoperand = equalities[0]->leftchild->operand;
+
+            for (size_t n=0; n < equalities.size(); n++)
+            {
+                class Ast &equalityRef = *equalities[n];
+
+                if (equalityRef.rightchild->operand[0]==OPERAND_PARAMETER)
+                {
+                    int64_t paramnum;
+                    memcpy(&paramnum, &equalityRef.rightchild->operand[1],
+                           sizeof(paramnum));
+                    equalityRef.rightchild->operand =
+                        statementPtr->parameters[paramnum];
+                }
+
+                statementPtr->stagedPredicate(OPERATOR_EQ,
+                                              statementPtr->currentQuery->tableid,
+                                              equalityRef.leftchild->operand,
+                                              equalityRef.rightchild->operand,
+                                              statementPtr->currentQuery->results.inValues,
+                                              statementPtr->transactionPtr->stagedRows,
+                                              predicateResults);
+            }
+
+            isoperator=false;
+            delete leftchild;
+            leftchild=NULL;
+            delete rightchild;
+            rightchild=NULL;
+            statementPtr->transactionPtr->sqlPredicate(statementPtr,
+                                                       OPERATOR_IN,
+                                                       statementPtr->currentQuery->tableid,
+                                                       fieldoperand,
+                                                       fieldoperand,
+                                                       statementPtr->currentQuery->locktype,
+                                                       orValues, this,
+                                                       predicateResults);
+            *nextAstNode = NULL;
+            return false;
+        }
+    }
+
     /* do left 1st, particularly for AND optimization */
 
     // unary operators ignore leftchild
@@ -490,6 +541,19 @@ bool Ast::evaluate(class Ast **nextAstNode, class Statement *statementPtr)
 
     case OPERATOR_AND:
     {
+        if (rightchild->isoperator==false &&
+            rightchild->operatortype==OPERATOR_TRUE)
+        {
+            // right side was pushed down with left side's search
+            predicateResults.swap(leftchild->predicateResults);
+            isoperator=false;
+            delete leftchild;
+            leftchild=NULL;
+            delete rightchild;
+            rightchild=NULL;
+            break;
+        }
+
         boost::unordered_map< int64_t, vector<int64_t> > enginerowids;
 
         boost::unordered_map<uuRecord_s, returnRow_s>::iterator it;
@@ -1517,483 +1581,569 @@ bool Ast::evaluate(class Ast **nextAstNode, class Statement *statementPtr)
     return true;
 }
 
-// to do updates like: set fieldA=fieldA+5
-void Ast::evaluateAssignment(vector<fieldValue_s> &fieldValues,
-                             class Statement *statementPtr)
+void Ast::toFloat(const string &inoperand, fieldValue_s &outField)
 {
-    if (isoperator==false)
+    switch (inoperand[0])
     {
-        normalizeSetAssignmentOperand(fieldValues, statementPtr);
-        return;
+    case OPERAND_INTEGER:
+    {
+        int64_t val;
+        memcpy(&val, &inoperand[1], sizeof(val));
+        outField.value.floating=(long double)val;
     }
+    break;
 
-    if (operatortype != OPERATOR_NEGATION) // not unary operator
-    {
-        leftchild->evaluateAssignment(fieldValues, statementPtr);
+    case OPERAND_FLOAT:
+        memcpy(&outField.value.floating, &inoperand[1], sizeof(long double));
+        break;
+
+    default:
+        outField.value.floating=0;
     }
+}
 
-    rightchild->evaluateAssignment(fieldValues, statementPtr);
+void Ast::toFloat(const string &inoperand, string &outoperand)
+{
+    string instr=inoperand;
 
-    switch (operatortype)
+    switch (instr[0])
     {
-    case OPERATOR_CONCATENATION:
+    case OPERAND_INTEGER:
     {
-        if (leftchild->operand[0] != OPERAND_STRING ||
-            rightchild->operand[0] != OPERAND_STRING)
-        {
-            printf("%s %i bad operand %c\n", __FILE__, __LINE__, operand[0]);
-            return;
-        }
-
-        operand=OPERAND_STRING;
-        operand.append(leftchild->operand.substr(1, string::npos));
-        operand.append(rightchild->operand.substr(1, string::npos));
-        isoperator=false;
-        delete leftchild;
-        leftchild=NULL;
-        delete rightchild;
-        rightchild=NULL;
+        outoperand.resize(1+sizeof(int64_t), OPERAND_FLOAT);
+        int64_t val;
+        memcpy(&val, &instr[1], sizeof(val));
+        memcpy(&outoperand[1], &val, sizeof(val));
     }
     break;
 
-    case OPERATOR_ADDITION:
-        if (leftchild->operand[0]==OPERAND_FLOAT ||
-            rightchild->operand[0]==OPERAND_FLOAT)
-        {
-            toFloat(leftchild->operand, leftchild->operand);
-            toFloat(rightchild->operand, rightchild->operand);
-        }
+    case OPERAND_FLOAT:
+        outoperand=instr;
+        break;
 
-        switch (leftchild->operand[0])
-        {
-        case OPERAND_INTEGER:
+    default:
+        outoperand.resize(1+sizeof(long double), OPERAND_FLOAT);
+        long double val;
+        memcpy(&val, &instr[1], sizeof(val));
+        memcpy(&outoperand[1], &val, sizeof(val));
+    }
+}
+
+Expression::Expression()
+{
+}
+
+Expression::~Expression()
+{
+}
+
+bool Expression::compile(class Ast *astPtr, class Table &tableRef)
+{
+    program.clear();
+    strings.clear();
+    stack.clear();
+
+    if (compile2(astPtr, tableRef, 0)==false)
+    {
+        return false;
+    }
+
+    buffers.resize(stack.size());
+
+    return true;
+}
+
+bool Expression::compile2(class Ast *astPtr, class Table &tableRef,
+                          size_t depth)
+{
+    if (stack.size() < depth+1)
+    {
+        stack.resize(depth+1);
+    }
+
+    instruction_s instruction = {};
+
+    if (astPtr->isoperator==false)
+    {
+        const string &operandRef = astPtr->operand;
+
+        switch (operandRef[0])
         {
-            if (rightchild->operand[0] != OPERAND_INTEGER)
+        case OPERAND_FIELDID:
+            instruction.opcode = OP_FIELD;
+            memcpy(&instruction.arg, &operandRef[1], sizeof(instruction.arg));
+
+            if (instruction.arg < 0 ||
+                (size_t)instruction.arg >= tableRef.fields.size())
             {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
+                return false;
             }
 
-            operand.resize(1+sizeof(int64_t), (char)0);
-            operand[0] = OPERAND_INTEGER;
-            int64_t val = *(int64_t *)(leftchild->operand.c_str()+1) +
-                *(int64_t *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
-        }
-        break;
+            instruction.fieldtype = tableRef.fields[instruction.arg].type;
+            break;
 
-        case OPERAND_FLOAT:
-        {
-            if (rightchild->operand[0] != OPERAND_FLOAT)
+        case OPERAND_PARAMETER:
+            instruction.opcode = OP_PARAMETER;
+            memcpy(&instruction.arg, &operandRef[1], sizeof(instruction.arg));
+            break;
+
+        default:
+            instruction.opcode = OP_CONSTANT;
+
+            if (decode(operandRef, instruction.constant)==false)
             {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
+                return false;
             }
 
-            operand.resize(1+sizeof(long double), (char)0);
-            operand[0] = OPERAND_FLOAT;
-            int64_t val = *(long double *)(leftchild->operand.c_str()+1) +
-                *(long double *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
+            if (instruction.constant.type==VARCHAR)
+            {
+                // copies of the Expression mustn't point into this one
+                instruction.arg = strings.size();
+                strings.push_back(operandRef.substr(1, string::npos));
+                instruction.constant.str = NULL;
+            }
         }
-        break;
 
-        default:
-            printf("%s %i not an arithmetic type %c\n", __FILE__, __LINE__,
-                   leftchild->operand[0]);
-            return;
-        }
+        program.push_back(instruction);
+        return true;
+    }
 
-        delete leftchild;
-        leftchild=NULL;
-        delete rightchild;
-        rightchild=NULL;
+    switch (astPtr->operatortype)
+    {
+    case OPERATOR_ADDITION:
+        instruction.opcode = OP_ADD;
         break;
 
     case OPERATOR_SUBTRACTION:
-        if (leftchild->operand[0]==OPERAND_FLOAT ||
-            rightchild->operand[0]==OPERAND_FLOAT)
+        instruction.opcode = OP_SUBTRACT;
+        break;
+
+    case OPERATOR_MULTIPLICATION:
+        instruction.opcode = OP_MULTIPLY;
+        break;
+
+    case OPERATOR_DIVISION:
+        instruction.opcode = OP_DIVIDE;
+        break;
+
+    case OPERATOR_NEGATION:
+        instruction.opcode = OP_NEGATE;
+        break;
+
+    case OPERATOR_CONCATENATION:
+        instruction.opcode = OP_CONCATENATE;
+        break;
+
+    default:
+        printf("%s %i can't compile operator %i\n", __FILE__, __LINE__,
+               astPtr->operatortype);
+        return false;
+    }
+
+    // unary operator has only rightchild
+    if (instruction.opcode != OP_NEGATE)
+    {
+        if (compile2(astPtr->leftchild, tableRef, depth)==false)
         {
-            toFloat(leftchild->operand, leftchild->operand);
-            toFloat(rightchild->operand, rightchild->operand);
+            return false;
         }
 
-        switch (leftchild->operand[0])
+        depth++;
+    }
+
+    if (compile2(astPtr->rightchild, tableRef, depth)==false)
+    {
+        return false;
+    }
+
+    program.push_back(instruction);
+
+    return true;
+}
+
+bool Expression::decode(const string &operand, value_s &value)
+{
+    switch (operand[0])
+    {
+    case OPERAND_INTEGER:
+        value.type = INT;
+        memcpy(&value.value.integer, &operand[1], sizeof(int64_t));
+        break;
+
+    case OPERAND_FLOAT:
+        value.type = FLOAT;
+        memcpy(&value.value.floating, &operand[1], sizeof(long double));
+        break;
+
+    case OPERAND_STRING:
+        value.type = VARCHAR;
+        value.str = operand.data()+1;
+        value.len = operand.size()-1;
+        break;
+
+    case OPERAND_BOOLEAN:
+        value.type = BOOL;
+        value.value.boolean = operand[1]=='t';
+        break;
+
+    case OPERAND_NULL:
+        value.type = NOFIELDTYPE;
+        break;
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+bool Expression::evaluate(const vector<fieldValue_s> &row,
+                          const vector<string> &parameters,
+                          fieldtype_e fieldtype, fieldValue_s &result)
+{
+    size_t top = 0; // values on stack
+
+    for (size_t n=0; n < program.size(); n++)
+    {
+        const instruction_s &instructionRef = program[n];
+
+        switch (instructionRef.opcode)
         {
-        case OPERAND_INTEGER:
+        case OP_CONSTANT:
         {
-            if (rightchild->operand[0] != OPERAND_INTEGER)
+            value_s &valueRef = stack[top++];
+            valueRef = instructionRef.constant;
+
+            if (valueRef.type==VARCHAR)
             {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
+                valueRef.str = strings[instructionRef.arg].data();
+                valueRef.len = strings[instructionRef.arg].size();
             }
-
-            operand.resize(1+sizeof(int64_t), (char)0);
-            operand[0] = OPERAND_INTEGER;
-            int64_t val = *(int64_t *)(leftchild->operand.c_str()+1) -
-                *(int64_t *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
         }
         break;
 
-        case OPERAND_FLOAT:
+        case OP_FIELD:
         {
-            if (rightchild->operand[0] != OPERAND_FLOAT)
+            if ((size_t)instructionRef.arg >= row.size())
             {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
+                return false;
             }
 
-            operand.resize(1+sizeof(long double), (char)0);
-            operand[0] = OPERAND_FLOAT;
-            int64_t val = *(long double *)(leftchild->operand.c_str()+1) -
-                *(long double *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
-        }
-        break;
+            const fieldValue_s &fieldRef = row[instructionRef.arg];
+            value_s &valueRef = stack[top++];
 
-        default:
-            printf("%s %i not an arithmetic type %c\n", __FILE__, __LINE__,
-                   leftchild->operand[0]);
-            return;
-        }
+            if (fieldRef.isnull==true)
+            {
+                valueRef.type = NOFIELDTYPE;
+                break;
+            }
 
-        delete leftchild;
-        leftchild=NULL;
-        delete rightchild;
-        rightchild=NULL;
-        break;
+            // as Ast operands have them
+            switch (instructionRef.fieldtype)
+            {
+            case INT:
+                valueRef.type = INT;
+                valueRef.value.integer = fieldRef.value.integer;
+                break;
 
-    case OPERATOR_MULTIPLICATION:
-        if (leftchild->operand[0]==OPERAND_FLOAT ||
-            rightchild->operand[0]==OPERAND_FLOAT)
-        {
-            toFloat(leftchild->operand, leftchild->operand);
-            toFloat(rightchild->operand, rightchild->operand);
+            case UINT:
+                valueRef.type = INT;
+                valueRef.value.integer = (int64_t)fieldRef.value.uinteger;
+                break;
+
+            case BOOL:
+                valueRef.type = INT;
+                valueRef.value.integer = fieldRef.value.boolean ? 1 : 0;
+                break;
+
+            case FLOAT:
+                valueRef.type = FLOAT;
+                valueRef.value.floating = fieldRef.value.floating;
+                break;
+
+            case CHAR:
+                valueRef.type = VARCHAR;
+                valueRef.str = &fieldRef.value.character;
+                valueRef.len = 1;
+                break;
+
+            case CHARX:
+            case VARCHAR:
+                valueRef.type = VARCHAR;
+                valueRef.str = fieldRef.str.data();
+                valueRef.len = fieldRef.str.size();
+                break;
+
+            default:
+                return false;
+            }
         }
+        break;
 
-        switch (leftchild->operand[0])
-        {
-        case OPERAND_INTEGER:
-        {
-            if (rightchild->operand[0] != OPERAND_INTEGER)
+        case OP_PARAMETER:
+            if (instructionRef.arg < 0 ||
+                (size_t)instructionRef.arg >= parameters.size() ||
+                parameters[instructionRef.arg].empty() ||
+                decode(parameters[instructionRef.arg], stack[top++])==false)
             {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
+                return false;
             }
 
-            operand.resize(1+sizeof(int64_t), (char)0);
-            operand[0] = OPERAND_INTEGER;
-            int64_t val = *(int64_t *)(leftchild->operand.c_str()+1) *
-                *(int64_t *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
+            break;
+
+        case OP_NEGATE:
+        {
+            value_s &valueRef = stack[top-1];
+
+            switch (valueRef.type)
+            {
+            case INT:
+                valueRef.value.integer = 0 - valueRef.value.integer;
+                break;
+
+            case FLOAT:
+                valueRef.value.floating = 0 - valueRef.value.floating;
+                break;
+
+            case NOFIELDTYPE:
+                break;
+
+            default:
+                return false;
+            }
         }
         break;
 
-        case OPERAND_FLOAT:
+        case OP_CONCATENATE:
         {
-            if (rightchild->operand[0] != OPERAND_FLOAT)
+            top--;
+            value_s &lhs = stack[top-1];
+            const value_s &rhs = stack[top];
+
+            if (lhs.type==NOFIELDTYPE || rhs.type==NOFIELDTYPE)
             {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
+                lhs.type = NOFIELDTYPE;
+                break;
+            }
+            if (lhs.type != VARCHAR || rhs.type != VARCHAR)
+            {
+                return false;
             }
 
-            operand.resize(1+sizeof(long double), (char)0);
-            operand[0] = OPERAND_FLOAT;
-            int64_t val = *(long double *)(leftchild->operand.c_str()+1) *
-                *(long double *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
+            // lhs may already be this slot's buffer
+            string &bufferRef = buffers[top-1];
+
+            if (lhs.str != bufferRef.data() || lhs.len != bufferRef.size())
+            {
+                bufferRef.assign(lhs.str, lhs.len);
+            }
+
+            bufferRef.append(rhs.str, rhs.len);
+            lhs.str = bufferRef.data();
+            lhs.len = bufferRef.size();
         }
         break;
 
         default:
-            printf("%s %i not an arithmetic type %c\n", __FILE__, __LINE__,
-                   leftchild->operand[0]);
-            return;
+            top--;
+
+            if (arithmetic(instructionRef.opcode, stack[top-1],
+                           stack[top])==false)
+            {
+                return false;
+            }
         }
+    }
 
-        delete leftchild;
-        leftchild=NULL;
-        delete rightchild;
-        rightchild=NULL;
-        break;
+    if (top != 1)
+    {
+        return false;
+    }
 
-    case OPERATOR_DIVISION:
-        if (leftchild->operand[0]==OPERAND_FLOAT ||
-            rightchild->operand[0]==OPERAND_FLOAT)
+    const value_s &valueRef = stack[0];
+    result.isnull = false;
+
+    if (valueRef.type==NOFIELDTYPE)
+    {
+        result.isnull = true;
+        return true;
+    }
+
+    switch (fieldtype)
+    {
+    case INT:
+    case UINT:
+        if (valueRef.type==INT)
         {
-            toFloat(leftchild->operand, leftchild->operand);
-            toFloat(rightchild->operand, rightchild->operand);
+            result.value.integer = valueRef.value.integer;
         }
-
-        switch (leftchild->operand[0])
+        else if (valueRef.type==FLOAT)
         {
-        case OPERAND_INTEGER:
+            result.value.integer = (int64_t)valueRef.value.floating;
+        }
+        else if (valueRef.type==BOOL)
         {
-            if (rightchild->operand[0] != OPERAND_INTEGER)
-            {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
-            }
-
-            operand.resize(1+sizeof(int64_t), (char)0);
-            operand[0] = OPERAND_INTEGER;
-            int64_t val = *(int64_t *)(leftchild->operand.c_str()+1) /
-                *(int64_t *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
+            result.value.integer = valueRef.value.boolean;
         }
-        break;
-
-        case OPERAND_FLOAT:
+        else
         {
-            if (rightchild->operand[0] != OPERAND_FLOAT)
-            {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
-            }
-
-            operand.resize(1+sizeof(long double), (char)0);
-            operand[0] = OPERAND_FLOAT;
-            int64_t val = *(long double *)(leftchild->operand.c_str()+1) /
-                *(long double *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
+            return false;
         }
+
         break;
 
-        default:
-            printf("%s %i not an arithmetic type %c\n", __FILE__, __LINE__,
-                   leftchild->operand[0]);
-            return;
+    case BOOL:
+        if (valueRef.type==INT)
+        {
+            result.value.boolean = valueRef.value.integer != 0;
+        }
+        else if (valueRef.type==BOOL)
+        {
+            result.value.boolean = valueRef.value.boolean;
+        }
+        else
+        {
+            return false;
         }
 
-        delete leftchild;
-        leftchild=NULL;
-        delete rightchild;
-        rightchild=NULL;
         break;
 
-    case OPERATOR_NEGATION:
-        if (rightchild->operand[0]==OPERAND_FLOAT)
+    case FLOAT:
+        if (valueRef.type==INT)
         {
-            toFloat(rightchild->operand, rightchild->operand);
+            result.value.floating = valueRef.value.integer;
         }
-
-        switch (rightchild->operand[0])
+        else if (valueRef.type==FLOAT)
         {
-        case OPERAND_INTEGER:
+            result.value.floating = valueRef.value.floating;
+        }
+        else
         {
-            if (rightchild->operand[0] != OPERAND_INTEGER)
-            {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
-            }
-
-            operand.resize(1+sizeof(int64_t), (char)0);
-            operand[0] = OPERAND_INTEGER;
-            int64_t val = 0 -
-                *(int64_t *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
+            return false;
         }
+
         break;
 
-        case OPERAND_FLOAT:
+    case CHAR:
+        if (valueRef.type != VARCHAR)
         {
-            if (rightchild->operand[0] != OPERAND_FLOAT)
-            {
-                printf("%s %i operand mismatch %c %i\n", __FILE__, __LINE__,
-                       leftchild->operand[0], rightchild->operand[0]);
-                return;
-            }
-
-            operand.resize(1+sizeof(long double), (char)0);
-            operand[0] = OPERAND_FLOAT;
-            int64_t val = 0 -
-                *(long double *)(rightchild->operand.c_str()+1);
-            memcpy(&operand[1], &val, sizeof(val));
-            isoperator=false;
+            return false;
         }
+
+        result.value.character = valueRef.len ? valueRef.str[0] : 0;
         break;
 
-        default:
-            printf("%s %i not an arithmetic type '%c'\n", __FILE__, __LINE__,
-                   leftchild->operand[0]);
-            return;
+    case CHARX:
+    case VARCHAR:
+        if (valueRef.type != VARCHAR)
+        {
+            return false;
         }
 
-        delete rightchild;
-        rightchild=NULL;
+        result.str.assign(valueRef.str, valueRef.len);
         break;
 
     default:
-        printf("%s %i can't evaluate %i in set assignment\n", __FILE__, __LINE__,
-               operatortype);
+        return false;
     }
+
+    return true;
 }
 
-void Ast::normalizeSetAssignmentOperand(vector<fieldValue_s> &fieldValues,
-                                        class Statement *statementPtr)
+bool Expression::arithmetic(opcode_e opcode, value_s &lhs,
+                            const value_s &rhs)
 {
-    switch (operand[0])
+    if (lhs.type==NOFIELDTYPE || rhs.type==NOFIELDTYPE)
     {
-    case OPERAND_FIELDID:
+        lhs.type = NOFIELDTYPE;
+        return true;
+    }
+    if ((lhs.type != INT && lhs.type != FLOAT) ||
+        (rhs.type != INT && rhs.type != FLOAT))
     {
-        int64_t fieldid;
-        memcpy(&fieldid, &operand[1], sizeof(fieldid));
+        return false;
+    }
 
-        switch (statementPtr->schemaPtr->tables[statementPtr->currentQuery->tableid]->fields[fieldid].type)
+    // INTEGER cast to FLOAT if either is FLOAT, as Ast::toFloat
+    if (lhs.type==FLOAT || rhs.type==FLOAT)
+    {
+        long double l = lhs.type==FLOAT ? lhs.value.floating :
+            (long double)lhs.value.integer;
+        long double r = rhs.type==FLOAT ? rhs.value.floating :
+            (long double)rhs.value.integer;
+        lhs.type = FLOAT;
+
+        switch (opcode)
         {
-        case INT:
-            operand.resize(1+sizeof(int64_t), (char)0);
-            operand[0] = OPERAND_INTEGER;
-            memcpy(&operand[1], &fieldValues[fieldid].value.integer,
-                   sizeof(int64_t));
+        case OP_ADD:
+            lhs.value.floating = l + r;
             break;
 
-        case UINT:
-            operand.resize(1+sizeof(int64_t), (char)0);
-            operand[0] = OPERAND_INTEGER;
-            memcpy(&operand[1], &fieldValues[fieldid].value.uinteger,
-                   sizeof(int64_t));
+        case OP_SUBTRACT:
+            lhs.value.floating = l - r;
             break;
 
-        case BOOL:
-            operand.resize(1+sizeof(int64_t), (char)0);
-            operand[0] = OPERAND_INTEGER;
-            int64_t val;
+        case OP_MULTIPLY:
+            lhs.value.floating = l * r;
+            break;
 
-            if (fieldValues[fieldid].value.boolean==true)
+        case OP_DIVIDE:
+            if (r==0)
             {
-                val=1;
-            }
-            else
-            {
-                val=0;
+                return false;
             }
 
-            memcpy(&operand[1], &val, sizeof(int64_t));
-            break;
-
-        case FLOAT:
-            operand.resize(1+sizeof(long double), (char)0);
-            operand[0] = OPERAND_FLOAT;
-            memcpy(&operand[1], &fieldValues[fieldid].value.floating,
-                   sizeof(int64_t));
-            break;
-
-        case CHAR:
-            operand.resize(1+sizeof(char), (char)0);
-            operand[0] = OPERAND_STRING;
-            operand[1] = fieldValues[fieldid].value.character;
-            break;
-
-        case CHARX:
-            operand.assign(1, OPERAND_STRING);
-            operand.append(fieldValues[fieldid].str);
-            break;
-
-        case VARCHAR:
-            operand.assign(1, OPERAND_STRING);
-            operand.append(fieldValues[fieldid].str);
+            lhs.value.floating = l / r;
             break;
 
         default:
-            printf("%s %i anomaly %i\n", __FILE__, __LINE__,
-                   statementPtr->schemaPtr->tables[statementPtr->currentQuery->tableid]->fields[fieldid].type);
+            return false;
         }
-    }
-    break;
-
-    case OPERAND_SUBQUERY:
-        statementPtr->subqueryScalar(this);
-        break;
-
-    case OPERAND_PARAMETER:
-    {
-        int64_t paramnum;
-        memcpy(&paramnum, &operand[1], sizeof(paramnum));
-        operand = statementPtr->parameters[paramnum];
-    }
-    break;
 
-    default:
-        return;
+        return true;
     }
-}
 
-void Ast::toFloat(const string &inoperand, fieldValue_s &outField)
-{
-    switch (inoperand[0])
-    {
-    case OPERAND_INTEGER:
-    {
-        int64_t val;
-        memcpy(&val, &inoperand[1], sizeof(val));
-        outField.value.floating=(long double)val;
-    }
-    break;
+    int64_t l = lhs.value.integer;
+    int64_t r = rhs.value.integer;
 
-    case OPERAND_FLOAT:
-        memcpy(&outField.value.floating, &inoperand[1], sizeof(long double));
+    switch (opcode)
+    {
+    case OP_ADD:
+        lhs.value.integer = l + r;
         break;
 
-    default:
-        outField.value.floating=0;
-    }
-}
+    case OP_SUBTRACT:
+        lhs.value.integer = l - r;
+        break;
 
-void Ast::toFloat(const string &inoperand, string &outoperand)
-{
-    string instr=inoperand;
+    case OP_MULTIPLY:
+        lhs.value.integer = l * r;
+        break;
 
-    switch (instr[0])
-    {
-    case OPERAND_INTEGER:
-    {
-        outoperand.resize(1+sizeof(int64_t), OPERAND_FLOAT);
-        int64_t val;
-        memcpy(&val, &instr[1], sizeof(val));
-        memcpy(&outoperand[1], &val, sizeof(val));
-    }
-    break;
+    case OP_DIVIDE:
+        if (r==0 || (r==-1 && l==INT64_MIN))
+        {
+            return false;
+        }
 
-    case OPERAND_FLOAT:
-        outoperand=instr;
+        lhs.value.integer = l / r;
         break;
 
     default:
-        outoperand.resize(1+sizeof(long double), OPERAND_FLOAT);
-        long double val;
-        memcpy(&val, &instr[1], sizeof(val));
-        memcpy(&outoperand[1], &val, sizeof(val));
+        return false;
     }
+
+    return true;
 }
 
-Statement::Statement()
+Statement::Statement() : iscursor(false), cursorowner(0)
 {
 }
 
 Statement::Statement(class TransactionAgent *taPtrarg,
                      class Schema *schemaPtrarg) :
     taPtr(taPtrarg), schemaPtr(schemaPtrarg), transactionPtr(NULL),
-    currentQuery(NULL)
+    currentQuery(NULL), iscursor(false), cursorowner(0)
 {
     reentry = reentry_s();
 }
@@ -2025,6 +2175,8 @@ void Statement::cp(const Statement &orig)
 
     parameters = orig.parameters;
     queryindex = orig.queryindex;
+    iscursor = orig.iscursor;
+    cursorowner = orig.cursorowner;
 }
 
 Statement::query_s Statement::cpquery(const query_s &orig)
@@ -2082,6 +2234,8 @@ Statement::query_s Statement::cpquery(const query_s &orig)
         *newstmt.fieldidAssignments[it->first] = *it->second;
     }
 
+    newstmt.fieldidExpressions = orig.fieldidExpressions;
+
     for (size_t n=0; n < orig.insertColumns.size(); n++)
     {
         newstmt.insertColumns.push_back(new class Ast);
@@ -2266,6 +2420,14 @@ bool Statement::resolveTableFields2()
             {
                 return false;
             }
+
+            if (currentQuery->fieldidExpressions[fid].compile(it->second,
+                                                              tableRef)==false)
+            {
+                printf("%s %i can't compile assignment to %s\n", __FILE__,
+                       __LINE__, it->first.c_str());
+                return false;
+            }
         }
     }
 
@@ -2392,6 +2554,69 @@ int64_t Statement::getfieldid(int64_t tableid, const string &fieldName)
     return ref[fieldName];
 }
 
+size_t Statement::countParameters()
+{
+    size_t count=0;
+
+    for (size_t n=0; n < queries.size(); n++)
+    {
+        query_s &queryRef = queries[n];
+        countParameters(queryRef.searchCondition, count);
+
+        for (size_t m=0; m < queryRef.inobject.expressionlist.size(); m++)
+        {
+            countParameters(queryRef.inobject.expressionlist[m], count);
+        }
+
+        boost::unordered_map<int64_t, class Ast *>::iterator it;
+
+        for (it = queryRef.fieldidAssignments.begin();
+             it != queryRef.fieldidAssignments.end(); ++it)
+        {
+            countParameters(it->second, count);
+        }
+
+        for (size_t m=0; m < queryRef.insertColumns.size(); m++)
+        {
+            countParameters(queryRef.insertColumns[m], count);
+        }
+    }
+
+    return count;
+}
+
+void Statement::countParameters(class Ast *astPtr, size_t &count)
+{
+    if (astPtr==NULL)
+    {
+        return;
+    }
+
+    if (astPtr->isoperator==false)
+    {
+        if (astPtr->operand[0]==OPERAND_PARAMETER)
+        {
+            int64_t paramnum;
+            memcpy(&paramnum, &astPtr->operand[1], sizeof(paramnum));
+
+            if (paramnum >= 0 && (size_t)paramnum >= count)
+            {
+                count = paramnum+1;
+            }
+        }
+
+        return;
+    }
+
+    // unary operators may point leftchild at themselves
+    if (astPtr->leftchild != astPtr)
+    {
+        countParameters(astPtr->leftchild, count);
+    }
+
+    countParameters(astPtr->rightchild, count);
+}
+
 bool Statement::stagedPredicate(operatortypes_e op, int64_t tableid,
                                 string &leftoperand, string &rightoperand,
                                 vector<fieldValue_s> &inValues,
@@ -3469,6 +3694,189 @@ bool Statement::stagedPredicate(operatortypes_e op, int64_t tableid,
 
 /* to be called for predicates ANDed with results of other predicates
  * this avoids traffic to engines */
+void Statement::pushdown(class Ast *predicateNode,
+                         vector<residualPredicate_s> &residuals,
+                         vector<int64_t> &projection)
+{
+    class Table &tableRef = *schemaPtr->tables[currentQuery->tableid];
+    class Ast *child = predicateNode;
+
+    for (class Ast *andNode = predicateNode->parent;
+         andNode != NULL && andNode->isoperator==true &&
+             andNode->operatortype==OPERATOR_AND &&
+             andNode->leftchild==child;
+         andNode = andNode->parent)
+    {
+        residualPredicate_s residual;
+
+        if (residualConjunct(andNode->rightchild, tableRef, residual)==false)
+        {
+            break;
+        }
+
+        residuals.push_back(residual);
+        // every row the Engines return satisfies it
+        class Ast &conjunctRef = *andNode->rightchild;
+        delete conjunctRef.leftchild;
+        conjunctRef.leftchild=NULL;
+        delete conjunctRef.rightchild;
+        conjunctRef.rightchild=NULL;
+        conjunctRef.isoperator=false;
+        conjunctRef.operatortype=OPERATOR_TRUE;
+        child = andNode;
+    }
+
+    if (currentQuery->type==CMD_SELECT && currentQuery->locktype==NOLOCK)
+    {
+        for (size_t n=0; n < currentQuery->fromColumnids.size(); n++)
+        {
+            projection.push_back(currentQuery->fromColumnids[n].fieldid);
+        }
+    }
+}
+
+bool Statement::residualConjunct(class Ast *conjunct, class Table &tableRef,
+                                 residualPredicate_s &residual)
+{
+    if (conjunct->isoperator==false)
+    {
+        return false;
+    }
+
+    switch (conjunct->operatortype)
+    {
+    case OPERATOR_EQ:
+    case OPERATOR_NE:
+    case OPERATOR_LT:
+    case OPERATOR_GT:
+    case OPERATOR_LTE:
+    case OPERATOR_GTE:
+        break;
+
+    default:
+        return false;
+    }
+
+    class Ast *lhs = conjunct->leftchild;
+    class Ast *rhs = conjunct->rightchild;
+
+    if (lhs==NULL || rhs==NULL || lhs->isoperator==true ||
+        rhs->isoperator==true || lhs->operand[0] != OPERAND_FIELDID)
+    {
+        return false;
+    }
+
+    string operand = rhs->operand;
+
+    if (operand[0]==OPERAND_PARAMETER)
+    {
+        int64_t paramnum;
+        memcpy(&paramnum, &operand[1], sizeof(paramnum));
+        operand = parameters[paramnum];
+    }
+
+    residual = residualPredicate_s();
+    memcpy(&residual.fieldid, &lhs->operand[1], sizeof(residual.fieldid));
+    residual.op = conjunct->operatortype;
+
+    switch (tableRef.fields[residual.fieldid].type)
+    {
+    case INT:
+    case UINT:
+        if (operand[0] != OPERAND_INTEGER)
+        {
+            return false;
+        }
+
+        memcpy(&residual.value.value.integer, &operand[1], sizeof(int64_t));
+        break;
+
+    case BOOL:
+        if (operand[0] != OPERAND_BOOLEAN)
+        {
+            return false;
+        }
+
+        residual.value.value.boolean = (operand[1]=='t');
+        break;
+
+    case FLOAT:
+        if (operand[0] != OPERAND_FLOAT)
+        {
+            return false;
+        }
+
+        memcpy(&residual.value.value.floating, &operand[1],
+               sizeof(long double));
+        break;
+
+    case CHAR:
+        if (operand[0] != OPERAND_STRING || operand.size() != 2)
+        {
+            return false;
+        }
+
+        residual.value.value.character = operand[1];
+        break;
+
+    case CHARX:
+    case VARCHAR:
+        if (operand[0] != OPERAND_STRING)
+        {
+            return false;
+        }
+
+        residual.value.str = operand.substr(1, string::npos);
+        break;
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+bool Statement::orEqualities(class Ast *orNode,
+                             vector<class Ast *> &equalities,
+                             vector<fieldValue_s> &values)
+{
+    if (orNode->isoperator==true && orNode->operatortype==OPERATOR_OR)
+    {
+        return orEqualities(orNode->leftchild, equalities, values) &&
+            orEqualities(orNode->rightchild, equalities, values);
+    }
+
+    class Table &tableRef = *schemaPtr->tables[currentQuery->tableid];
+    residualPredicate_s equality;
+
+    if (residualConjunct(orNode, tableRef, equality)==false ||
+        equality.op != OPERATOR_EQ)
+    {
+        return false;
+    }
+
+    if (!equalities.empty() &&
+        equalities[0]->leftchild->operand != orNode->leftchild->operand)
+    {
+        return false;
+    }
+
+    equalities.push_back(orNode);
+    fieldtype_e fieldtype = tableRef.fields[equality.fieldid].type;
+
+    for (size_t n=0; n < values.size(); n++)
+    {
+        if (compareFields(fieldtype, values[n], equality.value)==true)
+        {
+            return true;
+        }
+    }
+
+    values.push_back(equality.value);
+
+    return true;
+}
+
 void Statement::andPredicate(operatortypes_e op, int64_t tableid,
                              string &leftoperand, string &rightoperand,
                              vector<fieldValue_s> &inValues,
@@ -4920,12 +5328,41 @@ void Statement::branchtotype()
                  it != transactionPtr->stagedRows.end(); it++)
             {
                 const uuRecord_s &uurRef = it->first;
+
+                if (uurRef.tableid != currentQuery->tableid)
+                {
+                    continue;
+                }
+
                 const stagedRow_s &stagedRowRef = it->second;
                 returnRow_s returnRow;
                 stagedRow2ReturnRow(stagedRowRef, returnRow);
                 currentQuery->results.searchResults[uurRef]=returnRow;
             }
 
+            if (iscursor==true && queries.size()==1 &&
+                transactionPtr->cursor.isopen==false)
+            {
+                // staged rows are returned now, the rest by fetchRows()
+                class Transaction::cursor_s &cursorRef = transactionPtr->cursor;
+                cursorRef = Transaction::cursor_s();
+                cursorRef.isopen = true;
+                cursorRef.owner = cursorowner;
+                cursorRef.tableid = currentQuery->tableid;
+                cursorRef.locktype = currentQuery->locktype;
+
+                for (size_t n=0; n < currentQuery->fromColumnids.size(); n++)
+                {
+                    cursorRef.fieldids.push_back(currentQuery->fromColumnids[n].fieldid);
+                }
+
+                transactionPtr->sqlSelectAll(this, currentQuery->tableid,
+                                             currentQuery->locktype,
+                                             PRIMITIVE_SQLSELECTALLCURSOR,
+                                             currentQuery->results.searchResults);
+                break;
+            }
+
             transactionPtr->sqlSelectAll(this, currentQuery->tableid,
                                          currentQuery->locktype,
                                          PRIMITIVE_SQLSELECTALL,
@@ -5212,7 +5649,9 @@ void Statement::continueSelect(int64_t entrypoint, class Ast *ignorethis)
 
         currentQuery->results.selectResults[uurRef] = returnFields;
 
-        if (!transactionPtr->stagedRows.count(uurRef))
+        // unlocked rows have no lock to release, and may be projected
+        if (!transactionPtr->stagedRows.count(uurRef) &&
+            returnRowRef.locktype != NOLOCK)
         {
             stagedRow_s srow = {};
             srow.cmd=NOCOMMAND;
@@ -5282,7 +5721,7 @@ void Statement::continueUpdate(int64_t entrypoint, class Ast *ignorethis)
     case 1:
     {
         /* walk through each search result, doing update on each one
-         * and calling Ast::evaluateAssignment(fieldValues) for each
+         * and calling Expression::evaluate(fieldValues) for each
          * field to modify
          */
         currentQuery->results.updateIterator=
@@ -5294,7 +5733,7 @@ void Statement::continueUpdate(int64_t entrypoint, class Ast *ignorethis)
     case 2:
     {
         /* walk through each search result, doing update on each one
-         * and calling Ast::evaluateAssignment(fieldValues) for each
+         * and calling Expression::evaluate(fieldValues) for each
          * field to modify
          */
         if (transactionPtr->pendingcmd != NOCOMMAND)
@@ -5321,70 +5760,22 @@ void Statement::continueUpdate(int64_t entrypoint, class Ast *ignorethis)
                 currentQuery->results.updateIterator->second;
             tableRef.unmakerow((string *)&returnRowRef.row, &fieldValues);
 
-            // do update stuff
-            // boost::unordered_map<int64_t, class Ast *> fieldidAssignments
-            boost::unordered_map<int64_t, class Ast *>::iterator it;
+            // SET assignments, compiled by resolveTableFields
+            boost::unordered_map<int64_t, class Expression>::iterator it;
 
-            for (it = currentQuery->fieldidAssignments.begin();
-                 it != currentQuery->fieldidAssignments.end(); it++)
+            for (it = currentQuery->fieldidExpressions.begin();
+                 it != currentQuery->fieldidExpressions.end(); it++)
             {
-                it->second->evaluateAssignment(fieldValues, this);
-                // fieldid is it->first; class Ast * is it->second;
-                class Field &fieldRef = tableRef.fields[it->first];
                 fieldValue_s fieldValue = {};
 
-                if (it->second->operand[0]==OPERAND_NULL)
-                {
-                    fieldValue.isnull=true;
-                }
-                else
+                if (it->second.evaluate(fieldValues, parameters,
+                                        tableRef.fields[it->first].type,
+                                        fieldValue)==false)
                 {
-                    switch (fieldRef.type)
-                    {
-                    case INT:
-                        memcpy(&fieldValue.value.integer,
-                               &it->second->operand[1],
-                               sizeof(int64_t));
-                        break;
-
-                    case UINT:
-                        memcpy(&fieldValue.value.uinteger,
-                               &it->second->operand[1],
-                               sizeof(int64_t));
-                        break;
-
-                    case BOOL:
-                    {
-                        int64_t boolval;
-                        memcpy(&boolval, &it->second->operand[1],
-                               sizeof(int64_t));
-                        fieldValue.value.boolean = (bool)boolval;
-                    }
-                    break;
-
-                    case FLOAT:
-                        Ast::toFloat(it->second->operand, fieldValue);
-                        break;
-
-                    case CHAR:
-                        fieldValue.value.character=it->second->operand[1];
-                        break;
-
-                    case CHARX:
-                        fieldValue.str=it->second->operand.substr(1,
-                                                                  string::npos);
-                        break;
-
-                    case VARCHAR:
-                        fieldValue.str=it->second->operand.substr(1,
-                                                                  string::npos);
-                        break;
-
-                    default:
-                        printf("%s %i anomaly %i\n", __FILE__, __LINE__,
-                               tableRef.fields[it->first].type);
-                        return;
-                    }
+                    printf("%s %i can't assign to fieldid %li\n", __FILE__,
+                           __LINE__, it->first);
+                    abortQuery(APISTATUS_FIELD);
+                    return;
                 }
 
                 currentQuery->results.setFields[it->first]=fieldValue;
@@ -5546,8 +5937,8 @@ void Statement::startQuery()
         {
             reentry.reentryObject->results.cmdtype = CMD_SELECT;
             reentry.reentryObject->results.statementStatus = STATUS_OK;
-            reentry.reentryObject->results.selectResults =
-                currentQuery->results.selectResults;
+            reentry.reentryObject->results.selectResults.swap(
+                currentQuery->results.selectResults);
             class Table &tableRef = *schemaPtr->tables[currentQuery->tableid];
 
             for (size_t n=0; n < currentQuery->fromColumnids.size(); n++)
@@ -92,26 +92,6 @@ public:
      */
     bool evaluate(class Ast **nextAstNode,
                   class Statement *statementPtr);
-    /* evaluates for setassignment per row. does not get backgrounded */
-    /** 
-     *  evaluate assignments in UPDATE queries
-     *
-     * @param fieldValues list of values to set each row to
-     * @param statementPtr associated statement
-     */
-    void evaluateAssignment(std::vector<fieldValue_s> &fieldValues,
-                            class Statement *statementPtr);
-
-
-    /** 
-     * @brief convert 
-     *
-     * @param fieldValues 
-     * @param statementPtr 
-     */
-    void normalizeSetAssignmentOperand(vector<fieldValue_s> &fieldValues,
-                                       class Statement *statementPtr);
-
     /** 
      *  converts INTEGER to FLOAT (or leaves float alone).
      * Supports arithmetic between numbers. Parser doesn't determine type
@@ -146,6 +126,128 @@ public:
     //private:
 };
 
+/** 
+ * @brief expression compiled to a postfix program over typed values
+ *
+ * for UPDATE SET assignments. Compiled once from the resolved Ast, then
+ * evaluated per row without changing the Ast or the program, so it
+ * doesn't allocate once its stack and string buffers have grown
+ */
+class Expression
+{
+public:
+    /** 
+     * @brief instruction
+     *
+     */
+    enum opcode_e
+    {
+        OP_CONSTANT = 0,
+        OP_FIELD,
+        OP_PARAMETER,
+        OP_ADD,
+        OP_SUBTRACT,
+        OP_MULTIPLY,
+        OP_DIVIDE,
+        OP_NEGATE,
+        OP_CONCATENATE
+    };
+
+    /** 
+     * @brief value on evaluation stack
+     *
+     * type is INT, BOOL, FLOAT or VARCHAR (str and len), NOFIELDTYPE for
+     * NULL
+     */
+    struct value_s
+    {
+        fieldtype_e type;
+        fieldInput_s value;
+        const char *str;
+        size_t len;
+    };
+
+    /** 
+     * @brief program step
+     *
+     */
+    struct instruction_s
+    {
+        opcode_e opcode;
+        value_s constant; /**< OP_CONSTANT, str unset for strings */
+        int64_t arg; /**< fieldid, parameter number, or index to strings */
+        fieldtype_e fieldtype; /**< OP_FIELD */
+    };
+
+    Expression();
+    virtual ~Expression();
+
+    /** 
+     * @brief compile Ast with field names already resolved
+     *
+     * @param astPtr expression
+     * @param tableRef table fieldids refer to
+     *
+     * @return false if expression has something other than constants,
+     * fields, parameters and arithmetic or concatenation
+     */
+    bool compile(class Ast *astPtr, class Table &tableRef);
+    /** 
+     * @brief evaluate for row, converting to field's type
+     *
+     * @param row fields of row
+     * @param parameters statement parameters
+     * @param fieldtype type of field result is assigned to
+     * @param result output
+     *
+     * @return false if operand types don't fit operators or field, or
+     * division by zero
+     */
+    bool evaluate(const std::vector<fieldValue_s> &row,
+                  const std::vector<std::string> &parameters,
+                  fieldtype_e fieldtype, fieldValue_s &result);
+
+    std::vector<instruction_s> program;
+    // string constants
+    std::vector<std::string> strings;
+
+private:
+    /** 
+     * @brief called by compile recursively, children before parent
+     *
+     * @param astPtr expression
+     * @param tableRef table fieldids refer to
+     * @param depth stack depth before astPtr's value is pushed
+     *
+     * @return success (true) or failure (false)
+     */
+    bool compile2(class Ast *astPtr, class Table &tableRef, size_t depth);
+    /** 
+     * @brief apply arithmetic operator to top 2 values on stack
+     *
+     * @param opcode OP_ADD, OP_SUBTRACT, OP_MULTIPLY or OP_DIVIDE
+     * @param lhs left operand, and output
+     * @param rhs right operand
+     *
+     * @return success (true) or failure (false)
+     */
+    static bool arithmetic(opcode_e opcode, value_s &lhs, const value_s &rhs);
+    /** 
+     * @brief operand string to value
+     *
+     * @param operand operand with type embedded
+     * @param value output, strings point into operand
+     *
+     * @return false if not a constant
+     */
+    static bool decode(const std::string &operand, value_s &value);
+
+    // sized by compile to deepest point of program
+    std::vector<value_s> stack;
+    // concatenation results, one per stack slot
+    std::vector<std::string> buffers;
+};
+
 class Statement;
 typedef void(Statement::*statementfPtr)(int64_t, void *);
 
@@ -241,6 +343,8 @@ public:
         class Ast *searchCondition;
         boost::unordered_map<string, class Ast *> assignments;
         boost::unordered_map<int64_t, class Ast *> fieldidAssignments;
+        // SET assignments compiled by resolveTableFields
+        boost::unordered_map<int64_t, class Expression> fieldidExpressions;
         std::vector<class Ast *> insertColumns;
 
         std::string storedProcedure;
@@ -330,6 +434,19 @@ public:
      * @return fieldid
      */
     int64_t getfieldid(int64_t tableid, const string &fieldName);
+    /** 
+     * @brief number of parameters statement expects
+     *
+     * @return highest parameter number referenced, plus 1
+     */
+    size_t countParameters();
+    /** 
+     * @brief called by countParameters recursively on each expression
+     *
+     * @param astPtr expression
+     * @param count highest parameter number so far, plus 1
+     */
+    static void countParameters(class Ast *astPtr, size_t &count);
     /** 
      * perform search predicate query on results already gathered by this
      * transaction. saves from having to do unnecessary message traffic
@@ -360,6 +477,47 @@ public:
                       const boost::unordered_map<uuRecord_s,
                       returnRow_s> &andResults,
                       boost::unordered_map<uuRecord_s, returnRow_s> &results);
+    /** 
+     * @brief move AND conjuncts and select list to Engines
+     *
+     * walking up the ANDs predicateNode is the left side of, each right
+     * side that compares a field to a constant becomes a residual
+     * predicate and is replaced by TRUE, so the AND takes predicateNode's
+     * results as they are. Unlocked SELECTs only fetch their select list.
+     *
+     * @param predicateNode Ast node being searched by sqlPredicate
+     * @param residuals residual predicates for SELECTROWS
+     * @param projection fieldids to return, empty for all fields
+     */
+    void pushdown(class Ast *predicateNode,
+                  vector<residualPredicate_s> &residuals,
+                  vector<int64_t> &projection);
+    /** 
+     * @brief convert field-to-constant comparison to residual predicate
+     *
+     * @param conjunct Ast node
+     * @param tableRef table searched
+     * @param residual converted predicate
+     *
+     * @return false if conjunct can't be checked by Engine
+     */
+    bool residualConjunct(class Ast *conjunct, class Table &tableRef,
+                          residualPredicate_s &residual);
+    /** 
+     * @brief collect OR of equalities on a single field as an IN list
+     *
+     * so it is searched in 1 round of messages, each Engine only for
+     * the values in its partition, instead of 1 round per equality
+     *
+     * @param orNode OR Ast node
+     * @param equalities EQ Ast nodes under orNode
+     * @param values distinct constants compared to
+     *
+     * @return false if anything under orNode isn't field = constant
+     * on the same field
+     */
+    bool orEqualities(class Ast *orNode, vector<class Ast *> &equalities,
+                      vector<fieldValue_s> &values);
     /** 
      * @brief execute SQL statement
      *
@@ -471,6 +629,10 @@ public:
     std::vector<std::string> parameters;
 
     ssize_t queryindex;
+    // SELECT of a whole table leaves its rows to fetchRows()
+    bool iscursor;
+    // identifies the execution, only it fetches the cursor it opens
+    int64_t cursorowner;
 };
 
 #endif  /* INFINISQLASTS_H */
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2013 Mark Travis <mtravis15432+src@gmail.com>
+ * All rights reserved. No warranty, explicit or implicit, provided.
+ *
+ * This file is part of InfiniSQL(tm).
+
+ * InfiniSQL is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3
+ * as published by the Free Software Foundation.
+ *
+ * InfiniSQL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with InfiniSQL. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   ColumnBatch.cc
+ *
+ * @brief  batch of one column's values decoded into a contiguous array,
+ * filtered by comparison kernels into a selection bitmap
+ */
+
+#include "ColumnBatch.h"
+#line 31 "ColumnBatch.cc"
+
+/* each kernel fills a 64 byte selection block with 0 or 1 per value, which
+ * is a compare and mask the compiler vectorizes, then packs it 8 bytes at
+ * a time into the bitmap word: multiplying 8 bytes of 0/1 by this constant
+ * gathers byte n's low bit into bit 56+n, with no carries between them */
+#define PACKMAGIC 0x0102040810204080ULL
+
+static inline uint64_t packSelection(const unsigned char *selection)
+{
+    uint64_t word = 0;
+
+    for (size_t n=0; n < 8; n++)
+    {
+        uint64_t bytes;
+        memcpy(&bytes, selection + n*8, sizeof(bytes));
+        word |= ((le64toh(bytes) * PACKMAGIC) >> 56) << (n*8);
+    }
+
+    return word;
+}
+
+template <class T, class P>
+static void kernel(const T *values, size_t nvalues, P predicate,
+                   uint64_t *bitmap)
+{
+    unsigned char selection[64];
+    size_t nwords = nvalues / 64;
+
+    for (size_t w=0; w < nwords; w++)
+    {
+        const T *block = values + w*64;
+
+        for (size_t n=0; n < 64; n++)
+        {
+            selection[n] = predicate(block[n]);
+        }
+
+        bitmap[w] = packSelection(selection);
+    }
+
+    size_t remainder = nvalues % 64;
+
+    if (remainder)
+    {
+        const T *block = values + nwords*64;
+        memset(selection, 0, sizeof(selection));
+
+        for (size_t n=0; n < remainder; n++)
+        {
+            selection[n] = predicate(block[n]);
+        }
+
+        bitmap[nwords] = packSelection(selection);
+    }
+}
+
+template <class T>
+ColumnBatch<T>::ColumnBatch()
+{
+    values.reserve(COLUMNBATCHSIZE);
+    entries.reserve(COLUMNBATCHSIZE);
+    bitmap.reserve((COLUMNBATCHSIZE+63)/64);
+}
+
+template <class T>
+ColumnBatch<T>::~ColumnBatch()
+{
+}
+
+template <class T>
+void ColumnBatch<T>::clear()
+{
+    values.clear();
+    entries.clear();
+    bitmap.clear();
+}
+
+template <class T>
+bool ColumnBatch<T>::select(operatortypes_e op, T operand1, T operand2)
+{
+    bitmap.assign((values.size()+63)/64, 0);
+    const T *v = values.data();
+    size_t n = values.size();
+    uint64_t *b = bitmap.data();
+
+    switch (op)
+    {
+    case OPERATOR_EQ:
+        kernel(v, n, [=](T x) { return x == operand1; }, b);
+        break;
+
+    case OPERATOR_NE:
+        kernel(v, n, [=](T x) { return x != operand1; }, b);
+        break;
+
+    case OPERATOR_LT:
+        kernel(v, n, [=](T x) { return x < operand1; }, b);
+        break;
+
+    case OPERATOR_GT:
+        kernel(v, n, [=](T x) { return x > operand1; }, b);
+        break;
+
+    case OPERATOR_LTE:
+        kernel(v, n, [=](T x) { return x <= operand1; }, b);
+        break;
+
+    case OPERATOR_GTE:
+        kernel(v, n, [=](T x) { return x >= operand1; }, b);
+        break;
+
+    case OPERATOR_BETWEEN:
+        kernel(v, n, [=](T x) { return (x >= operand1) & (x <= operand2); },
+               b);
+        break;
+
+    case OPERATOR_NOTBETWEEN:
+        kernel(v, n, [=](T x) { return (x < operand1) | (x > operand2); },
+               b);
+        break;
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+template <class T>
+void ColumnBatch<T>::selectIn(const std::vector<T> &list, bool isnotin)
+{
+    bitmap.assign((values.size()+63)/64, 0);
+    const T *v = values.data();
+    size_t n = values.size();
+    uint64_t *b = bitmap.data();
+
+    if (list.size() <= COLUMNBATCHINSCAN)
+    {
+        /* short lists: compare each value against every list member,
+         * without branching, so the inner loop still vectorizes */
+        const T *l = list.data();
+        size_t nlist = list.size();
+        kernel(v, n, [=](T x) -> bool
+               {
+                   bool isfound = false;
+
+                   for (size_t m=0; m < nlist; m++)
+                   {
+                       isfound |= (x == l[m]);
+                   }
+
+                   return isfound != isnotin;
+               }, b);
+    }
+    else
+    {
+        std::vector<T> sorted(list);
+        std::sort(sorted.begin(), sorted.end());
+        kernel(v, n, [&](T x)
+               {
+                   return std::binary_search(sorted.begin(), sorted.end(),
+                                             x) != isnotin;
+               }, b);
+    }
+}
+
+template <class T>
+size_t ColumnBatch<T>::count()
+{
+    size_t matched = 0;
+
+    for (size_t n=0; n < bitmap.size(); n++)
+    {
+        matched += __builtin_popcountll(bitmap[n]);
+    }
+
+    return matched;
+}
+
+template <class T>
+void ColumnBatch<T>::emit(std::vector<indexEntry_s> *returnEntries)
+{
+    for (size_t w=0; w < bitmap.size(); w++)
+    {
+        uint64_t word = bitmap[w];
+
+        while (word)
+        {
+            returnEntries->push_back(entries[w*64 + __builtin_ctzll(word)]);
+            word &= word - 1;
+        }
+    }
+}
+
+template class ColumnBatch<int64_t>;
+template class ColumnBatch<uint64_t>;
+template class ColumnBatch<long double>;
+template class ColumnBatch<char>;
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2013 Mark Travis <mtravis15432+src@gmail.com>
+ * All rights reserved. No warranty, explicit or implicit, provided.
+ *
+ * This file is part of InfiniSQL(tm).
+
+ * InfiniSQL is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3
+ * as published by the Free Software Foundation.
+ *
+ * InfiniSQL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with InfiniSQL. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   ColumnBatch.h
+ *
+ * @brief  batch of one column's values decoded into a contiguous array,
+ * filtered by comparison kernels into a selection bitmap
+ */
+
+#ifndef INFINISQLCOLUMNBATCH_H
+#define INFINISQLCOLUMNBATCH_H
+
+#include "gch.h"
+
+/**
+ * @brief column values and their index entries, filtered a batch at a time
+ *
+ * Scans that have to visit every entry of an index (unordered indices for
+ * <, >, BETWEEN, and any index for <> or NOT IN) append each key and its
+ * entry here, then run one kernel over the whole batch. Kernels are
+ * branchless loops over a plain array, 64 values per bitmap word, so the
+ * compiler vectorizes them instead of branching per map node. emit()
+ * returns the entries whose bits are set.
+ *
+ * Instantiated for int64_t, uint64_t, long double and char.
+ */
+template <class T>
+class ColumnBatch
+{
+public:
+    ColumnBatch();
+    virtual ~ColumnBatch();
+
+    /**
+     * @brief add a value and the row it came from
+     *
+     * @param value field value
+     * @param rowid rowid
+     * @param engineid engineid
+     */
+    void append(T value, int64_t rowid, int16_t engineid)
+    {
+        values.push_back(value);
+        entries.push_back({rowid, engineid});
+    }
+    /**
+     * @brief number of values in batch
+     *
+     * @return size
+     */
+    size_t size()
+    {
+        return values.size();
+    }
+    /**
+     * @brief empty batch for reuse, keeping allocations
+     *
+     */
+    void clear();
+    /**
+     * @brief set bitmap for values matching =, <>, <, >, <=, >=,
+     * BETWEEN or NOT BETWEEN
+     *
+     * BETWEEN and NOT BETWEEN follow Index::between() and
+     * Index::notbetween(): lower and upper inclusive for BETWEEN,
+     * exclusive for NOT BETWEEN
+     *
+     * @param op operator
+     * @param operand1 operand, or lower bound for BETWEEN
+     * @param operand2 upper bound for BETWEEN, otherwise ignored
+     *
+     * @return false if operator has no kernel
+     */
+    bool select(operatortypes_e op, T operand1, T operand2);
+    /**
+     * @brief set bitmap for values matching IN or NOT IN list
+     *
+     * @param list values in list
+     * @param isnotin true for NOT IN
+     */
+    void selectIn(const std::vector<T> &list, bool isnotin);
+    /**
+     * @brief number of values matched by last select
+     *
+     * @return count
+     */
+    size_t count();
+    /**
+     * @brief append entries matched by last select
+     *
+     * @param returnEntries matching rows
+     */
+    void emit(std::vector<indexEntry_s> *returnEntries);
+
+    std::vector<T> values;
+    std::vector<indexEntry_s> entries;
+    std::vector<uint64_t> bitmap;
+};
+
+#endif  /* INFINISQLCOLUMNBATCH_H */
@@ -33,7 +33,7 @@
 #define EPOLLEVENTS 1024
 
 IbGateway::IbGateway(Topology::actorIdentity *myIdentityArg) :
-    fds(NULL), nfds(0), ismultinode(false)
+    epollfd(-1), ismultinode(false)
 {
     init(myIdentityArg);
     /*
@@ -70,12 +70,6 @@ IbGateway::IbGateway(Topology::actorIdentity *myIdentityArg) :
     struct addrinfo *p=NULL;
     int so_rcvbuf=16777216;
     socklen_t optlen=sizeof(so_rcvbuf);
-    inbuf=new (std::nothrow) char[so_rcvbuf];
-    if (inbuf==NULL)
-    {
-        fprintf(logfile, "%s %i malloc inbuf failed\n", __FILE__, __LINE__);
-        exit(1);
-    }
 
     for (p = servinfo; p != NULL; p = p->ai_next)
     {
@@ -120,7 +114,7 @@ IbGateway::IbGateway(Topology::actorIdentity *myIdentityArg) :
         return; /**< TODO: handle listener failure */
     }
 
-    fcntl(sockfd, F_SETFL, O_NONBLOCK==-1);
+    fcntl(sockfd, F_SETFL, O_NONBLOCK);
 
     if (listen(sockfd, 1000) == -1)
     {
@@ -132,291 +126,299 @@ IbGateway::IbGateway(Topology::actorIdentity *myIdentityArg) :
 
     socklen_t sin_size = sizeof(their_addr);
 
-    addtofds(sockfd);
+    epollfd = epoll_create(1);
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = sockfd;
 
-    dcstrsmall=new (std::nothrow) char[SERIALIZEDMAXSIZE];
-  
-    while (1)
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, sockfd, &ev) == -1)
     {
-        int eventcount = poll(fds, nfds, -1);
+        fprintf(logfile, "%s %i epoll_ctl errno %i\n", __FILE__, __LINE__, errno);
+        exit(1);
+    }
 
-        if (eventcount < 0)
-        {
-            continue;
-        }
+    struct epoll_event events[EPOLLEVENTS];
 
-        int m = 0;
+    while (1)
+    {
+        int eventcount = epoll_wait(epollfd, events, EPOLLEVENTS, -1);
 
-        for (nfds_t n=0; n < nfds; n++)
+        for (int n=0; n < eventcount; n++)
         {
-            if (m==eventcount)
-            {
-                break;
-            }
-
-            if (!fds[n].revents)
-            {
-                continue;
-            }
-
-            m++;
-            short event = fds[n].revents;
+            int fd = events[n].data.fd;
+            int event = events[n].events;
 
-            // if it's the listening socket, then accept(), otherwise
-            if (fds[n].fd==sockfd)
+            // if it's the listening socket, then accept() all, otherwise
+            if (fd==sockfd)
             {
-                if ((event & EPOLLERR) || (event & EPOLLHUP))
-                {
-                    continue;
-                }
-                else if (event & POLLIN)
+                while (1)
                 {
                     int newfd = accept(sockfd, (struct sockaddr *)&their_addr,
                                        &sin_size);
 
                     if (newfd == -1)
                     {
-                        printf("%s %i accept errno %i\n", __FILE__, __LINE__,
-                               errno);
-                        continue;
+                        if (errno != EAGAIN && errno != EWOULDBLOCK)
+                        {
+                            printf("%s %i accept errno %i\n", __FILE__,
+                                   __LINE__, errno);
+                        }
+                        break;
                     }
-                    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &so_rcvbuf,
+                    if (setsockopt(newfd, SOL_SOCKET, SO_RCVBUF, &so_rcvbuf,
                                    optlen)==-1)
                     {
                         fprintf(logfile, "%s %i setsockopt errno %i\n", __FILE__,
                                 __LINE__, errno);
-                        continue;
                     }
                     fcntl(newfd, F_SETFL, O_NONBLOCK);
-                    addtofds(newfd);
+                    connection_s &connRef=connections[newfd];
+                    connRef.capacity=SERIALIZEDMAXSIZE;
+                    connRef.data=new char[connRef.capacity];
+                    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+                    ev.data.fd = newfd;
+                    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, newfd, &ev) == -1)
+                    {
+                        fprintf(logfile, "%s %i epoll_ctl errno %i\n",
+                                __FILE__, __LINE__, errno);
+                        closeconnection(newfd);
+                        continue;
+                    }
                     if (ismultinode==false)
                     {
                         setprio();
                         ismultinode=true;
                     }
-                    continue;
                 }
+                continue;
             }
 
-            if ((event & EPOLLERR) || (event & EPOLLHUP))
+            // drain whatever arrived before any hangup, edge-triggered
+            if ((event & EPOLLIN) && readconnection(fd)==false)
             {
-                close(fds[n].fd);
-                fdremoveset.insert(fds[n].fd);
-                fprintf(logfile, "%s %i instance %li n %lu\n", __FILE__,
-                        __LINE__, myIdentity.instance, n);
-                continue;
+                continue; // closed
             }
-            else if (event & POLLIN)
-            {
-                ssize_t readed;
-                int readfd=fds[n].fd;
-
-                do
-                {
-                    readed=read(readfd, inbuf, so_rcvbuf);
-                    switch (readed)
-                    {
-                    case -1:
-                        if (errno==EAGAIN || errno==EWOULDBLOCK)
-                        {
-                            if (pendingReads.count(readfd))
-                            {
-                                string &strRef=pendingReads[readfd];
-                                size_t pos=0;
-                                while (pos < strRef.size())
-                                {
-                                    if (sizeof(size_t)>(size_t)(strRef.size()-
-                                                                pos))
-                                    { // can't even read size of message group
-                                        break;
-                                    }
-                                    size_t packagesize=*(size_t *)(strRef.c_str()+
-                                                                   pos);
-                                    if (packagesize > strRef.size()-pos)
-                                    { // can't read next message group entirely
-                                        break;
-                                    }
-                                    inbufhandler(strRef.c_str()+pos, packagesize);
-                                    pos += packagesize;
-                                }
-                                if (pos<strRef.size())
-                                { // background the remainder
-                                    string newstr(strRef, pos, string::npos);
-                                    strRef.swap(newstr);
-                                }
-                                else
-                                {
-                                    strRef.clear();
-                                }
-                            }
-                        }
-                        else
-                        {
-                            close(readfd);
-                            fdremoveset.insert(readfd);
-                            pendingReads.erase(readfd);
-                            break;
-                        }
-                        break;
-              
-                    case 0:
-                        close(readfd);
-                        fdremoveset.insert(readfd);
-                        pendingReads.erase(readfd);
-                        break;
-              
-                    default:
-                    {
-                        if (pendingReads.count(readfd))
-                        {
-                            pendingReads[readfd].append(inbuf, readed);
-                        }
-                        else
-                        {
-                            size_t pos=0;
-                            while (pos < (size_t)readed)
-                            {
-                                if (sizeof(size_t)>(size_t)(readed-pos))
-                                { // can't even read size of message group
-                                    break;
-                                }
-                                size_t packagesize=*(size_t *)(inbuf+pos);
-                                if (packagesize > readed-pos)
-                                { // can't read next message group entirely
-                                    break;
-                                }
-                                inbufhandler(inbuf+pos, packagesize);
-                                pos += packagesize;
-                            }
-                            if (pos<(size_t)readed)
-                            { // background the remainder
-                                pendingReads[readfd].assign(inbuf+pos,
-                                                            readed-pos);
-                            }
-                        }
-                    }
-                    }
-                }
-                while (readed > 0);
 
+            if (event & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+            {
+                fprintf(logfile, "%s %i instance %li fd %i events %i\n",
+                        __FILE__, __LINE__, myIdentity.instance, fd, event);
+                closeconnection(fd);
             }
         }
-
-        removefds();
     }
 }
 
 IbGateway::~IbGateway()
 {
-    delete inbuf;
-    delete dcstrsmall;
+    while (!connections.empty())
+    {
+        closeconnection(connections.begin()->first);
+    }
+    close(epollfd);
 }
 
-// have read everything before processing
-void IbGateway::inbufhandler(const char *buf, size_t bufsize)
+bool IbGateway::readconnection(int fd)
 {
-    char *inbuf;
-    size_t inbufsize;
-    char *dcstr;
-    char *dcstrbig;
-    bool isdcstrbig=false;
-  
-    if (cfgs.compressgw==true)
-    { // SERIALIZEDMAXSIZE
-        int bs=SERIALIZEDMAXSIZE;
-        dcstr=dcstrsmall;
-        while (1)
+    connection_s &connRef=connections[fd];
+
+    while (1)
+    {
+        struct iovec iov[2];
+        ssize_t readed=readv(fd, iov, ringspace(connRef, iov));
+
+        if (readed==-1)
         {
-            ssize_t dcsize=LZ4_decompress_safe(buf+sizeof(bufsize), dcstr,
-                                       bufsize-sizeof(bufsize), bs);
-            if (dcsize < 0)
+            if (errno==EINTR)
             {
-                if (isdcstrbig==true)
-                {
-                    delete dcstrbig;
-                }
-                else
-                {
-                    isdcstrbig=true;
-                }
-                bs *= 2;
-                dcstrbig=new (std::nothrow) char[bs];
-                dcstr=dcstrbig;
                 continue;
             }
-            inbuf=dcstr;
-            inbufsize=dcsize;
-            break;
+            if (errno==EAGAIN || errno==EWOULDBLOCK)
+            {
+                return true;
+            }
+            closeconnection(fd);
+            return false;
+        }
+        if (readed==0)
+        {
+            closeconnection(fd);
+            return false;
+        }
+
+        connRef.used += readed;
+        if (parseconnection(fd, connRef)==false)
+        {
+            return false;
         }
     }
-    else
-    {
-        inbuf=(char *)buf;
-        inbufsize=bufsize;
+}
+
+int IbGateway::ringspace(connection_s &connRef, struct iovec *iov)
+{
+    if (connRef.used==connRef.capacity)
+    { // a frame bigger than the ring is arriving
+        growconnection(connRef, 2*connRef.capacity);
     }
-  
-    size_t pos=sizeof(size_t); // i already know the whole size, it's bufsize
-    while (pos<inbufsize)
+
+    // free space is [start+used, capacity) then [0, start)
+    size_t wpos=(connRef.start+connRef.used) % connRef.capacity;
+    size_t free=connRef.capacity-connRef.used;
+    iov[0].iov_base=connRef.data+wpos;
+    iov[0].iov_len=std::min(free, connRef.capacity-wpos);
+    iov[1].iov_base=connRef.data;
+    iov[1].iov_len=free-iov[0].iov_len;
+
+    return iov[1].iov_len ? 2 : 1;
+}
+
+bool IbGateway::parseconnection(int fd, connection_s &connRef)
+{
+    const char *frame;
+    size_t framesize;
+    int rv;
+
+    while ((rv=nextframe(connRef, wrapbuf, &frame, &framesize))==1)
     {
-        size_t s=*(size_t *)(inbuf+pos);
-        pos += sizeof(s);
-        string *serstr=new string(inbuf+pos, s);
-        pos += s;
-        class MessageSerialized *msgsnd=new class MessageSerialized(serstr);
-        mboxes.toActor(msgsnd->messageStruct.sourceAddr,
-                       msgsnd->messageStruct.destAddr, *msgsnd);
+        inbufhandler(fd, frame, framesize);
     }
 
-    if (isdcstrbig==true)
+    if (rv==-1)
     {
-        delete[] dcstrbig;
+        fprintf(logfile, "%s %i frame size %lu too small, closing %i\n",
+                __FILE__, __LINE__, (unsigned long)framesize, fd);
+        closeconnection(fd);
+        return false;
     }
+
+    return true;
 }
 
-void IbGateway::addtofds(int newfd)
+int IbGateway::nextframe(connection_s &connRef, std::string &wrapbufRef,
+                         const char **frame, size_t *framesize)
 {
-    struct pollfd *newfds = new struct pollfd[++nfds];
-
-    for (nfds_t n=0; n < nfds-1; n++)
+    if (connRef.used < sizeof(size_t))
     {
-        newfds[n] = fds[n];
+        if (!connRef.used)
+        { // keep following frames contiguous as long as possible
+            connRef.start=0;
+        }
+        return 0;
     }
 
-    newfds[nfds-1] = {newfd, EPOLLIN | EPOLLERR | EPOLLHUP, 0};
+    size_t header;
+    ringcopy(connRef, connRef.start, sizeof(header), (char *)&header);
+    size_t packagesize=header & ~GWFRAMECOMPRESSED;
+    *framesize=packagesize;
 
-    if (fds != NULL)
+    if (packagesize < sizeof(header))
+    { // would never advance past it
+        return -1;
+    }
+    if (packagesize > connRef.capacity)
     {
-        delete fds;
+        growconnection(connRef, packagesize);
+    }
+    if (packagesize > connRef.used)
+    { // can't read next message group entirely
+        return 0;
     }
 
-    fds = newfds;
-}
-
-void IbGateway::removefds()
-{
-    if (!fdremoveset.size())
+    if (connRef.start+packagesize <= connRef.capacity)
     {
-        return;
+        *frame=connRef.data+connRef.start;
     }
+    else
+    { // frame wraps around the end of the ring
+        wrapbufRef.resize(packagesize);
+        ringcopy(connRef, connRef.start, packagesize, &wrapbufRef[0]);
+        *frame=wrapbufRef.c_str();
+    }
+
+    // still readable until the ring is next written
+    connRef.start=(connRef.start+packagesize) % connRef.capacity;
+    connRef.used -= packagesize;
 
-    struct pollfd *newfds = new struct pollfd[nfds - fdremoveset.size()];
+    return 1;
+}
 
-    nfds_t m=0;
+void IbGateway::ringcopy(connection_s &connRef, size_t pos, size_t len,
+                         char *out)
+{
+    size_t first=std::min(len, connRef.capacity-pos);
+    memcpy(out, connRef.data+pos, first);
+    memcpy(out+first, connRef.data, len-first);
+}
 
-    for (nfds_t n=0; n < nfds - fdremoveset.size(); n++)
+void IbGateway::growconnection(connection_s &connRef, size_t capacity)
+{
+    char *newdata=new char[capacity];
+    ringcopy(connRef, connRef.start, connRef.used, newdata);
+    delete[] connRef.data;
+    connRef.data=newdata;
+    connRef.capacity=capacity;
+    connRef.start=0;
+}
+
+void IbGateway::closeconnection(int fd)
+{
+    close(fd); // also leaves epollfd
+    boost::unordered_map<int, connection_s>::iterator it=connections.find(fd);
+    if (it != connections.end())
     {
-        if (!fdremoveset.count(fds[n].fd))
+        delete[] it->second.data;
+        connections.erase(it);
+    }
+    fprintf(logfile, "%s %i instance %li closed fd %i connections %lu\n",
+            __FILE__, __LINE__, myIdentity.instance, fd, connections.size());
+}
+
+// have read everything before processing
+void IbGateway::inbufhandler(int fd, const char *buf, size_t bufsize)
+{
+    const char *inbuf;
+    size_t inbufsize;
+    size_t header=*(size_t *)buf;
+  
+    if (header & GWFRAMECOMPRESSED)
+    { // [framesize, rawsize, lz4 block against previous block's tail]
+        size_t rawsize=*(size_t *)(buf+sizeof(header));
+        size_t hdrsize=2*sizeof(size_t);
+        dcbuf.resize(rawsize);
+        string &dictRef=connections[fd].lz4dict;
+        int dcsize=LZ4_decompress_safe_usingDict(buf+hdrsize, &dcbuf[0],
+                                                 bufsize-hdrsize, rawsize,
+                                                 dictRef.data(),
+                                                 dictRef.size());
+        if (dcsize < 0 || (size_t)dcsize != rawsize)
         {
-            newfds[m++] = fds[n];
+            fprintf(logfile, "%s %i LZ4_decompress_safe_usingDict %i rawsize %lu fd %i\n",
+                    __FILE__, __LINE__, dcsize, rawsize, fd);
+            return;
         }
+        // same history sender's LZ4_saveDict kept
+        size_t dictsize=std::min(rawsize, (size_t)GWLZ4DICTSIZE);
+        dictRef.assign(dcbuf, rawsize-dictsize, dictsize);
+        inbuf=dcbuf.c_str();
+        inbufsize=rawsize;
+    }
+    else
+    {
+        inbuf=buf;
+        inbufsize=bufsize;
+    }
+  
+    size_t pos=sizeof(size_t); // i already know the whole size, it's bufsize
+    while (pos<inbufsize)
+    {
+        size_t s=*(size_t *)(inbuf+pos);
+        pos += sizeof(s);
+        string *serstr=new string(inbuf+pos, s);
+        pos += s;
+        class MessageSerialized *msgsnd=new class MessageSerialized(serstr);
+        mboxes.toActor(msgsnd->messageStruct.sourceAddr,
+                       msgsnd->messageStruct.destAddr, *msgsnd);
     }
-
-    delete fds;
-    fds = newfds;
-    nfds -= fdremoveset.size();
-    fdremoveset.clear();
-    fprintf(logfile, "%s %i instance %li removefds nfds %lu\n", __FILE__,
-            __LINE__, myIdentity.instance, nfds);
 }
 
 // launcher, regular function
@@ -56,32 +56,104 @@ public:
     class Topology myTopology;
     */
 
+    /** 
+     * @brief ring buffer of bytes read from one remote ObGateway
+     *
+     * frames are handed to inbufhandler() in place unless they wrap
+     * around the end, data holds used bytes starting at start
+     */
+    struct connection_s
+    {
+        char *data;
+        size_t capacity;
+        size_t start;
+        size_t used;
+        std::string lz4dict; /**< tail of last decompressed frame */
+
+        connection_s() : data(NULL), capacity(0), start(0), used(0)
+        {
+        }
+    };
+
+    /** 
+     * @brief free space of ring as iovecs for readv, doubling a full ring
+     *
+     * @param connRef connection
+     * @param iov 2 iovecs to fill
+     *
+     * @return number of iovecs used
+     */
+    static int ringspace(connection_s &connRef, struct iovec *iov);
+    /** 
+     * @brief take next complete frame off ring
+     *
+     * frame points into ring, or into wrapbufRef if it wraps, and stays
+     * valid until ring is next written
+     *
+     * @param connRef connection
+     * @param wrapbufRef holds frame that wraps around end of ring
+     * @param frame returned frame
+     * @param framesize returned frame size, also set if malformed
+     *
+     * @return 1 frame returned, 0 incomplete, -1 header smaller than itself
+     */
+    static int nextframe(connection_s &connRef, std::string &wrapbufRef,
+                         const char **frame, size_t *framesize);
+    /** 
+     * @brief copy bytes out of ring, following wraparound
+     *
+     * @param connRef connection
+     * @param pos position in ring
+     * @param len bytes to copy
+     * @param out destination
+     */
+    static void ringcopy(connection_s &connRef, size_t pos, size_t len,
+                         char *out);
+    /** 
+     * @brief reallocate ring, unwrapping its contents to the start
+     *
+     * @param connRef connection
+     * @param capacity new capacity
+     */
+    static void growconnection(connection_s &connRef, size_t capacity);
+
 private:
     /** 
-     * @brief process compressed batch of incoming messages
+     * @brief process batch of incoming messages, decompressing if flagged
      *
+     * @param fd socket batch arrived on, selects lz4 stream history
      * @param buf incoming message buffer
      * @param bufsize buffer size
      */
-    void inbufhandler(const char *buf, size_t bufsize);
+    void inbufhandler(int fd, const char *buf, size_t bufsize);
+    /** 
+     * @brief readv into connection's free space until socket is drained
+     *
+     * @param fd socket
+     *
+     * @return false if connection was closed
+     */
+    bool readconnection(int fd);
     /** 
-     * @brief add file descriptor to remote ObGateway to poll structure
+     * @brief hand every complete frame in ring to inbufhandler()
+     *
+     * @param fd socket
+     * @param connRef connection
      *
-     * @param newfd socket descriptor
+     * @return false if connection was closed on a malformed frame
      */
-    void addtofds(int newfd);
+    bool parseconnection(int fd, connection_s &connRef);
     /** 
-     * @brief remove file descriptors from poll struct
+     * @brief close socket and free its connection
      *
+     * @param fd socket
      */
-    void removefds();
+    void closeconnection(int fd);
 
-    boost::unordered_map<int, std::string> pendingReads;
-    boost::unordered_set<int> fdremoveset;
-    struct pollfd *fds;
-    nfds_t nfds;
-    char *inbuf;
-    char *dcstrsmall;
+    boost::unordered_map<int, connection_s> connections;
+    int epollfd;
+    std::string dcbuf;
+    std::string wrapbuf;
     bool ismultinode;
 };
 
@@ -1502,21 +1502,8 @@ void Index::getnotequal(int64_t input, vector<indexEntry_s> *returnEntries)
     break;
 
     case unorderedint:
-    {
-        unorderedIntMap::iterator it;
-
-        for (it=unorderedIntIndex->begin(); it != unorderedIntIndex->end(); ++it)
-        {
-            if (it->first != input)
-            {
-                indexEntry_s entry;
-                entry.rowid = it->second.rowid;
-                entry.engineid = it->second.engineid;
-                returnEntries->push_back(entry);
-            }
-        }
-    }
-    break;
+        batchScan(unorderedIntIndex, OPERATOR_NE, input, input, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -1561,22 +1548,8 @@ void Index::getnotequal(uint64_t input, vector<indexEntry_s> *returnEntries)
     break;
 
     case unordereduint:
-    {
-        unorderedUintMap::iterator it;
-
-        for (it=unorderedUintIndex->begin(); it != unorderedUintIndex->end();
-             ++it)
-        {
-            if (it->first != input)
-            {
-                indexEntry_s entry;
-                entry.rowid = it->second.rowid;
-                entry.engineid = it->second.engineid;
-                returnEntries->push_back(entry);
-            }
-        }
-    }
-    break;
+        batchScan(unorderedUintIndex, OPERATOR_NE, input, input, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -1682,22 +1655,9 @@ void Index::getnotequal(long double input, vector<indexEntry_s> *returnEntries)
     break;
 
     case unorderedfloat:
-    {
-        unorderedFloatMap::iterator it;
-
-        for (it=unorderedFloatIndex->begin(); it != unorderedFloatIndex->end();
-             ++it)
-        {
-            if (it->first != input)
-            {
-                indexEntry_s entry;
-                entry.rowid = it->second.rowid;
-                entry.engineid = it->second.engineid;
-                returnEntries->push_back(entry);
-            }
-        }
-    }
-    break;
+        batchScan(unorderedFloatIndex, OPERATOR_NE, input, input,
+                  returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -1742,22 +1702,8 @@ void Index::getnotequal(char input, vector<indexEntry_s> *returnEntries)
     break;
 
     case unorderedchar:
-    {
-        unorderedCharMap::iterator it;
-
-        for (it=unorderedCharIndex->begin(); it != unorderedCharIndex->end();
-             ++it)
-        {
-            if (it->first != input)
-            {
-                indexEntry_s entry;
-                entry.rowid = it->second.rowid;
-                entry.engineid = it->second.engineid;
-                returnEntries->push_back(entry);
-            }
-        }
-    }
-    break;
+        batchScan(unorderedCharIndex, OPERATOR_NE, input, input, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -1951,10 +1897,8 @@ void Index::comparison(int64_t input, operatortypes_e op,
     break;
 
     case unorderedint:
-    {
-        return; // unordered_map isn't sorted
-    }
-    break;
+        batchScan(unorderedIntIndex, op, input, input, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -2072,10 +2016,8 @@ void Index::comparison(uint64_t input, operatortypes_e op,
     break;
 
     case unordereduint:
-    {
-        return;
-    }
-    break;
+        batchScan(unorderedUintIndex, op, input, input, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -2276,10 +2218,8 @@ void Index::comparison(long double input, operatortypes_e op,
     break;
 
     case unorderedfloat:
-    {
-        return;
-    }
-    break;
+        batchScan(unorderedFloatIndex, op, input, input, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -2360,10 +2300,8 @@ void Index::comparison(char input, operatortypes_e op,
     break;
 
     case unorderedchar:
-    {
-        return;
-    }
-    break;
+        batchScan(unorderedCharIndex, op, input, input, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -2596,6 +2534,11 @@ void Index::between(int64_t lower, int64_t upper,
     }
     break;
 
+    case unorderedint:
+        batchScan(unorderedIntIndex, OPERATOR_BETWEEN, lower, upper,
+                  returnEntries);
+        break;
+
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
     }
@@ -2655,6 +2598,11 @@ void Index::between(uint64_t lower, uint64_t upper,
     }
     break;
 
+    case unordereduint:
+        batchScan(unorderedUintIndex, OPERATOR_BETWEEN, lower, upper,
+                  returnEntries);
+        break;
+
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
     }
@@ -2728,6 +2676,11 @@ void Index::between(long double lower, long double upper,
     }
     break;
 
+    case unorderedfloat:
+        batchScan(unorderedFloatIndex, OPERATOR_BETWEEN, lower, upper,
+                  returnEntries);
+        break;
+
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
     }
@@ -2794,6 +2747,11 @@ void Index::between(char lower, char upper, vector<indexEntry_s> *returnEntries)
     }
     break;
 
+    case unorderedchar:
+        batchScan(unorderedCharIndex, OPERATOR_BETWEEN, lower, upper,
+                  returnEntries);
+        break;
+
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
     }
@@ -3069,84 +3027,16 @@ void Index::getnotin(vector<int64_t> &entries,
     switch (indexmaptype)
     {
     case uniqueint:
-    {
-        uniqueIntMap::iterator it;
-
-        for (it = uniqueIntIndex->begin(); it != uniqueIntIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(uniqueIntIndex, entries, true, returnEntries);
+        break;
 
     case unorderedint:
-    {
-        unorderedIntMap::iterator it;
-
-        for (it = unorderedIntIndex->begin(); it != unorderedIntIndex->end();
-             ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(unorderedIntIndex, entries, true, returnEntries);
+        break;
 
     case nonuniqueint:
-    {
-        nonuniqueIntMap::iterator it;
-
-        for (it = nonuniqueIntIndex->begin(); it != nonuniqueIntIndex->end();
-             ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(nonuniqueIntIndex, entries, true, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -3159,84 +3049,16 @@ void Index::getnotin(vector<uint64_t> &entries,
     switch (indexmaptype)
     {
     case uniqueuint:
-    {
-        uniqueUintMap::iterator it;
-
-        for (it = uniqueUintIndex->begin(); it != uniqueUintIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(uniqueUintIndex, entries, true, returnEntries);
+        break;
 
     case unordereduint:
-    {
-        unorderedUintMap::iterator it;
-
-        for (it = unorderedUintIndex->begin();
-             it != unorderedUintIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(unorderedUintIndex, entries, true, returnEntries);
+        break;
 
     case nonuniqueuint:
-    {
-        nonuniqueUintMap::iterator it;
-
-        for (it = nonuniqueUintIndex->begin(); it != nonuniqueUintIndex->end();
-             ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(nonuniqueUintIndex, entries, true, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -3339,84 +3161,16 @@ void Index::getnotin(vector<long double> &entries,
     switch (indexmaptype)
     {
     case uniquefloat:
-    {
-        uniqueFloatMap::iterator it;
-
-        for (it = uniqueFloatIndex->begin(); it != uniqueFloatIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(uniqueFloatIndex, entries, true, returnEntries);
+        break;
 
     case unorderedfloat:
-    {
-        unorderedFloatMap::iterator it;
-
-        for (it = unorderedFloatIndex->begin();
-             it != unorderedFloatIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(unorderedFloatIndex, entries, true, returnEntries);
+        break;
 
     case nonuniquefloat:
-    {
-        nonuniqueFloatMap::iterator it;
-
-        for (it = nonuniqueFloatIndex->begin();
-             it != nonuniqueFloatIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(nonuniqueFloatIndex, entries, true, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -3429,84 +3183,16 @@ void Index::getnotin(vector<char> &entries,
     switch (indexmaptype)
     {
     case uniquechar:
-    {
-        uniqueCharMap::iterator it;
-
-        for (it = uniqueCharIndex->begin(); it != uniqueCharIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(uniqueCharIndex, entries, true, returnEntries);
+        break;
 
     case unorderedchar:
-    {
-        unorderedCharMap::iterator it;
-
-        for (it = unorderedCharIndex->begin();
-             it != unorderedCharIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(unorderedCharIndex, entries, true, returnEntries);
+        break;
 
     case nonuniquechar:
-    {
-        nonuniqueCharMap::iterator it;
-
-        for (it = nonuniqueCharIndex->begin();
-             it != nonuniqueCharIndex->end(); ++it)
-        {
-            bool isfound=false;
-
-            for (size_t n=0; n < entries.size(); n++)
-            {
-                if (entries[n] == it->first)
-                {
-                    isfound=true;
-                    break;
-                }
-            }
-
-            if (isfound==false)
-            {
-                returnEntries->push_back({it->second.rowid,
-                            it->second.engineid});
-            }
-        }
-    }
-    break;
+        batchScanIn(nonuniqueCharIndex, entries, true, returnEntries);
+        break;
 
     default:
         fprintf(logfile, "anomaly %i %s %i\n", indexmaptype, __FILE__, __LINE__);
@@ -29,6 +29,7 @@
 #define INFINISQLINDEX_H
 
 #include "gch.h"
+#include "ColumnBatch.h"
 
 /** 
  * @brief value for UNIQUE (potentially locking) indices
@@ -1152,6 +1153,80 @@ public:
     int64_t getprevioussubtransactionid(char val);
     int64_t getprevioussubtransactionid(string &val);
 
+    /** 
+     * @brief return entries matching comparison or BETWEEN, scanning the
+     * whole map through ColumnBatch kernels
+     *
+     * for maps that can't be searched by range: unordered maps, and any
+     * map for <>
+     *
+     * @param mapPtr map to search
+     * @param op operator
+     * @param operand1 operand, or lower bound for BETWEEN
+     * @param operand2 upper bound for BETWEEN
+     * @param returnEntries matching rows
+     */
+    template <class M, class T>
+        void batchScan(M *mapPtr, operatortypes_e op, T operand1, T operand2,
+                       vector<indexEntry_s> *returnEntries)
+    {
+        ColumnBatch<T> batch;
+        typename M::iterator it = mapPtr->begin();
+
+        while (it != mapPtr->end())
+        {
+            batch.clear();
+
+            for (; it != mapPtr->end() && batch.size() < COLUMNBATCHSIZE;
+                 ++it)
+            {
+                batch.append(it->first, it->second.rowid,
+                             it->second.engineid);
+            }
+
+            if (batch.select(op, operand1, operand2)==false)
+            {
+                fprintf(logfile, "anomaly: %i %s %i\n", op, __FILE__,
+                        __LINE__);
+                return;
+            }
+
+            batch.emit(returnEntries);
+        }
+    }
+
+    /** 
+     * @brief return entries matching IN or NOT IN list, scanning the
+     * whole map through ColumnBatch kernels
+     *
+     * @param mapPtr map to search
+     * @param list IN list
+     * @param isnotin true for NOT IN
+     * @param returnEntries matching rows
+     */
+    template <class M, class T>
+        void batchScanIn(M *mapPtr, vector<T> &list, bool isnotin,
+                         vector<indexEntry_s> *returnEntries)
+    {
+        ColumnBatch<T> batch;
+        typename M::iterator it = mapPtr->begin();
+
+        while (it != mapPtr->end())
+        {
+            batch.clear();
+
+            for (; it != mapPtr->end() && batch.size() < COLUMNBATCHSIZE;
+                 ++it)
+            {
+                batch.append(it->first, it->second.rowid,
+                             it->second.engineid);
+            }
+
+            batch.selectIn(list, isnotin);
+            batch.emit(returnEntries);
+        }
+    }
+
     /** 
      * @brief set iterators part of regex query
      *
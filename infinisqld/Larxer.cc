@@ -595,7 +595,7 @@ void Larxer::consumeSelect(string &columns)
             {
                 currentQuery->locktype=NOLOCK;
             }
-
+            else
             {
                 currentQuery->locktype=READLOCK;
             }
@@ -22,177 +22,28 @@
  * @author Mark Travis <mtravis15432+src@gmail.com>
  * @date   Tue Dec 17 13:27:04 2013
  * 
- * @brief  On each host, this actor accepts new connections and distributes
- * incoming network traffic from clients to Transaction Agents.
+ * @brief  On each host, this actor stands for the client listening
+ * addresses.
  * 
- * There is only one listener per host. It takes a small amount of coding
- * effort to allow for multiple listeners per host. But no workload as yet
- * (benchmarked on 12-core Xeon) has been shown to warrant multiple listeners.
- * It's very possible that larger hosts may benefit from distributing
- * incoming TCP/IP traffic across multiple listeners, and the effort to allow
- * that won't be difficult to implement.
+ * There is only one listener per host, but it no longer accepts anything.
+ * TopologyMgr publishes its nodes and services in the topology, and each
+ * Transaction Agent binds its own SO_REUSEPORT sockets to them, so that the
+ * kernel spreads new connections across Transaction Agents and each one
+ * handles accept and read readiness for its connections in its own thread.
+ * startsocket() is shared with them.
  */
 
 #include "Listener.h"
 #line 38 "Listener.cc"
 
-#define EPOLLEVENTS 1024
-
 Listener::Listener(Topology::actorIdentity *myIdentityArg)
 {
     init(myIdentityArg);
-    /*
-    delete myIdentityArg;
-    mboxes.nodeid = myIdentity.address.nodeid;
-    mboxes.update(myTopology);
-    */
-
-    int listenersockfd = startsocket(myIdentity.nodes[0], myIdentity.services[0]);
-    int pglistenersockfd = startsocket(myIdentity.nodes[1],
-                                       myIdentity.services[1]);
-    struct epoll_event ev;
-    ev.events = EPOLLIN | EPOLLHUP | EPOLLET;
-    ev.data.fd = listenersockfd;
-
-    if (epoll_ctl(myIdentity.epollfd, EPOLL_CTL_ADD, listenersockfd, &ev) == -1)
-    {
-        fprintf(logfile, "%s %i epoll_ctl errno %i\n", __FILE__, __LINE__, errno);
-    }
-
-    ev.data.fd = pglistenersockfd;
 
-    if (epoll_ctl(myIdentity.epollfd, EPOLL_CTL_ADD, pglistenersockfd, &ev) == -1)
-    {
-        fprintf(logfile, "%s %i epoll_ctl errno %i\n", __FILE__, __LINE__, errno);
-    }
-
-    struct sockaddr_in their_addr; // connector's address information
-
-    socklen_t sin_size = sizeof(their_addr);
-
-    int roundrobin = 0;
-
-    struct epoll_event events[EPOLLEVENTS];
-
-    socketAffinity.resize(NUMSOCKETS+1, 0);
-    listenerTypes.resize(NUMSOCKETS+1, LISTENER_NONE);
-
-    class MboxProducer *producer=NULL;
-    listenertype_e listenertype=LISTENER_NONE;
-  
+    // nothing to do but drain topology updates
     while (1)
     {
-        int eventcount = epoll_wait(myIdentity.epollfd, events, EPOLLEVENTS, -1);
-
-        for (int n=0; n < eventcount; n++)
-        {
-            int fd = events[n].data.fd;
-            int event = events[n].events;
-
-            if (fd==listenersockfd || fd==pglistenersockfd)
-            {
-                if (fd==listenersockfd)
-                {
-                    if (event & EPOLLIN)
-                    {
-                        int newfd = accept(fd, (struct sockaddr *)&their_addr,
-                                           &sin_size);
-
-                        if (newfd == -1)
-                        {
-                            printf("%s %i accept errno %i\n", __FILE__, __LINE__,
-                                   errno);
-                            break;
-                        }
-                        if (newfd > NUMSOCKETS)
-                        {
-                            fprintf(logfile, "%s %i fd %i > %i\n", __FILE__,
-                                    __LINE__, newfd,
-                                    NUMSOCKETS);
-                            close(newfd);
-                            continue;
-                        }
-
-                        fcntl(newfd, F_SETFL, O_NONBLOCK);
-                        int optval = 1;
-                        setsockopt(newfd, SOL_SOCKET, SO_KEEPALIVE, &optval,
-                                   sizeof(optval));
-                        ev.data.fd = newfd;
-                        pthread_mutex_lock(&connectionsMutex);
-                        socketAffinity[newfd]=
-                            mboxes.transactionAgentPtrs[roundrobin++ %
-                                                        myTopology.numtransactionagents];
-                        listenerTypes[newfd]=LISTENER_RAW;
-                        pthread_mutex_unlock(&connectionsMutex);
-                        epoll_ctl(myIdentity.epollfd, EPOLL_CTL_ADD, newfd, &ev);
-                    }
-                }
-                else if (fd==pglistenersockfd)
-                {
-                    //          if (event & EPOLLIN)
-                    while (1)
-                    {
-                        int newfd = accept(fd, (struct sockaddr *)&their_addr,
-                                           &sin_size);
-
-                        if (newfd == -1)
-                        {
-                            if (errno != EAGAIN && errno != EWOULDBLOCK)
-                            {
-                                printf("%s %i accept errno %i\n", __FILE__,
-                                       __LINE__, errno);
-                            }
-                            else
-                            {
-                                break;
-                            }
-                        }
-                        if (newfd > NUMSOCKETS)
-                        {
-                            fprintf(logfile, "%s %i fd %i > %i\n", __FILE__,
-                                    __LINE__, newfd, NUMSOCKETS);
-                            close(newfd);
-                            continue;
-                        }
-
-                        fcntl(newfd, F_SETFL, O_NONBLOCK);
-                        int optval = 1;
-                        setsockopt(newfd, SOL_SOCKET, SO_KEEPALIVE, &optval,
-                                   sizeof(optval));
-                        ev.data.fd = newfd;
-                        pthread_mutex_lock(&connectionsMutex);
-                        socketAffinity[newfd]=
-                            mboxes.transactionAgentPtrs[roundrobin++ %
-                                                        myTopology.numtransactionagents];
-                        listenerTypes[newfd]=LISTENER_PG;
-                        pthread_mutex_unlock(&connectionsMutex);
-                        epoll_ctl(myIdentity.epollfd, EPOLL_CTL_ADD, newfd, &ev);
-                        socketAffinity[newfd]->sendMsg(*(new class MessageSocket(newfd, 0, listenerTypes[newfd], myIdentity.address.nodeid, TOPIC_SOCKETCONNECTED)));
-                    }
-                }
-            }
-            else
-            { // already established socket activity
-                pthread_mutex_lock(&connectionsMutex);
-                if (socketAffinity[fd])
-                {
-                    producer=socketAffinity[fd];
-                    listenertype=listenerTypes[fd];
-                }
-                else
-                {
-                    pthread_mutex_unlock(&connectionsMutex);
-                    fprintf(logfile, "%s %i event %i on spurious sockfd %i\n", __FILE__,
-                            __LINE__, event, fd);
-                    continue;
-                }
-                pthread_mutex_unlock(&connectionsMutex);
-                producer->sendMsg(*(new class MessageSocket(fd, event,
-                                                            listenertype,
-                                                            myIdentity.address.nodeid,
-                                                            TOPIC_SOCKET)));
-            }
-        }
+        getmsg(-1);
     }
 }
 
@@ -210,7 +61,7 @@ void *listener(void *identity)
     return NULL;
 }
 
-int Listener::startsocket(string &node, string &service)
+int Listener::startsocket(const string &node, const string &service)
 {
     struct addrinfo hints = {};
     hints.ai_family = AF_INET;
@@ -260,6 +111,15 @@ int Listener::startsocket(string &node, string &service)
             continue;
         }
 
+        // every TransactionAgent binds the same address
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes))==-1)
+        {
+            close(sockfd);
+            fprintf(logfile, "%s %i setsockopt errno %i\n", __FILE__, __LINE__,
+                    errno);
+            continue;
+        }
+
         if (bind(sockfd, p->ai_addr, p->ai_addrlen)==-1)
         {
             close(sockfd);
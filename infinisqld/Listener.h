@@ -22,15 +22,15 @@
  * @author Mark Travis <mtravis15432+src@gmail.com>
  * @date   Tue Dec 17 13:29:01 2013
  * 
- * @brief  On each host, this actor accepts new connections and distributes
- * incoming network traffic from clients to Transaction Agents.
+ * @brief  On each host, this actor stands for the client listening
+ * addresses.
  * 
- * There is only one listener per host. It takes a small amount of coding
- * effort to allow for multiple listeners per host. But no workload as yet
- * (benchmarked on 12-core Xeon) has been shown to warrant multiple listeners.
- * It's very possible that larger hosts may benefit from distributing
- * incoming TCP/IP traffic across multiple listeners, and the effort to allow
- * that won't be difficult to implement.
+ * There is only one listener per host, but it no longer accepts anything.
+ * TopologyMgr publishes its nodes and services in the topology, and each
+ * Transaction Agent binds its own SO_REUSEPORT sockets to them, so that the
+ * kernel spreads new connections across Transaction Agents and each one
+ * handles accept and read readiness for its connections in its own thread.
+ * startsocket() is shared with them.
  */
 
 #ifndef INFINISQLLISTENER_H
@@ -51,14 +51,16 @@ public:
     virtual ~Listener();
 
     /** 
-     * @brief create listening socket
+     * @brief create non-blocking SO_REUSEPORT listening socket
+     *
+     * called by each TransactionAgent for the same node and service
      *
      * @param node hostname or ipv4 address
      * @param service TCP port or service name
      *
-     * @return 
+     * @return socket descriptor, -1 on failure
      */
-    int startsocket(string &node, string &service);
+    static int startsocket(const string &node, const string &service);
 
     //private:
     /*
@@ -29,12 +29,19 @@
 #include "gch.h"
 #include "Mbox.h"
 #include <time.h>
-#line 33 "Mbox.cc"
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#line 36 "Mbox.cc"
 
 /** lockfree producer adapted from:
- * http://www.cs.rochester.edu/research/synchronization/pseudocode/queues.html */
+ * http://www.cs.rochester.edu/research/synchronization/pseudocode/queues.html
+ * or, with MBOXVYUKOV, intrusive MPSC queue from:
+ * http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+ */
 
-Mbox::Mbox() : counter(8888)
+Mbox::Mbox() : actortype(ACTOR_NONE), wakefd(-1), load(0), counter(8888),
+               parked(0), batchMsg(NULL)
 {
     firstMsg = new class Message();
     firstMsg->messageStruct.payloadtype = PAYLOADNONE;
@@ -42,10 +49,13 @@ Mbox::Mbox() : counter(8888)
     currentMsg = firstMsg;
     lastMsg = firstMsg;
     myLastMsg = firstMsg;
+#ifdef MBOXVYUKOV
+    firstMsg->nextmsg = 0;
+    vtail = firstMsg;
+#endif
 
     head = getInt128FromPointer(firstMsg, 10000);
     tail = head;
-    current = head;
     mytail = head;
 
     pthread_mutexattr_t attr;
@@ -55,54 +65,227 @@ Mbox::Mbox() : counter(8888)
 
 Mbox::~Mbox()
 {
-    delete firstMsg;
+    releaseBatch();
+    // firstMsg is already gone once anything has been received
+    class Message *msg = currentMsg;
+
+    while (msg != NULL)
+    {
+        class Message *nextmsg = getNext(msg);
+        delete msg;
+        msg = nextmsg;
+    }
 }
 
 // return *message, NULL if timeout or nothing
-// timeout: -1, wait forever (well, uncertain effect)
+// timeout: -1, wait forever
 // timeout: 0, do not wait
 // timeout: >0, microseconds to wait
-//size_t Mbox::receive(class Message *msg, int timeout)
+// spins cfgs.mboxspin[actortype] times before parking on futex
 class Message *Mbox::receive(int timeout)
 {
-    __int128 mynext;
+    class Message *mynext;
+    int64_t spins = 0;
+    bool hasparked = false;
+
+    releaseBatch();
 
     while (1)
     {
-        mynext = __atomic_load_n(&(getPtr(current)->nextmsg), __ATOMIC_SEQ_CST);
+        mynext = getNext(currentMsg);
 
-        if (getPtr(mynext)==NULL)
+        if (mynext==NULL)
         {
-            switch (timeout)
+            if (timeout==0 || (hasparked==true && timeout > 0))
             {
-            case -1:
-                break;
-
-            case 0:
                 return NULL;
-                break;
+            }
 
-            default:
-                struct timespec ts = {0, timeout * 1000};
-                nanosleep(&ts, NULL);
-                return NULL;
+            if (spins++ < __atomic_load_n(&cfgs.mboxspin[actortype],
+                                          __ATOMIC_RELAXED))
+            {
+                __builtin_ia32_pause();
+                continue;
             }
+
+            park(timeout);
+            hasparked = true;
         }
         else
         {
-            if (getPtr(current)==getPtr(mynext))
+            if (currentMsg==mynext)
             {
-                printf("%s %i WTF found it i guess count current %lu next %lu\n",
-                       __FILE__, __LINE__, getCount(current), getCount(mynext));
+                printf("%s %i WTF found it i guess current %p next %p\n",
+                       __FILE__, __LINE__, currentMsg, mynext);
             }
 
-            delete getPtr(current);
-            current = mynext;
-            return getPtr(current);      
+            delete currentMsg;
+            currentMsg = mynext;
+            return currentMsg;
         }
     }
 }
 
+size_t Mbox::receiveBatch(class Message **out, size_t max, int timeout)
+{
+    if (max==0)
+    {
+        return 0;
+    }
+
+    class Message *msg = receive(timeout);
+
+    if (msg==NULL)
+    {
+        return 0;
+    }
+
+    // current stays the last message handed out, as with receive()
+    batchMsg = msg;
+    out[0] = msg;
+    size_t n = 1;
+
+    while (n < max)
+    {
+        class Message *mynext = getNext(currentMsg);
+
+        if (mynext==NULL)
+        {
+            break;
+        }
+
+        currentMsg = mynext;
+        out[n++] = currentMsg;
+    }
+
+    return n;
+}
+
+void Mbox::releaseBatch()
+{
+    while (batchMsg != NULL && batchMsg != currentMsg)
+    {
+        class Message *nextmsg = getNext(batchMsg);
+        delete batchMsg;
+        batchMsg = nextmsg;
+    }
+
+    batchMsg = NULL;
+}
+
+void Mbox::park(int timeout)
+{
+    // declare sleeping, then check queue again so that a producer which
+    // enqueued before seeing parked==1 is not missed
+    __atomic_store_n(&parked, 1, __ATOMIC_SEQ_CST);
+
+    if (getNext(currentMsg)==NULL)
+    {
+        if (timeout < 0)
+        {
+            syscall(SYS_futex, &parked, FUTEX_WAIT_PRIVATE, 1, NULL, NULL, 0);
+        }
+        else
+        {
+            struct timespec ts = {timeout / 1000000,
+                                  (timeout % 1000000) * 1000};
+            syscall(SYS_futex, &parked, FUTEX_WAIT_PRIVATE, 1, &ts, NULL, 0);
+        }
+    }
+
+    __atomic_store_n(&parked, 0, __ATOMIC_SEQ_CST);
+}
+
+int Mbox::pollwait(int epollfd, struct epoll_event *events, int maxevents,
+                   int timeout)
+{
+    int64_t spins = 0;
+
+    while (timeout != 0 && getNext(currentMsg)==NULL &&
+           spins++ < __atomic_load_n(&cfgs.mboxspin[actortype],
+                                     __ATOMIC_RELAXED))
+    {
+        __builtin_ia32_pause();
+    }
+
+    // same protocol as park(), but sleeping in epoll_wait on wakefd
+    __atomic_store_n(&parked, 1, __ATOMIC_SEQ_CST);
+
+    int mstimeout = 0;
+
+    if (timeout != 0 && getNext(currentMsg)==NULL)
+    {
+        mstimeout = timeout < 0 ? -1 : (timeout + 999) / 1000;
+    }
+
+    int eventcount = epoll_wait(epollfd, events, maxevents, mstimeout);
+    __atomic_store_n(&parked, 0, __ATOMIC_SEQ_CST);
+
+    if (eventcount < 0)
+    {
+        if (errno != EINTR)
+        {
+            fprintf(logfile, "%s %i epoll_wait errno %i\n", __FILE__,
+                    __LINE__, errno);
+        }
+
+        return 0;
+    }
+
+    int n = 0;
+
+    for (int m=0; m < eventcount; m++)
+    {
+        if (events[m].data.fd==wakefd)
+        {
+            uint64_t count;
+
+            if (read(wakefd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+            {
+                fprintf(logfile, "%s %i read errno %i\n", __FILE__, __LINE__,
+                        errno);
+            }
+
+            continue;
+        }
+
+        events[n++] = events[m];
+    }
+
+    return n;
+}
+
+void Mbox::wakeup()
+{
+    if (__atomic_load_n(&parked, __ATOMIC_SEQ_CST) &&
+        __atomic_exchange_n(&parked, 0, __ATOMIC_SEQ_CST))
+    {
+        if (wakefd >= 0)
+        {
+            uint64_t count = 1;
+
+            if (write(wakefd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+            {
+                fprintf(logfile, "%s %i write errno %i\n", __FILE__, __LINE__,
+                        errno);
+            }
+        }
+        else
+        {
+            syscall(SYS_futex, &parked, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+        }
+    }
+}
+
+class Message *Mbox::getNext(class Message *msg)
+{
+#ifdef MBOXVYUKOV
+    return __atomic_load_n((class Message **)&msg->nextmsg, __ATOMIC_SEQ_CST);
+#else
+    return getPtr(__atomic_load_n(&msg->nextmsg, __ATOMIC_SEQ_CST));
+#endif
+}
+
 __int128 Mbox::getInt128FromPointer(class Message *ptr, uint64_t count)
 {
     __int128 i128;
@@ -145,11 +328,12 @@ void MboxProducer::sendMsg(class Message &msgsnd)
             obBatchMsg=new class MessageBatchSerialized(nodeid);
         }
         obBatchMsg->msgbatch[obBatchMsg->nmsgs++]=
-            {msgsnd.messageStruct.destAddr.nodeid, msgsnd.sermsg()};
+            {msgsnd.messageStruct.destAddr.nodeid, obBatchMsg->arena.size()};
+        msgsnd.sermsg(obBatchMsg->arena);
         delete &msgsnd;
         if (obBatchMsg->nmsgs==OBGWMSGBATCHSIZE)
         {
-            mboxes->sendObBatch();
+            sendObBatch();
         }
         return;
     }
@@ -158,7 +342,17 @@ void MboxProducer::sendMsg(class Message &msgsnd)
         msgptr=&msgsnd;
     }
     class Message &msg=*msgptr;
-  
+
+#ifdef MBOXVYUKOV
+    msg.nextmsg = 0;
+    // swing tail to msg, then link previous tail. Consumer sees an empty
+    // queue until the link is stored, same as an in-progress MS enqueue
+    class Message *prev = __atomic_exchange_n(&mbox->vtail, &msg,
+                                              __ATOMIC_SEQ_CST);
+    __atomic_store_n((class Message **)&prev->nextmsg, &msg,
+                     __ATOMIC_SEQ_CST);
+    mbox->wakeup();
+#else
     msg.nextmsg = Mbox::getInt128FromPointer(NULL, 5555);
 
     __int128 mytail;
@@ -188,6 +382,18 @@ void MboxProducer::sendMsg(class Message &msgsnd)
     }
 
     __atomic_compare_exchange_n(&mbox->tail, &mytail, Mbox::getInt128FromPointer(&msg, __atomic_add_fetch(&mbox->counter, 1, __ATOMIC_SEQ_CST)), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    mbox->wakeup();
+#endif
+}
+
+void MboxProducer::sendObBatch()
+{
+    if (obBatchMsg != NULL)
+    {
+        class MessageBatchSerialized *batch=obBatchMsg;
+        obBatchMsg=NULL;
+        sendMsg(*batch); // batch is addressed to this node
+    }
 }
 
 Mboxes::Mboxes() : Mboxes(0)
@@ -198,8 +404,7 @@ Mboxes::Mboxes(int64_t nodeidarg) : nodeid(nodeidarg),
                                     topologyMgrPtr(NULL),
                                     userSchemaMgrLocation (),
                                     deadlockMgrLocation (),
-                                    listenerPtr(NULL),
-                                    obGatewayPtr (NULL)
+                                    listenerPtr(NULL)
 {
     topologyMgr.mbox = NULL;
     userSchemaMgr.mbox = NULL;
@@ -236,6 +441,7 @@ void Mboxes::update(class Topology &top, int64_t myActorid)
     actoridToProducers.resize(top.actorList.size(), NULL);
     transactionAgentPtrs.resize(top.numtransactionagents, NULL);
     enginePtrs.resize(top.numengines, NULL);
+    obGatewayPtrs.resize(top.numobgateways, NULL);
 
     for (size_t n=0; n < top.actorList.size(); n++)
     {
@@ -287,11 +493,8 @@ void Mboxes::update(class Topology &top, int64_t myActorid)
                 break;
 
             case ACTOR_OBGATEWAY:
-                if ((int64_t)(myActorid % top.numobgateways) ==
-                    top.actorList[n].instance)
-                {
-                    obGatewayPtr = actoridToProducers[n];
-                }
+                obGatewayPtrs[top.actorList[n].instance] =
+                    actoridToProducers[n];
                 break;
           
             case ACTOR_NONE:
@@ -322,7 +525,8 @@ void Mboxes::update(class Topology &top, int64_t myActorid)
             }
             else
             {
-                partitionToProducers[n].destmbox = obGatewayPtr;
+                partitionToProducers[n].destmbox =
+                    obGatewayFor(partitionToProducers[n].address.actorid);
             }
         }
     }
@@ -355,10 +559,20 @@ void Mboxes::toActor(const Topology::addressStruct &source,
     }
     else
     {
-        obGatewayPtr->sendMsg(msg);
+        obGatewayFor(dest.actorid)->sendMsg(msg);
     }
 }
 
+class MboxProducer *Mboxes::obGatewayFor(int16_t actorid)
+{
+    if (obGatewayPtrs.empty())
+    {
+        return NULL;
+    }
+
+    return obGatewayPtrs[actorid % obGatewayPtrs.size()];
+}
+
 void Mboxes::toUserSchemaMgr(const Topology::addressStruct &source,
                              class Message &msg)
 {
@@ -550,12 +764,11 @@ int64_t Mboxes::toAllOfTypeThisReplica(actortypes_e type,
 
 void Mboxes::sendObBatch()
 {
-    if (obGatewayPtr != NULL)
+    for (size_t n=0; n < obGatewayPtrs.size(); n++)
     {
-        if (obGatewayPtr->obBatchMsg != NULL)
+        if (obGatewayPtrs[n] != NULL)
         {
-            obGatewayPtr->sendMsg(*obGatewayPtr->obBatchMsg);
-            obGatewayPtr->obBatchMsg=NULL;
+            obGatewayPtrs[n]->sendObBatch();
         }
     }
 }
@@ -31,6 +31,7 @@
 
 #include "Message.h"
 #include "Topology.h"
+#include "defs.h"
 
 using std::vector;
 using std::string;
@@ -42,6 +43,10 @@ using std::string;
  * adapted from:
  * http://www.cs.rochester.edu/research/synchronization/pseudocode/queues.html
  *
+ * building with -DMBOXVYUKOV (configure --enable-vyukov-mbox) replaces the
+ * 128bit CAS enqueue with an intrusive Vyukov MPSC queue: one pointer
+ * exchange on the tail per message, no shared counter
+ *
  */
 class Mbox
 {
@@ -52,11 +57,52 @@ public:
     /** 
      * @brief consume a Message
      *
+     * spins up to cfgs.mboxspin[actortype] times on an empty queue, then
+     * parks on a futex until a producer wakes it or timeout expires
+     *
      * @param timeout timeout in microseconds
      *
      * @return Message object
      */
     class Message *receive(int timeout);
+    /** 
+     * @brief consume all ready Message objects, up to max
+     *
+     * waits for the first one like receive(), then walks the chain of
+     * already linked messages without spinning or parking again. Returned
+     * messages stay valid until the next receive() or receiveBatch().
+     *
+     * @param out array to fill with Message objects
+     * @param max size of out
+     * @param timeout timeout in microseconds, as in receive()
+     *
+     * @return number of Message objects put in out
+     */
+    size_t receiveBatch(class Message **out, size_t max, int timeout);
+    /** 
+     * @brief wake consumer if it is parked in receive()
+     *
+     * called by producer after each enqueue. Only makes the futex syscall
+     * if the consumer has declared itself asleep.
+     */
+    void wakeup();
+    /** 
+     * @brief wait for a Message or for events on an epoll set
+     *
+     * for a consumer that also owns sockets. Spins like receive(), then
+     * sleeps in epoll_wait. Producers wake it through wakefd, which must be
+     * in epollfd, instead of the futex. Its event is consumed here and not
+     * returned.
+     *
+     * @param epollfd epoll descriptor containing wakefd
+     * @param events array to fill with epoll events
+     * @param maxevents size of events
+     * @param timeout timeout in microseconds, as in receive()
+     *
+     * @return number of events put in events
+     */
+    int pollwait(int epollfd, struct epoll_event *events, int maxevents,
+                 int timeout);
 
     /** 
      * @brief create 128bit integer from Message object
@@ -83,23 +129,63 @@ public:
      * @return count
      */
     static uint64_t getCount(__int128 i128);
+    /** 
+     * @brief return Message linked after msg, or NULL
+     *
+     * @param msg Message in queue
+     *
+     * @return next Message
+     */
+    static class Message *getNext(class Message *msg);
 
     friend class MboxProducer;
 
+    actortypes_e actortype;
+    // eventfd written by wakeup() instead of the futex, -1 if unused
+    int wakefd;
+    // load score published by the consumer, read by its peers for placement,
+    // padded off the fields above
+    char loadpad[CACHELINESIZE];
+    int64_t load;
+
 private:
+    /** 
+     * @brief block on futex until woken by producer
+     *
+     * @param timeout timeout in microseconds, -1 for forever
+     */
+    void park(int timeout);
+    /** 
+     * @brief delete messages handed out by previous receiveBatch()
+     *
+     */
+    void releaseBatch();
+
+    // producers write tail and counter (or vtail, with MBOXVYUKOV) and read
+    // parked; consumer owns currentMsg and the fields after it. padding keeps
+    // each group on its own cache lines however Mbox is allocated
+    char tailpad[CACHELINESIZE];
+#ifdef MBOXVYUKOV
+    class Message *vtail;
+#endif
+    __int128 tail;
+    uint64_t counter;
+    char counterpad[CACHELINESIZE];
+    // futex word, 1 when consumer is asleep or about to be
+    int32_t parked;
+    char parkedpad[CACHELINESIZE];
+    class Message *currentMsg;
+    char currentpad[CACHELINESIZE];
+
     pthread_mutex_t mutexLast;
 
     class Message *firstMsg;
-    class Message *currentMsg;
     class Message *lastMsg;
     class Message *myLastMsg; // not to be modified by producer
+    class Message *batchMsg; // 1st of previous batch, freed up to current
 
     __int128 head;
-    __int128 tail;
-    __int128 current;
     __int128 mytail;
-
-    uint64_t counter;
 };
 
 /** 
@@ -123,6 +209,10 @@ public:
      * @param msgsnd Message
      */
     void sendMsg(class Message &msgsnd);
+    /** 
+     * @brief send pending batch of Message objects destined to remote nodes
+     */
+    void sendObBatch();
 
     class Mbox *mbox;
     int16_t nodeid;
@@ -233,6 +323,17 @@ public:
      * @brief send batched Message objects destined to remote nodes
      */
     void sendObBatch();
+    /** 
+     * @brief ObGateway lane for a remote actor
+     *
+     * lanes are sharded by destination actorid, so messages to any one
+     * remote actor keep their order
+     *
+     * @param actorid destination actorid
+     *
+     * @return ObGateway producer
+     */
+    class MboxProducer *obGatewayFor(int16_t actorid);
 
     int64_t nodeid;
 
@@ -253,7 +354,8 @@ public:
     location_s userSchemaMgrLocation;
     location_s deadlockMgrLocation;
     class MboxProducer *listenerPtr;
-    class MboxProducer *obGatewayPtr;
+    // obGatewayPtrs[instance], one lane per ObGateway
+    std::vector<class MboxProducer *> obGatewayPtrs;
 
     std::vector<location_s> partitionToProducers;
     // allActors[nodeid][actorid] = actortype
@@ -38,6 +38,16 @@ Message::~Message()
 {
 }
 
+void *Message::operator new(size_t size)
+{
+    return MessagePool::allocate(size);
+}
+
+void Message::operator delete(void *ptr)
+{
+    MessagePool::deallocate(ptr);
+}
+
 size_t Message::size()
 {
     return SerializedMessage::sersize(messageStruct);
@@ -194,6 +204,76 @@ string *Message::sermsg()
     return serstr;
 }
 
+/** 
+ * @brief size variant once, then package it in place at end of arena
+ *
+ * @param msg Message variant
+ * @param arena buffer to append to
+ */
+template < class T >
+static void serframe(T &msg, string &arena)
+{
+    size_t s=msg.size();
+    class SerializedMessage serobj(&arena, sizeof(s)+s);
+    serobj.ser(sizeof(s), &s);
+    msg.package(serobj);
+    if (serobj.pos != serobj.size)
+    {
+        fprintf(logfile, "%s %i ser %i size %lu pos %lu\n", __FILE__, __LINE__,
+                msg.messageStruct.payloadtype, serobj.size, serobj.pos);
+    }
+}
+
+void Message::sermsg(string &arena)
+{
+    switch (messageStruct.payloadtype)
+    {
+    case PAYLOADMESSAGE:
+        serframe(*this, arena);
+        break;
+
+    case PAYLOADSOCKET:
+        serframe(*(class MessageSocket *)this, arena);
+        break;
+
+    case PAYLOADUSERSCHEMA:
+        serframe(*(class MessageUserSchema *)this, arena);
+        break;
+
+    case PAYLOADDEADLOCK:
+        serframe(*(class MessageDeadlock *)this, arena);
+        break;
+
+    case PAYLOADSUBTRANSACTION:
+        serframe(*(class MessageSubtransactionCmd *)this, arena);
+        break;
+
+    case PAYLOADCOMMITROLLBACK:
+        serframe(*(class MessageCommitRollback *)this, arena);
+        break;
+
+    case PAYLOADDISPATCH:
+        serframe(*(class MessageDispatch *)this, arena);
+        break;
+
+    case PAYLOADACKDISPATCH:
+        serframe(*(class MessageAckDispatch *)this, arena);
+        break;
+
+    case PAYLOADAPPLY:
+        serframe(*(class MessageApply *)this, arena);
+        break;
+
+    case PAYLOADACKAPPLY:
+        serframe(*(class MessageAckApply *)this, arena);
+        break;
+
+    default:
+        printf("%s %i anomaly %i\n", __FILE__, __LINE__,
+               messageStruct.payloadtype);
+    }
+}
+
 void Message::setEnvelope(const Topology::addressStruct &source,
                           const Topology::addressStruct &dest,
                           class Message &msg)
@@ -202,14 +282,14 @@ void Message::setEnvelope(const Topology::addressStruct &source,
     msg.messageStruct.destAddr = dest;
 }
 
-MessageSocket::MessageSocket()
+MessageSocket::MessageSocket() : pgPtr(NULL)
 {
 }
 
 MessageSocket::MessageSocket(int socketarg, uint32_t eventsarg,
                              listenertype_e listenertypearg, int64_t nodeidarg,
                              topic_e topicarg) :
-    socketStruct({socketarg, eventsarg, listenertypearg})
+    socketStruct({socketarg, eventsarg, listenertypearg}), pgPtr(NULL)
 {
     messageStruct.topic=topicarg;
     messageStruct.payloadtype=PAYLOADSOCKET;
@@ -253,6 +333,7 @@ void MessageSocket::clear()
 {
     Message::clear();
     socketStruct={};
+    pgPtr=NULL;
 }
 
 MessageUserSchema::MessageUserSchema()
@@ -430,7 +511,8 @@ void MessageTransaction::clear()
 }
 
 MessageSubtransactionCmd::MessageSubtransactionCmd() :
-    subtransactionStruct (), fieldVal ()
+    subtransactionStruct (), fieldVal (), rowpos(0), indexhitspos(0),
+    returnrowspos(0)
 {
 }
 
@@ -440,6 +522,9 @@ MessageSubtransactionCmd::~MessageSubtransactionCmd()
 
 size_t MessageSubtransactionCmd::size()
 {
+    getRow();
+    getIndexHits();
+    getReturnRows();
     return MessageTransaction::size() +
         SerializedMessage::sersize(subtransactionStruct) +
         SerializedMessage::sersize(row) +
@@ -464,6 +549,9 @@ string *MessageSubtransactionCmd::ser()
 
 void MessageSubtransactionCmd::package(class SerializedMessage &serobj)
 {
+    getRow();
+    getIndexHits();
+    getReturnRows();
     MessageTransaction::package(serobj);
     serobj.ser(subtransactionStruct);
     serobj.ser(row);
@@ -496,6 +584,67 @@ void MessageSubtransactionCmd::clear()
     searchParameters={};
     rowids.clear();
     returnRows.clear();
+    viewdata.reset();
+    rowpos=0;
+    indexhitspos=0;
+    returnrowspos=0;
+}
+
+void MessageSubtransactionCmd::unpackView(SerializedMessage &serobj)
+{
+    MessageTransaction::unpack(serobj);
+    serobj.des(subtransactionStruct);
+    rowpos=serobj.pos;
+    serobj.skip(1);
+    serobj.des(fieldVal);
+    indexhitspos=serobj.pos;
+    serobj.skip(sizeof(nonLockingIndexEntry_s));
+    serobj.des(searchParameters);
+    serobj.des(rowids);
+    // returnRows is last, nothing to skip to
+    returnrowspos=serobj.pos;
+    serobj.pos=serobj.size;
+    viewdata.reset(serobj.data);
+    serobj.data=NULL;
+}
+
+std::string &MessageSubtransactionCmd::getRow()
+{
+    if (rowpos)
+    {
+        SerializedMessage serobj(viewdata.get());
+        serobj.pos=rowpos;
+        serobj.des(row);
+        rowpos=0;
+    }
+
+    return row;
+}
+
+std::vector<nonLockingIndexEntry_s> &MessageSubtransactionCmd::getIndexHits()
+{
+    if (indexhitspos)
+    {
+        SerializedMessage serobj(viewdata.get());
+        serobj.pos=indexhitspos;
+        serobj.des(indexHits);
+        indexhitspos=0;
+    }
+
+    return indexHits;
+}
+
+std::vector<returnRow_s> &MessageSubtransactionCmd::getReturnRows()
+{
+    if (returnrowspos)
+    {
+        SerializedMessage serobj(viewdata.get());
+        serobj.pos=returnrowspos;
+        serobj.des(returnRows);
+        returnrowspos=0;
+    }
+
+    return returnRows;
 }
 
 MessageCommitRollback::MessageCommitRollback()
@@ -793,6 +942,13 @@ SerializedMessage::SerializedMessage(string *dataarg) : pos(0), data(dataarg)
     size=data->size();
 }
 
+SerializedMessage::SerializedMessage(string *arenaarg, size_t sizearg) :
+    pos(arenaarg->size()), data(arenaarg)
+{
+    size=pos+sizearg;
+    data->resize(size);
+}
+
 SerializedMessage::~SerializedMessage()
 {
 }
@@ -817,6 +973,13 @@ void SerializedMessage::des(size_t s, void *dataptr)
     pos += s;
 }
 
+void SerializedMessage::skip(size_t elementsize)
+{
+    size_t s;
+    des((int64_t *)&s);
+    pos += s * elementsize;
+}
+
 //pods
 void SerializedMessage::ser(int64_t d)
 {
@@ -1286,10 +1449,9 @@ void SerializedMessage::des(MessageDispatch::record_s &d)
 void SerializedMessage::ser(vector<nonLockingIndexEntry_s> &d)
 {
     ser((int64_t)d.size());
-    vector<nonLockingIndexEntry_s>::iterator it;
-    for (it=d.begin(); it != d.end(); ++it)
+    if (!d.empty())
     {
-        ser(*it);
+        ser(d.size() * sizeof(nonLockingIndexEntry_s), &d[0]);
     }
 }
 
@@ -1303,12 +1465,12 @@ void SerializedMessage::des(vector<nonLockingIndexEntry_s> &d)
 {
     size_t s;
     des((int64_t *)&s);
-    d.reserve(s);
-    for (size_t n=0; n<s; n++)
+    // entries are packed PODs, copy them in one go
+    size_t first=d.size();
+    d.resize(first+s);
+    if (s)
     {
-        nonLockingIndexEntry_s val;
-        des(val);
-        d.push_back(val);
+        des(s * sizeof(nonLockingIndexEntry_s), &d[first]);
     }
 }
 
@@ -1364,23 +1526,51 @@ void SerializedMessage::des(vector<fieldValue_s> &d)
     }
 }
 
+/** 
+ * @brief fixed part of returnRow_s in flat vector layout
+ *
+ * layout is: count, count x returnrowflat_s, row bytes. rowend is the end
+ * of the row's bytes, so the records double as offset table
+ */
+struct __attribute__ ((__packed__)) returnrowflat_s
+{
+    int64_t rowid;
+    int64_t previoussubtransactionid;
+    int8_t locktype;
+    int64_t rowend;
+};
+
 void SerializedMessage::ser(vector<returnRow_s> &d)
 {
-    ser((int64_t)d.size());
-    vector<returnRow_s>::iterator it;
-    for (it=d.begin(); it != d.end(); ++it)
+    size_t s=d.size();
+    ser((int64_t)s);
+    if (!s)
     {
-        ser(*it);
+        return;
+    }
+    returnrowflat_s *flat=(returnrowflat_s *)&data->at(pos);
+    pos += s * sizeof(*flat);
+    char *rows=&(*data)[0]+pos; // may be empty, so no at()
+    size_t rowend=0;
+    for (size_t n=0; n<s; n++)
+    {
+        returnRow_s &rowRef=d[n];
+        memcpy(rows+rowend, rowRef.row.c_str(), rowRef.row.size());
+        rowend += rowRef.row.size();
+        returnrowflat_s f={rowRef.rowid, rowRef.previoussubtransactionid,
+                           (int8_t)rowRef.locktype, (int64_t)rowend};
+        memcpy(flat+n, &f, sizeof(f));
     }
+    pos += rowend;
 }
 
 size_t SerializedMessage::sersize(vector<returnRow_s> &d)
 {
-    size_t retval=sizeof(int64_t);
+    size_t retval=sizeof(int64_t) + d.size()*sizeof(returnrowflat_s);
     vector<returnRow_s>::iterator it;
     for (it = d.begin(); it != d.end(); ++it)
     {
-        retval += sersize(*it);
+        retval += it->row.size();
     }
     return retval;
 }
@@ -1389,13 +1579,28 @@ void SerializedMessage::des(vector<returnRow_s> &d)
 {
     size_t s;
     des((int64_t *)&s);
-    d.reserve(s);
+    if (!s)
+    {
+        return;
+    }
+    const returnrowflat_s *flat=(const returnrowflat_s *)&data->at(pos);
+    pos += s * sizeof(*flat);
+    const char *rows=data->c_str()+pos;
+    size_t first=d.size();
+    d.resize(first+s);
+    size_t rowstart=0;
     for (size_t n=0; n<s; n++)
     {
-        returnRow_s val;
-        des(val);
-        d.push_back(val);
+        returnrowflat_s f;
+        memcpy(&f, flat+n, sizeof(f));
+        returnRow_s &rowRef=d[first+n];
+        rowRef.rowid=f.rowid;
+        rowRef.previoussubtransactionid=f.previoussubtransactionid;
+        rowRef.locktype=(locktype_e)f.locktype;
+        rowRef.row.assign(rows+rowstart, f.rowend-rowstart);
+        rowstart=f.rowend;
     }
+    pos += rowstart;
 }
 
 void SerializedMessage::ser(vector<MessageDispatch::record_s> &d)
@@ -1497,16 +1702,68 @@ void SerializedMessage::des(MessageApply::applyindex_s &d)
 }
 
 // level 3
+void SerializedMessage::ser(residualPredicate_s &d)
+{
+    ser(d.fieldid);
+    ser((int8_t)d.op);
+    ser(d.value);
+}
+
+size_t SerializedMessage::sersize(residualPredicate_s &d)
+{
+    return sersize(d.fieldid)+sersize((int8_t)d.op)+sersize(d.value);
+}
+
+void SerializedMessage::des(residualPredicate_s &d)
+{
+    des(&d.fieldid);
+    des((int8_t *)&d.op);
+    des(d.value);
+}
+
+void SerializedMessage::ser(vector<residualPredicate_s> &d)
+{
+    ser((int64_t)d.size());
+    for (size_t n=0; n < d.size(); n++)
+    {
+        ser(d[n]);
+    }
+}
+
+size_t SerializedMessage::sersize(vector<residualPredicate_s> &d)
+{
+    size_t retval=sizeof(int64_t);
+    for (size_t n=0; n < d.size(); n++)
+    {
+        retval += sersize(d[n]);
+    }
+    return retval;
+}
+
+void SerializedMessage::des(vector<residualPredicate_s> &d)
+{
+    size_t s;
+    des((int64_t *)&s);
+    d.resize(s);
+    for (size_t n=0; n<s; n++)
+    {
+        des(d[n]);
+    }
+}
+
 void SerializedMessage::ser(searchParams_s &d)
 {
     ser((int8_t)d.op);
     ser(d.values);
     ser(d.regexString);
+    ser(d.residuals);
+    ser(d.projection);
 }
 
 size_t SerializedMessage::sersize(searchParams_s &d)
 {
-    return sersize((int8_t)d.op)+sersize(d.values)+sersize(d.regexString);
+    return sersize((int8_t)d.op)+sersize(d.values)+sersize(d.regexString)+
+        sersize(d.residuals)+sersize(d.projection);
 }
 
 void SerializedMessage::des(searchParams_s &d)
@@ -1514,25 +1771,70 @@ void SerializedMessage::des(searchParams_s &d)
     des((int8_t *)&d.op);
     des(d.values);
     des(d.regexString);
+    des(d.residuals);
+    des(d.projection);
 }
 
+/** 
+ * @brief fixed part of rowOrField_s in flat vector layout
+ *
+ * layout is: count, count x roflat_s, fieldVal.str bytes. strend is the
+ * end of the field's string bytes, so the records double as offset table
+ */
+struct __attribute__ ((__packed__)) roflat_s
+{
+    int8_t isrow;
+    int16_t tableid;
+    int64_t rowid;
+    int16_t fieldid;
+    int16_t engineid;
+    int8_t deleteindexentry;
+    int8_t isnotaddunique;
+    int8_t isreplace;
+    int64_t newrowid;
+    int16_t newengineid;
+    fieldInput_s value;
+    int8_t isnull;
+    int64_t strend;
+};
+
 void SerializedMessage::ser(vector<rowOrField_s> &d)
 {
-    ser((int64_t)d.size());
-    vector<rowOrField_s>::iterator it;
-    for (it=d.begin(); it != d.end(); ++it)
+    size_t s=d.size();
+    ser((int64_t)s);
+    if (!s)
     {
-        ser(*it);
+        return;
     }
+    roflat_s *flat=(roflat_s *)&data->at(pos);
+    pos += s * sizeof(*flat);
+    char *strs=&(*data)[0]+pos; // may be empty, so no at()
+    size_t strend=0;
+    for (size_t n=0; n<s; n++)
+    {
+        rowOrField_s &rofRef=d[n];
+        std::string &strRef=rofRef.fieldVal.str;
+        memcpy(strs+strend, strRef.c_str(), strRef.size());
+        strend += strRef.size();
+        roflat_s f={(int8_t)rofRef.isrow, rofRef.tableid, rofRef.rowid,
+                    rofRef.fieldid, rofRef.engineid,
+                    (int8_t)rofRef.deleteindexentry,
+                    (int8_t)rofRef.isnotaddunique, (int8_t)rofRef.isreplace,
+                    rofRef.newrowid, rofRef.newengineid,
+                    rofRef.fieldVal.value, (int8_t)rofRef.fieldVal.isnull,
+                    (int64_t)strend};
+        memcpy(flat+n, &f, sizeof(f));
+    }
+    pos += strend;
 }
 
 size_t SerializedMessage::sersize(vector<rowOrField_s> &d)
 {
-    size_t retval=sizeof(int64_t);
+    size_t retval=sizeof(int64_t) + d.size()*sizeof(roflat_s);
     vector<rowOrField_s>::iterator it;
     for (it = d.begin(); it != d.end(); ++it)
     {
-        retval += sersize(*it);
+        retval += it->fieldVal.str.size();
     }
     return retval;
 }
@@ -1541,13 +1843,37 @@ void SerializedMessage::des(vector<rowOrField_s> &d)
 {
     size_t s;
     des((int64_t *)&s);
-    d.reserve(s);
+    if (!s)
+    {
+        return;
+    }
+    const roflat_s *flat=(const roflat_s *)&data->at(pos);
+    pos += s * sizeof(*flat);
+    const char *strs=data->c_str()+pos;
+    size_t first=d.size();
+    d.resize(first+s);
+    size_t strstart=0;
     for (size_t n=0; n<s; n++)
     {
-        rowOrField_s val;
-        des(val);
-        d.push_back(val);
+        roflat_s f;
+        memcpy(&f, flat+n, sizeof(f));
+        rowOrField_s &rofRef=d[first+n];
+        rofRef.isrow=f.isrow;
+        rofRef.tableid=f.tableid;
+        rofRef.rowid=f.rowid;
+        rofRef.fieldid=f.fieldid;
+        rofRef.engineid=f.engineid;
+        rofRef.deleteindexentry=f.deleteindexentry;
+        rofRef.isnotaddunique=f.isnotaddunique;
+        rofRef.isreplace=f.isreplace;
+        rofRef.newrowid=f.newrowid;
+        rofRef.newengineid=f.newengineid;
+        rofRef.fieldVal.value=f.value;
+        rofRef.fieldVal.isnull=f.isnull;
+        rofRef.fieldVal.str.assign(strs+strstart, f.strend-strstart);
+        strstart=f.strend;
     }
+    pos += strstart;
 }
 
 void SerializedMessage::ser(vector<MessageApply::applyindex_s> &d)
@@ -1632,7 +1958,8 @@ MessageSerialized::~MessageSerialized()
 }
 
 MessageBatchSerialized::MessageBatchSerialized(int16_t nodeidarg) : nmsgs(0),
-                                                                    msgbatch ()
+                                                                    msgbatch (),
+                                                                    arena ()
 {
     messageStruct.destAddr.nodeid=nodeidarg;
     messageStruct.topic=TOPIC_BATCHSERIALIZED;
@@ -33,6 +33,7 @@
 #include "gch.h"
 #include "defs.h"
 #include "Topology.h"
+#include "MessagePool.h"
 
 /* THIS STUFF PROBABLY NEEDS TO BE CONSIDERED THROUGHOUT THE CODE BASE
  * BECAUSE SIZES CHANGED FROM int64_t TO OTHER THINGS, SUCH AS int16_t
@@ -99,6 +100,20 @@ public:
   
     Message();
     virtual ~Message();
+    /** 
+     * @brief allocate Message variant from calling thread's MessagePool
+     *
+     * @param size size of variant
+     *
+     * @return storage
+     */
+    static void *operator new(size_t size);
+    /** 
+     * @brief return Message variant storage to owning MessagePool
+     *
+     * @param ptr storage
+     */
+    static void operator delete(void *ptr);
     /** 
      * @brief get Message size
      *
@@ -144,6 +159,15 @@ public:
      * @return serialized Message variant string
      */
     string *sermsg();
+    /** 
+     * @brief append Message variant to arena, prefixed by its size
+     *
+     * size is computed once and arena grown once, the variant is then
+     * packaged in place, in the same [size, msg] framing ObGateway sends
+     *
+     * @param arena buffer to append to
+     */
+    void sermsg(string &arena);
     /** 
      * @brief put addresses in Message variant envelope
      *
@@ -223,6 +247,9 @@ public:
     void clear();
 
     socket_s socketStruct;
+    // connection moving between TransactionAgents on this node, not
+    // serialized
+    class Pg *pgPtr;
 };
 
 /** 
@@ -487,6 +514,35 @@ public:
      *
      */
     void clear();
+    /** 
+     * @brief deserialize into this without decoding bulky members
+     *
+     * fixed size structs and small members are decoded, row, indexHits
+     * and returnRows are left in the buffer, which this takes ownership
+     * of, until first accessed through getRow(), getIndexHits() or
+     * getReturnRows()
+     *
+     * @param serobj SerializedMessage, data is set to NULL
+     */
+    void unpackView(SerializedMessage &serobj);
+    /** 
+     * @brief row, decoded from unpackView buffer if necessary
+     *
+     * @return row
+     */
+    std::string &getRow();
+    /** 
+     * @brief indexHits, decoded from unpackView buffer if necessary
+     *
+     * @return indexHits
+     */
+    std::vector<nonLockingIndexEntry_s> &getIndexHits();
+    /** 
+     * @brief returnRows, decoded from unpackView buffer if necessary
+     *
+     * @return returnRows
+     */
+    std::vector<returnRow_s> &getReturnRows();
 
     subtransaction_s subtransactionStruct;
 
@@ -496,6 +552,12 @@ public:
     searchParams_s searchParameters;
     std::vector<int64_t> rowids;
     std::vector<returnRow_s> returnRows;
+
+    // unpackView buffer and offsets of members not yet decoded (0 if done)
+    std::shared_ptr<std::string> viewdata;
+    size_t rowpos;
+    size_t indexhitspos;
+    size_t returnrowspos;
 };
 
 /** 
@@ -850,10 +912,9 @@ public:
  * 1) sender to obgw: SerializedMessage on stack
  * 2) copy pointer SerializedMessage.data to new MessageSerialized.data
  * 3) send MessageSerialized to obgw
- * 4) obgw takes MessageSerialized.data in
- *    boost_unordered::map< int64_t, vector<string *> > for sending to remote
- *    node
- * 5) obgw copies string *'s, deletes them, sends to remote node
+ * 4) obgw appends MessageSerialized.data to
+ *    boost_unordered::map< int64_t, string > for sending to remote node
+ * 5) obgw deletes string *'s, sends each node's buffer to remote node
  * 6) ibgw creates new MessageSerialized for each string *
  *    gets destAddr, etc by reading 1st sizeof(Message::message_s)
  * 7) destination copies MessageSerialized.data ptr to SerializedMessage.data
@@ -879,6 +940,15 @@ public:
      * @param dataarg serialized message to populate with
      */
     SerializedMessage(string *dataarg);
+    /** 
+     * @brief serialize into the end of a shared buffer
+     *
+     * arena is grown by sizearg, pos starts at its previous end
+     *
+     * @param arenaarg buffer to append to
+     * @param sizearg bytes to append
+     */
+    SerializedMessage(string *arenaarg, size_t sizearg);
     virtual ~SerializedMessage();
   
     size_t size;
@@ -889,6 +959,12 @@ public:
     // raw
     void ser(size_t s, void *dataptr);
     void des(size_t s, void *dataptr);
+    /** 
+     * @brief advance past length-prefixed member without decoding it
+     *
+     * @param elementsize size of each element, 1 for string
+     */
+    void skip(size_t elementsize);
     // pods
     void ser(int64_t d);
     static size_t sersize(int64_t d);
@@ -985,6 +1061,12 @@ public:
     static size_t sersize(MessageApply::applyindex_s &d);
     void des(MessageApply::applyindex_s &d);
     // level 3
+    void ser(residualPredicate_s &d);
+    static size_t sersize(residualPredicate_s &d);
+    void des(residualPredicate_s &d);
+    void ser(vector<residualPredicate_s> &d);
+    static size_t sersize(vector<residualPredicate_s> &d);
+    void des(vector<residualPredicate_s> &d);
     void ser(searchParams_s &d);
     static size_t sersize(searchParams_s &d);
     void des(searchParams_s &d);
@@ -1035,7 +1117,7 @@ public:
     struct msgbatch_s
     {
         int16_t nodeid;
-        std::string *serializedmsg;
+        size_t offset; /**< of [size, msg] in arena */
     };
   
     MessageBatchSerialized(int16_t nodeidarg);
@@ -1043,6 +1125,7 @@ public:
   
     short nmsgs;
     msgbatch_s msgbatch[OBGWMSGBATCHSIZE];
+    std::string arena; /**< every message in batch, see Message::sermsg */
 };
 
 #endif  /* INFINISQLMESSAGE_H */
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2013 Mark Travis <mtravis15432+src@gmail.com>
+ * All rights reserved. No warranty, explicit or implicit, provided.
+ *
+ * This file is part of InfiniSQL(tm).
+
+ * InfiniSQL is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3
+ * as published by the Free Software Foundation.
+ *
+ * InfiniSQL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with InfiniSQL. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   MessagePool.cc
+ *
+ * @brief  per-thread slab allocator for Message variants. Consumer threads
+ * return blocks to the allocating thread's pool through a lockfree list.
+ */
+
+#include "gch.h"
+#include "MessagePool.h"
+#line 31 "MessagePool.cc"
+
+pthread_mutex_t MessagePool::poolsMutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<class MessagePool *> MessagePool::pools;
+
+static __thread class MessagePool *threadPool = NULL;
+
+MessagePool::MessagePool() : hits(0), misses(0), bypasses(0), returns(0)
+{
+    for (size_t n=0; n < MSGPOOLCLASSES; n++)
+    {
+        freelist[n] = NULL;
+        returnlist[n] = NULL;
+    }
+}
+
+MessagePool::~MessagePool()
+{
+}
+
+class MessagePool *MessagePool::localPool()
+{
+    if (threadPool==NULL)
+    {
+        // pools outlive their threads, blocks may still be in flight
+        threadPool = new class MessagePool;
+        pthread_mutex_lock(&poolsMutex);
+        pools.push_back(threadPool);
+        pthread_mutex_unlock(&poolsMutex);
+    }
+
+    return threadPool;
+}
+
+MessagePool::block_s *MessagePool::pop(int64_t sizeclass)
+{
+    block_s *block = freelist[sizeclass];
+
+    if (block==NULL)
+    {
+        block = __atomic_exchange_n(&returnlist[sizeclass], (block_s *)NULL,
+                                    __ATOMIC_ACQUIRE);
+    }
+
+    if (block != NULL)
+    {
+        __atomic_store_n(&hits, hits+1, __ATOMIC_RELAXED);
+        freelist[sizeclass] = block->next;
+        return block;
+    }
+
+    __atomic_store_n(&misses, misses+1, __ATOMIC_RELAXED);
+    size_t blocksize = (sizeclass+1) * MSGPOOLGRANULE;
+    char *slab = (char *)malloc(blocksize * MSGPOOLSLABBLOCKS);
+
+    if (slab==NULL)
+    {
+        fprintf(logfile, "%s %i malloc errno %i\n", __FILE__, __LINE__, errno);
+        exit(1);
+    }
+
+    for (size_t n=1; n < MSGPOOLSLABBLOCKS; n++)
+    {
+        block_s *b = (block_s *)(slab + n*blocksize);
+        b->header.owner = this;
+        b->header.sizeclass = sizeclass;
+        b->next = freelist[sizeclass];
+        freelist[sizeclass] = b;
+    }
+
+    block = (block_s *)slab;
+    block->header.owner = this;
+    block->header.sizeclass = sizeclass;
+
+    return block;
+}
+
+void *MessagePool::allocate(size_t size)
+{
+    int64_t sizeclass = (size + sizeof(header_s) - 1) / MSGPOOLGRANULE;
+
+    if (sizeclass >= MSGPOOLCLASSES ||
+        __atomic_load_n(&cfgs.messagepool, __ATOMIC_RELAXED)==false)
+    {
+        header_s *header = (header_s *)malloc(sizeof(header_s) + size);
+
+        if (header==NULL)
+        {
+            throw std::bad_alloc();
+        }
+
+        header->owner = NULL;
+        header->sizeclass = -1;
+        class MessagePool *pool = localPool();
+        __atomic_store_n(&pool->bypasses, pool->bypasses+1, __ATOMIC_RELAXED);
+
+        return header+1;
+    }
+
+    return &localPool()->pop(sizeclass)->header + 1;
+}
+
+void MessagePool::deallocate(void *ptr)
+{
+    if (ptr==NULL)
+    {
+        return;
+    }
+
+    block_s *block = (block_s *)((header_s *)ptr - 1);
+    class MessagePool *owner = block->header.owner;
+
+    if (owner==NULL)
+    {
+        free(block);
+        return;
+    }
+
+    int64_t sizeclass = block->header.sizeclass;
+
+    if (owner==threadPool)
+    {
+        block->next = owner->freelist[sizeclass];
+        owner->freelist[sizeclass] = block;
+        return;
+    }
+
+    // push only; owner takes whole list with exchange, so no ABA
+    block->next = __atomic_load_n(&owner->returnlist[sizeclass],
+                                  __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&owner->returnlist[sizeclass],
+                                        &block->next, block, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+
+    if (threadPool != NULL)
+    {
+        __atomic_store_n(&threadPool->returns, threadPool->returns+1,
+                         __ATOMIC_RELAXED);
+    }
+}
+
+void MessagePool::getStats(stats_s &stats)
+{
+    stats = stats_s();
+    pthread_mutex_lock(&poolsMutex);
+
+    for (size_t n=0; n < pools.size(); n++)
+    {
+        stats.hits += __atomic_load_n(&pools[n]->hits, __ATOMIC_RELAXED);
+        stats.misses += __atomic_load_n(&pools[n]->misses, __ATOMIC_RELAXED);
+        stats.bypasses += __atomic_load_n(&pools[n]->bypasses,
+                                          __ATOMIC_RELAXED);
+        stats.returns += __atomic_load_n(&pools[n]->returns, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&poolsMutex);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2013 Mark Travis <mtravis15432+src@gmail.com>
+ * All rights reserved. No warranty, explicit or implicit, provided.
+ *
+ * This file is part of InfiniSQL(tm).
+
+ * InfiniSQL is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3
+ * as published by the Free Software Foundation.
+ *
+ * InfiniSQL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with InfiniSQL. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   MessagePool.h
+ *
+ * @brief  per-thread slab allocator for Message variants. Consumer threads
+ * return blocks to the allocating thread's pool through a lockfree list.
+ */
+
+#ifndef INFINISQLMESSAGEPOOL_H
+#define INFINISQLMESSAGEPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <vector>
+
+/** block sizes are multiples of this */
+#define MSGPOOLGRANULE 64
+/** number of size classes, larger objects bypass the pool */
+#define MSGPOOLCLASSES 16
+/** blocks carved from each new slab */
+#define MSGPOOLSLABBLOCKS 64
+
+/**
+ * @brief slab pool of Message-sized blocks owned by one producer thread
+ *
+ * Message::operator new allocates from the calling thread's pool.
+ * Message::operator delete pushes onto the local free list if called by
+ * the owning thread, or onto the owner's return list otherwise (normally
+ * Mbox::receive in the consumer). The owner takes the whole return list
+ * back with one atomic exchange when its free list runs dry.
+ */
+class MessagePool
+{
+public:
+    /**
+     * @brief header preceding each block handed out
+     *
+     */
+    struct __attribute__ ((aligned (16))) header_s
+    {
+        class MessagePool *owner; /**< NULL if not pooled */
+        int64_t sizeclass;
+    };
+
+    /**
+     * @brief free block, next pointer overlays the payload
+     *
+     */
+    struct block_s
+    {
+        header_s header;
+        block_s *next;
+    };
+
+    /**
+     * @brief aggregate counters across all pools
+     *
+     */
+    struct stats_s
+    {
+        uint64_t hits;      /**< allocations served from a pool */
+        uint64_t misses;    /**< allocations that needed a new slab */
+        uint64_t bypasses;  /**< too large, or pooling disabled */
+        uint64_t returns;   /**< blocks freed by a thread other than owner */
+    };
+
+    MessagePool();
+    virtual ~MessagePool();
+
+    /**
+     * @brief allocate block for Message variant
+     *
+     * @param size size of object
+     *
+     * @return pointer to object storage
+     */
+    static void *allocate(size_t size);
+    /**
+     * @brief release block allocated by allocate()
+     *
+     * @param ptr object storage
+     */
+    static void deallocate(void *ptr);
+    /**
+     * @brief sum counters of every pool created so far
+     *
+     * @param stats output counters
+     */
+    static void getStats(stats_s &stats);
+
+private:
+    /**
+     * @brief return calling thread's pool, creating it if necessary
+     *
+     * @return pool
+     */
+    static class MessagePool *localPool();
+    /**
+     * @brief pop block from free list, refilling from return list or new slab
+     *
+     * @param sizeclass size class
+     *
+     * @return block
+     */
+    block_s *pop(int64_t sizeclass);
+
+    block_s *freelist[MSGPOOLCLASSES];
+    block_s *returnlist[MSGPOOLCLASSES]; // pushed by other threads
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bypasses;
+    uint64_t returns;
+
+    static pthread_mutex_t poolsMutex;
+    static std::vector<class MessagePool *> pools;
+};
+
+#endif  /* INFINISQLMESSAGEPOOL_H */
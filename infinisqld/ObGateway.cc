@@ -30,10 +30,30 @@
 #include "ObGateway.h"
 #line 32 "ObGateway.cc"
 
+pthread_mutex_t ObGateway::instancesMutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<class ObGateway *> ObGateway::instances;
+
 ObGateway::ObGateway(Topology::actorIdentity *myIdentityArg) :
     so_sndbuf(16777216), ismultinode(false)
 {
     init(myIdentityArg);
+    pthread_mutex_lock(&instancesMutex);
+    instances.push_back(this);
+    pthread_mutex_unlock(&instancesMutex);
+    // sleep in epoll_wait, so that peers whose socket buffer filled up are
+    // written to as soon as they drain, and producers wake us through the
+    // mbox eventfd
+    epollfd = epoll_create(1);
+    myIdentity.mbox->wakefd = eventfd(0, EFD_NONBLOCK);
+    struct epoll_event wakeev;
+    wakeev.events = EPOLLIN;
+    wakeev.data.fd = myIdentity.mbox->wakefd;
+
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, myIdentity.mbox->wakefd, &wakeev)
+        == -1)
+    {
+        fprintf(logfile, "%s %i epoll_ctl errno %i\n", __FILE__, __LINE__, errno);
+    }
     /*
     delete myIdentityArg;
 
@@ -44,151 +64,565 @@ ObGateway::ObGateway(Topology::actorIdentity *myIdentityArg) :
 
     optlen=sizeof(so_sndbuf);
     int waitfor = 100;
+    bool backlogged = false;
   
-    // pendingMsgs[remotenodeid]=serialized messages
-    char *sendstr=NULL;
-    size_t sendsize=0;
-    boost::unordered_map< int64_t, vector<string *> > pendingMsgs;
-    char *serstr=NULL;
-    serstrsmall=new (std::nothrow) char[SERIALIZEDMAXSIZE];
-    char *serstrbig=NULL;
-    bool isserstrbig=false;
-    char *cstr=NULL;
-    cstrsmall=new (std::nothrow) char[SERIALIZEDMAXSIZE];
-    char *cstrbig=NULL;
-    bool iscstrbig=false;
+    // pendingMsgs[remotenodeid]=total size, [msgsize, msg]... as segments
+    // of the buffers the messages arrived in
+    boost::unordered_map< int64_t, pending_s > pendingMsgs;
+    class Message *msgbatch[MSGRECEIVEBATCHSIZE];
+    struct epoll_event events[OBGWEPOLLEVENTS];
 
     while (1)
     {
-        for (size_t inmsg=0; inmsg < 5000; inmsg++)
+        int eventcount;
+
+        if (backlogged==true)
+        {
+            // a peer's queue is at its cap, so leave messages in the mbox
+            // until the peer takes more
+            eventcount = epoll_wait(epollfd, events, OBGWEPOLLEVENTS, -1);
+        }
+        else
         {
-            class Message *msgrcv = myIdentity.mbox->receive(waitfor);
+            eventcount = myIdentity.mbox->pollwait(epollfd, events,
+                                                   OBGWEPOLLEVENTS, waitfor);
+        }
+
+        for (int n=0; n < eventcount; n++)
+        {
+            if (events[n].data.fd==myIdentity.mbox->wakefd)
+            {
+                uint64_t count;
+                if (read(myIdentity.mbox->wakefd, &count, sizeof(count)) < 0 &&
+                    errno != EAGAIN)
+                {
+                    fprintf(logfile, "%s %i read errno %i\n", __FILE__,
+                            __LINE__, errno);
+                }
+                continue;
+            }
 
-            if (msgrcv==NULL)
+            boost::unordered_map<int, int64_t>::iterator it =
+                socketNodeids.find(events[n].data.fd);
+            if (it != socketNodeids.end())
+            {
+                flush(it->second);
+            }
+        }
+
+        backlogged = false;
+        for (size_t n=0; n < peerQueues.size(); n++)
+        {
+            if (peerQueues[n].queuedbytes >= OBGWMAXQUEUEDBYTES)
             {
-                waitfor = 100;
+                backlogged = true;
                 break;
             }
+        }
+        if (backlogged==true)
+        {
+            continue;
+        }
 
-            waitfor = 0;
+        size_t nmsgs=0;
+        waitfor = 100;
+        for (size_t inmsg=0; inmsg < 5000; inmsg += nmsgs)
+        {
+            nmsgs = myIdentity.mbox->receiveBatch(msgbatch,
+                                                  MSGRECEIVEBATCHSIZE, 0);
 
-            switch (msgrcv->messageStruct.topic)
+            if (nmsgs==0)
             {
-            case TOPIC_TOPOLOGY:
-                mboxes.update(myTopology);
-                updateRemoteGateways();
                 break;
+            }
+
+            waitfor = 0;
+
+            for (size_t n=0; n < nmsgs; n++)
+            {
+                class Message *msgrcv = msgbatch[n];
+                if (n+1 < nmsgs)
+                {
+                    __builtin_prefetch(msgbatch[n+1]);
+                }
 
-            case TOPIC_SERIALIZED: // destined for remote host
-                pendingMsgs[msgrcv->messageStruct.destAddr.nodeid].push_back(((class MessageSerialized *)msgrcv)->data);
+                switch (msgrcv->messageStruct.topic)
+                {
+                case TOPIC_TOPOLOGY:
+                    mboxes.update(myTopology);
+                    updateRemoteGateways();
+                    break;
+
+                case TOPIC_SERIALIZED: // destined for remote host
+                {
+                    string *dataPtr=((class MessageSerialized *)msgrcv)->data;
+                    // take over the serialized message, it is written from
+                    // where it is
+                    buffer_s *buffer=getBuffer();
+                    buffer->data.swap(*dataPtr);
+                    delete dataPtr;
+                    pending_s &pendingRef=
+                        pendingMsgs[msgrcv->messageStruct.destAddr.nodeid];
+                    addSegment(pendingRef, NULL, NULL, buffer->data.size());
+                    addSegment(pendingRef, buffer, buffer->data.data(),
+                               buffer->data.size());
+                }
                 break;
           
-            case TOPIC_BATCHSERIALIZED:
-            {
-                class MessageBatchSerialized &msgRef=
-                    *(class MessageBatchSerialized *)msgrcv;
-                for (short n=0; n<msgRef.nmsgs; n++)
+                case TOPIC_BATCHSERIALIZED:
                 {
-                    pendingMsgs[msgRef.msgbatch[n].nodeid].push_back(msgRef.msgbatch[n].serializedmsg);
+                    class MessageBatchSerialized &msgRef=
+                        *(class MessageBatchSerialized *)msgrcv;
+                    // messages are already framed in the arena, take it over
+                    // and add each run bound for the same node as a segment
+                    buffer_s *buffer=getBuffer();
+                    buffer->data.swap(msgRef.arena);
+                    for (short m=0; m<msgRef.nmsgs;)
+                    {
+                        int16_t nodeid=msgRef.msgbatch[m].nodeid;
+                        size_t start=msgRef.msgbatch[m].offset;
+                        for (++m; m<msgRef.nmsgs &&
+                                 msgRef.msgbatch[m].nodeid==nodeid; m++)
+                        {
+                        }
+                        size_t end = m<msgRef.nmsgs ?
+                            msgRef.msgbatch[m].offset : buffer->data.size();
+                        buffer->refs++;
+                        addSegment(pendingMsgs[nodeid], buffer,
+                                   buffer->data.data()+start, end-start);
+                    }
+                    // drop getBuffer()'s reference
+                    if (--buffer->refs==0)
+                    {
+                        putBuffer(spareBuffers, buffer);
+                    }
                 }
-            }
-            break;
+                break;
         
-            default:
-                printf("%s %i anomaly %i\n", __FILE__, __LINE__,
-                       msgrcv->messageStruct.topic);
+                default:
+                    printf("%s %i anomaly %i\n", __FILE__, __LINE__,
+                           msgrcv->messageStruct.topic);
+                }
             }
         }
 
-        // send all pendings
-        boost::unordered_map< int64_t, vector<string *> >::iterator it;
+        // queue all pendings, then write as much as each peer takes
+        boost::unordered_map< int64_t, pending_s >::iterator it;
         for (it=pendingMsgs.begin(); it != pendingMsgs.end(); ++it)
         {
-            vector<string *> &msgsRef = it->second;
-            size_t s=sizeof(size_t);
-            for (size_t n=0; n < msgsRef.size(); n++)
-            {
-                s += sizeof(size_t) + msgsRef[n]->size();
-            }
-            if (!s)
-            {
-                continue;
-            }
-            // format is: total size, [msgsize, msg]...
-            if (s>SERIALIZEDMAXSIZE)
+            if (!it->second.segments.empty())
             {
-                serstrbig=new (std::nothrow) char[s];
-                serstr=serstrbig;
-                isserstrbig=true;
+                queueFrame(it->first, it->second);
             }
-            else
-            {
-                serstr=serstrsmall;
-                isserstrbig=false;
-            }
-            memcpy(serstr, &s, sizeof(s));
-            size_t pos=sizeof(s);
-            for (size_t n=0; n < msgsRef.size(); n++)
+        }
+
+        // a peer whose socket buffer is full is written to on EPOLLOUT
+        for (size_t n=0; n < peerQueues.size(); n++)
+        {
+            if (!peerQueues[n].segments.empty() &&
+                peerQueues[n].writewait==false)
             {
-                string &msgRef=*msgsRef[n];
-                size_t ms=msgRef.size();
-                memcpy(serstr+pos, &ms, sizeof(ms));
-                pos += sizeof(size_t);
-                memcpy(serstr+pos, msgRef.c_str(), ms);
-                pos += ms;
-                delete &msgRef;
+                flush(n);
             }
-      
-            // compress
-            if (cfgs.compressgw==true)
+        }
+    }
+}
+
+ObGateway::~ObGateway()
+{
+    pthread_mutex_lock(&instancesMutex);
+    instances.erase(std::find(instances.begin(), instances.end(), this));
+    pthread_mutex_unlock(&instancesMutex);
+
+    for (size_t n=0; n < peerQueues.size(); n++)
+    {
+        while (!peerQueues[n].segments.empty())
+        {
+            releaseSegment(spareBuffers, peerQueues[n].segments.front());
+            peerQueues[n].segments.pop_front();
+        }
+        if (peerQueues[n].lz4stream != NULL)
+        {
+            LZ4_freeStream(peerQueues[n].lz4stream);
+            delete[] peerQueues[n].lz4dict;
+        }
+    }
+    for (size_t n=0; n < spareBuffers.size(); n++)
+    {
+        delete spareBuffers[n];
+    }
+    close(epollfd);
+}
+
+void ObGateway::addSegment(pending_s &pendingRef, buffer_s *buffer,
+                           const char *base, size_t len)
+{
+    if (pendingRef.segments.empty())
+    { // frame's total size, filled in by queueFrame()
+        segment_s total={NULL, NULL, sizeof(size_t), 0};
+        pendingRef.segments.push_back(total);
+        pendingRef.size=sizeof(size_t);
+    }
+
+    segment_s segment={buffer, base, len, 0};
+    if (buffer==NULL)
+    {
+        segment.len=sizeof(size_t);
+        segment.header=len;
+    }
+    pendingRef.segments.push_back(segment);
+    pendingRef.size += segment.len;
+}
+
+void ObGateway::queueFrame(int64_t nodeid, pending_s &pendingRef)
+{
+    // format is: total size, [msgsize, msg]...
+    pendingRef.segments[0].header=pendingRef.size;
+
+    if ((int64_t)peerQueues.size() <= nodeid)
+    {
+        addPeers(peerQueues, nodeid);
+    }
+    peerQueue_s &queueRef=peerQueues[nodeid];
+
+    if (compressing(queueRef, pendingRef.size)==true)
+    {
+        // lz4 takes contiguous input, so only here are messages copied
+        gatherBuffer.clear();
+        for (size_t n=0; n < pendingRef.segments.size(); n++)
+        {
+            segment_s &segmentRef=pendingRef.segments[n];
+            if (segmentRef.buffer==NULL)
             {
-                int cbound=LZ4_compressBound(s);
-                if (cbound+sizeof(size_t) > SERIALIZEDMAXSIZE)
-                {
-                    cstrbig=new (std::nothrow) char[cbound+sizeof(size_t)];
-                    cstr=cstrbig;
-                    iscstrbig=true;
-                }
-                else
-                {
-                    cstr=cstrsmall;
-                    iscstrbig=false;
-                }
-                size_t csize=LZ4_compress(serstr, cstr+sizeof(csize), s);
-                csize += sizeof(csize);
-                memcpy(cstr, &csize, sizeof(csize));
-                sendstr=cstr;
-                sendsize=csize;
+                gatherBuffer.append((const char *)&segmentRef.header,
+                                    segmentRef.len);
             }
             else
             {
-                sendstr=serstr;
-                sendsize=s;
+                gatherBuffer.append(segmentRef.base, segmentRef.len);
             }
+            releaseSegment(spareBuffers, segmentRef);
+        }
 
-            if (send(remoteGateways[it->first], sendstr, sendsize, 0)==-1)
-            {
-                printf("%s %i send errno %i nodeid %i instance %li it->first %li socket %i\n", __FILE__, __LINE__, errno, myTopology.nodeid, myIdentity.instance,
-                       it->first, remoteGateways[it->first]);
-            }
-            pendingMsgs.erase(it->first);
+        buffer_s *buffer=getBuffer();
+        compressFrame(queueRef, gatherBuffer, buffer->data);
+        segment_s segment={buffer, buffer->data.data(), buffer->data.size(),
+                           0};
+        queueRef.segments.push_back(segment);
+        queueRef.queuedbytes += segment.len;
+    }
+    else
+    {
+        queueRef.segments.insert(queueRef.segments.end(),
+                                 pendingRef.segments.begin(),
+                                 pendingRef.segments.end());
+        queueRef.queuedbytes += pendingRef.size;
+    }
+
+    pendingRef.segments.clear();
+    pendingRef.size=0;
+}
+
+bool ObGateway::compress(peerQueue_s &queueRef, const string &in, string &out)
+{
+    if (compressing(queueRef, in.size())==false)
+    {
+        return false;
+    }
+
+    compressFrame(queueRef, in, out);
+
+    return true;
+}
+
+bool ObGateway::compressing(peerQueue_s &queueRef, size_t framesize)
+{
+    compressStats_s &statsRef=queueRef.stats;
+
+    if (cfgs.compressgw==false || framesize < cfgs.compressgwthreshold)
+    {
+        __atomic_store_n(&statsRef.uncompressedbytes,
+                         statsRef.uncompressedbytes+framesize,
+                         __ATOMIC_RELAXED);
+        return false;
+    }
+
+    if (statsRef.iscompressing==false)
+    {
+        if (--queueRef.probecountdown > 0)
+        {
+            __atomic_store_n(&statsRef.uncompressedbytes,
+                             statsRef.uncompressedbytes+framesize,
+                             __ATOMIC_RELAXED);
+            return false;
+        }
+        __atomic_store_n(&statsRef.iscompressing, true, __ATOMIC_RELAXED);
+    }
+
+    return true;
+}
+
+void ObGateway::compressFrame(peerQueue_s &queueRef, const string &in,
+                              string &out)
+{
+    compressStats_s &statsRef=queueRef.stats;
+
+    if (queueRef.lz4stream==NULL)
+    {
+        queueRef.lz4stream=LZ4_createStream();
+        queueRef.lz4dict=new char[GWLZ4DICTSIZE];
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t rawsize=in.size();
+    size_t hdrsize=2*sizeof(size_t);
+    int cbound=LZ4_compressBound(rawsize);
+    out.resize(hdrsize+cbound);
+    int csize=LZ4_compress_fast_continue(queueRef.lz4stream, in.c_str(),
+                                         &out[hdrsize], rawsize, cbound, 1);
+    // next frame's history, decoder keeps the same tail of its output
+    LZ4_saveDict(queueRef.lz4stream, queueRef.lz4dict, GWLZ4DICTSIZE);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (csize <= 0)
+    {
+        fprintf(logfile, "%s %i LZ4_compress_fast_continue %i rawsize %lu\n",
+                __FILE__, __LINE__, csize, rawsize);
+        exit(1);
+    }
+
+    size_t framesize=hdrsize+csize;
+    out.resize(framesize);
+    size_t header=framesize | GWFRAMECOMPRESSED;
+    memcpy(&out[0], &header, sizeof(header));
+    memcpy(&out[sizeof(header)], &rawsize, sizeof(rawsize));
+
+    uint64_t ns=(end.tv_sec-start.tv_sec)*1000000000 +
+        end.tv_nsec-start.tv_nsec;
+    __atomic_store_n(&statsRef.rawbytes, statsRef.rawbytes+rawsize,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&statsRef.compressedbytes,
+                     statsRef.compressedbytes+framesize, __ATOMIC_RELAXED);
+    __atomic_store_n(&statsRef.compressns, statsRef.compressns+ns,
+                     __ATOMIC_RELAXED);
+    queueRef.windowraw += rawsize;
+    queueRef.windowcompressed += framesize;
+    queueRef.windowns += ns;
+
+    if (++queueRef.windowframes == GWCOMPRESSWINDOW)
+    {
+        int64_t saving=queueRef.windowraw-queueRef.windowcompressed;
+        if (saving*100 < (int64_t)queueRef.windowraw*cfgs.compressgwminsaving ||
+            (int64_t)queueRef.windowns > saving*cfgs.compressgwnsperbyte)
+        {
+            __atomic_store_n(&statsRef.iscompressing, false, __ATOMIC_RELAXED);
+            queueRef.probecountdown=GWCOMPRESSPROBE;
+        }
+        queueRef.windowframes=0;
+        queueRef.windowraw=0;
+        queueRef.windowcompressed=0;
+        queueRef.windowns=0;
+    }
+}
+
+void ObGateway::getCompressStats(std::vector<compressStats_s> &stats)
+{
+    stats.clear();
+    pthread_mutex_lock(&instancesMutex);
+
+    for (size_t n=0; n < instances.size(); n++)
+    {
+        peerStats(instances[n]->peerQueues, stats);
+    }
+
+    pthread_mutex_unlock(&instancesMutex);
+}
+
+void ObGateway::peerStats(const std::vector<peerQueue_s> &peers,
+                          std::vector<compressStats_s> &stats)
+{
+    for (size_t n=0; n < peers.size(); n++)
+    {
+        const compressStats_s &statsRef=peers[n].stats;
+        compressStats_s s;
+        s.nodeid=statsRef.nodeid;
+        s.iscompressing=__atomic_load_n(&statsRef.iscompressing,
+                                        __ATOMIC_RELAXED);
+        s.rawbytes=__atomic_load_n(&statsRef.rawbytes, __ATOMIC_RELAXED);
+        s.compressedbytes=__atomic_load_n(&statsRef.compressedbytes,
+                                          __ATOMIC_RELAXED);
+        s.uncompressedbytes=__atomic_load_n(&statsRef.uncompressedbytes,
+                                            __ATOMIC_RELAXED);
+        s.compressns=__atomic_load_n(&statsRef.compressns, __ATOMIC_RELAXED);
+        if (s.rawbytes==0 && s.uncompressedbytes==0)
+        { // slot of a node never sent to
+            continue;
+        }
+        stats.push_back(s);
+    }
+}
 
-            if (isserstrbig==true)
+void ObGateway::addPeers(std::vector<peerQueue_s> &peers, int64_t nodeid)
+{
+    // getCompressStats() may be walking peers
+    pthread_mutex_lock(&instancesMutex);
+    size_t oldsize=peers.size();
+    peers.resize(nodeid+1);
+    for (size_t n=oldsize; n < peers.size(); n++)
+    {
+        peers[n].stats.nodeid=n;
+    }
+    pthread_mutex_unlock(&instancesMutex);
+}
+
+bool ObGateway::flush(int64_t nodeid)
+{
+    peerQueue_s &queueRef=peerQueues[nodeid];
+    int sockfd=remoteGateways[nodeid];
+    int rv=writeQueue(queueRef, sockfd, spareBuffers);
+
+    if (rv==-1)
+    {
+        printf("%s %i sendmsg errno %i nodeid %i instance %li nodeid %li socket %i queued %lu\n",
+               __FILE__, __LINE__, errno, myTopology.nodeid,
+               myIdentity.instance, nodeid, sockfd,
+               (unsigned long)queueRef.queuedbytes);
+        // peer is gone, drop what was meant for it
+        while (!queueRef.segments.empty())
+        {
+            releaseSegment(spareBuffers, queueRef.segments.front());
+            queueRef.segments.pop_front();
+        }
+        queueRef.headpos=0;
+        queueRef.queuedbytes=0;
+        setWritewait(nodeid, false);
+        return true;
+    }
+
+    setWritewait(nodeid, rv==0);
+
+    return rv==1;
+}
+
+void ObGateway::setWritewait(int64_t nodeid, bool writewait)
+{
+    peerQueue_s &queueRef=peerQueues[nodeid];
+
+    if (queueRef.writewait==writewait)
+    {
+        return;
+    }
+
+    int sockfd=remoteGateways[nodeid];
+    struct epoll_event ev;
+    ev.events = EPOLLOUT;
+    ev.data.fd = sockfd;
+
+    if (epoll_ctl(epollfd, writewait ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, sockfd,
+                  &ev) == -1)
+    {
+        fprintf(logfile, "%s %i epoll_ctl errno %i nodeid %li\n", __FILE__,
+                __LINE__, errno, nodeid);
+        return;
+    }
+
+    queueRef.writewait=writewait;
+}
+
+int ObGateway::writeQueue(peerQueue_s &queueRef, int sockfd,
+                          std::vector<buffer_s *> &spares)
+{
+    struct iovec iov[OBGWIOVMAX];
+
+    while (!queueRef.segments.empty())
+    {
+        size_t niov=0;
+        std::deque<segment_s>::iterator it;
+        for (it=queueRef.segments.begin();
+             it != queueRef.segments.end() && niov < OBGWIOVMAX; ++it)
+        {
+            size_t skip = niov ? 0 : queueRef.headpos;
+            const char *base = it->buffer==NULL ?
+                (const char *)&it->header : it->base;
+            iov[niov].iov_base=(void *)(base+skip);
+            iov[niov++].iov_len=it->len-skip;
+        }
+
+        struct msghdr hdr={};
+        hdr.msg_iov=iov;
+        hdr.msg_iovlen=niov;
+        ssize_t sent=sendmsg(sockfd, &hdr, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if (sent==-1)
+        {
+            if (errno==EINTR)
             {
-                delete[] serstrbig;
+                continue;
             }
-            if (iscstrbig==true)
+            if (errno==EAGAIN || errno==EWOULDBLOCK)
             {
-                delete[] cstrbig;
+                return 0;
             }
+            return -1;
         }
+
+        // retire fully written segments, remember offset into partial one
+        queueRef.queuedbytes -= sent;
+        size_t written=sent;
+        while (!queueRef.segments.empty() &&
+               written >= queueRef.segments.front().len-queueRef.headpos)
+        {
+            written -= queueRef.segments.front().len-queueRef.headpos;
+            queueRef.headpos=0;
+            releaseSegment(spares, queueRef.segments.front());
+            queueRef.segments.pop_front();
+        }
+        queueRef.headpos += written;
     }
+
+    return 1;
 }
 
-ObGateway::~ObGateway()
+void ObGateway::releaseSegment(std::vector<buffer_s *> &spares,
+                               segment_s &segmentRef)
 {
-    delete serstrsmall;
-    delete cstrsmall;
+    if (segmentRef.buffer != NULL && --segmentRef.buffer->refs==0)
+    {
+        putBuffer(spares, segmentRef.buffer);
+    }
+    segmentRef.buffer=NULL;
+}
+
+ObGateway::buffer_s *ObGateway::getBuffer()
+{
+    buffer_s *buffer;
+
+    if (!spareBuffers.empty())
+    {
+        buffer=spareBuffers.back();
+        spareBuffers.pop_back();
+    }
+    else
+    {
+        buffer=new buffer_s;
+    }
+    buffer->refs=1;
+
+    return buffer;
+}
+
+void ObGateway::putBuffer(std::vector<buffer_s *> &spares, buffer_s *buffer)
+{
+    if (spares.size() < OBGWSPAREBUFFERS)
+    {
+        buffer->data.clear();
+        spares.push_back(buffer);
+    }
+    else
+    {
+        delete buffer;
+    }
 }
 
 void ObGateway::updateRemoteGateways()
@@ -210,8 +644,15 @@ void ObGateway::updateRemoteGateways()
         {
             continue;
         }
-        if ((int64_t)myTopology.ibGateways[it->first].size() <
-            myIdentity.instance+1)
+        if (vecstringRef.empty())
+        {
+            continue;
+        }
+        // lane to this node, remote node may run fewer IbGateways than
+        // there are ObGateways here, so they can share one
+        string &hostportRef =
+            vecstringRef[myIdentity.instance % vecstringRef.size()];
+        if (hostportRef.empty())
         {
             continue;
         }
@@ -225,10 +666,10 @@ void ObGateway::updateRemoteGateways()
                 ismultinode=true;
             }
             int sockfd;
-            size_t found = vecstringRef[myIdentity.instance].find(':');
-            string node = vecstringRef[myIdentity.instance].substr(0, found);
-            string service = vecstringRef[myIdentity.instance].substr(found+1,
-                                                                      vecstringRef[myIdentity.instance].size()-(found+1));
+            size_t found = hostportRef.find(':');
+            string node = hostportRef.substr(0, found);
+            string service = hostportRef.substr(found+1,
+                                                hostportRef.size()-(found+1));
             struct addrinfo hints;
             memset(&hints, 0, sizeof(struct addrinfo));
             hints.ai_family = AF_INET;
@@ -269,6 +710,7 @@ void ObGateway::updateRemoteGateways()
             freeaddrinfo(servinfo);
 
             remoteGateways[it->first] = sockfd;
+            socketNodeids[sockfd] = it->first;
         }
     }
 }
@@ -41,9 +41,171 @@
 class ObGateway : public Actor
 {
 public:
+    /** 
+     * @brief per remote node compression metrics
+     *
+     */
+    struct compressStats_s
+    {
+        int64_t nodeid;
+        bool iscompressing;         /**< current policy decision */
+        uint64_t rawbytes;          /**< input to compressed frames */
+        uint64_t compressedbytes;   /**< output of compressed frames */
+        uint64_t uncompressedbytes; /**< frames sent as is */
+        uint64_t compressns;        /**< time spent compressing */
+    };
+
+    /** 
+     * @brief message bytes held until written, shared by every segment
+     * pointing into them
+     *
+     */
+    struct buffer_s
+    {
+        std::string data;
+        size_t refs;
+    };
+
+    /** 
+     * @brief one iovec of a frame
+     *
+     */
+    struct segment_s
+    {
+        buffer_s *buffer; /**< NULL if segment is its own size header */
+        const char *base;
+        size_t len;
+        size_t header; /**< frame or message size, if buffer is NULL */
+    };
+
+    /** 
+     * @brief frames waiting to be written to one remote node
+     *
+     */
+    struct peerQueue_s
+    {
+        std::deque<segment_s> segments;
+        size_t headpos; /**< bytes of front segment already written */
+        size_t queuedbytes;
+        bool writewait; /**< EPOLLOUT armed on peer's socket */
+
+        // lz4 stream to the peer, history kept in lz4dict between frames
+        LZ4_stream_t *lz4stream;
+        char *lz4dict;
+        compressStats_s stats;
+        uint64_t windowframes;
+        uint64_t windowraw;
+        uint64_t windowcompressed;
+        uint64_t windowns;
+        int64_t probecountdown;
+
+        peerQueue_s() : headpos(0), queuedbytes(0), writewait(false),
+                        lz4stream(NULL), lz4dict(NULL), stats(),
+                        windowframes(0), windowraw(0), windowcompressed(0),
+                        windowns(0), probecountdown(0)
+        {
+            stats.iscompressing=true;
+        }
+    };
+
     ObGateway(Topology::actorIdentity *myIdentityArg);
     virtual ~ObGateway();
     void updateRemoteGateways();
+    /** 
+     * @brief write queued frames to peer with gather writes
+     *
+     * stops without blocking when peer's socket buffer is full, keeping
+     * the unwritten remainder queued and EPOLLOUT armed until it drains
+     *
+     * @param nodeid remote node
+     *
+     * @return true if queue drained, false if peer would block
+     */
+    bool flush(int64_t nodeid);
+    /** 
+     * @brief gather write queued segments until drained or sockfd would
+     * block, releasing each buffer once all its segments are written
+     *
+     * @param queueRef peer
+     * @param sockfd peer's socket
+     * @param spares spare buffers
+     *
+     * @return 1 if drained, 0 if sockfd would block, -1 on socket error,
+     * with the queue left as it was before the failed write
+     */
+    static int writeQueue(peerQueue_s &queueRef, int sockfd,
+                          std::vector<buffer_s *> &spares);
+    /** 
+     * @brief drop segment's reference to its buffer
+     *
+     * @param spares spare buffers, buffer goes here or is deleted once
+     * unreferenced
+     * @param segmentRef segment
+     */
+    static void releaseSegment(std::vector<buffer_s *> &spares,
+                               segment_s &segmentRef);
+    /** 
+     * @brief metrics for every remote node of every ObGateway
+     *
+     * rawbytes-compressedbytes is the saving
+     *
+     * @param stats output, one entry per ObGateway instance and node
+     */
+    static void getCompressStats(std::vector<compressStats_s> &stats);
+    /** 
+     * @brief append metrics of each remote node's queue
+     *
+     * caller holds instancesMutex if peers belong to a running ObGateway
+     *
+     * @param peers peerQueues of one ObGateway
+     * @param stats output
+     */
+    static void peerStats(const std::vector<peerQueue_s> &peers,
+                          std::vector<compressStats_s> &stats);
+    /** 
+     * @brief grow peers to hold nodeid, each new queue tagged with its nodeid
+     *
+     * @param peers peerQueues of one ObGateway
+     * @param nodeid remote node
+     */
+    static void addPeers(std::vector<peerQueue_s> &peers, int64_t nodeid);
+    /** 
+     * @brief compress frame if policy for peer says so
+     *
+     * compressed frame is [framesize|GWFRAMECOMPRESSED, rawsize, lz4 block],
+     * the block compressed against the previous compressed frame to the
+     * same peer. Every GWCOMPRESSWINDOW compressed frames, compression is
+     * switched off for GWCOMPRESSPROBE frames if it saved less than
+     * compressgwminsaving percent, or took longer than sending the saved
+     * bytes at compressgwnsperbyte
+     *
+     * @param queueRef peer
+     * @param in frame
+     * @param out compressed frame
+     *
+     * @return true if compressed into out, false if in should be sent
+     */
+    static bool compress(peerQueue_s &queueRef, const std::string &in,
+                         std::string &out);
+    /** 
+     * @brief policy half of compress(), counting frame as uncompressed if
+     * it is to be sent as is
+     *
+     * @param queueRef peer
+     * @param framesize raw frame size
+     *
+     * @return true if frame is to be compressed
+     */
+    static bool compressing(peerQueue_s &queueRef, size_t framesize);
+    /** 
+     * @brief compress frame unconditionally, see compress()
+     *
+     * @param queueRef peer
+     * @param in frame
+     * @param out compressed frame
+     */
+    static void compressFrame(peerQueue_s &queueRef, const std::string &in,
+                              std::string &out);
 
     /*
     Topology::actorIdentity myIdentity;
@@ -52,13 +214,68 @@ public:
     */
 
 private:
+    /** 
+     * @brief messages bound for one remote node this round
+     *
+     */
+    struct pending_s
+    {
+        std::vector<segment_s> segments;
+        size_t size; /**< of frame, including its size header */
+    };
+
+    /** 
+     * @brief take spare buffer, keeping its capacity, or a new one
+     *
+     * @return buffer with 1 reference
+     */
+    buffer_s *getBuffer();
+    /** 
+     * @brief return unreferenced buffer to spares
+     *
+     * @param spares spare buffers
+     * @param buffer buffer, deleted if spares are full
+     */
+    static void putBuffer(std::vector<buffer_s *> &spares, buffer_s *buffer);
+    /** 
+     * @brief add segment to this round's frame for a remote node
+     *
+     * @param pendingRef frame
+     * @param buffer buffer holding base, NULL for a size header
+     * @param base start of segment
+     * @param len bytes, or size header's value if buffer is NULL
+     */
+    static void addSegment(pending_s &pendingRef, buffer_s *buffer,
+                           const char *base, size_t len);
+    /** 
+     * @brief move frame to peer's queue, compressing it if policy says so
+     *
+     * @param nodeid remote node
+     * @param pendingRef frame, left empty
+     */
+    void queueFrame(int64_t nodeid, pending_s &pendingRef);
+    /** 
+     * @brief arm or disarm EPOLLOUT on peer's socket
+     *
+     * @param nodeid remote node
+     * @param writewait true to arm
+     */
+    void setWritewait(int64_t nodeid, bool writewait);
     // remoteGateways[nodeid]=socket for corresponding ibgw's
     std::vector<int> remoteGateways;
+    // socketNodeids[remoteGateways[nodeid]]=nodeid, for EPOLLOUT events
+    boost::unordered_map<int, int64_t> socketNodeids;
+    // peerQueues[nodeid]=frames not yet written to remoteGateways[nodeid]
+    std::vector<peerQueue_s> peerQueues;
+    std::vector<buffer_s *> spareBuffers;
+    std::string gatherBuffer; /**< contiguous frame to compress */
+    int epollfd;
     socklen_t optlen;
     int so_sndbuf;
-    char *serstrsmall;
-    char *cstrsmall;
     bool ismultinode;
+
+    static pthread_mutex_t instancesMutex;
+    static std::vector<class ObGateway *> instances;
 };
 
 /** 
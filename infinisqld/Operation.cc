@@ -38,6 +38,7 @@ Operation::Operation(int typearg, class TransactionAgent *taarg, int64_t uid,
     operationid = ++taRef.operationidcounter;
     taRef.pendingOperations[operationid] = this;
     sockfd = taRef.sockfd;
+    requestid = taRef.requestid;
 
     if (type==OP_SCHEMA)
     {
@@ -97,6 +97,7 @@ public:
     class TransactionAgent *taPtr;
     int64_t operationid;
     int sockfd;
+    int64_t requestid;
     int64_t userid;
     int64_t domainid;
     string domainName; // for login
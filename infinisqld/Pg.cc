@@ -36,8 +36,14 @@
 
 Pg::Pg(class TransactionAgent *taPtrarg, int sockfdarg) :
     state(STATE_BEGIN),
-    sockfd(sockfdarg), pgcmdtype('\0'), size(0), outcmd('\0'), userid(-1),
-    schemaPtr(NULL), session_isautocommit(true), isintransactionblock(false)
+    sockfd(sockfdarg), pgcmdtype('\0'), size(0), outcmd('\0'), outchunkpos(0),
+    outbuflen(0), outbufmark(0), iswritepending(false), activity(0),
+    userid(-1),
+    schemaPtr(NULL), session_isautocommit(true), isintransactionblock(false),
+    isextendedquery(false), isskippingtosync(false), isexecuting(false),
+    isreadpending(false), isrollingback(false), copystate(), iscopyout(false),
+    isstreaming(false), selectrows(0), maxrows(SIZE_MAX),
+    isimplicittransaction(false), cursorowner(0), lastcursorowner(0)
 {
     domainid=-1;
     taPtr = taPtrarg;
@@ -49,6 +55,14 @@ Pg::Pg(class TransactionAgent *taPtrarg, int sockfdarg) :
 
 Pg::~Pg()
 {
+    clearPortals();
+
+    boost::unordered_map<std::string, preparedStatement_s>::iterator it;
+
+    for (it = preparedStatements.begin(); it != preparedStatements.end(); ++it)
+    {
+        delete it->second.statementPtr;
+    }
 }
 
 // processing logic for Pg, state machine
@@ -72,6 +86,13 @@ void Pg::cont()
 
     if (msgrcvref.socketStruct.events & EPOLLIN)
     {
+        if (isexecuting==true && pendingbuf.size() >= PGINPUTHOLDMAX)
+        {
+            // leave the rest in the socket, resume() reads it
+            isreadpending=true;
+            return;
+        }
+
         // read stuff from the socket
         if (readsocket(newdata)==false)
         {
@@ -101,30 +122,203 @@ void Pg::cont()
         return;
     }
 
-    short retval = initcmd(newdata);
-
-    switch (retval)
+    if (isexecuting==true)
     {
-    case -1: // bogus input
-        closesocket(*taPtr);
+        pendingbuf.append(newdata);
         return;
-//        break;
+    }
+
+    processinput(newdata);
+}
+
+void Pg::processinput(string &newdata)
+{
+    class TransactionAgent *ta = taPtr;
+    int fd = sockfd;
+
+    while (1)
+    {
+        short retval = initcmd(newdata);
+
+        switch (retval)
+        {
+        case -1: // bogus input
+            closesocket(*taPtr);
+            return;
+//            break;
+
+        case 0: // command not completely received
+            // end of the pipelined batch, send its coalesced responses
+            if (outbuflen && flushsocket()==-1)
+            {
+                closesocket(*taPtr);
+            }
+
+            return;
+//            break;
+
+        case 1: // command completely received
+            pos = 0;
+            outbufmark = outbuflen;
+            activity++;
+            break;
+
+        default:
+            printf("%s %i anomaly retval %i\n", __FILE__, __LINE__, retval);
+        }
+
+        command();
+
+        // closesocket may have deleted this
+        boost::unordered_map<int, class Pg *>::iterator it = ta->Pgs.find(fd);
+
+        if (it==ta->Pgs.end() || it->second != this || state==STATE_EXITING)
+        {
+            return;
+        }
+
+        size=0;
+        inbuf.clear();
+
+        if (isexecuting==true)
+        {
+            // resume() picks up the rest after the response is written
+            return;
+        }
+
+        if (pendingbuf.empty())
+        {
+            if (outbuflen && flushsocket()==-1)
+            {
+                closesocket(*taPtr);
+            }
+
+            return;
+        }
+
+        if (iswritepending==true && outbuflen >= PGOUTHIGHWATER)
+        {
+            // rewritesocket() resumes once the client reads
+            return;
+        }
+
+        newdata.clear();
+        newdata.swap(pendingbuf);
+    }
+}
 
-    case 0: // command not completely received
+void Pg::resume()
+{
+    if (state==STATE_EXITING || isexecuting==true)
+    {
         return;
-//        break;
+    }
 
-    case 1: // command completely received
-        pos = 0;
-        outbuf.clear();
-        break;
+    if (isreadpending==true)
+    {
+        // edge triggered, so read whatever arrived since
+        isreadpending=false;
 
-    default:
-        printf("%s %i anomaly retval %i\n", __FILE__, __LINE__, retval);
+        if (readsocket(pendingbuf)==false)
+        {
+            closesocket(*taPtr);
+            return;
+        }
+    }
+
+    if (pendingbuf.empty())
+    {
+        if (outbuflen && flushsocket()==-1)
+        {
+            closesocket(*taPtr);
+        }
+
+        return;
     }
 
+    string newdata;
+    newdata.swap(pendingbuf);
+    processinput(newdata);
+}
+
+void Pg::command()
+{
     // now, type & size are set.
 
+    if (state==STATE_ESTABLISHED || state==STATE_ABORTED)
+    {
+        bool isok=true;
+
+        switch (pgcmdtype)
+        {
+        case 'S':
+            syncmsg();
+            return;
+//            break;
+
+        case 'P':
+        case 'B':
+        case 'D':
+        case 'E':
+        case 'C':
+        case 'H':
+            isextendedquery=true;
+
+            if (isskippingtosync==true)
+            {
+                return;
+            }
+
+            switch (pgcmdtype)
+            {
+            case 'P':
+                isok=parsemsg();
+                break;
+
+            case 'B':
+                isok=bindmsg();
+                break;
+
+            case 'D':
+                isok=describemsg();
+                break;
+
+            case 'E':
+                isok=executemsg();
+                break;
+
+            case 'C':
+                isok=closemsg();
+                break;
+
+            case 'H':
+                isok=(flushsocket() != -1);
+                break;
+
+            default:
+                ;
+            }
+
+            if (isok==false)
+            {
+                closesocket(*taPtr);
+            }
+
+            return;
+//            break;
+
+        case 'd':
+        case 'c':
+        case 'f':
+            // rest of a COPY FROM STDIN that failed
+            return;
+//            break;
+
+        default:
+            ;
+        }
+    }
+
     switch (state)
     {
     case STATE_BEGIN:
@@ -145,7 +339,7 @@ void Pg::cont()
                 return;
             }
 
-            outbuf.assign("N");
+            outappend("N", 1);
 
             if (writesocket()==-1)
             {
@@ -334,6 +528,37 @@ void Pg::cont()
     }
     break;
 
+    case STATE_COPYIN:
+    {
+        switch (pgcmdtype)
+        {
+        case 'd':
+            copydatamsg();
+            break;
+
+        case 'c':
+            copydonemsg();
+            break;
+
+        case 'f':
+            copyfailmsg();
+            break;
+
+        case 'H':
+        case 'S':
+            // ignored during COPY FROM STDIN
+            break;
+
+        case 'X':
+            closesocket(*taPtr);
+            break;
+
+        default:
+            copyerror("08P01", "unexpected message type during COPY FROM STDIN");
+        }
+    }
+    break;
+
     default:
         printf("%s %i anomaly state %i\n", __FILE__, __LINE__, state);
     }
@@ -391,22 +616,48 @@ void Pg::closesocket(class TransactionAgent &taRef)
     }
 }
 
+bool Pg::ismigratable()
+{
+    return state==STATE_ESTABLISHED && transactionPtr==NULL &&
+        statementPtr==NULL && isintransactionblock==false &&
+        isextendedquery==false && isexecuting==false &&
+        isreadpending==false && isrollingback==false && isstreaming==false &&
+        iscopyout==false &&
+        iswritepending==false && outbuflen==0 && pendingbuf.empty() &&
+        portals.empty();
+}
+
+void Pg::rebind(class TransactionAgent *taPtrarg)
+{
+    taPtr = taPtrarg;
+    taPtr->Pgs[sockfd]=this;
+    schemaPtr = NULL;
+
+    domainidToSchemaMap::iterator it = taPtr->domainidsToSchemata.find(domainid);
+
+    if (it != taPtr->domainidsToSchemata.end())
+    {
+        schemaPtr = it->second;
+    }
+
+    boost::unordered_map<std::string, preparedStatement_s>::iterator psIt;
+
+    for (psIt = preparedStatements.begin(); psIt != preparedStatements.end();
+         ++psIt)
+    {
+        psIt->second.statementPtr->taPtr = taPtr;
+        psIt->second.statementPtr->schemaPtr = schemaPtr;
+    }
+}
+
 void Pg::pgclosesocket(class TransactionAgent &taRef, int socketfd)
 {
 //  taRef.Pgs.erase(socketfd);
     // NEW WAY
-    epoll_ctl(taRef.myIdentity.epollfd, EPOLL_CTL_DEL, socketfd, NULL);
-    if (socketfd <= NUMSOCKETS)
-    {
-        pthread_mutex_lock(&connectionsMutex);
-        socketAffinity[socketfd]=0;
-        listenerTypes[socketfd]=LISTENER_NONE;
-        pthread_mutex_unlock(&connectionsMutex);
-    }
-    else
+    epoll_ctl(taRef.epollfd, EPOLL_CTL_DEL, socketfd, NULL);
+    if ((size_t)socketfd < taRef.socketTypes.size())
     {
-        fprintf(logfile, "%s %i fd %i > %i\n", __FILE__, __LINE__, socketfd,
-                NUMSOCKETS);
+        taRef.socketTypes[socketfd]=LISTENER_NONE;
     }
     taRef.Pgs.erase(socketfd);
     close(socketfd);
@@ -459,15 +710,23 @@ short Pg::initcmd(string &newdata)
         return 1;
     }
 
+    if (size >= sizeof(size) && inbuf.size() + sizeof(size) > size)
+    {
+        // got whole thing and the start of the next, hold the rest
+        pendingbuf.insert(0, inbuf, size - sizeof(size), string::npos);
+        inbuf.resize(size - sizeof(size));
+        return 1;
+    }
+
     if (inbuf.size() + sizeof(size) < size)
     {
-        // wait for more
-        fprintf(logfile, "%s %i sockfd %i pgcmdtype %c inbuf.size() %lu sizeof(size) %lu size %u state %i '%s'\n", __FILE__, __LINE__, sockfd, pgcmdtype,
-                inbuf.size(), sizeof(size), size, state, inbuf.c_str());
+        // wait for more, routine for CopyData spanning recv() calls
         return 0;
     }
 
     // bogus data
+    fprintf(logfile, "%s %i sockfd %i pgcmdtype %c bogus size %u state %i\n",
+            __FILE__, __LINE__, sockfd, pgcmdtype, size, state);
     return -1;
 }
 
@@ -718,18 +977,126 @@ void Pg::put(char *val)
 void Pg::replymsg()
 {
     uint32_t osize = htobe32((uint32_t)outmsg.size() + sizeof(osize));
-    string prependstr(sizeof(osize) + sizeof(outcmd), '\0');
-    prependstr[0] = outcmd;
-    memcpy(&prependstr[1], &osize, sizeof(osize));
-    outmsg.insert(0, prependstr);
-    outbuf.append(outmsg);
+    char header[sizeof(outcmd) + sizeof(osize)];
+    header[0] = outcmd;
+    memcpy(&header[1], &osize, sizeof(osize));
+    outappend(header, sizeof(header));
+    outappend(outmsg.data(), outmsg.size());
 
+    // keeps its capacity for the next message
     outmsg.clear();
 }
 
+void Pg::outappend(const char *data, size_t len)
+{
+    while (len)
+    {
+        if (outchunks.empty() || outchunks.back().size() >= PGOUTCHUNKSIZE)
+        {
+            outchunks.push_back(string());
+
+            if (!freechunks.empty())
+            {
+                outchunks.back().swap(freechunks.back());
+                freechunks.pop_back();
+            }
+            else
+            {
+                outchunks.back().reserve(PGOUTCHUNKSIZE);
+            }
+        }
+
+        string &chunk = outchunks.back();
+        size_t n = PGOUTCHUNKSIZE - chunk.size();
+
+        if (n > len)
+        {
+            n = len;
+        }
+
+        chunk.append(data, n);
+        data += n;
+        len -= n;
+        outbuflen += n;
+    }
+}
+
+void Pg::outconsume(size_t len)
+{
+    outbuflen -= len;
+    size_t nchunks = 0;
+
+    while (len)
+    {
+        size_t avail = outchunks[nchunks].size() - outchunkpos;
+
+        if (len < avail)
+        {
+            outchunkpos += len;
+            break;
+        }
+
+        len -= avail;
+        outchunkpos = 0;
+        outrecycle(outchunks[nchunks++]);
+    }
+
+    outchunks.erase(outchunks.begin(), outchunks.begin() + nchunks);
+}
+
+void Pg::outtruncate(size_t len)
+{
+    size_t drop = outbuflen - len;
+
+    while (drop)
+    {
+        string &chunk = outchunks.back();
+        size_t avail = chunk.size() - (outchunks.size()==1 ? outchunkpos : 0);
+
+        if (drop < avail)
+        {
+            chunk.resize(chunk.size() - drop);
+            break;
+        }
+
+        drop -= avail;
+        outrecycle(chunk);
+        outchunks.pop_back();
+
+        if (outchunks.empty())
+        {
+            outchunkpos = 0;
+        }
+    }
+
+    outbuflen = len;
+}
+
+void Pg::outrecycle(string &chunk)
+{
+    if (freechunks.size() < PGOUTFREECHUNKS)
+    {
+        chunk.clear();
+        freechunks.push_back(string());
+        freechunks.back().swap(chunk);
+    }
+}
+
 // put ReadyForQuery at the end
 short Pg::writesocket()
 {
+    if (isexecuting==true && isrollingback==false)
+    {
+        // statement's response is complete
+        executed();
+    }
+
+    if (isextendedquery==true)
+    {
+        // ReadyForQuery waits for Sync
+        return coalescesocket();
+    }
+
     if (state==STATE_ESTABLISHED)
     {
         outcmd='Z';
@@ -752,26 +1119,48 @@ short Pg::writesocket()
         replymsg();
     }
 
-    size_t curpos = 0;
-    size_t outbuflen = outbuf.size();
+    return coalescesocket();
+}
 
-    while (curpos < outbuflen)
+short Pg::flushsocket()
+{
+    while (outbuflen)
     {
-        ssize_t sent = send(sockfd, &outbuf[curpos],
-                            (outbuflen-curpos) >= 8192 ? 8192 :
-                            outbuflen-curpos, 0);
+        struct iovec iov[PGOUTIOVMAX];
+        int iovcnt = 0;
+
+        for (size_t n=0; n < outchunks.size() && iovcnt < PGOUTIOVMAX; n++)
+        {
+            size_t offset = n ? 0 : outchunkpos;
+            iov[iovcnt].iov_base = &outchunks[n][offset];
+            iov[iovcnt].iov_len = outchunks[n].size() - offset;
+            iovcnt++;
+        }
+
+        ssize_t sent = writev(sockfd, iov, iovcnt);
 
         if (sent == -1)
         {
+            if (errno==EINTR)
+            {
+                continue;
+            }
+
             if (errno==EAGAIN || errno==EWOULDBLOCK)
             {
-                string backgroundstr = outbuf.substr(curpos, string::npos);
-                outbuf.swap(backgroundstr);
-                struct epoll_event epevent;
-                epevent.events = EPOLLOUT | EPOLLHUP | EPOLLET;
-                epevent.data.fd = sockfd;
-                epoll_ctl(taPtr->myIdentity.epollfd, EPOLL_CTL_MOD, sockfd,
-                          &epevent);
+                // what's left is committed, including partial messages
+                outbufmark = outbuflen;
+
+                if (iswritepending==false)
+                {
+                    iswritepending=true;
+                    struct epoll_event epevent;
+                    epevent.events = EPOLLOUT | EPOLLHUP | EPOLLET;
+                    epevent.data.fd = sockfd;
+                    epoll_ctl(taPtr->epollfd, EPOLL_CTL_MOD, sockfd,
+                              &epevent);
+                }
+
                 return 1;
             }
 
@@ -779,44 +1168,77 @@ short Pg::writesocket()
             return -1;
         }
 
-        curpos += sent;
+        outconsume(sent);
     }
 
-    outbuf.clear();
-    return 0;
-}
-
-short Pg::rewritesocket()
-{
-    switch (writesocket())
-    {
-    case -1:
-        return -1;
-//        break;
+    outbufmark = 0;
 
-    case 0:
+    if (iswritepending==true)
     {
+        iswritepending=false;
         struct epoll_event epevent;
         epevent.events = EPOLLIN | EPOLLHUP | EPOLLET;
         epevent.data.fd=sockfd;
-        epoll_ctl(taPtr->myIdentity.epollfd, EPOLL_CTL_MOD, sockfd, &epevent);
-        return 0;
+        epoll_ctl(taPtr->epollfd, EPOLL_CTL_MOD, sockfd, &epevent);
     }
-    break;
 
-    case 1:
-        return 1;
-//        break;
+    return 0;
+}
 
-    default:
-        printf("%s %i anomaly WTF\n", __FILE__, __LINE__);
-        return -1;
+short Pg::coalescesocket()
+{
+    if (outbuflen < PGCOALESCEMAX && isinputqueued()==true)
+    {
+        // processinput() or resume() sends it after the batch
+        return 0;
     }
+
+    return flushsocket();
 }
 
-void Pg::continueLogin(int cmdstate, class MessageUserSchema &msgrcvref)
+bool Pg::isinputqueued()
 {
-    if (msgrcvref.userschemaStruct.status==STATUS_OK)
+    if (isreadpending==true)
+    {
+        return true;
+    }
+
+    if (pendingbuf.size() < sizeof(size)+1)
+    {
+        return false;
+    }
+
+    uint32_t nextsize;
+    memcpy(&nextsize, &pendingbuf[1], sizeof(nextsize));
+
+    return pendingbuf.size() >= (size_t)be32toh(nextsize)+1;
+}
+
+short Pg::rewritesocket()
+{
+    short retval = flushsocket();
+
+    if (retval != 0)
+    {
+        return retval;
+    }
+
+    if (isstreaming==true)
+    {
+        selectRows();
+    }
+    else if (isexecuting==false && !pendingbuf.empty())
+    {
+        // input held while output was full
+        taPtr->pgsToResume.push_back(sockfd);
+    }
+
+    return 0;
+}
+
+void Pg::continueLogin(int cmdstate, class MessageUserSchema &msgrcvref)
+{
+    if (msgrcvref.userschemaStruct.status==STATUS_OK)
     {
         userid = msgrcvref.userschemaStruct.userid;
         domainid = msgrcvref.userschemaStruct.domainid;
@@ -825,52 +1247,2587 @@ void Pg::continueLogin(int cmdstate, class MessageUserSchema &msgrcvref)
         procedureprefix.append("_");
         schemaPtr = taPtr->domainidsToSchemata[domainid];
 
-        putAuthenticationOk();
-    }
-    else // STATUS_NOTOK
-    {
-        putErrorResponse("FATAL", "28P01", "authenticationfailure");
+        putAuthenticationOk();
+    }
+    else // STATUS_NOTOK
+    {
+        putErrorResponse("FATAL", "28P01", "authenticationfailure");
+    }
+}
+
+void Pg::executeStatement(string &stmtstr)
+{
+    if (iscopyout==false && executeCopy(stmtstr)==true)
+    {
+        return;
+    }
+
+    vector<string> parameters;
+    statementPtr=cachedStatement(stmtstr, parameters);
+
+    if (statementPtr==NULL)
+    {
+        parameters.clear();
+        class Larxer lx((char *)stmtstr.c_str(), taPtr, schemaPtr);
+
+        if (lx.statementPtr==NULL)
+        {
+            iscopyout=false;
+            putErrorResponse("ERROR", "42601", "syntax error");
+            return;
+        }
+
+        statementPtr=lx.statementPtr;
+
+        if (statementPtr->resolveTableFields()==false)
+        {
+            iscopyout=false;
+            sqlrollbackimplicit();
+            putErrorResponse("ERROR", "42704", "table or column does not exist");
+            delete statementPtr;
+            return;
+        }
+    }
+
+    if (iscopyout==true && statementPtr->queries[0].type != CMD_SELECT)
+    {
+        iscopyout=false;
+        putErrorResponse("ERROR", "0A000", "COPY query must be a SELECT");
+        delete statementPtr;
+        return;
+    }
+
+    if (statementPtr->queries[0].type==CMD_STOREDPROCEDURE)
+    {
+        statementPtr->queries[0].storedProcedure.insert(0, procedureprefix);
+    }
+
+    results = results_s();
+
+    if (transactionPtr==NULL)
+    {
+        command_autocommit=true;
+    }
+    else
+    {
+        command_autocommit=false;
+    }
+
+    resultformats.clear();
+    selectrows=0;
+    maxrows=SIZE_MAX;
+    executingportal.clear();
+    // COPY TO STDOUT puts every row at once
+    statementPtr->iscursor = !iscopyout;
+    cursorowner = ++lastcursorowner;
+    statementPtr->cursorowner = cursorowner;
+    isexecuting=true;
+    statementPtr->execute(this, &ApiInterface::continuePgFunc, 1, transactionPtr,
+                          transactionPtr, parameters);
+}
+
+class Statement *Pg::cachedStatement(string &stmtstr,
+                                     vector<string> &parameters)
+{
+    string key;
+
+    if (StatementCache::normalize(stmtstr, key, parameters)==false)
+    {
+        return NULL;
+    }
+
+    class StatementCache &cacheRef = taPtr->statementCache;
+    class Statement *templatePtr;
+
+    if (cacheRef.get(schemaPtr->domainid, key, &templatePtr)==false)
+    {
+        class Larxer lx((char *)key.c_str(), taPtr, schemaPtr);
+        templatePtr=lx.statementPtr;
+
+        if (templatePtr != NULL)
+        {
+            switch (templatePtr->queries[0].type)
+            {
+            case CMD_SELECT:
+            case CMD_INSERT:
+            case CMD_UPDATE:
+            case CMD_DELETE:
+                if (templatePtr->resolveTableFields()==false)
+                {
+                    // same names as stmtstr, so let it fail the same way
+                    delete templatePtr;
+                    return NULL;
+                }
+
+                break;
+
+            default:
+                delete templatePtr;
+                templatePtr=NULL;
+            }
+        }
+
+        // NULL if literal is where grammar doesn't take a parameter, or
+        // not SELECT, INSERT, UPDATE or DELETE: parse stmtstr instead
+        cacheRef.put(schemaPtr->domainid, key, templatePtr);
+    }
+
+    if (templatePtr==NULL)
+    {
+        return NULL;
+    }
+
+    // template is already resolved, only parameters differ
+    class Statement *stmtPtr = new class Statement;
+    *stmtPtr = *templatePtr;
+
+    return stmtPtr;
+}
+
+bool Pg::parsemsg()
+{
+    string name;
+    string query;
+    int16_t nparams;
+    vector<int32_t> paramtypes;
+
+    if (get(name)==false || get(query)==false || get(&nparams)==false ||
+        nparams < 0 || get(paramtypes, nparams)==false)
+    {
+        return false;
+    }
+
+    if (!name.empty() && preparedStatements.count(name))
+    {
+        putErrorResponse("ERROR", "42P05", "prepared statement already exists");
+        return true;
+    }
+
+    class Larxer lx((char *)query.c_str(), taPtr, schemaPtr);
+
+    if (lx.statementPtr==NULL)
+    {
+        putErrorResponse("ERROR", "42601", "syntax error");
+        return true;
+    }
+
+    class Statement *stmtPtr=lx.statementPtr;
+
+    if (stmtPtr->resolveTableFields()==false)
+    {
+        delete stmtPtr;
+        sqlrollbackimplicit();
+        putErrorResponse("ERROR", "42704", "table or column does not exist");
+        return true;
+    }
+
+    Statement::query_s &queryRef = stmtPtr->queries[0];
+
+    if (queryRef.type==CMD_STOREDPROCEDURE)
+    {
+        queryRef.storedProcedure.insert(0, procedureprefix);
+    }
+
+    preparedStatement_s &preparedRef = preparedStatements[name];
+
+    if (preparedRef.statementPtr != NULL)
+    {
+        // unnamed statement is replaced
+        delete preparedRef.statementPtr;
+    }
+
+    preparedRef.statementPtr=stmtPtr;
+    preparedRef.paramtypes.swap(paramtypes);
+
+    if (preparedRef.paramtypes.size() < stmtPtr->countParameters())
+    {
+        preparedRef.paramtypes.resize(stmtPtr->countParameters(), 0);
+    }
+
+    inferParameterTypes(*stmtPtr, preparedRef.paramtypes);
+    preparedRef.fields.clear();
+
+    if (queryRef.type==CMD_SELECT && schemaPtr->tables.count(queryRef.tableid))
+    {
+        class Table &tableRef = *schemaPtr->tables[queryRef.tableid];
+
+        for (size_t n=0; n < queryRef.fromColumnids.size(); n++)
+        {
+            preparedRef.fields.push_back(
+                {tableRef.fields[queryRef.fromColumnids[n].fieldid].type,
+                 queryRef.fromColumnids[n].name});
+        }
+    }
+
+    // ParseComplete
+    outcmd='1';
+    replymsg();
+
+    return true;
+}
+
+bool Pg::bindmsg()
+{
+    string portalname;
+    string stmtname;
+    int16_t nformats;
+    vector<int16_t> formats;
+    int16_t nparams;
+
+    if (get(portalname)==false || get(stmtname)==false ||
+        get(&nformats)==false || nformats < 0 ||
+        get(formats, nformats)==false || get(&nparams)==false ||
+        nparams < 0 || (nformats > 1 && nformats != nparams))
+    {
+        return false;
+    }
+
+    boost::unordered_map<std::string, preparedStatement_s>::iterator it;
+    it = preparedStatements.find(stmtname);
+
+    if (it==preparedStatements.end())
+    {
+        putErrorResponse("ERROR", "26000", "prepared statement does not exist");
+        return true;
+    }
+
+    preparedStatement_s &preparedRef = it->second;
+
+    if ((size_t)nparams != preparedRef.paramtypes.size())
+    {
+        putErrorResponse("ERROR", "08P01",
+                         "bind message supplies wrong number of parameters");
+        return true;
+    }
+
+    if (!portalname.empty() && portals.count(portalname))
+    {
+        putErrorResponse("ERROR", "42P03", "portal already exists");
+        return true;
+    }
+
+    vector<string> parameters(nparams);
+
+    for (int16_t n=0; n < nparams; n++)
+    {
+        int32_t len;
+
+        if (get(&len)==false)
+        {
+            return false;
+        }
+
+        if (len==-1)
+        {
+            parameters[n].assign(1, OPERAND_NULL);
+            continue;
+        }
+
+        string val;
+
+        if (len < 0 || get(val, len)==false)
+        {
+            return false;
+        }
+
+        int16_t format = nformats ? formats[nformats==1 ? 0 : n] : 0;
+
+        if (bindParameter(preparedRef.paramtypes[n], format, val,
+                          parameters[n])==false)
+        {
+            putErrorResponse("ERROR", "22P02",
+                             "invalid input syntax for parameter");
+            return true;
+        }
+    }
+
+    int16_t nresultformats;
+    vector<int16_t> resultformats;
+
+    if (get(&nresultformats)==false || nresultformats < 0 ||
+        get(resultformats, nresultformats)==false)
+    {
+        return false;
+    }
+
+    if (nresultformats > 1 &&
+        (size_t)nresultformats != preparedRef.fields.size())
+    {
+        putErrorResponse("ERROR", "08P01",
+                         "bind message has wrong number of result formats");
+        return true;
+    }
+
+    for (size_t n=0; n < resultformats.size(); n++)
+    {
+        if (resultformats[n] != 0 && resultformats[n] != 1)
+        {
+            putErrorResponse("ERROR", "22023", "unsupported format code");
+            return true;
+        }
+    }
+
+    portal_s &portalRef = portals[portalname];
+    // unnamed portal is replaced
+    closePortal(portalRef);
+
+    // template is already resolved, only parameters differ
+    portalRef.statementPtr = new class Statement;
+    *portalRef.statementPtr = *preparedRef.statementPtr;
+    portalRef.parameters.swap(parameters);
+    portalRef.fields = preparedRef.fields;
+
+    // one format for every column, or one for each
+    if (nresultformats==1)
+    {
+        portalRef.resultformats.assign(portalRef.fields.size(),
+                                       resultformats[0]);
+    }
+    else
+    {
+        portalRef.resultformats.swap(resultformats);
+    }
+
+    // BindComplete
+    outcmd='2';
+    replymsg();
+
+    return true;
+}
+
+bool Pg::describemsg()
+{
+    char type;
+    string name;
+
+    if (get(&type)==false || get(name)==false)
+    {
+        return false;
+    }
+
+    const vector<fieldtypename_s> *fields;
+    // statement's result formats aren't known until Bind
+    const vector<int16_t> textformats;
+    const vector<int16_t> *formats = &textformats;
+
+    if (type=='S')
+    {
+        boost::unordered_map<std::string, preparedStatement_s>::iterator it;
+        it = preparedStatements.find(name);
+
+        if (it==preparedStatements.end())
+        {
+            putErrorResponse("ERROR", "26000",
+                             "prepared statement does not exist");
+            return true;
+        }
+
+        // ParameterDescription
+        outcmd='t';
+        put((int16_t)it->second.paramtypes.size());
+        put(it->second.paramtypes);
+        replymsg();
+        fields = &it->second.fields;
+    }
+    else if (type=='P')
+    {
+        boost::unordered_map<std::string, portal_s>::iterator it;
+        it = portals.find(name);
+
+        if (it==portals.end())
+        {
+            putErrorResponse("ERROR", "34000", "portal does not exist");
+            return true;
+        }
+
+        fields = &it->second.fields;
+        formats = &it->second.resultformats;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (fields->empty())
+    {
+        // NoData
+        outcmd='n';
+        replymsg();
+    }
+    else
+    {
+        putRowDescription(*fields, *formats);
+    }
+
+    return true;
+}
+
+bool Pg::executemsg()
+{
+    string portalname;
+    int32_t maxrowsarg;
+
+    if (get(portalname)==false || get(&maxrowsarg)==false)
+    {
+        return false;
+    }
+
+    boost::unordered_map<std::string, portal_s>::iterator it;
+    it = portals.find(portalname);
+
+    if (it==portals.end())
+    {
+        putErrorResponse("ERROR", "34000", "portal does not exist");
+        return true;
+    }
+
+    selectrows=0;
+    maxrows = maxrowsarg > 0 ? (size_t)maxrowsarg : SIZE_MAX;
+    executingportal=portalname;
+
+    if (it->second.issuspended==true)
+    {
+        if (state==STATE_ABORTED)
+        {
+            putErrorResponse("ERROR", "25P02", "current transaction is aborted, commands ignored until end of transaction block");
+            return true;
+        }
+
+        resumePortal(it->second);
+        return true;
+    }
+
+    if (it->second.statementPtr==NULL)
+    {
+        putErrorResponse("ERROR", "55000", "portal has already been executed");
+        return true;
+    }
+
+    statementPtr=it->second.statementPtr;
+    it->second.statementPtr=NULL;
+
+    if (state==STATE_ABORTED)
+    {
+        if (statementPtr->queries[0].type==CMD_COMMIT ||
+            statementPtr->queries[0].type==CMD_ROLLBACK)
+        {
+            putCommandComplete("ROLLBACK");
+            state=STATE_ESTABLISHED;
+            isintransactionblock=false;
+        }
+        else
+        {
+            putErrorResponse("ERROR", "25P02", "current transaction is aborted, commands ignored until end of transaction block");
+        }
+
+        delete statementPtr;
+        statementPtr=NULL;
+        return true;
+    }
+
+    results = results_s();
+
+    if (transactionPtr==NULL)
+    {
+        command_autocommit=true;
+    }
+    else
+    {
+        command_autocommit=false;
+    }
+
+    isexecuting=true;
+    resultformats = it->second.resultformats;
+    statementPtr->iscursor=true;
+    cursorowner = ++lastcursorowner;
+    statementPtr->cursorowner = cursorowner;
+    statementPtr->execute(this, &ApiInterface::continuePgFunc, 1, transactionPtr,
+                          transactionPtr, it->second.parameters);
+
+    return true;
+}
+
+bool Pg::closemsg()
+{
+    char type;
+    string name;
+
+    if (get(&type)==false || get(name)==false)
+    {
+        return false;
+    }
+
+    if (type=='S')
+    {
+        boost::unordered_map<std::string, preparedStatement_s>::iterator it;
+        it = preparedStatements.find(name);
+
+        if (it != preparedStatements.end())
+        {
+            delete it->second.statementPtr;
+            preparedStatements.erase(it);
+        }
+    }
+    else if (type=='P')
+    {
+        boost::unordered_map<std::string, portal_s>::iterator it;
+        it = portals.find(name);
+
+        if (it != portals.end())
+        {
+            closePortal(it->second);
+            portals.erase(it);
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    // CloseComplete
+    outcmd='3';
+    replymsg();
+
+    return true;
+}
+
+void Pg::syncmsg()
+{
+    isextendedquery=false;
+    isskippingtosync=false;
+
+    if (isimplicittransaction==true)
+    {
+        // left open for a suspended portal, ends now as it would have
+        // after that portal's Execute
+        isimplicittransaction=false;
+        clearPortals();
+        isexecuting=true;
+        sqlcommitimplicit();
+        return;
+    }
+
+    if (transactionPtr==NULL)
+    {
+        // portals live until end of transaction
+        clearPortals();
+    }
+
+    if (writesocket()==-1)
+    {
+        closesocket(*taPtr);
+    }
+}
+
+bool Pg::bindParameter(int32_t oid, int16_t format, const string &val,
+                       string &operand)
+{
+    if (format==1)
+    {
+        return bindBinaryParameter(oid, val, operand);
+    }
+
+    if (format != 0)
+    {
+        return false;
+    }
+
+    const char *str = val.c_str();
+    char *endptr;
+
+    switch (oid)
+    {
+    case INT2OID:
+    case INT4OID:
+    case INT8OID:
+    {
+        int64_t integer = strtol(str, &endptr, 10);
+
+        if (val.empty() || *endptr != '\0')
+        {
+            return false;
+        }
+
+        operand.assign(1 + sizeof(integer), char(0));
+        operand[0]=OPERAND_INTEGER;
+        memcpy(&operand[1], &integer, sizeof(integer));
+    }
+    break;
+
+    case FLOAT4OID:
+    case FLOAT8OID:
+    case NUMERICOID:
+    {
+        long double floating = strtold(str, &endptr);
+
+        if (val.empty() || *endptr != '\0')
+        {
+            return false;
+        }
+
+        operand.assign(1 + sizeof(floating), char(0));
+        operand[0]=OPERAND_FLOAT;
+        memcpy(&operand[1], &floating, sizeof(floating));
+    }
+    break;
+
+    case BOOLOID:
+        if (val=="t" || val=="true" || val=="1")
+        {
+            operand.assign(1, OPERAND_BOOLEAN).append(1, 't');
+        }
+        else if (val=="f" || val=="false" || val=="0")
+        {
+            operand.assign(1, OPERAND_BOOLEAN).append(1, 'f');
+        }
+        else
+        {
+            return false;
+        }
+
+        break;
+
+    case 0:
+    case UNKNOWNOID:
+    {
+        // nothing to go on, so take it the way the lexer would
+        int64_t integer = strtol(str, &endptr, 10);
+
+        if (!val.empty() && *endptr == '\0')
+        {
+            operand.assign(1 + sizeof(integer), char(0));
+            operand[0]=OPERAND_INTEGER;
+            memcpy(&operand[1], &integer, sizeof(integer));
+            break;
+        }
+
+        long double floating = strtold(str, &endptr);
+
+        if (!val.empty() && *endptr == '\0')
+        {
+            operand.assign(1 + sizeof(floating), char(0));
+            operand[0]=OPERAND_FLOAT;
+            memcpy(&operand[1], &floating, sizeof(floating));
+            break;
+        }
+
+        operand.assign(1, OPERAND_STRING).append(val);
+    }
+    break;
+
+    default:
+        operand.assign(1, OPERAND_STRING).append(val);
+    }
+
+    return true;
+}
+
+bool Pg::bindBinaryParameter(int32_t oid, const string &val, string &operand)
+{
+    int64_t integer;
+    double floating;
+
+    switch (oid)
+    {
+    case INT2OID:
+    {
+        int16_t val16;
+
+        if (val.size() != sizeof(val16))
+        {
+            return false;
+        }
+
+        memcpy(&val16, val.c_str(), sizeof(val16));
+        integer = (int16_t)be16toh(val16);
+    }
+    break;
+
+    case INT4OID:
+    {
+        int32_t val32;
+
+        if (val.size() != sizeof(val32))
+        {
+            return false;
+        }
+
+        memcpy(&val32, val.c_str(), sizeof(val32));
+        integer = (int32_t)be32toh(val32);
+    }
+    break;
+
+    case INT8OID:
+        if (val.size() != sizeof(integer))
+        {
+            return false;
+        }
+
+        memcpy(&integer, val.c_str(), sizeof(integer));
+        integer = be64toh(integer);
+        break;
+
+    case FLOAT4OID:
+    {
+        uint32_t bits;
+        float val32;
+
+        if (val.size() != sizeof(bits))
+        {
+            return false;
+        }
+
+        memcpy(&bits, val.c_str(), sizeof(bits));
+        bits = be32toh(bits);
+        memcpy(&val32, &bits, sizeof(val32));
+        floating = val32;
+    }
+    break;
+
+    case FLOAT8OID:
+    {
+        uint64_t bits;
+
+        if (val.size() != sizeof(bits))
+        {
+            return false;
+        }
+
+        memcpy(&bits, val.c_str(), sizeof(bits));
+        bits = be64toh(bits);
+        memcpy(&floating, &bits, sizeof(floating));
+    }
+    break;
+
+    case BOOLOID:
+        if (val.size() != 1)
+        {
+            return false;
+        }
+
+        operand.assign(1, OPERAND_BOOLEAN).append(1, val[0] ? 't' : 'f');
+        return true;
+//        break;
+
+    case CHAROID:
+    case BPCHAROID:
+    case VARCHAROID:
+    case TEXTOID:
+    case NAMEOID:
+        // binary is the same as text for strings
+        operand.assign(1, OPERAND_STRING).append(val);
+        return true;
+//        break;
+
+    default:
+        return false;
+    }
+
+    if (oid==FLOAT4OID || oid==FLOAT8OID)
+    {
+        long double ldfloating = floating;
+        operand.assign(1 + sizeof(ldfloating), char(0));
+        operand[0]=OPERAND_FLOAT;
+        memcpy(&operand[1], &ldfloating, sizeof(ldfloating));
+    }
+    else
+    {
+        operand.assign(1 + sizeof(integer), char(0));
+        operand[0]=OPERAND_INTEGER;
+        memcpy(&operand[1], &integer, sizeof(integer));
+    }
+
+    return true;
+}
+
+void Pg::inferParameterTypes(class Statement &stmtRef,
+                             vector<int32_t> &paramtypes)
+{
+    for (size_t n=0; n < stmtRef.queries.size(); n++)
+    {
+        Statement::query_s &queryRef = stmtRef.queries[n];
+
+        if (!schemaPtr->tables.count(queryRef.tableid))
+        {
+            continue;
+        }
+
+        class Table &tableRef = *schemaPtr->tables[queryRef.tableid];
+        inferParameterTypes(queryRef.searchCondition, tableRef, paramtypes);
+
+        boost::unordered_map<int64_t, class Ast *>::iterator it;
+
+        for (it = queryRef.fieldidAssignments.begin();
+             it != queryRef.fieldidAssignments.end(); ++it)
+        {
+            if (it->second->isoperator==false)
+            {
+                setParameterType(it->second->operand,
+                                 tableRef.fields[it->first].type, paramtypes);
+            }
+            else
+            {
+                inferParameterTypes(it->second, tableRef, paramtypes);
+            }
+        }
+
+        // insertColumns are in reverse field order
+        size_t numfields = queryRef.insertColumns.size();
+
+        for (size_t m=0; m < numfields && m < tableRef.fields.size(); m++)
+        {
+            class Ast *astPtr = queryRef.insertColumns[numfields-1-m];
+
+            if (astPtr->isoperator==false)
+            {
+                setParameterType(astPtr->operand, tableRef.fields[m].type,
+                                 paramtypes);
+            }
+        }
+    }
+}
+
+void Pg::inferParameterTypes(class Ast *astPtr, class Table &tableRef,
+                             vector<int32_t> &paramtypes)
+{
+    if (astPtr==NULL || astPtr->isoperator==false)
+    {
+        return;
+    }
+
+    class Ast *leftPtr = astPtr->leftchild==astPtr ? NULL : astPtr->leftchild;
+    class Ast *rightPtr = astPtr->rightchild;
+
+    if (leftPtr != NULL && rightPtr != NULL && leftPtr->isoperator==false &&
+        rightPtr->isoperator==false)
+    {
+        // field compared to parameter, either way around
+        class Ast *fieldPtr = NULL;
+        class Ast *paramPtr = NULL;
+
+        if (leftPtr->operand[0]==OPERAND_FIELDID)
+        {
+            fieldPtr=leftPtr;
+            paramPtr=rightPtr;
+        }
+        else if (rightPtr->operand[0]==OPERAND_FIELDID)
+        {
+            fieldPtr=rightPtr;
+            paramPtr=leftPtr;
+        }
+
+        if (fieldPtr != NULL)
+        {
+            int64_t fieldid;
+            memcpy(&fieldid, &fieldPtr->operand[1], sizeof(fieldid));
+
+            if (fieldid >= 0 && (size_t)fieldid < tableRef.fields.size())
+            {
+                setParameterType(paramPtr->operand,
+                                 tableRef.fields[fieldid].type, paramtypes);
+            }
+        }
+
+        return;
+    }
+
+    inferParameterTypes(leftPtr, tableRef, paramtypes);
+    inferParameterTypes(rightPtr, tableRef, paramtypes);
+}
+
+void Pg::setParameterType(const string &operand, fieldtype_e type,
+                          vector<int32_t> &paramtypes)
+{
+    if (operand[0] != OPERAND_PARAMETER)
+    {
+        return;
+    }
+
+    int64_t paramnum;
+    memcpy(&paramnum, &operand[1], sizeof(paramnum));
+
+    if (paramnum < 0 || (size_t)paramnum >= paramtypes.size() ||
+        paramtypes[paramnum] != 0)
+    {
+        return;
+    }
+
+    switch (type)
+    {
+    case INT:
+    case UINT:
+        paramtypes[paramnum]=INT8OID;
+        break;
+
+    case BOOL:
+        paramtypes[paramnum]=BOOLOID;
+        break;
+
+    case FLOAT:
+        paramtypes[paramnum]=FLOAT8OID;
+        break;
+
+    case CHAR:
+        paramtypes[paramnum]=CHAROID;
+        break;
+
+    case CHARX:
+        paramtypes[paramnum]=BPCHAROID;
+        break;
+
+    case VARCHAR:
+        paramtypes[paramnum]=VARCHAROID;
+        break;
+
+    default:
+        ;
+    }
+}
+
+void Pg::clearPortals()
+{
+    boost::unordered_map<std::string, portal_s>::iterator it;
+
+    for (it = portals.begin(); it != portals.end(); ++it)
+    {
+        closePortal(it->second);
+    }
+
+    portals.clear();
+}
+
+void Pg::closePortal(portal_s &portalRef)
+{
+    if (portalRef.statementPtr != NULL)
+    {
+        delete portalRef.statementPtr;
+        portalRef.statementPtr=NULL;
+    }
+
+    if (portalRef.hascursor==true && transactionPtr != NULL &&
+        transactionPtr->cursor.isownedby(portalRef.cursorowner)==true)
+    {
+        transactionPtr->cursor = Transaction::cursor_s();
+    }
+
+    portalRef.issuspended=false;
+    portalRef.hascursor=false;
+    portalRef.results = results_s();
+}
+
+void Pg::executed()
+{
+    isexecuting=false;
+
+    if (!pendingbuf.empty() || isreadpending==true)
+    {
+        // TransactionAgent resumes input
+        taPtr->pgsToResume.push_back(sockfd);
+    }
+}
+
+bool Pg::executeCopy(string &stmtstr)
+{
+    copy_s newcopy = copy_s();
+    string tablename;
+    vector<string> columns;
+    string query;
+
+    size_t pos = stmtstr.find_first_not_of(" \t\r\n");
+
+    if (pos==string::npos || strncasecmp(&stmtstr[pos], "copy", 4) ||
+        (pos+4 < stmtstr.size() && !isspace(stmtstr[pos+4]) &&
+         stmtstr[pos+4] != '('))
+    {
+        return false;
+    }
+
+    if (parseCopy(stmtstr, newcopy, tablename, columns, query)==false)
+    {
+        putErrorResponse("ERROR", "42601",
+                         "syntax error, COPY supports FROM STDIN and TO STDOUT");
+        return true;
+    }
+
+    if (newcopy.isfrom==false)
+    {
+        // results come back through continuePgFunc as a SELECT
+        copystate = newcopy;
+
+        if (query.empty())
+        {
+            query.assign("SELECT ");
+
+            if (columns.empty())
+            {
+                query.append("*");
+            }
+
+            for (size_t n=0; n < columns.size(); n++)
+            {
+                query.append(n ? "," : "").append(columns[n]);
+            }
+
+            query.append(" FROM ").append(tablename);
+        }
+
+        iscopyout=true;
+        executeStatement(query);
+        return true;
+    }
+
+    if (!schemaPtr->tableNameToId.count(tablename))
+    {
+        putErrorResponse("ERROR", "42P01", "table does not exist");
+        return true;
+    }
+
+    newcopy.tableid = schemaPtr->tableNameToId[tablename];
+    class Table &tableRef = *schemaPtr->tables[newcopy.tableid];
+
+    if (columns.empty())
+    {
+        for (size_t n=0; n < tableRef.fields.size(); n++)
+        {
+            newcopy.fieldids.push_back(n);
+        }
+    }
+
+    for (size_t n=0; n < columns.size(); n++)
+    {
+        if (!tableRef.columnaNameToFieldMap.count(columns[n]))
+        {
+            putErrorResponse("ERROR", "42703", "column does not exist");
+            return true;
+        }
+
+        newcopy.fieldids.push_back(tableRef.columnaNameToFieldMap[columns[n]]);
+    }
+
+    for (size_t n=0; n < newcopy.fieldids.size(); n++)
+    {
+        newcopy.types.push_back(tableRef.fields[newcopy.fieldids[n]].type);
+    }
+
+    copystate = newcopy;
+
+    if (transactionPtr==NULL)
+    {
+        transactionPtr = new class Transaction(taPtr, domainid);
+        command_autocommit=true;
+    }
+    else
+    {
+        command_autocommit=false;
+    }
+
+    results = results_s();
+    results.transactionPtr = transactionPtr;
+    state = STATE_COPYIN;
+
+    // CopyInResponse
+    outcmd='G';
+    put((char)(copystate.format=='b' ? 1 : 0));
+    put((int16_t)copystate.types.size());
+
+    for (size_t n=0; n < copystate.types.size(); n++)
+    {
+        put((int16_t)(copystate.format=='b' ? 1 : 0));
+    }
+
+    replymsg();
+
+    if (flushsocket()==-1)
+    {
+        closesocket(*taPtr);
+    }
+
+    return true;
+}
+
+void Pg::copydatamsg()
+{
+    if (copystate.isdone==true)
+    {
+        // after end-of-data marker
+        return;
+    }
+
+    if (copystate.buf.empty())
+    {
+        copystate.buf.swap(inbuf);
+    }
+    else
+    {
+        copystate.buf.append(inbuf);
+    }
+
+    if (copyrows(false)==false)
+    {
+        return;
+    }
+
+    if (copystate.isbatchfull==true)
+    {
+        copyflush();
+    }
+}
+
+void Pg::copydonemsg()
+{
+    if (copyrows(true)==false)
+    {
+        return;
+    }
+
+    copystate.iscomplete=true;
+
+    if (copystate.batches.empty())
+    {
+        copyfinish();
+        return;
+    }
+
+    copyflush();
+}
+
+void Pg::copyfailmsg()
+{
+    string message;
+    get(message);
+    message.insert(0, "COPY from stdin failed: ");
+    copyerror("57014", (char *)message.c_str());
+}
+
+bool Pg::copyrows(bool isfinal)
+{
+    vector< vector<fieldValue_s> > rows;
+
+    if (parseCopyData(copystate, isfinal, rows)==false ||
+        (isfinal==true && copystate.isdone==false &&
+         !copystate.buf.empty()))
+    {
+        copyerror("22P04", "invalid COPY data");
+        return false;
+    }
+
+    class Table &tableRef = *schemaPtr->tables[copystate.tableid];
+    size_t numfields = tableRef.fields.size();
+    bool isinorder = (copystate.fieldids.size()==numfields);
+
+    for (size_t f=0; f < copystate.fieldids.size(); f++)
+    {
+        if (copystate.fieldids[f] != (int64_t)f)
+        {
+            isinorder=false;
+        }
+    }
+
+    for (size_t n=0; n < rows.size(); n++)
+    {
+        vector<fieldValue_s> fieldValues;
+
+        if (isinorder==true)
+        {
+            fieldValues.swap(rows[n]);
+        }
+        else
+        {
+            fieldValues.resize(numfields);
+
+            for (size_t f=0; f < numfields; f++)
+            {
+                fieldValues[f].isnull=true;
+            }
+
+            for (size_t c=0; c < rows[n].size(); c++)
+            {
+                fieldValues[copystate.fieldids[c]] = rows[n][c];
+            }
+        }
+
+        for (size_t f=0; f < numfields; f++)
+        {
+            if (fieldValues[f].isnull==true &&
+                (tableRef.fields[f].indextype==UNIQUENOTNULL ||
+                 tableRef.fields[f].indextype==NONUNIQUENOTNULL ||
+                 tableRef.fields[f].indextype==UNORDEREDNOTNULL))
+            {
+                copyerror("23502", "null value violates not-null constraint");
+                return false;
+            }
+        }
+
+        string row;
+
+        if (tableRef.makerow(&fieldValues, &row)==false)
+        {
+            copyerror("22P04", "invalid COPY data");
+            return false;
+        }
+
+        insertBatch_s &batchRef =
+            copystate.batches[transactionPtr->getengine(tableRef.fields[0].type,
+                                                        fieldValues[0])];
+        batchRef.rowbytes += row.size();
+        batchRef.rows.push_back(string());
+        batchRef.rows.back().swap(row);
+        batchRef.fieldValues.push_back(vector<fieldValue_s>());
+        batchRef.fieldValues.back().swap(fieldValues);
+        copystate.rows++;
+
+        if (batchRef.rows.size() >= COPYBATCHROWS ||
+            batchRef.rowbytes >= COPYBATCHBYTES)
+        {
+            copystate.isbatchfull=true;
+        }
+    }
+
+    return true;
+}
+
+void Pg::copyflush()
+{
+    copystate.isbatchfull=false;
+    isexecuting=true;
+
+    transactionPtr->reentryObject = this;
+    transactionPtr->reentryFuncPtr = &ApiInterface::continuePgFunc;
+    transactionPtr->reentryCmd = 2;
+    transactionPtr->reentryState = NULL;
+
+    transactionPtr->insertRows(copystate.tableid, copystate.batches);
+}
+
+void Pg::continueCopyIn()
+{
+    executed();
+
+    if (transactionPtr->resultCode != APISTATUS_OK)
+    {
+        int64_t status = transactionPtr->resultCode;
+        copystate = copy_s();
+        state = STATE_ESTABLISHED;
+        sqlrollbackimplicit();
+        errorStatus(status);
+        return;
+    }
+
+    if (copystate.iscomplete==true)
+    {
+        copyfinish();
+    }
+}
+
+void Pg::copyfinish()
+{
+    std::stringstream tag;
+    tag << "COPY " << copystate.rows;
+    putCommandComplete((char *)tag.str().c_str());
+
+    copystate = copy_s();
+    state = STATE_ESTABLISHED;
+
+    if (isintransactionblock==false && (session_isautocommit==true ||
+                                        command_autocommit==true))
+    {
+        sqlcommitimplicit();
+    }
+    else
+    {
+        if (writesocket()==-1)
+        {
+            closesocket(*taPtr);
+        }
+    }
+}
+
+void Pg::copyerror(char *code, char *message)
+{
+    copystate = copy_s();
+    state = STATE_ESTABLISHED;
+    sqlrollbackimplicit();
+    putErrorResponse("ERROR", code, message);
+}
+
+void Pg::putCopyData()
+{
+    int16_t numfields = (int16_t)results.selectFields.size();
+
+    // CopyOutResponse
+    outcmd='H';
+    put((char)(copystate.format=='b' ? 1 : 0));
+    put(numfields);
+
+    for (int16_t n=0; n < numfields; n++)
+    {
+        put((int16_t)(copystate.format=='b' ? 1 : 0));
+    }
+
+    replymsg();
+
+    if (copystate.format=='b')
+    {
+        outcmd='d';
+        put("PGCOPY\n\377\r\n", 11); // signature includes its '\0'
+        put((int32_t)0); // flags
+        put((int32_t)0); // header extension length
+        replymsg();
+    }
+    else if (copystate.format=='c' && copystate.isheader==true)
+    {
+        outcmd='d';
+
+        for (int16_t n=0; n < numfields; n++)
+        {
+            outmsg.append(n ? 1 : 0, copystate.delimiter);
+            outmsg.append(results.selectFields[n].name);
+        }
+
+        outmsg.append(1, '\n');
+        replymsg();
+    }
+
+    boost::unordered_map< uuRecord_s, vector<fieldValue_s> >::const_iterator it;
+    string val;
+
+    for (it = results.selectResults.begin(); it != results.selectResults.end();
+         it++)
+    {
+        const vector<fieldValue_s> &fieldValues = it->second;
+        outcmd='d';
+
+        if (copystate.format=='b')
+        {
+            put(numfields);
+
+            for (int16_t n=0; n < numfields; n++)
+            {
+                if (fieldValues[n].isnull==true)
+                {
+                    put((int32_t)-1);
+                }
+                else if (putBinaryField(results.selectFields[n].type,
+                                        fieldValues[n])==false)
+                {
+                    printf("%s %i anomaly %i\n", __FILE__, __LINE__,
+                           results.selectFields[n].type);
+                    put((int32_t)-1);
+                }
+            }
+
+            replymsg();
+            continue;
+        }
+
+        for (int16_t n=0; n < numfields; n++)
+        {
+            if (n)
+            {
+                outmsg.append(1, copystate.delimiter);
+            }
+
+            if (fieldValues[n].isnull==true)
+            {
+                outmsg.append(copystate.nullstr);
+                continue;
+            }
+
+            copyFieldText(results.selectFields[n].type, fieldValues[n], val);
+
+            if (copystate.format=='c')
+            {
+                // quote if it could be mistaken for NULL or a delimiter
+                if ((val.empty() && copystate.nullstr.empty()) ||
+                    val==copystate.nullstr ||
+                    val.find_first_of(string(1, copystate.delimiter) +
+                                      copystate.quote + copystate.escape +
+                                      "\r\n") != string::npos)
+                {
+                    outmsg.append(1, copystate.quote);
+
+                    for (size_t i=0; i < val.size(); i++)
+                    {
+                        if (val[i]==copystate.quote ||
+                            val[i]==copystate.escape)
+                        {
+                            outmsg.append(1, copystate.escape);
+                        }
+
+                        outmsg.append(1, val[i]);
+                    }
+
+                    outmsg.append(1, copystate.quote);
+                }
+                else
+                {
+                    outmsg.append(val);
+                }
+
+                continue;
+            }
+
+            for (size_t i=0; i < val.size(); i++)
+            {
+                switch (val[i])
+                {
+                case '\\':
+                    outmsg.append("\\\\");
+                    break;
+
+                case '\n':
+                    outmsg.append("\\n");
+                    break;
+
+                case '\r':
+                    outmsg.append("\\r");
+                    break;
+
+                case '\t':
+                    outmsg.append("\\t");
+                    break;
+
+                default:
+                    if (val[i]==copystate.delimiter)
+                    {
+                        outmsg.append(1, '\\');
+                    }
+
+                    outmsg.append(1, val[i]);
+                }
+            }
+        }
+
+        outmsg.append(1, '\n');
+        replymsg();
+    }
+
+    if (copystate.format=='b')
+    {
+        outcmd='d';
+        put((int16_t)-1);
+        replymsg();
+    }
+
+    // CopyDone
+    outcmd='c';
+    replymsg();
+
+    copystate = copy_s();
+}
+
+// words, 'strings' (leading quote kept), "identifiers" (unquoted) and
+// punctuation of a COPY statement
+static void copyTokens(const string &str, size_t pos, vector<string> &tokens)
+{
+    while (pos < str.size())
+    {
+        char c = str[pos];
+
+        if (isspace(c) || c==';')
+        {
+            pos++;
+            continue;
+        }
+
+        if (c=='(' || c==')' || c==',')
+        {
+            tokens.push_back(string(1, c));
+            pos++;
+            continue;
+        }
+
+        bool isescapestring = ((c=='E' || c=='e') && pos+1 < str.size() &&
+                               str[pos+1]=='\'');
+
+        if (isescapestring==true)
+        {
+            c = str[++pos];
+        }
+
+        if (c=='\'' || c=='"')
+        {
+            string token(c=='\'' ? 1 : 0, c);
+
+            for (pos++; pos < str.size(); pos++)
+            {
+                if (isescapestring==true && str[pos]=='\\' &&
+                    pos+1 < str.size())
+                {
+                    switch (str[++pos])
+                    {
+                    case 't':
+                        token.append(1, '\t');
+                        break;
+
+                    case 'n':
+                        token.append(1, '\n');
+                        break;
+
+                    case 'r':
+                        token.append(1, '\r');
+                        break;
+
+                    default:
+                        token.append(1, str[pos]);
+                    }
+
+                    continue;
+                }
+
+                if (str[pos]==c)
+                {
+                    if (pos+1 < str.size() && str[pos+1]==c)
+                    {
+                        token.append(1, c);
+                        pos++;
+                        continue;
+                    }
+
+                    break;
+                }
+
+                token.append(1, str[pos]);
+            }
+
+            pos++;
+            tokens.push_back(token);
+            continue;
+        }
+
+        size_t end = pos;
+
+        while (end < str.size() && !isspace(str[end]) &&
+               strchr("(),;'\"", str[end])==NULL)
+        {
+            end++;
+        }
+
+        tokens.push_back(str.substr(pos, end-pos));
+        pos = end;
+    }
+}
+
+// value of COPY option if the next token is a 'string', with optional AS
+static bool copyOptionString(const vector<string> &tokens, size_t &t,
+                             string &val)
+{
+    if (t < tokens.size() && !strcasecmp(tokens[t].c_str(), "as"))
+    {
+        t++;
+    }
+
+    if (t==tokens.size() || tokens[t].empty() || tokens[t][0] != '\'')
+    {
+        return false;
+    }
+
+    val = tokens[t++].substr(1, string::npos);
+    return true;
+}
+
+bool Pg::parseCopy(const string &stmtstr, copy_s &copyRef, string &tablename,
+                   vector<string> &columns, string &query)
+{
+    size_t pos = stmtstr.find_first_not_of(" \t\r\n");
+
+    if (pos==string::npos || strncasecmp(&stmtstr[pos], "copy", 4))
+    {
+        return false;
+    }
+
+    pos = stmtstr.find_first_not_of(" \t\r\n", pos+4);
+
+    if (pos==string::npos)
+    {
+        return false;
+    }
+
+    if (stmtstr[pos]=='(')
+    {
+        // (query), to the matching parenthesis outside of quotes
+        size_t start = pos+1;
+        int64_t depth = 0;
+        char inquote = 0;
+
+        for (; pos < stmtstr.size(); pos++)
+        {
+            char c = stmtstr[pos];
+
+            if (inquote)
+            {
+                if (c==inquote)
+                {
+                    inquote = 0;
+                }
+            }
+            else if (c=='\'' || c=='"')
+            {
+                inquote = c;
+            }
+            else if (c=='(')
+            {
+                depth++;
+            }
+            else if (c==')' && --depth==0)
+            {
+                break;
+            }
+        }
+
+        if (pos==stmtstr.size())
+        {
+            return false;
+        }
+
+        query = stmtstr.substr(start, pos-start);
+        pos++;
+    }
+
+    vector<string> tokens;
+    copyTokens(stmtstr, pos, tokens);
+    size_t t = 0;
+
+    if (query.empty())
+    {
+        if (t==tokens.size() || tokens[t]=="(")
+        {
+            return false;
+        }
+
+        tablename = tokens[t++];
+
+        if (t < tokens.size() && tokens[t]=="(")
+        {
+            for (t++; t < tokens.size() && tokens[t] != ")"; t++)
+            {
+                if (tokens[t] != ",")
+                {
+                    columns.push_back(tokens[t]);
+                }
+            }
+
+            if (t++==tokens.size())
+            {
+                return false;
+            }
+        }
+    }
+
+    if (t+2 > tokens.size())
+    {
+        return false;
+    }
+
+    if (!strcasecmp(tokens[t].c_str(), "from") &&
+        !strcasecmp(tokens[t+1].c_str(), "stdin") && query.empty())
+    {
+        copyRef.isfrom=true;
+    }
+    else if (!strcasecmp(tokens[t].c_str(), "to") &&
+             !strcasecmp(tokens[t+1].c_str(), "stdout"))
+    {
+        copyRef.isfrom=false;
+    }
+    else
+    {
+        return false;
+    }
+
+    t += 2;
+
+    if (t < tokens.size() && !strcasecmp(tokens[t].c_str(), "with"))
+    {
+        t++;
+    }
+
+    // ( option [value], ... ) or the pre-9.0 option list without commas
+    bool isparenthesized = (t < tokens.size() && tokens[t]=="(");
+    bool isdelimiter=false, isnull=false, isquote=false, isescape=false;
+    string val;
+    copyRef.format='t';
+
+    if (isparenthesized==true)
+    {
+        t++;
+    }
+
+    while (t < tokens.size())
+    {
+        const char *option = tokens[t++].c_str();
+
+        if (!strcmp(option, ","))
+        {
+            continue;
+        }
+
+        if (!strcmp(option, ")") && isparenthesized==true)
+        {
+            if (t != tokens.size())
+            {
+                return false;
+            }
+
+            isparenthesized=false;
+            break;
+        }
+
+        if (!strcasecmp(option, "binary"))
+        {
+            copyRef.format='b';
+        }
+        else if (!strcasecmp(option, "csv"))
+        {
+            copyRef.format='c';
+        }
+        else if (!strcasecmp(option, "format"))
+        {
+            if (t==tokens.size())
+            {
+                return false;
+            }
+
+            const char *format = tokens[t++].c_str();
+
+            if (format[0]=='\'')
+            {
+                format++;
+            }
+
+            if (!strcasecmp(format, "text"))
+            {
+                copyRef.format='t';
+            }
+            else if (!strcasecmp(format, "csv"))
+            {
+                copyRef.format='c';
+            }
+            else if (!strcasecmp(format, "binary"))
+            {
+                copyRef.format='b';
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (!strcasecmp(option, "header"))
+        {
+            copyRef.isheader=true;
+
+            if (t < tokens.size())
+            {
+                const char *boolean = tokens[t].c_str();
+
+                if (!strcasecmp(boolean, "false") || !strcasecmp(boolean, "off") ||
+                    !strcmp(boolean, "0"))
+                {
+                    copyRef.isheader=false;
+                    t++;
+                }
+                else if (!strcasecmp(boolean, "true") ||
+                         !strcasecmp(boolean, "on") || !strcmp(boolean, "1"))
+                {
+                    t++;
+                }
+            }
+        }
+        else if (!strcasecmp(option, "null"))
+        {
+            if (copyOptionString(tokens, t, copyRef.nullstr)==false)
+            {
+                return false;
+            }
+
+            isnull=true;
+        }
+        else if (!strcasecmp(option, "delimiter") ||
+                 !strcasecmp(option, "quote") || !strcasecmp(option, "escape"))
+        {
+            if (copyOptionString(tokens, t, val)==false || val.size() != 1)
+            {
+                return false;
+            }
+
+            switch (tolower(option[0]))
+            {
+            case 'd':
+                copyRef.delimiter=val[0];
+                isdelimiter=true;
+                break;
+
+            case 'q':
+                copyRef.quote=val[0];
+                isquote=true;
+                break;
+
+            default:
+                copyRef.escape=val[0];
+                isescape=true;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (isparenthesized==true)
+    {
+        // no closing parenthesis
+        return false;
+    }
+
+    if (copyRef.format=='c')
+    {
+        copyRef.delimiter = isdelimiter ? copyRef.delimiter : ',';
+        copyRef.quote = isquote ? copyRef.quote : '"';
+        copyRef.escape = isescape ? copyRef.escape : copyRef.quote;
+    }
+    else
+    {
+        copyRef.delimiter = isdelimiter ? copyRef.delimiter : '\t';
+        copyRef.nullstr = isnull ? copyRef.nullstr : "\\N";
+    }
+
+    return true;
+}
+
+// text format field with backslash escapes
+static void copyUnescape(const char *in, size_t len, string &out)
+{
+    if (memchr(in, '\\', len)==NULL)
+    {
+        out.assign(in, len);
+        return;
+    }
+
+    out.clear();
+
+    for (size_t i=0; i < len; i++)
+    {
+        if (in[i] != '\\' || i+1==len)
+        {
+            out.append(1, in[i]);
+            continue;
+        }
+
+        char c = in[++i];
+
+        switch (c)
+        {
+        case 'b':
+            out.append(1, '\b');
+            break;
+
+        case 'f':
+            out.append(1, '\f');
+            break;
+
+        case 'n':
+            out.append(1, '\n');
+            break;
+
+        case 'r':
+            out.append(1, '\r');
+            break;
+
+        case 't':
+            out.append(1, '\t');
+            break;
+
+        case 'v':
+            out.append(1, '\v');
+            break;
+
+        case 'x':
+        {
+            int val = 0;
+            size_t n;
+
+            for (n=0; n < 2 && i+1 < len && isxdigit(in[i+1]); n++)
+            {
+                c = in[++i];
+                val = val*16 + (isdigit(c) ? c-'0' : tolower(c)-'a'+10);
+            }
+
+            out.append(1, n ? (char)val : 'x');
+        }
+        break;
+
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        {
+            int val = c-'0';
+
+            for (size_t n=1; n < 3 && i+1 < len && in[i+1] >= '0' &&
+                     in[i+1] <= '7'; n++)
+            {
+                val = val*8 + in[++i]-'0';
+            }
+
+            out.append(1, (char)val);
+        }
+        break;
+
+        default:
+            out.append(1, c);
+        }
+    }
+}
+
+static bool parseCopyText(Pg::copy_s &copyRef, bool isfinal, size_t &pos,
+                          vector< vector<fieldValue_s> > &rows)
+{
+    const string &buf = copyRef.buf;
+    size_t numcolumns = copyRef.types.size();
+    string val;
+
+    while (pos < buf.size() && copyRef.isdone==false)
+    {
+        size_t end = buf.find('\n', pos);
+        size_t next = end+1;
+
+        if (end==string::npos)
+        {
+            if (isfinal==false)
+            {
+                break;
+            }
+
+            end = next = buf.size();
+        }
+
+        if (end > pos && buf[end-1]=='\r')
+        {
+            end--;
+        }
+
+        if (end-pos==2 && buf[pos]=='\\' && buf[pos+1]=='.')
+        {
+            copyRef.isdone=true;
+            pos = next;
+            break;
+        }
+
+        if (copyRef.isheader==true && copyRef.isheaderdone==false)
+        {
+            copyRef.isheaderdone=true;
+            pos = next;
+            continue;
+        }
+
+        rows.push_back(vector<fieldValue_s>(numcolumns));
+        vector<fieldValue_s> &fieldValues = rows.back();
+        size_t column = 0;
+
+        for (size_t i=pos; ; )
+        {
+            size_t fieldend = i;
+
+            while (fieldend < end && buf[fieldend] != copyRef.delimiter)
+            {
+                fieldend += (buf[fieldend]=='\\') ? 2 : 1;
+            }
+
+            if (fieldend > end)
+            {
+                fieldend = end;
+            }
+
+            if (column==numcolumns)
+            {
+                return false;
+            }
+
+            fieldValue_s &fieldValue = fieldValues[column];
+
+            if (fieldend-i==copyRef.nullstr.size() &&
+                !buf.compare(i, fieldend-i, copyRef.nullstr))
+            {
+                fieldValue.isnull=true;
+            }
+            else
+            {
+                copyUnescape(&buf[i], fieldend-i, val);
+
+                if (Pg::copyTextField(copyRef.types[column], val,
+                                      fieldValue)==false)
+                {
+                    return false;
+                }
+            }
+
+            column++;
+
+            if (fieldend==end)
+            {
+                break;
+            }
+
+            i = fieldend+1;
+        }
+
+        if (column != numcolumns)
+        {
+            return false;
+        }
+
+        pos = next;
+    }
+
+    return true;
+}
+
+/* -1: need more data, 0: field ends at delimiter, 1: field ends row,
+ * 2: malformed */
+static int csvField(const Pg::copy_s &copyRef, bool isfinal, size_t &i,
+                    string &val, bool &isquoted)
+{
+    const string &buf = copyRef.buf;
+    bool inquotes = false;
+    val.clear();
+    isquoted = false;
+
+    while (1)
+    {
+        if (i==buf.size())
+        {
+            if (isfinal==false)
+            {
+                return -1;
+            }
+
+            return inquotes ? 2 : 1;
+        }
+
+        char c = buf[i];
+
+        if (inquotes==true)
+        {
+            if (c==copyRef.escape && (copyRef.escape != copyRef.quote ||
+                                      (i+1 < buf.size() &&
+                                       buf[i+1]==copyRef.quote)))
+            {
+                if (i+1==buf.size())
+                {
+                    if (isfinal==false)
+                    {
+                        return -1;
+                    }
+
+                    return 2;
+                }
+
+                if (buf[i+1]==copyRef.quote || buf[i+1]==copyRef.escape)
+                {
+                    val.append(1, buf[i+1]);
+                    i += 2;
+                    continue;
+                }
+            }
+
+            if (c==copyRef.quote)
+            {
+                if (i+1==buf.size() && isfinal==false)
+                {
+                    // might be the first of a doubled quote
+                    return -1;
+                }
+
+                inquotes=false;
+                i++;
+                continue;
+            }
+
+            val.append(1, c);
+            i++;
+            continue;
+        }
+
+        if (c==copyRef.quote)
+        {
+            inquotes=true;
+            isquoted=true;
+            i++;
+            continue;
+        }
+
+        if (c==copyRef.delimiter)
+        {
+            i++;
+            return 0;
+        }
+
+        if (c=='\n')
+        {
+            i++;
+            return 1;
+        }
+
+        if (c=='\r')
+        {
+            if (i+1==buf.size() && isfinal==false)
+            {
+                return -1;
+            }
+
+            i += (i+1 < buf.size() && buf[i+1]=='\n') ? 2 : 1;
+            return 1;
+        }
+
+        val.append(1, c);
+        i++;
+    }
+}
+
+static bool parseCopyCsv(Pg::copy_s &copyRef, bool isfinal, size_t &pos,
+                         vector< vector<fieldValue_s> > &rows)
+{
+    const string &buf = copyRef.buf;
+    size_t numcolumns = copyRef.types.size();
+    string val;
+    bool isquoted;
+
+    while (pos < buf.size() && copyRef.isdone==false)
+    {
+        if (!buf.compare(pos, 2, "\\."))
+        {
+            size_t i = pos+2;
+
+            if (i < buf.size() && buf[i]=='\r')
+            {
+                i++;
+            }
+
+            if (i < buf.size() && buf[i]=='\n')
+            {
+                copyRef.isdone=true;
+                pos = i+1;
+                break;
+            }
+
+            if (i==buf.size())
+            {
+                if (isfinal==true)
+                {
+                    copyRef.isdone=true;
+                    pos = i;
+                }
+
+                break;
+            }
+        }
+
+        bool isheaderline = (copyRef.isheader==true &&
+                             copyRef.isheaderdone==false);
+        rows.push_back(vector<fieldValue_s>(numcolumns));
+        vector<fieldValue_s> &fieldValues = rows.back();
+        size_t i = pos;
+        size_t column = 0;
+        int retval;
+
+        do
+        {
+            retval = csvField(copyRef, isfinal, i, val, isquoted);
+
+            if (retval==-1)
+            {
+                // rest of row not received yet
+                rows.pop_back();
+                return true;
+            }
+
+            if (retval==2 || column==numcolumns)
+            {
+                return false;
+            }
+
+            if (isheaderline==true)
+            {
+                column++;
+                continue;
+            }
+
+            fieldValue_s &fieldValue = fieldValues[column++];
+
+            if (isquoted==false && val==copyRef.nullstr)
+            {
+                fieldValue.isnull=true;
+            }
+            else if (Pg::copyTextField(copyRef.types[column-1], val,
+                                       fieldValue)==false)
+            {
+                return false;
+            }
+        }
+        while (retval==0);
+
+        if (column != numcolumns)
+        {
+            return false;
+        }
+
+        if (isheaderline==true)
+        {
+            copyRef.isheaderdone=true;
+            rows.pop_back();
+        }
+
+        pos = i;
+    }
+
+    return true;
+}
+
+static bool parseCopyBinary(Pg::copy_s &copyRef, size_t &pos,
+                            vector< vector<fieldValue_s> > &rows)
+{
+    const string &buf = copyRef.buf;
+    size_t numcolumns = copyRef.types.size();
+
+    if (copyRef.isheaderdone==false)
+    {
+        // signature, flags, header extension length, header extension
+        if (buf.size() < 19)
+        {
+            return true;
+        }
+
+        if (memcmp(buf.c_str(), "PGCOPY\n\377\r\n", 11))
+        {
+            return false;
+        }
+
+        uint32_t extlen;
+        memcpy(&extlen, &buf[15], sizeof(extlen));
+        extlen = be32toh(extlen);
+
+        if (buf.size() < 19 + (size_t)extlen)
+        {
+            return true;
+        }
+
+        pos = 19 + extlen;
+        copyRef.isheaderdone=true;
+    }
+
+    while (buf.size()-pos >= sizeof(int16_t) && copyRef.isdone==false)
+    {
+        int16_t numfields;
+        memcpy(&numfields, &buf[pos], sizeof(numfields));
+        numfields = be16toh(numfields);
+
+        if (numfields==-1)
+        {
+            copyRef.isdone=true;
+            pos += sizeof(numfields);
+            break;
+        }
+
+        if ((size_t)numfields != numcolumns)
+        {
+            return false;
+        }
+
+        // whole tuple received?
+        size_t i = pos + sizeof(numfields);
+        size_t column;
+
+        for (column=0; column < numcolumns; column++)
+        {
+            int32_t len;
+
+            if (buf.size()-i < sizeof(len))
+            {
+                break;
+            }
+
+            memcpy(&len, &buf[i], sizeof(len));
+            len = be32toh(len);
+            i += sizeof(len);
+
+            if (len < -1)
+            {
+                return false;
+            }
+
+            if (len > 0 && buf.size()-i < (size_t)len)
+            {
+                break;
+            }
+
+            i += (len > 0) ? len : 0;
+        }
+
+        if (column < numcolumns)
+        {
+            break;
+        }
+
+        rows.push_back(vector<fieldValue_s>(numcolumns));
+        vector<fieldValue_s> &fieldValues = rows.back();
+        i = pos + sizeof(numfields);
+
+        for (column=0; column < numcolumns; column++)
+        {
+            int32_t len;
+            memcpy(&len, &buf[i], sizeof(len));
+            len = be32toh(len);
+            i += sizeof(len);
+
+            if (len==-1)
+            {
+                fieldValues[column].isnull=true;
+                continue;
+            }
+
+            if (Pg::copyBinaryField(copyRef.types[column], &buf[i], len,
+                                    fieldValues[column])==false)
+            {
+                return false;
+            }
+
+            i += len;
+        }
+
+        pos = i;
+    }
+
+    return true;
+}
+
+bool Pg::parseCopyData(copy_s &copyRef, bool isfinal,
+                       vector< vector<fieldValue_s> > &rows)
+{
+    size_t pos = 0;
+    bool isok;
+
+    switch (copyRef.format)
+    {
+    case 'b':
+        isok = parseCopyBinary(copyRef, pos, rows);
+        break;
+
+    case 'c':
+        isok = parseCopyCsv(copyRef, isfinal, pos, rows);
+        break;
+
+    default:
+        isok = parseCopyText(copyRef, isfinal, pos, rows);
+    }
+
+    copyRef.buf.erase(0, pos);
+
+    return isok;
+}
+
+bool Pg::copyTextField(fieldtype_e type, const string &val,
+                       fieldValue_s &fieldValue)
+{
+    const char *str = val.c_str();
+    char *endptr;
+
+    switch (type)
+    {
+    case INT:
+        fieldValue.value.integer = strtol(str, &endptr, 10);
+        return !val.empty() && *endptr=='\0';
+//        break;
+
+    case UINT:
+        fieldValue.value.uinteger = strtoul(str, &endptr, 10);
+        return !val.empty() && *endptr=='\0';
+//        break;
+
+    case FLOAT:
+        fieldValue.value.floating = strtold(str, &endptr);
+        return !val.empty() && *endptr=='\0';
+//        break;
+
+    case BOOL:
+        if (!strcasecmp(str, "t") || !strcasecmp(str, "true") ||
+            !strcmp(str, "1"))
+        {
+            fieldValue.value.boolean=true;
+        }
+        else if (!strcasecmp(str, "f") || !strcasecmp(str, "false") ||
+                 !strcmp(str, "0"))
+        {
+            fieldValue.value.boolean=false;
+        }
+        else
+        {
+            return false;
+        }
+
+        break;
+
+    case CHAR:
+        if (val.size() != 1)
+        {
+            return false;
+        }
+
+        fieldValue.value.character = val[0];
+        break;
+
+    case CHARX:
+    case VARCHAR:
+        fieldValue.str = val;
+        break;
+
+    default:
+        return false;
     }
+
+    return true;
 }
 
-void Pg::executeStatement(string &stmtstr)
+bool Pg::copyBinaryField(fieldtype_e type, const char *val, size_t len,
+                         fieldValue_s &fieldValue)
 {
-    class Larxer lx((char *)stmtstr.c_str(), taPtr, schemaPtr);
-
-    if (lx.statementPtr==NULL)
+    switch (type)
     {
-        putErrorResponse("ERROR", "42601", "syntax error");
-        return;
+    case INT:
+    case UINT:
+        if (len==sizeof(int16_t))
+        {
+            int16_t val16;
+            memcpy(&val16, val, sizeof(val16));
+            fieldValue.value.integer = (int16_t)be16toh(val16);
+        }
+        else if (len==sizeof(int32_t))
+        {
+            int32_t val32;
+            memcpy(&val32, val, sizeof(val32));
+            fieldValue.value.integer = (int32_t)be32toh(val32);
+        }
+        else if (len==sizeof(int64_t))
+        {
+            int64_t val64;
+            memcpy(&val64, val, sizeof(val64));
+            fieldValue.value.integer = be64toh(val64);
+        }
+        else
+        {
+            return false;
+        }
+
+        break;
+
+    case FLOAT:
+        if (len==sizeof(uint32_t))
+        {
+            uint32_t bits;
+            float floating;
+            memcpy(&bits, val, sizeof(bits));
+            bits = be32toh(bits);
+            memcpy(&floating, &bits, sizeof(floating));
+            fieldValue.value.floating = floating;
+        }
+        else if (len==sizeof(uint64_t))
+        {
+            uint64_t bits;
+            double floating;
+            memcpy(&bits, val, sizeof(bits));
+            bits = be64toh(bits);
+            memcpy(&floating, &bits, sizeof(floating));
+            fieldValue.value.floating = floating;
+        }
+        else
+        {
+            return false;
+        }
+
+        break;
+
+    case BOOL:
+        if (len != 1)
+        {
+            return false;
+        }
+
+        fieldValue.value.boolean = (val[0] != 0);
+        break;
+
+    case CHAR:
+        if (len != 1)
+        {
+            return false;
+        }
+
+        fieldValue.value.character = val[0];
+        break;
+
+    case CHARX:
+    case VARCHAR:
+        fieldValue.str.assign(val, len);
+        break;
+
+    default:
+        return false;
     }
 
-    statementPtr=lx.statementPtr;
+    return true;
+}
 
-    if (statementPtr->resolveTableFields()==false)
+void Pg::copyFieldText(fieldtype_e type, const fieldValue_s &fieldValue,
+                       string &val)
+{
+    switch (type)
     {
-        sqlrollbackimplicit();
-        putErrorResponse("ERROR", "42704", "table or column does not exist");
-        delete statementPtr;
-        return;
+    case INT:
+    {
+        char str[21];
+        val.assign(str, sprintf(str, "%li", fieldValue.value.integer));
     }
+    break;
 
-    if (statementPtr->queries[0].type==CMD_STOREDPROCEDURE)
+    case UINT:
     {
-        statementPtr->queries[0].storedProcedure.insert(0, procedureprefix);
+        char str[21];
+        val.assign(str, sprintf(str, "%lu", fieldValue.value.uinteger));
     }
+    break;
 
-    results = results_s();
+    case BOOL:
+        val.assign(1, fieldValue.value.boolean==true ? 't' : 'f');
+        break;
 
-    if (transactionPtr==NULL)
-    {
-        command_autocommit=true;
-    }
-    else
+    case FLOAT:
     {
-        command_autocommit=false;
+        std::stringstream str;
+        str << (double)fieldValue.value.floating;
+
+        if ((double)fieldValue.value.floating /
+            (int64_t)fieldValue.value.floating == 1)
+        {
+            str << ".0";
+        }
+
+        val = str.str();
     }
+    break;
 
-    statementPtr->execute(this, &ApiInterface::continuePgFunc, 1, transactionPtr,
-                          transactionPtr, vector<string>());
+    case CHAR:
+        val.assign(1, fieldValue.value.character);
+        break;
+
+    case CHARX:
+    case VARCHAR:
+        val = fieldValue.str;
+        break;
+
+    default:
+        val.clear();
+    }
 }
 
 void Pg::continuePgFunc(int64_t entrypoint, void *statePtr)
@@ -886,6 +3843,18 @@ void Pg::continuePgFunc(int64_t entrypoint, void *statePtr)
      * CommandComplete at the end of everything returned
      * If set, then set whatever
      */
+    if (entrypoint==2)
+    {
+        continueCopyIn();
+        return;
+    }
+
+    if (entrypoint==3)
+    {
+        continueFetch();
+        return;
+    }
+
     transactionPtr=results.transactionPtr;
 
     if (state==STATE_EXITING)
@@ -908,17 +3877,30 @@ void Pg::continuePgFunc(int64_t entrypoint, void *statePtr)
     {
     case CMD_SELECT:
     {
-        if (results.statementStatus==STATUS_OK)
+        if (results.statementStatus==STATUS_OK && iscopyout==true)
         {
-            putRowDescription();
-            putDataRows();
+            iscopyout=false;
+            putCopyData();
 
             std::stringstream tag;
-            tag << "SELECT " << results.selectResults.size();
+            tag << "COPY " << results.selectResults.size();
             putCommandComplete((char *)tag.str().c_str());
         }
+        else if (results.statementStatus==STATUS_OK)
+        {
+            if (isextendedquery==false)
+            {
+                // extended query sends it for Describe instead
+                putRowDescription();
+            }
+
+            dataRowsIt = results.selectResults.begin();
+            selectRows();
+            return;
+        }
         else
         {
+            iscopyout=false;
             sqlrollbackimplicit();
             errorStatus(results.statementStatus);
             return;
@@ -1090,6 +4072,13 @@ void Pg::continuePgFunc(int64_t entrypoint, void *statePtr)
         break;
 
     case CMD_SET:
+        putCommandComplete("SET");
+
+        if (writesocket()==-1)
+        {
+            closesocket(*taPtr);
+        }
+
         break;
 
     case CMD_STOREDPROCEDURE:
@@ -1097,11 +4086,9 @@ void Pg::continuePgFunc(int64_t entrypoint, void *statePtr)
         if (results.statementStatus==STATUS_OK)
         {
             putRowDescription();
-            putDataRows();
-
-            std::stringstream tag;
-            tag << "SELECT " << results.selectResults.size();
-            putCommandComplete((char *)tag.str().c_str());
+            dataRowsIt = results.selectResults.begin();
+            selectRows();
+            return;
         }
         else
         {
@@ -1151,6 +4138,11 @@ void Pg::putErrorResponse(char *severity, char *code, char *message)
 
     replymsg();
 
+    if (isextendedquery==true)
+    {
+        isskippingtosync=true;
+    }
+
     if (writesocket()==-1)
     {
         closesocket(*taPtr);
@@ -1210,12 +4202,23 @@ void Pg::sqlrollbackimplicit()
         state=STATE_ABORTED;
     }
 
+    if (isextendedquery==false)
+    {
+        // drop the failed statement's partial response, keep responses
+        // to earlier pipelined messages
+        outtruncate(outbufmark);
+    }
+
     if (transactionPtr==NULL)
     {
         continuePgRollbackimplicit(1, NULL);
         return;
     }
 
+    // next pipelined message waits for the rollback
+    isexecuting=true;
+    isrollingback=true;
+
     transactionPtr->reentryObject = this;
     transactionPtr->reentryFuncPtr = &ApiInterface::continuePgRollbackimplicit;
     transactionPtr->reentryCmd = 1;
@@ -1252,18 +4255,24 @@ bool Pg::sqlbegin()
 }
 
 void Pg::putRowDescription()
+{
+    putRowDescription(results.selectFields, resultformats);
+}
+
+void Pg::putRowDescription(const vector<fieldtypename_s> &fields,
+                           const vector<int16_t> &formats)
 {
     outcmd='T';
-    int16_t numfields = (int16_t)results.selectFields.size();
+    int16_t numfields = (int16_t)fields.size();
     put(numfields);
 
     for (int16_t n=0; n < numfields; n++)
     {
-        put(results.selectFields[n].name);
+        put((char *)fields[n].name.c_str());
         put((int32_t)0);
         put((int16_t)0);
 
-        switch (results.selectFields[n].type)
+        switch (fields[n].type)
         {
         case INT:
             put((int32_t)INT8OID);
@@ -1301,30 +4310,55 @@ void Pg::putRowDescription()
             break;
 
         default:
-            printf("%s %i anomaly %i\n", __FILE__, __LINE__,
-                   results.selectFields[n].type);
+            printf("%s %i anomaly %i\n", __FILE__, __LINE__, fields[n].type);
             return;
         }
 
         put((int32_t)0);
-        put((int16_t)0); // text format code
+        put((int16_t)(n < (int16_t)formats.size() ? formats[n] : 0));
     }
 
     replymsg();
 }
 
-void Pg::putDataRows()
+bool Pg::putDataRows()
 {
-    boost::unordered_map< uuRecord_s, vector<fieldValue_s> >::const_iterator it;
+    isstreaming=false;
 
-    for (it = results.selectResults.begin(); it != results.selectResults.end();
-         it++)
+    for (; dataRowsIt != results.selectResults.end(); dataRowsIt++)
     {
+        if (selectrows==maxrows)
+        {
+            // portal suspends
+            return true;
+        }
+
+        if (outbuflen >= PGOUTHIGHWATER)
+        {
+            // send what's built so far
+            switch (flushsocket())
+            {
+            case -1:
+                closesocket(*taPtr);
+                return false;
+//                break;
+
+            case 1:
+                // client isn't reading, resume on EPOLLOUT
+                isstreaming=true;
+                return false;
+//                break;
+
+            default:
+                ;
+            }
+        }
+
         outcmd='D';
         int16_t numfields = (int16_t)results.selectFields.size();
         put(numfields);
 
-        const vector<fieldValue_s> &fieldValues = it->second;
+        const vector<fieldValue_s> &fieldValues = dataRowsIt->second;
 
         for (int16_t n=0; n < numfields; n++)
         {
@@ -1334,6 +4368,19 @@ void Pg::putDataRows()
                 continue;
             }
 
+            if (n < (int16_t)resultformats.size() && resultformats[n]==1)
+            {
+                if (putBinaryField(results.selectFields[n].type,
+                                   fieldValues[n])==false)
+                {
+                    printf("%s %i anomaly %i\n", __FILE__, __LINE__,
+                           results.selectFields[n].type);
+                    return true;
+                }
+
+                continue;
+            }
+
             switch (results.selectFields[n].type)
             {
             case INT:
@@ -1409,12 +4456,192 @@ void Pg::putDataRows()
             default:
                 printf("%s %i anomaly %i\n", __FILE__, __LINE__,
                        results.selectFields[n].type);
-                return;
+                return true;
             }
         }
 
         replymsg();
+        selectrows++;
+    }
+
+    return true;
+}
+
+void Pg::selectRows()
+{
+    if (putDataRows()==false)
+    {
+        // paused, or socket closed
+        return;
+    }
+
+    // another portal's suspended cursor is left alone
+    bool iscursor = (transactionPtr != NULL &&
+                     transactionPtr->cursor.isownedby(cursorowner)==true);
+
+    if (dataRowsIt != results.selectResults.end() ||
+        (iscursor==true && transactionPtr->iscursorpending()==true))
+    {
+        if (selectrows==maxrows)
+        {
+            suspendPortal();
+        }
+        else
+        {
+            fetchRows(&ApiInterface::continuePgFunc, 3, NULL);
+        }
+
+        return;
+    }
+
+    if (iscursor==true)
+    {
+        transactionPtr->cursor = Transaction::cursor_s();
+    }
+
+    std::stringstream tag;
+    tag << "SELECT " << selectrows;
+    putCommandComplete((char *)tag.str().c_str());
+
+    if (isintransactionblock==false && (session_isautocommit==true ||
+                                        command_autocommit==true))
+    {
+        sqlcommitimplicit();
+    }
+    else
+    {
+        if (writesocket()==-1)
+        {
+            closesocket(*taPtr);
+        }
+    }
+}
+
+void Pg::continueFetch()
+{
+    if (transactionPtr->resultCode != APISTATUS_OK)
+    {
+        int64_t status = transactionPtr->resultCode;
+
+        if (transactionPtr->cursor.isownedby(cursorowner)==true)
+        {
+            transactionPtr->cursor = Transaction::cursor_s();
+        }
+
+        sqlrollbackimplicit();
+        errorStatus(status);
+        return;
+    }
+
+    dataRowsIt = results.selectResults.begin();
+    selectRows();
+}
+
+void Pg::suspendPortal()
+{
+    boost::unordered_map<std::string, portal_s>::iterator it;
+    it = portals.find(executingportal);
+
+    if (it==portals.end())
+    {
+        printf("%s %i anomaly portal '%s'\n", __FILE__, __LINE__,
+               executingportal.c_str());
+        return;
+    }
+
+    portal_s &portalRef = it->second;
+    // sent rows are dropped, the rest wait for the next Execute
+    results.selectResults.erase(results.selectResults.begin(), dataRowsIt);
+    std::swap(results, portalRef.results);
+    portalRef.issuspended=true;
+    portalRef.hascursor = (transactionPtr != NULL &&
+                           transactionPtr->cursor.isownedby(cursorowner)==true);
+    portalRef.cursorowner = cursorowner;
+
+    if (isintransactionblock==false && (session_isautocommit==true ||
+                                        command_autocommit==true))
+    {
+        isimplicittransaction=true;
+    }
+
+    // PortalSuspended
+    outcmd='s';
+    replymsg();
+
+    if (writesocket()==-1)
+    {
+        closesocket(*taPtr);
+    }
+}
+
+void Pg::resumePortal(portal_s &portalRef)
+{
+    std::swap(results, portalRef.results);
+    portalRef.results = results_s();
+    portalRef.issuspended=false;
+    portalRef.hascursor=false;
+    cursorowner = portalRef.cursorowner;
+    resultformats = portalRef.resultformats;
+    // implicit transaction, if any, ends at Sync
+    command_autocommit = (transactionPtr==NULL);
+    isexecuting=true;
+    dataRowsIt = results.selectResults.begin();
+    selectRows();
+}
+
+bool Pg::putBinaryField(fieldtype_e type, const fieldValue_s &fieldValue)
+{
+    size_t curpos = outmsg.size();
+
+    switch (type)
+    {
+    case INT:
+    case UINT:
+    {
+        // int8, length and value straight from the union
+        int32_t len = htobe32((int32_t)sizeof(int64_t));
+        uint64_t val = htobe64((uint64_t)fieldValue.value.integer);
+        outmsg.resize(curpos + sizeof(len) + sizeof(val));
+        memcpy(&outmsg[curpos], &len, sizeof(len));
+        memcpy(&outmsg[curpos+sizeof(len)], &val, sizeof(val));
+    }
+    break;
+
+    case FLOAT:
+    {
+        // float8
+        double floating = (double)fieldValue.value.floating;
+        uint64_t val;
+        memcpy(&val, &floating, sizeof(val));
+        int32_t len = htobe32((int32_t)sizeof(val));
+        val = htobe64(val);
+        outmsg.resize(curpos + sizeof(len) + sizeof(val));
+        memcpy(&outmsg[curpos], &len, sizeof(len));
+        memcpy(&outmsg[curpos+sizeof(len)], &val, sizeof(val));
+    }
+    break;
+
+    case BOOL:
+        put((int32_t)1);
+        put((char)(fieldValue.value.boolean==true ? 1 : 0));
+        break;
+
+    case CHAR:
+        put((int32_t)1);
+        put(fieldValue.value.character);
+        break;
+
+    case CHARX:
+    case VARCHAR:
+        put((int32_t)fieldValue.str.size());
+        put((char *)fieldValue.str.c_str(), fieldValue.str.size());
+        break;
+
+    default:
+        return false;
     }
+
+    return true;
 }
 
 void Pg::continuePgCommitimplicit(int64_t entrypoint, void *statePtr)
@@ -1469,14 +4696,10 @@ void Pg::continuePgCommitexplicit(int64_t entrypoint, void *statePtr)
     {
         closesocket(*taPtr);
     }
-
-    outbuf.clear();
 }
 
 void Pg::continuePgRollbackimplicit(int64_t entrypoint, void *statePtr)
 {
-    outbuf.clear();
-
     if (transactionPtr != NULL)
     {
         delete transactionPtr;
@@ -1494,6 +4717,12 @@ void Pg::continuePgRollbackimplicit(int64_t entrypoint, void *statePtr)
 
         return;
     }
+
+    if (isrollingback==true)
+    {
+        isrollingback=false;
+        executed();
+    }
 }
 
 void Pg::continuePgRollbackexplicit(int64_t entrypoint, void *statePtr)
@@ -1522,8 +4751,6 @@ void Pg::continuePgRollbackexplicit(int64_t entrypoint, void *statePtr)
     {
         closesocket(*taPtr);
     }
-
-    outbuf.clear();
 }
 
 /* pg 9.2.4 response to perl client ParameterStatus list:
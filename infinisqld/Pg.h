@@ -58,9 +58,66 @@ public:
         STATE_AUTH,
         STATE_ESTABLISHED,
         STATE_ABORTED,
+        STATE_COPYIN,
         STATE_EXITING
     };
 
+    /** 
+     * @brief statement prepared by extended query Parse message
+     *
+     * template is lexed, parsed and resolved once, then copied for each
+     * Bind
+     */
+    struct preparedStatement_s
+    {
+        class Statement *statementPtr; /**< resolved template */
+        std::vector<int32_t> paramtypes; /**< oid per parameter, 0 unknown */
+        std::vector<fieldtypename_s> fields; /**< SELECT output columns */
+    };
+
+    /** 
+     * @brief portal created by extended query Bind message
+     *
+     */
+    struct portal_s
+    {
+        class Statement *statementPtr; /**< copy of template, NULL after
+                                        * Execute */
+        std::vector<std::string> parameters; /**< operands for Execute */
+        std::vector<fieldtypename_s> fields; /**< SELECT output columns */
+        std::vector<int16_t> resultformats; /**< format code per column */
+        bool issuspended; /**< Execute stopped at max rows, rows remain */
+        bool hascursor; /**< suspended with the transaction's cursor */
+        int64_t cursorowner; /**< execution it was suspended from */
+        results_s results; /**< rows not yet sent, if suspended */
+    };
+
+    /** 
+     * @brief COPY FROM STDIN or TO STDOUT in progress
+     *
+     */
+    struct copy_s
+    {
+        int64_t tableid;
+        std::vector<int64_t> fieldids; /**< field of each column of data */
+        std::vector<fieldtype_e> types; /**< type of each column of data */
+        bool isfrom;
+        char format; /**< 't' text, 'c' csv, 'b' binary */
+        char delimiter;
+        char quote;
+        char escape;
+        std::string nullstr;
+        bool isheader; /**< first line is column names */
+        bool isheaderdone; /**< header line or binary header consumed */
+        bool isdone; /**< end-of-data marker or binary trailer consumed */
+        bool iscomplete; /**< CopyDone received */
+        std::string buf; /**< CopyData not yet parsed into rows */
+        int64_t rows;
+        /** rows not yet sent, by engineid */
+        boost::unordered_map<int64_t, insertBatch_s> batches;
+        bool isbatchfull; /**< an engine's batch is ready to send */
+    };
+
     Pg(class TransactionAgent *entrypoint, int statePtr);
     virtual ~Pg();
 
@@ -91,7 +148,8 @@ public:
      * CommandComplete at the end of everything returned
      * If set, then set whatever
      *
-     * @param entrypoint entry point to contiue
+     * @param entrypoint 1 statement executed, 2 COPY FROM batch inserted, 3
+     * cursor rows fetched
      * @param statePtr state data to continue with
      */
     void continuePgFunc(int64_t entrypoint, void *statePtr);
@@ -151,6 +209,23 @@ public:
      * @param taRef TransactionAgent
      */
     void closesocket(class TransactionAgent &taRef);
+    /** 
+     * @brief whether this can move to another TransactionAgent
+     *
+     * only between transactions, with no input, output, portal or
+     * statement in progress
+     *
+     * @return true if idle
+     */
+    bool ismigratable();
+    /** 
+     * @brief attach to TransactionAgent this was moved to
+     *
+     * re-resolves schema and prepared statements against its copies
+     *
+     * @param taPtrarg new TransactionAgent
+     */
+    void rebind(class TransactionAgent *taPtrarg);
     /** 
      * @brief more socket closing-related activities
      *
@@ -165,6 +240,26 @@ public:
      *
      */
     void cont();
+    /** 
+     * @brief handle each complete message in newdata
+     *
+     * stops when a statement is executing, leaving the remainder in
+     * pendingbuf until resume()
+     *
+     * @param newdata data read from socket
+     */
+    void processinput(string &newdata);
+    /** 
+     * @brief handle one complete message, based on state
+     *
+     */
+    void command();
+    /** 
+     * @brief continue processing input held while a statement executed
+     *
+     * called by TransactionAgent after the statement's response is written
+     */
+    void resume();
     /** 
      * @brief read new command from socket
      *
@@ -178,6 +273,31 @@ public:
      *
      */
     void replymsg();
+    /** 
+     * @brief append to outbound chunks
+     *
+     * @param data bytes to append
+     * @param len number of bytes
+     */
+    void outappend(const char *data, size_t len);
+    /** 
+     * @brief release sent bytes from the front of outbound chunks
+     *
+     * @param len number of bytes sent
+     */
+    void outconsume(size_t len);
+    /** 
+     * @brief drop unsent bytes from the end of outbound chunks
+     *
+     * @param len number of bytes to keep
+     */
+    void outtruncate(size_t len);
+    /** 
+     * @brief move emptied chunk to free list for reuse
+     *
+     * @param chunk chunk to recycle
+     */
+    void outrecycle(std::string &chunk);
     /** 
      * @brief write response messages to socket
      *
@@ -190,12 +310,35 @@ public:
     /** 
      * @brief write stored buffer to socket
      *
-     * called after socket becomes writable
-     *
+     * called after socket becomes writable. once drained, continues a
+     * paused result or held pipelined input
      *
      * @return see writesocket
      */
     short rewritesocket();
+    /** 
+     * @brief send outbound chunks with writev, without appending
+     * ReadyForQuery
+     *
+     * @return see writesocket
+     */
+    short flushsocket();
+    /** 
+     * @brief send outbound chunks unless more pipelined messages are queued
+     *
+     * the response to the last message of a pipelined batch flushes
+     * the whole batch, or earlier once they reach PGCOALESCEMAX
+     *
+     * @return see writesocket
+     */
+    short coalescesocket();
+    /** 
+     * @brief whether another message is ready to handle after this one
+     *
+     * @return true if pendingbuf holds a complete message, or socket
+     * input was left unread
+     */
+    bool isinputqueued();
 
     /** 
      * @brief read 16bit integer from inbound message string
@@ -362,10 +505,57 @@ public:
      */
     void putRowDescription();
     /** 
-     * @brief write rows to outbound message buffer
+     * @brief write field names to outbound message buffer
+     *
+     * @param fields field types and names
+     * @param formats format code per field, text if not present
+     */
+    void putRowDescription(const std::vector<fieldtypename_s> &fields,
+                           const std::vector<int16_t> &formats);
+    /** 
+     * @brief write rows to outbound message buffer, from dataRowsIt
      *
+     * sends rows as PGOUTHIGHWATER bytes accumulate, pausing until
+     * the socket drains if the client isn't reading
+     *
+     * stops after maxrows rows for this Execute
+     *
+     * @return false if paused or socket closed, true if all rows put
+     * or maxrows reached
+     */
+    bool putDataRows();
+    /** 
+     * @brief put rows, then fetch more from cursor, suspend portal or
+     * complete SELECT
+     *
+     * also continues after paused putDataRows()
      */
-    void putDataRows();
+    void selectRows();
+    /** 
+     * @brief continue SELECT with rows from fetchRows()
+     *
+     */
+    void continueFetch();
+    /** 
+     * @brief keep unsent rows in portal until its next Execute
+     *
+     */
+    void suspendPortal();
+    /** 
+     * @brief Execute on suspended portal
+     *
+     * @param portalRef portal
+     */
+    void resumePortal(portal_s &portalRef);
+    /** 
+     * @brief write field in binary format to outbound message buffer
+     *
+     * @param type field type
+     * @param fieldValue field value
+     *
+     * @return false if type has no binary format
+     */
+    bool putBinaryField(fieldtype_e type, const fieldValue_s &fieldValue);
     /** 
      * @brief write authenticationok status to outbound message buffer
      *
@@ -432,6 +622,239 @@ public:
      * @param stmtstr query string
      */
     void executeStatement(string &stmtstr);
+    /** 
+     * @brief copy of cached template for stmtstr, parsing and caching it
+     * if new
+     *
+     * @param stmtstr query string
+     * @param parameters output literals taken out of stmtstr
+     *
+     * @return Statement to execute with parameters, NULL if stmtstr must
+     * be parsed as is
+     */
+    class Statement *cachedStatement(string &stmtstr,
+                                     vector<string> &parameters);
+    /** 
+     * @brief Parse message, prepare named or unnamed statement
+     *
+     * @return false if message malformed
+     */
+    bool parsemsg();
+    /** 
+     * @brief Bind message, create portal from prepared statement and
+     * parameters
+     *
+     * @return false if message malformed
+     */
+    bool bindmsg();
+    /** 
+     * @brief Describe message, for prepared statement or portal
+     *
+     * @return false if message malformed
+     */
+    bool describemsg();
+    /** 
+     * @brief Execute message, execute portal
+     *
+     * @return false if message malformed
+     */
+    bool executemsg();
+    /** 
+     * @brief Close message, for prepared statement or portal
+     *
+     * @return false if message malformed
+     */
+    bool closemsg();
+    /** 
+     * @brief Sync message, end of extended query, send ReadyForQuery
+     *
+     */
+    void syncmsg();
+    /** 
+     * @brief convert text parameter from Bind to Ast operand
+     *
+     * @param oid parameter type, 0 if unspecified
+     * @param format format code, 0 text
+     * @param val parameter value
+     * @param operand converted operand
+     *
+     * @return false if val doesn't convert to type
+     */
+    static bool bindParameter(int32_t oid, int16_t format, const string &val,
+                              string &operand);
+    /** 
+     * @brief convert binary parameter from Bind to Ast operand
+     *
+     * @param oid parameter type
+     * @param val parameter value, network byte order
+     * @param operand converted operand
+     *
+     * @return false if type unsupported or val wrong length
+     */
+    static bool bindBinaryParameter(int32_t oid, const string &val,
+                                    string &operand);
+    /** 
+     * @brief fill in unspecified parameter types from the fields they're
+     * compared to or assigned to
+     *
+     * @param stmtRef resolved statement
+     * @param paramtypes oid per parameter
+     */
+    void inferParameterTypes(class Statement &stmtRef,
+                             std::vector<int32_t> &paramtypes);
+    /** 
+     * @brief called by inferParameterTypes recursively on each expression
+     *
+     * @param astPtr expression
+     * @param tableRef table fields belong to
+     * @param paramtypes oid per parameter
+     */
+    static void inferParameterTypes(class Ast *astPtr, class Table &tableRef,
+                                    std::vector<int32_t> &paramtypes);
+    /** 
+     * @brief set type of parameter operand if unspecified
+     *
+     * @param operand parameter operand
+     * @param type field type
+     * @param paramtypes oid per parameter
+     */
+    static void setParameterType(const string &operand, fieldtype_e type,
+                                 std::vector<int32_t> &paramtypes);
+    /** 
+     * @brief delete portals' statements and portals
+     *
+     */
+    void clearPortals();
+    /** 
+     * @brief release portal's statement, rows and cursor
+     *
+     * @param portalRef portal
+     */
+    void closePortal(portal_s &portalRef);
+    /** 
+     * @brief statement finished executing, resume input held meanwhile
+     *
+     */
+    void executed();
+    /** 
+     * @brief start COPY FROM STDIN or TO STDOUT
+     *
+     * @param stmtstr query string
+     *
+     * @return false if not a COPY statement
+     */
+    bool executeCopy(string &stmtstr);
+    /** 
+     * @brief CopyData message, parse rows and send full batches
+     *
+     */
+    void copydatamsg();
+    /** 
+     * @brief CopyDone message, send remaining rows then complete COPY
+     *
+     */
+    void copydonemsg();
+    /** 
+     * @brief CopyFail message, abandon COPY
+     *
+     */
+    void copyfailmsg();
+    /** 
+     * @brief parse buffered CopyData, make rows and route them to batches
+     *
+     * @param isfinal no more data coming
+     *
+     * @return false if COPY failed and error was sent
+     */
+    bool copyrows(bool isfinal);
+    /** 
+     * @brief send batches to engines
+     *
+     */
+    void copyflush();
+    /** 
+     * @brief continuation after batch inserted
+     *
+     */
+    void continueCopyIn();
+    /** 
+     * @brief send CommandComplete and commit if necessary
+     *
+     */
+    void copyfinish();
+    /** 
+     * @brief abandon COPY FROM, rollback and send ErrorResponse
+     *
+     * @param code SQLSTATE
+     * @param message message
+     */
+    void copyerror(char *code, char *message);
+    /** 
+     * @brief write SELECT results as CopyOutResponse, CopyData and CopyDone
+     *
+     */
+    void putCopyData();
+    /** 
+     * @brief parse COPY statement
+     *
+     * supports FROM STDIN and TO STDOUT, with both parenthesized and
+     * pre-9.0 options: FORMAT, BINARY, CSV, DELIMITER, NULL, HEADER, QUOTE,
+     * ESCAPE
+     *
+     * @param stmtstr query string
+     * @param copyRef direction and options set
+     * @param tablename table, empty if query
+     * @param columns column list, empty for all
+     * @param query query in parentheses, for TO STDOUT
+     *
+     * @return false if not a valid COPY statement
+     */
+    static bool parseCopy(const string &stmtstr, copy_s &copyRef,
+                          string &tablename, std::vector<string> &columns,
+                          string &query);
+    /** 
+     * @brief parse complete rows from copyRef.buf, consuming them
+     *
+     * @param copyRef COPY in progress
+     * @param isfinal no more data coming, end of buffer ends last row
+     * @param rows field values of each row, in order of data columns
+     *
+     * @return false if data malformed
+     */
+    static bool parseCopyData(copy_s &copyRef, bool isfinal,
+                              std::vector< std::vector<fieldValue_s> > &rows);
+    /** 
+     * @brief convert text or csv field
+     *
+     * @param type field type
+     * @param val field after unescaping
+     * @param fieldValue output
+     *
+     * @return false if val doesn't convert to type
+     */
+    static bool copyTextField(fieldtype_e type, const string &val,
+                              fieldValue_s &fieldValue);
+    /** 
+     * @brief convert binary field
+     *
+     * @param type field type
+     * @param val field, network byte order
+     * @param len length of val
+     * @param fieldValue output
+     *
+     * @return false if val wrong length for type
+     */
+    static bool copyBinaryField(fieldtype_e type, const char *val, size_t len,
+                                fieldValue_s &fieldValue);
+    /** 
+     * @brief text representation of field, as in DataRow
+     *
+     * @param type field type
+     * @param fieldValue field
+     * @param val output
+     */
+    static void copyFieldText(fieldtype_e type, const fieldValue_s &fieldValue,
+                              string &val);
     /** 
      * @brief output error based on Transaction::resultCode
      *
@@ -450,7 +873,24 @@ public:
     size_t pos;
     char outcmd;
     std::string outmsg;
-    std::string outbuf;
+    // unsent responses, in chunks of up to PGOUTCHUNKSIZE
+    std::vector<std::string> outchunks;
+    // bytes of outchunks[0] already sent
+    size_t outchunkpos;
+    // unsent bytes in outchunks
+    size_t outbuflen;
+    // outbuflen when the current message's response started
+    size_t outbufmark;
+    // sent chunks kept for reuse
+    std::vector<std::string> freechunks;
+    // socket full, EPOLLOUT armed instead of EPOLLIN
+    bool iswritepending;
+    // format code per column of current Execute, empty for all text
+    std::vector<int16_t> resultformats;
+    // input received after the message being executed
+    std::string pendingbuf;
+    // messages processed since the TransactionAgent last looked
+    int64_t activity;
 
     int64_t userid;
     class Schema *schemaPtr;
@@ -465,6 +905,40 @@ public:
     // autocommit a command that started without being in a transaction block
     bool command_autocommit;
     bool isintransactionblock;
+
+    // extended query protocol
+    boost::unordered_map<std::string, preparedStatement_s> preparedStatements;
+    boost::unordered_map<std::string, portal_s> portals;
+    // between first extended query message and Sync
+    bool isextendedquery;
+    // error during extended query, discard messages until Sync
+    bool isskippingtosync;
+    // statement in flight, hold further input in pendingbuf
+    bool isexecuting;
+    // pendingbuf full while executing, socket left unread
+    bool isreadpending;
+    // implicit rollback in flight, hold input until it finishes
+    bool isrollingback;
+
+    // COPY
+    copy_s copystate;
+    // SELECT in flight is for COPY TO STDOUT
+    bool iscopyout;
+    // next row for putDataRows()
+    boost::unordered_map< uuRecord_s,
+                          std::vector<fieldValue_s> >::const_iterator dataRowsIt;
+    // putDataRows() paused until the socket drains
+    bool isstreaming;
+    // rows put by current Execute, and most it may put
+    size_t selectrows;
+    size_t maxrows;
+    // portal of current Execute, empty for simple query
+    std::string executingportal;
+    // implicit transaction left open by a suspended portal, ends at Sync
+    bool isimplicittransaction;
+    // Statement::cursorowner of current execution, and the last one given
+    int64_t cursorowner;
+    int64_t lastcursorowner;
 };
 
 #endif  /* INFINISQLPG_H */
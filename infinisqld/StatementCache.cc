@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2013 Mark Travis <mtravis15432+src@gmail.com>
+ * All rights reserved. No warranty, explicit or implicit, provided.
+ *
+ * This file is part of InfiniSQL(tm).
+
+ * InfiniSQL is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3
+ * as published by the Free Software Foundation.
+ *
+ * InfiniSQL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with InfiniSQL. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   StatementCache.cc
+ *
+ * @brief  per-TransactionAgent LRU cache of parsed and resolved Statements,
+ * keyed by query text with literals replaced by parameters
+ */
+
+#include "gch.h"
+#include "StatementCache.h"
+#include "Asts.h"
+#line 32 "StatementCache.cc"
+
+pthread_mutex_t StatementCache::cachesMutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<class StatementCache *> StatementCache::caches;
+
+StatementCache::StatementCache(size_t capacityarg) : capacity(capacityarg),
+                                                     hits(0), misses(0),
+                                                     evictions(0),
+                                                     invalidations(0)
+{
+    pthread_mutex_lock(&cachesMutex);
+    caches.push_back(this);
+    pthread_mutex_unlock(&cachesMutex);
+}
+
+StatementCache::~StatementCache()
+{
+    pthread_mutex_lock(&cachesMutex);
+    caches.erase(std::find(caches.begin(), caches.end(), this));
+    pthread_mutex_unlock(&cachesMutex);
+
+    while (!entries.empty())
+    {
+        erase(entries.begin());
+    }
+}
+
+/* tokens follow lexer.ll: 'string', "identifier", words, [0-9]+ and
+ * [0-9]*"."[0-9]+ numbers, -- comments, and everything else as single
+ * characters. A sign right before a number is folded into the parameter
+ * where the grammar's number rule would have taken it
+ */
+bool StatementCache::normalize(const string &query, string &key,
+                               vector<string> &parameters)
+{
+    key.clear();
+    key.reserve(query.size());
+    parameters.clear();
+    // previous 2 tokens: 'w' word, 'v' ends an operand, 'p' other, ' ' none
+    char prev=' ';
+    char prevprev=' ';
+    size_t prevpos=0;
+    // last word, in query
+    const char *word=NULL;
+    size_t wordlen=0;
+    size_t len = query.size();
+    size_t n=0;
+
+    while (n < len)
+    {
+        char c = query[n];
+
+        if (c==' ' || c=='\t' || c=='\n' || c=='\r')
+        {
+            key.push_back(c);
+            n++;
+            continue;
+        }
+
+        if (c=='-' && n+1 < len && query[n+1]=='-')
+        {
+            size_t end = query.find('\n', n);
+
+            if (end==string::npos)
+            {
+                end = len;
+            }
+
+            key.append(query, n, end-n);
+            n = end;
+            continue;
+        }
+
+        size_t pos = key.size();
+        char token;
+        string operand;
+
+        if (c=='\'')
+        {
+            size_t end = n+1;
+
+            while (1)
+            {
+                end = query.find('\'', end);
+
+                if (end==string::npos)
+                {
+                    return false;
+                }
+                if (end+1 < len && query[end+1]=='\'')
+                {
+                    end += 2;
+                    continue;
+                }
+
+                break;
+            }
+
+            if (prev=='w' && ((wordlen==4 && !strncasecmp(word, "LIKE", 4)) ||
+                              (wordlen==7 && !strncasecmp(word, "COLLATE", 7))))
+            {
+                // grammar wants the string itself
+                key.append(query, n, end+1-n);
+            }
+            else
+            {
+                // as lexer and parser leave it, '' not collapsed
+                operand.assign(1, OPERAND_STRING);
+                operand.append(query, n+1, end-n-1);
+            }
+
+            n = end+1;
+            token = 'v';
+        }
+        else if (c=='"')
+        {
+            size_t end = query.find('"', n+1);
+
+            if (end==string::npos)
+            {
+                return false;
+            }
+
+            key.append(query, n, end+1-n);
+            n = end+1;
+            token = 'v';
+        }
+        else if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
+        {
+            size_t end = n+1;
+
+            while (end < len && (isalnum(query[end]) || query[end]=='_'))
+            {
+                end++;
+            }
+
+            word = &query[n];
+            wordlen = end-n;
+            key.append(query, n, end-n);
+            n = end;
+            token = 'w';
+        }
+        else if (isdigit(c) || (c=='.' && n+1 < len && isdigit(query[n+1])))
+        {
+            size_t end = n;
+
+            while (end < len && isdigit(query[end]))
+            {
+                end++;
+            }
+
+            bool isfloat = false;
+
+            if (end+1 < len && query[end]=='.' && isdigit(query[end+1]))
+            {
+                isfloat = true;
+                end++;
+
+                while (end < len && isdigit(query[end]))
+                {
+                    end++;
+                }
+            }
+
+            string text(query, n, end-n);
+            bool isnegative = false;
+            n = end;
+            token = 'v';
+
+            if (prev=='p' && (key[prevpos]=='-' || key[prevpos]=='+'))
+            {
+                if (prevprev=='w')
+                {
+                    // unary after keyword, or binary after identifier
+                    key.append(text);
+                    prevprev = prev;
+                    prev = token;
+                    prevpos = pos;
+                    continue;
+                }
+                if (prevprev != 'v')
+                {
+                    // number rule: sign and literal are the operand
+                    isnegative = key[prevpos]=='-';
+                    key.resize(prevpos);
+                    pos = prevpos;
+                    prev = prevprev;
+                }
+            }
+
+            if (isfloat)
+            {
+                long double val = strtold(text.c_str(), NULL);
+
+                if (isnegative)
+                {
+                    val = 0-val;
+                }
+
+                operand.assign(1 + sizeof(val), char(0));
+                operand[0] = OPERAND_FLOAT;
+                memcpy(&operand[1], &val, sizeof(val));
+            }
+            else
+            {
+                int64_t val = atol(text.c_str());
+
+                if (isnegative)
+                {
+                    val = 0-val;
+                }
+
+                operand.assign(1 + sizeof(val), char(0));
+                operand[0] = OPERAND_INTEGER;
+                memcpy(&operand[1], &val, sizeof(val));
+            }
+        }
+        else if (c=='$' || (c==':' && n+1 < len && isdigit(query[n+1])))
+        {
+            // already has parameters
+            return false;
+        }
+        else
+        {
+            key.push_back(c);
+            n++;
+            token = c==')' ? 'v' : 'p';
+        }
+
+        if (!operand.empty())
+        {
+            parameters.push_back(operand);
+            key.push_back('$');
+            key.append(std::to_string(parameters.size()));
+        }
+
+        prevprev = prev;
+        prev = token;
+        prevpos = pos;
+    }
+
+    return true;
+}
+
+bool StatementCache::get(int64_t domainid, const string &key,
+                         class Statement **statementPtr)
+{
+    boost::unordered_map<cacheKey, std::list<entry_s>::iterator>::iterator it;
+    it = index.find(cacheKey(domainid, key));
+
+    if (it==index.end())
+    {
+        __atomic_store_n(&misses, misses+1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    __atomic_store_n(&hits, hits+1, __ATOMIC_RELAXED);
+    entries.splice(entries.begin(), entries, it->second);
+    *statementPtr = it->second->statementPtr;
+
+    return true;
+}
+
+void StatementCache::put(int64_t domainid, const string &key,
+                         class Statement *statementPtr)
+{
+    cacheKey k(domainid, key);
+    boost::unordered_map<cacheKey, std::list<entry_s>::iterator>::iterator it;
+    it = index.find(k);
+
+    if (it != index.end())
+    {
+        erase(it->second);
+    }
+
+    entries.push_front({k, statementPtr});
+    index[k] = entries.begin();
+
+    if (entries.size() > capacity)
+    {
+        erase(--entries.end());
+        __atomic_store_n(&evictions, evictions+1, __ATOMIC_RELAXED);
+    }
+}
+
+void StatementCache::invalidate(int64_t domainid)
+{
+    std::list<entry_s>::iterator it = entries.begin();
+
+    while (it != entries.end())
+    {
+        std::list<entry_s>::iterator next = it;
+        ++next;
+
+        if (it->key.first==domainid)
+        {
+            erase(it);
+            __atomic_store_n(&invalidations, invalidations+1,
+                             __ATOMIC_RELAXED);
+        }
+
+        it = next;
+    }
+}
+
+size_t StatementCache::size()
+{
+    return entries.size();
+}
+
+void StatementCache::erase(std::list<entry_s>::iterator it)
+{
+    index.erase(it->key);
+    delete it->statementPtr;
+    entries.erase(it);
+}
+
+void StatementCache::getStats(stats_s &stats)
+{
+    stats = stats_s();
+    pthread_mutex_lock(&cachesMutex);
+
+    for (size_t n=0; n < caches.size(); n++)
+    {
+        stats.hits += __atomic_load_n(&caches[n]->hits, __ATOMIC_RELAXED);
+        stats.misses += __atomic_load_n(&caches[n]->misses, __ATOMIC_RELAXED);
+        stats.evictions += __atomic_load_n(&caches[n]->evictions,
+                                           __ATOMIC_RELAXED);
+        stats.invalidations += __atomic_load_n(&caches[n]->invalidations,
+                                               __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&cachesMutex);
+}
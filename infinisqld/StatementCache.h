@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2013 Mark Travis <mtravis15432+src@gmail.com>
+ * All rights reserved. No warranty, explicit or implicit, provided.
+ *
+ * This file is part of InfiniSQL(tm).
+
+ * InfiniSQL is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3
+ * as published by the Free Software Foundation.
+ *
+ * InfiniSQL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with InfiniSQL. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   StatementCache.h
+ *
+ * @brief  per-TransactionAgent LRU cache of parsed and resolved Statements,
+ * keyed by query text with literals replaced by parameters
+ */
+
+#ifndef INFINISQLSTATEMENTCACHE_H
+#define INFINISQLSTATEMENTCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <utility>
+#include <boost/unordered_map.hpp>
+
+class Statement;
+
+/**
+ * @brief Statement templates for simple query protocol
+ *
+ * normalize() turns each literal into $n and returns the literal as the
+ * operand Larxer would have pushed for it, so a template parsed from the
+ * normalized text executes with those operands as Statement::parameters,
+ * the same way as a prepared statement. Entries are per domain, since
+ * they are resolved against the domain's Schema, and the domain's
+ * entries are dropped when its schema changes.
+ */
+class StatementCache
+{
+public:
+    /**
+     * @brief aggregate counters across all caches
+     *
+     */
+    struct stats_s
+    {
+        uint64_t hits;          /**< lookups that found an entry */
+        uint64_t misses;        /**< lookups that had to parse */
+        uint64_t evictions;     /**< entries dropped as least recently used */
+        uint64_t invalidations; /**< entries dropped by schema changes */
+    };
+
+    /**
+     * @param capacityarg most entries kept
+     */
+    StatementCache(size_t capacityarg);
+    virtual ~StatementCache();
+
+    /**
+     * @brief replace literals in query with parameters
+     *
+     * literals that the grammar doesn't take as operands, such as LIKE
+     * patterns, stay in the text
+     *
+     * @param query SQL text
+     * @param key output normalized text, parseable by Larxer
+     * @param parameters output operands, parameters[n] for $n+1
+     *
+     * @return false if query can't be normalized, such as if it already
+     * has parameters
+     */
+    static bool normalize(const std::string &query, std::string &key,
+                          std::vector<std::string> &parameters);
+    /**
+     * @brief look up template, making it most recently used
+     *
+     * @param domainid domainid
+     * @param key normalized text
+     * @param statementPtr output template, NULL if key is known not to be
+     * cacheable
+     *
+     * @return true if key is cached
+     */
+    bool get(int64_t domainid, const std::string &key,
+             class Statement **statementPtr);
+    /**
+     * @brief add template, evicting least recently used entry if full
+     *
+     * @param domainid domainid
+     * @param key normalized text
+     * @param statementPtr template, cache takes ownership. NULL to
+     * remember that key isn't cacheable
+     */
+    void put(int64_t domainid, const std::string &key,
+             class Statement *statementPtr);
+    /**
+     * @brief drop domain's entries
+     *
+     * @param domainid domainid
+     */
+    void invalidate(int64_t domainid);
+    /**
+     * @brief number of entries
+     *
+     * @return number of entries
+     */
+    size_t size();
+    /**
+     * @brief sum counters of every cache
+     *
+     * @param stats output counters
+     */
+    static void getStats(stats_s &stats);
+
+private:
+    typedef std::pair<int64_t, std::string> cacheKey;
+
+    /**
+     * @brief cached template
+     *
+     */
+    struct entry_s
+    {
+        cacheKey key;
+        class Statement *statementPtr;
+    };
+
+    /**
+     * @brief delete entry
+     *
+     * @param it entry
+     */
+    void erase(std::list<entry_s>::iterator it);
+
+    size_t capacity;
+    // most recently used first
+    std::list<entry_s> entries;
+    boost::unordered_map<cacheKey, std::list<entry_s>::iterator> index;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+
+    static pthread_mutex_t cachesMutex;
+    static std::vector<class StatementCache *> caches;
+};
+
+#endif  /* INFINISQLSTATEMENTCACHE_H */
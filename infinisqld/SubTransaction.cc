@@ -65,7 +65,26 @@ void SubTransaction::processTransactionMessage(class Message *msgrcvarg)
         {
             msgref.subtransactionStruct.rowid =
                 newrow(subtransactionCmdRef.subtransactionStruct.tableid,
-                       subtransactionCmdRef.row);
+                       subtransactionCmdRef.getRow());
+            msgref.subtransactionStruct.locktype = WRITELOCK;
+        }
+        break;
+
+        case NEWROWS:
+        {
+            // batch from COPY, rowids returned in the same order as rows
+            vector<returnRow_s> &newRows = subtransactionCmdRef.getReturnRows();
+            msgref.rowids.reserve(newRows.size());
+
+            for (size_t n=0; n < newRows.size(); n++)
+            {
+                msgref.rowids.push_back(
+                    newrow(subtransactionCmdRef.subtransactionStruct.tableid,
+                           newRows[n].row));
+            }
+
+            msgref.subtransactionStruct.tableid =
+                subtransactionCmdRef.subtransactionStruct.tableid;
             msgref.subtransactionStruct.locktype = WRITELOCK;
         }
         break;
@@ -91,7 +110,7 @@ void SubTransaction::processTransactionMessage(class Message *msgrcvarg)
             msgref.subtransactionStruct.status =
                 updaterow(subtransactionCmdRef.subtransactionStruct.tableid,
                           subtransactionCmdRef.subtransactionStruct.rowid,
-                          &subtransactionCmdRef.row);
+                          &subtransactionCmdRef.getRow());
             msgref.subtransactionStruct.locktype=WRITELOCK;
         }
         break;
@@ -136,6 +155,7 @@ void SubTransaction::processTransactionMessage(class Message *msgrcvarg)
                        &subtransactionCmdRef.rowids,
                        subtransactionCmdRef.subtransactionStruct.locktype,
                        subtransactionCmdRef.transactionStruct.transaction_pendingcmdid,
+                       subtransactionCmdRef.searchParameters,
                        &msgref.returnRows);
         }
         break;
@@ -2312,12 +2332,54 @@ int64_t SubTransaction::deleterow(int64_t tableid, int64_t rowid,
 
 void SubTransaction::selectrows(int64_t tableid, vector<int64_t> *rowids,
                                 locktype_e locktype, int64_t pendingcmdid,
+                                searchParams_s &searchParams,
                                 vector<returnRow_s> *returnRows)
 {
     int64_t tacmd = ((class MessageTransaction *)msgrcv)->transactionStruct.transaction_tacmdentrypoint;
     class Table &tableRef = *schemaPtr->tables[tableid];
+
+    if (!searchParams.residuals.empty())
+    {
+        /* drop rows failing the remaining conjuncts before they're locked.
+         * rowids not found are kept, so they're returned as NOTFOUNDLOCK */
+        vector<int64_t> &rowidsRef = *rowids;
+        size_t kept = 0;
+
+        for (size_t n=0; n < rowidsRef.size(); n++)
+        {
+            boost::unordered_map<int64_t, rowdata_s *>::iterator it =
+                tableRef.rows.find(rowidsRef[n]);
+
+            if (it != tableRef.rows.end() &&
+                tableRef.qualifies(&it->second->row,
+                                   searchParams.residuals)==false)
+            {
+                continue;
+            }
+
+            rowidsRef[kept++] = rowidsRef[n];
+        }
+
+        rowidsRef.resize(kept);
+    }
+
     tableRef.selectrows(rowids, locktype, subtransactionid, pendingcmdid,
                         returnRows, tacmd);
+
+    if (!searchParams.projection.empty())
+    {
+        vector<returnRow_s> &returnRowsRef = *returnRows;
+
+        for (size_t n=0; n < returnRowsRef.size(); n++)
+        {
+            // locked rows are staged whole by the Transaction
+            if (returnRowsRef[n].locktype==NOLOCK)
+            {
+                tableRef.project(&returnRowsRef[n].row,
+                                 searchParams.projection);
+            }
+        }
+    }
 }
 
 void SubTransaction::searchReturn1(int64_t tableid, int64_t fieldid,
@@ -2336,7 +2398,7 @@ void SubTransaction::searchReturn1(int64_t tableid, int64_t fieldid,
             *(class MessageSubtransactionCmd *)msgrcv;
         vector<int64_t> rowids(1, hit.rowid);
         selectrows(tableid, &rowids, locktype, msgrcvRef.transactionStruct.transaction_pendingcmdid,
-                   &returnRows);
+                   searchParams, &returnRows);
     }
     else
     {
@@ -164,14 +164,20 @@ private:
     /** 
      * @brief return rows
      *
+     * rows not satisfying searchParams.residuals are neither locked nor
+     * returned, and returned unlocked rows only carry the fields in
+     * searchParams.projection
+     *
      * @param tableid tableid
      * @param rowids list of rowids to return
      * @param locktype lock type
      * @param pendingcmdid pending commad of sending Transaction
+     * @param searchParams residual predicates and projection
      * @param returnRows rows to return
      */
     void selectrows(int64_t tableid, vector<int64_t> *rowids,
                     locktype_e locktype, int64_t pendingcmdid,
+                    searchParams_s &searchParams,
                     vector<returnRow_s> *returnRows);
     /** 
      * @brief search index for and return matching rows
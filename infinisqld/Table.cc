@@ -1003,6 +1003,166 @@ bool Table::unmakerow(string *rowstring, vector<fieldValue_s> *resultFields)
     return true;
 }
 
+template <class T>
+static int comparefield(T lhs, T rhs)
+{
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+bool Table::qualifies(vector<fieldValue_s> &fieldValues,
+                      vector<residualPredicate_s> &residuals)
+{
+    for (size_t n=0; n < residuals.size(); n++)
+    {
+        residualPredicate_s &residualRef = residuals[n];
+        fieldValue_s &lhs = fieldValues[residualRef.fieldid];
+        fieldInput_s &rhs = residualRef.value.value;
+
+        if (lhs.isnull==true)
+        {
+            // comparison to NULL is unknown, so row doesn't qualify
+            return false;
+        }
+
+        int cmp;
+
+        switch (fields[residualRef.fieldid].type)
+        {
+        case INT:
+            cmp = comparefield(lhs.value.integer, rhs.integer);
+            break;
+
+        case UINT:
+            cmp = comparefield(lhs.value.uinteger, rhs.uinteger);
+            break;
+
+        case BOOL:
+            cmp = comparefield(lhs.value.boolean, rhs.boolean);
+            break;
+
+        case FLOAT:
+            cmp = comparefield(lhs.value.floating, rhs.floating);
+            break;
+
+        case CHAR:
+            cmp = comparefield(lhs.value.character, rhs.character);
+            break;
+
+        case CHARX:
+            cmp = lhs.str.compare(residualRef.value.str);
+            break;
+
+        case VARCHAR:
+            cmp = lhs.str.compare(residualRef.value.str);
+            break;
+
+        default:
+            fprintf(logfile, "anomaly: %i %s %i\n",
+                    fields[residualRef.fieldid].type, __FILE__, __LINE__);
+            return false;
+        }
+
+        switch (residualRef.op)
+        {
+        case OPERATOR_EQ:
+            if (cmp != 0)
+            {
+                return false;
+            }
+
+            break;
+
+        case OPERATOR_NE:
+            if (cmp == 0)
+            {
+                return false;
+            }
+
+            break;
+
+        case OPERATOR_LT:
+            if (cmp >= 0)
+            {
+                return false;
+            }
+
+            break;
+
+        case OPERATOR_GT:
+            if (cmp <= 0)
+            {
+                return false;
+            }
+
+            break;
+
+        case OPERATOR_LTE:
+            if (cmp > 0)
+            {
+                return false;
+            }
+
+            break;
+
+        case OPERATOR_GTE:
+            if (cmp < 0)
+            {
+                return false;
+            }
+
+            break;
+
+        default:
+            fprintf(logfile, "anomaly: %i %s %i\n", residualRef.op, __FILE__,
+                    __LINE__);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Table::qualifies(string *rowstring, vector<residualPredicate_s> &residuals)
+{
+    if (residuals.empty())
+    {
+        return true;
+    }
+
+    vector<fieldValue_s> fieldValues;
+
+    if (unmakerow(rowstring, &fieldValues)==false)
+    {
+        return false;
+    }
+
+    return qualifies(fieldValues, residuals);
+}
+
+void Table::project(string *rowstring, vector<int64_t> &projection)
+{
+    vector<fieldValue_s> fieldValues;
+    unmakerow(rowstring, &fieldValues);
+    vector<bool> isprojected(fieldValues.size(), false);
+
+    for (size_t n=0; n < projection.size(); n++)
+    {
+        isprojected[projection[n]] = true;
+    }
+
+    for (size_t n=0; n < fieldValues.size(); n++)
+    {
+        if (isprojected[n]==false)
+        {
+            fieldValues[n].value = fieldInput_s();
+            fieldValues[n].str.clear();
+            fieldValues[n].isnull = true;
+        }
+    }
+
+    makerow(&fieldValues, rowstring);
+}
+
 int64_t Table::getnextrowid()
 {
     return ++nextrowid;
@@ -136,6 +136,35 @@ public:
      */
     bool unmakerow(std::string *rowstring,
                    vector<fieldValue_s> *resultFields);
+    /** 
+     * @brief check fields against residual predicates
+     *
+     * rows with NULL in a compared field don't qualify
+     *
+     * @param fieldValues fields, as from unmakerow
+     * @param residuals predicates, all of which must be true
+     *
+     * @return true if row qualifies
+     */
+    bool qualifies(vector<fieldValue_s> &fieldValues,
+                   vector<residualPredicate_s> &residuals);
+    /** 
+     * @brief check row string against residual predicates
+     *
+     * @param rowstring row
+     * @param residuals predicates, all of which must be true
+     *
+     * @return true if row qualifies
+     */
+    bool qualifies(std::string *rowstring,
+                   vector<residualPredicate_s> &residuals);
+    /** 
+     * @brief set fields not in projection to NULL, keeping row layout
+     *
+     * @param rowstring row, modified in place
+     * @param projection fieldids to keep
+     */
+    void project(std::string *rowstring, vector<int64_t> &projection);
     // for fetch (cursor)
     /** 
      * @brief orphan?
@@ -129,6 +129,10 @@ public:
     size_t numobgateways;
 
     vector<actor_s> actorList;
+    // Listener's client addresses, raw then pg. Each TransactionAgent
+    // binds its own SO_REUSEPORT sockets to them
+    vector<string> listenerNodes;
+    vector<string> listenerServices;
 
     //global
     int16_t numpartitions;
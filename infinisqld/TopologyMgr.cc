@@ -166,6 +166,75 @@ TopologyMgr::TopologyMgr(Topology::actorIdentity *myIdentityArg) :
             }
             break;
 
+            case CMDMBOXSPIN:
+            {
+                if (pac.next(&result)==false)
+                {
+                    replypk.pack_int(CMDNOTOK);
+                    replyToManager(zmqresponder, replysbuf);
+                    zmq_msg_close(&zmqrecvmsg);
+                    goto HECK;
+                }
+
+                int actortype;
+                msgpack::object obj3 = result.get();
+                obj3.convert(&actortype);
+
+                if (pac.next(&result)==false || actortype < 0 ||
+                    actortype >= NUMACTORTYPES)
+                {
+                    replypk.pack_int(CMDNOTOK);
+                    replyToManager(zmqresponder, replysbuf);
+                    zmq_msg_close(&zmqrecvmsg);
+                    goto HECK;
+                }
+
+                int64_t val;
+                msgpack::object obj4 = result.get();
+                obj4.convert(&val);
+
+                // consumers pick it up on their next empty receive
+                __atomic_store_n(&cfgs.mboxspin[actortype], val < 0 ? 0 : val,
+                                 __ATOMIC_RELAXED);
+                replypk.pack_int(CMDOK);
+            }
+            break;
+
+            case CMDTAPLACEMENT:
+            {
+                if (pac.next(&result)==false)
+                {
+                    replypk.pack_int(CMDNOTOK);
+                    replyToManager(zmqresponder, replysbuf);
+                    zmq_msg_close(&zmqrecvmsg);
+                    goto HECK;
+                }
+
+                int64_t margin;
+                msgpack::object obj3 = result.get();
+                obj3.convert(&margin);
+
+                if (pac.next(&result)==false)
+                {
+                    replypk.pack_int(CMDNOTOK);
+                    replyToManager(zmqresponder, replysbuf);
+                    zmq_msg_close(&zmqrecvmsg);
+                    goto HECK;
+                }
+
+                int migrate;
+                msgpack::object obj4 = result.get();
+                obj4.convert(&migrate);
+
+                // TransactionAgents read both on each accept and load sample
+                __atomic_store_n(&cfgs.taplacementmargin, margin,
+                                 __ATOMIC_RELAXED);
+                __atomic_store_n(&cfgs.tamigrate, migrate != 0,
+                                 __ATOMIC_RELAXED);
+                replypk.pack_int(CMDOK);
+            }
+            break;
+
             default:
                 replypk.pack_int(CMDNOTOK);
                 replyToManager(zmqresponder, replysbuf);
@@ -295,6 +364,10 @@ TopologyMgr::TopologyMgr(Topology::actorIdentity *myIdentityArg) :
                 obj4.convert(&service);
                 services.push_back(service);
 
+                pthread_mutex_lock(&nodeTopologyMutex);
+                nodeTopology.listenerNodes = nodes;
+                nodeTopology.listenerServices = services;
+                pthread_mutex_unlock(&nodeTopologyMutex);
                 newmbox = new class Mbox;
 
                 if (pthread_create(&tid, NULL, listener,
@@ -314,6 +387,8 @@ TopologyMgr::TopologyMgr(Topology::actorIdentity *myIdentityArg) :
                 {
                     replypk.pack_int(CMDOK);
                     replypk.pack_int64((int64_t)newmbox);
+                    // TransactionAgents already running start listening
+                    broadcastConfig();
                 }
             }
             break;
@@ -876,8 +951,8 @@ void TopologyMgr::updateGlobalConfig(msgpack::unpacker &pac,
         if (ibgws[node].size() < (size_t)(instance+1))
         {
             ibgws[node].resize(instance+1, string());
-            ibgws[node][instance] = hostport;
         }
+        ibgws[node][instance] = hostport;
     }
 
     nodeTopology.ibGateways.swap(ibgws);
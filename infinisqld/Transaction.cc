@@ -41,6 +41,7 @@ Transaction::Transaction(class TransactionAgent *taPtrarg, int64_t domainidarg)
     lockcount = 0;
     lockpendingcount = 0;
     nextpendingcmdid = 0;
+    cursor = cursor_s();
 }
 
 Transaction::~Transaction()
@@ -209,6 +210,39 @@ int64_t Transaction::getEngineid(class Table *tablePtr, int64_t fieldid,
     return hash % nodeTopology.numpartitions;
 }
 
+void Transaction::partitionValues(class Table *tablePtr, int64_t fieldid,
+                                  vector<fieldValue_s> &values,
+                                  boost::unordered_map< int64_t,
+                                  vector<fieldValue_s> > &enginevalues)
+{
+    fieldtype_e fieldtype = tablePtr->fields[fieldid].type;
+
+    for (size_t n=0; n < values.size(); n++)
+    {
+        fieldValue_s &valRef = values[n];
+
+        if (valRef.isnull==true)
+        {
+            continue;
+        }
+
+        if (fieldtype==CHARX || fieldtype==VARCHAR)
+        {
+            // same as the OPERATOR_EQ path hashes it
+            trimspace(valRef.str);
+        }
+
+        int64_t engineid = getEngineid(tablePtr, fieldid, &valRef);
+
+        if (engineid < 0)
+        {
+            continue;
+        }
+
+        enginevalues[engineid].push_back(valRef);
+    }
+}
+
 // TODO forget this for now 10/22/2012
 void Transaction::dispatch(class Message *msgrcv)
 {
@@ -392,14 +426,16 @@ void Transaction::continueSelectRows(int64_t entrypoint)
         // add rowid-engineids to vector, decrement currentCmdState.engines
         // if it's zero, then send messages to engines to see if they're
         // real rowids
-        size_t numhits = subtransactionCmdRef.indexHits.size();
+        vector<nonLockingIndexEntry_s> &indexHits =
+            subtransactionCmdRef.getIndexHits();
+        size_t numhits = indexHits.size();
         currentCmdState.rowidsEngineids.
             reserve(currentCmdState.rowidsEngineids.size() + numhits);
 
         for (size_t n = 0; n < numhits; n++)
         {
             currentCmdState.rowidsEngineids.
-                push_back(subtransactionCmdRef.indexHits[n]);
+                push_back(indexHits[n]);
         }
 
         currentCmdState.engines--;
@@ -486,9 +522,11 @@ void Transaction::continueSelectRows(int64_t entrypoint)
         };
         stagedRow_s sRow = {};
 
-        for (size_t n=0; n < subtransactionCmdRef.returnRows.size(); n++)
+        vector<returnRow_s> &returnRows = subtransactionCmdRef.getReturnRows();
+
+        for (size_t n=0; n < returnRows.size(); n++)
         {
-            rRow = subtransactionCmdRef.returnRows[n];
+            rRow = returnRows[n];
             uur.rowid = rRow.rowid;
 
             if (currentCmdState.pendingStagedRows.count(uur))
@@ -616,19 +654,152 @@ void Transaction::continueSelectRows(int64_t entrypoint)
     }
 }
 
+void Transaction::fetchRows(size_t maxrows)
+{
+    if (pendingcmd != NOCOMMAND)
+    {
+        reenter(APISTATUS_PENDING);
+        return;
+    }
+
+    reentryObject->results.selectResults.clear();
+
+    if (cursor.isopen==false || iscursorpending()==false)
+    {
+        // exhausted
+        reenter(APISTATUS_OK);
+        return;
+    }
+
+    pendingcmdid = getnextpendingcmdid();
+    pendingcmd = FETCH;
+    cursor.status = APISTATUS_OK;
+
+    size_t lasthit = cursor.nexthit + maxrows;
+
+    if (lasthit > cursor.hits.size())
+    {
+        lasthit = cursor.hits.size();
+    }
+
+    /* map of engineids to vectors of rowids */
+    boost::unordered_map< int64_t, vector<int64_t> > payloads;
+
+    for (size_t n=cursor.nexthit; n < lasthit; n++)
+    {
+        payloads[cursor.hits[n].engineid].push_back(cursor.hits[n].rowid);
+    }
+
+    cursor.nexthit = lasthit;
+
+    if (cursor.nexthit==cursor.hits.size())
+    {
+        vector<indexEntry_s>().swap(cursor.hits);
+        cursor.nexthit = 0;
+    }
+
+    cursor.eventwaitcount = payloads.size();
+    boost::unordered_map< int64_t, vector<int64_t> >::iterator it;
+
+    for (it = payloads.begin(); it != payloads.end(); it++)
+    {
+        class MessageSubtransactionCmd *msg =
+            new class MessageSubtransactionCmd();
+        msg->subtransactionStruct.tableid = cursor.tableid;
+        msg->subtransactionStruct.locktype = cursor.locktype;
+        msg->rowids.swap(it->second);
+        sendTransaction(SELECTROWS, PAYLOADSUBTRANSACTION, 1, it->first,
+                        (void *)msg);
+    }
+}
+
+bool Transaction::iscursorpending()
+{
+    return cursor.nexthit < cursor.hits.size();
+}
+
 void Transaction::continueFetchRows(int64_t entrypoint)
 {
+    class MessageSubtransactionCmd &subtransactionCmdRef =
+        *(static_cast<MessageSubtransactionCmd *>(msgrcv));
+
     switch (entrypoint)
     {
     case 1:
     {
+        boost::unordered_map< uuRecord_s, vector<fieldValue_s> > &selectResultsRef =
+            reentryObject->results.selectResults;
+        class Table &tableRef = *schemaPtr->tables[cursor.tableid];
+        uuRecord_s uur = {-1, cursor.tableid,
+                          subtransactionCmdRef.transactionStruct.engineinstance
+        };
+        vector<fieldValue_s> foundFields;
 
-    }
-    break;
+        vector<returnRow_s> &returnRows = subtransactionCmdRef.getReturnRows();
 
-    case 2:
-    {
+        for (size_t n=0; n < returnRows.size(); n++)
+        {
+            returnRow_s &returnrowRef = returnRows[n];
+            uur.rowid = returnrowRef.rowid;
 
+            switch (returnrowRef.locktype)
+            {
+            case NOLOCK:
+                break;
+
+            case READLOCK:
+                break;
+
+            case WRITELOCK:
+                break;
+
+            case PENDINGLOCK:
+                cursor.status = APISTATUS_LOCK;
+                continue;
+//                break;
+
+            case NOTFOUNDLOCK:
+                continue;
+//                break;
+
+            default:
+                // abort if lock pending, as continueSqlPredicate does
+                cursor.status = APISTATUS_NOTOK;
+                continue;
+            }
+
+            if (cursor.locktype != NOLOCK && !stagedRows.count(uur))
+            {
+                // rows read without a lock aren't staged, which keeps a
+                // large cursor's memory to its current chunk
+                stagedRow_s srow = {};
+                srow.cmd=NOCOMMAND;
+                srow.locktype=returnrowRef.locktype;
+                srow.originalRow=returnrowRef.row;
+                srow.originalrowid=returnrowRef.rowid;
+                stagedRows[uur]=srow;
+            }
+
+            foundFields.clear();
+            tableRef.unmakerow(&returnrowRef.row, &foundFields);
+            vector<fieldValue_s> &returnFields = selectResultsRef[uur];
+            returnFields.reserve(cursor.fieldids.size());
+
+            for (size_t m=0; m < cursor.fieldids.size(); m++)
+            {
+                returnFields.push_back(foundFields[cursor.fieldids[m]]);
+            }
+        }
+
+        if (--cursor.eventwaitcount==0 && lockpendingcount==0)
+        {
+            if (cursor.status != APISTATUS_OK)
+            {
+                selectResultsRef.clear();
+            }
+
+            reenter(cursor.status);
+        }
     }
     break;
 
@@ -793,6 +964,10 @@ void Transaction::processTransactionMessage(class Message *msgrcvarg)
         continueSqlPredicate(msgrcvRef.transactionStruct.transaction_tacmdentrypoint);
         break;
 
+    case PRIMITIVE_SQLSELECTALLCURSOR:
+        continueSqlPredicate(msgrcvRef.transactionStruct.transaction_tacmdentrypoint);
+        break;
+
     case PRIMITIVE_SQLDELETE:
         continueSqlDelete(msgrcvRef.transactionStruct.transaction_tacmdentrypoint);
         break;
@@ -809,6 +984,10 @@ void Transaction::processTransactionMessage(class Message *msgrcvarg)
         continueSqlReplace(msgrcvRef.transactionStruct.transaction_tacmdentrypoint);
         break;
 
+    case INSERTROWS:
+        continueInsertRows(msgrcvRef.transactionStruct.transaction_tacmdentrypoint);
+        break;
+
     default:
         fprintf(logfile, "anomaly: %i %s %i\n", pendingcmd, __FILE__, __LINE__);
     }
@@ -838,8 +1017,7 @@ void Transaction::select(int64_t tableid, int64_t fieldid, locktype_e locktype,
     currentCmdState.rowidsEngineids.clear();
     currentCmdState.ispossibledeadlock = false;
 
-    if (searchParamsRef.op == OPERATOR_EQ) // IN should probably be optimized this way
-        // too, eventually
+    if (searchParamsRef.op == OPERATOR_EQ)
     {
         int64_t destengineid=-1;
         currentCmdState.engines = 1;
@@ -890,6 +1068,34 @@ void Transaction::select(int64_t tableid, int64_t fieldid, locktype_e locktype,
         sendTransaction(INDEXSEARCH, PAYLOADSUBTRANSACTION, 1,
                         destengineid, (void *)msg);
     }
+    else if (searchParamsRef.op == OPERATOR_IN)
+    {
+        // each engine gets only the values that hash to it
+        boost::unordered_map< int64_t, vector<fieldValue_s> > enginevalues;
+        partitionValues(schemaPtr->tables[tableid], fieldid,
+                        searchParamsRef.values, enginevalues);
+
+        if (enginevalues.empty()==true)
+        {
+            // nothing can match, but 1 engine still answers with no hits
+            enginevalues[0];
+        }
+
+        currentCmdState.engines = enginevalues.size();
+        boost::unordered_map< int64_t, vector<fieldValue_s> >::iterator it;
+
+        for (it = enginevalues.begin(); it != enginevalues.end(); it++)
+        {
+            class MessageSubtransactionCmd *msg =
+                new class MessageSubtransactionCmd();
+            msg->subtransactionStruct.tableid = currentCmdState.tableid;
+            msg->subtransactionStruct.fieldid = currentCmdState.fieldid;
+            msg->searchParameters.op = searchParamsRef.op;
+            msg->searchParameters.values.swap(it->second);
+            sendTransaction(INDEXSEARCH, PAYLOADSUBTRANSACTION, 1,
+                            it->first, (void *)msg);
+        }
+    }
     else
     {
         // walk through all engines, send message to each, bumping engines
@@ -2725,6 +2931,30 @@ void Transaction::sqlPredicate(class Statement *statement,
     }
     }
 
+    sqlcmdstate.statement->pushdown((class Ast *)continuationData,
+                                    sqlcmdstate.residuals,
+                                    sqlcmdstate.projection);
+
+    if (!sqlcmdstate.residuals.empty())
+    {
+        // results so far are staged rows, Engines check the rest
+        class Table &tableRef = *schemaPtr->tables[tableid];
+        boost::unordered_map<uuRecord_s, returnRow_s>::iterator it;
+
+        for (it = results.begin(); it != results.end(); )
+        {
+            if (tableRef.qualifies(&it->second.row,
+                                   sqlcmdstate.residuals)==false)
+            {
+                it = results.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
     if (op==OPERATOR_EQ)
     {
         // send to only single engine based on hashval
@@ -2783,6 +3013,8 @@ void Transaction::sqlPredicate(class Statement *statement,
             msg->subtransactionStruct.fieldid = fieldid;
             msg->subtransactionStruct.locktype = locktype;
             searchParams.op = op;
+            searchParams.residuals = sqlcmdstate.residuals;
+            searchParams.projection = sqlcmdstate.projection;
             msg->searchParameters = searchParams;
             sendTransaction(SEARCHRETURN1, PAYLOADSUBTRANSACTION, 2,
                             destengineid, msg);
@@ -2799,6 +3031,34 @@ void Transaction::sqlPredicate(class Statement *statement,
                             destengineid, msg);
         }
     }
+    else if (op==OPERATOR_IN)
+    {
+        // each engine gets only the values that hash to it
+        boost::unordered_map< int64_t, vector<fieldValue_s> > enginevalues;
+        partitionValues(schemaPtr->tables[tableid], fieldid,
+                        searchParams.values, enginevalues);
+
+        if (enginevalues.empty()==true)
+        {
+            // nothing can match, but 1 engine still answers with no hits
+            enginevalues[0];
+        }
+
+        sqlcmdstate.eventwaitcount = enginevalues.size();
+        boost::unordered_map< int64_t, vector<fieldValue_s> >::iterator it;
+
+        for (it = enginevalues.begin(); it != enginevalues.end(); it++)
+        {
+            class MessageSubtransactionCmd *msg =
+                new class MessageSubtransactionCmd();
+            msg->subtransactionStruct.tableid = tableid;
+            msg->subtransactionStruct.fieldid = fieldid;
+            msg->searchParameters.op = op;
+            msg->searchParameters.values.swap(it->second);
+            sendTransaction(INDEXSEARCH, PAYLOADSUBTRANSACTION, 1,
+                            it->first, msg);
+        }
+    }
     else
     {
         class MessageSubtransactionCmd msg;
@@ -2841,12 +3101,43 @@ void Transaction::continueSqlPredicate(int64_t entrypoint)
     {
     case 1:
     {
+        vector<nonLockingIndexEntry_s> &indexHits =
+            subtransactionCmdRef.getIndexHits();
         sqlcmdstate.indexHits.insert(sqlcmdstate.indexHits.end(),
-                                     subtransactionCmdRef.indexHits.begin(),
-                                     subtransactionCmdRef.indexHits.end());
+                                     indexHits.begin(), indexHits.end());
 
         if (--sqlcmdstate.eventwaitcount == 0)
         {
+            if (pendingcmd==PRIMITIVE_SQLSELECTALLCURSOR)
+            {
+                // rows are retrieved later, by fetchRows()
+                cursor.hits.clear();
+                cursor.hits.reserve(sqlcmdstate.indexHits.size());
+                uuRecord_s uur = {-1, cursor.tableid, -1};
+
+                for (size_t n=0; n < sqlcmdstate.indexHits.size(); n++)
+                {
+                    indexEntry_s &hit = sqlcmdstate.indexHits[n];
+                    uur.rowid = hit.rowid;
+                    uur.engineid = hit.engineid;
+
+                    if (stagedRows.count(uur))
+                    {
+                        // Statement returns staged rows itself
+                        continue;
+                    }
+
+                    cursor.hits.push_back(hit);
+                }
+
+                sqlcmdstate.indexHits.clear();
+                cursor.nexthit = 0;
+                pendingcmd = NOCOMMAND;
+                pendingcmdid = 0;
+                sqlcmdstate.statement->continueSelect(1, NULL);
+                return;
+            }
+
             if (sqlcmdstate.indexHits.empty()==true)
             {
                 // no rows returned
@@ -2876,6 +3167,8 @@ void Transaction::continueSqlPredicate(int64_t entrypoint)
                 msg->subtransactionStruct.locktype = sqlcmdstate.locktype;
                 indexEntry_s &hit = sqlcmdstate.indexHits[0];
                 msg->rowids.push_back(hit.rowid);
+                msg->searchParameters.residuals = sqlcmdstate.residuals;
+                msg->searchParameters.projection = sqlcmdstate.projection;
                 sendTransaction(SELECTROWS, PAYLOADSUBTRANSACTION, 2,
                                 hit.engineid, msg);
             }
@@ -2900,6 +3193,8 @@ void Transaction::continueSqlPredicate(int64_t entrypoint)
                     msg->subtransactionStruct.tableid = sqlcmdstate.tableid;
                     msg->subtransactionStruct.locktype = sqlcmdstate.locktype;
                     msg->rowids = it->second;
+                    msg->searchParameters.residuals = sqlcmdstate.residuals;
+                    msg->searchParameters.projection = sqlcmdstate.projection;
                     sendTransaction(SELECTROWS, PAYLOADSUBTRANSACTION, 2,
                                     it->first, (void *)msg);
                 }
@@ -2918,9 +3213,11 @@ void Transaction::continueSqlPredicate(int64_t entrypoint)
         };
         bool islockchange = false;
 
-        for (size_t n=0; n < subtransactionCmdRef.returnRows.size(); n++)
+        vector<returnRow_s> &returnRows = subtransactionCmdRef.getReturnRows();
+
+        for (size_t n=0; n < returnRows.size(); n++)
         {
-            returnRow_s &returnrowRef = subtransactionCmdRef.returnRows[n];
+            returnRow_s &returnrowRef = returnRows[n];
             uur.rowid = returnrowRef.rowid;
 
             switch (returnrowRef.locktype)
@@ -3392,6 +3689,164 @@ void Transaction::continueSqlReplace(int64_t entrypoint)
     }
 }
 
+void Transaction::insertRows(int64_t tableidarg,
+                             boost::unordered_map<int64_t, insertBatch_s> &batches)
+{
+    if (pendingcmd != NOCOMMAND)
+    {
+        reenter(APISTATUS_PENDING);
+        return;
+    }
+
+    pendingcmdid = getnextpendingcmdid();
+    pendingcmd = INSERTROWS;
+    sqlcmdstate = (sqlcmdstate_s)
+        {
+            0
+        };
+    sqlcmdstate.tableid = tableidarg;
+    insertRowsStatus = APISTATUS_OK;
+    insertBatches.clear();
+    insertBatches.swap(batches);
+
+    boost::unordered_map<int64_t, insertBatch_s>::const_iterator it;
+
+    for (it = insertBatches.begin(); it != insertBatches.end(); ++it)
+    {
+        const vector<string> &rowsRef = it->second.rows;
+
+        if (rowsRef.empty())
+        {
+            continue;
+        }
+
+        class MessageSubtransactionCmd *msg =
+            new class MessageSubtransactionCmd();
+        msg->subtransactionStruct.tableid = tableidarg;
+        msg->returnRows.resize(rowsRef.size());
+
+        for (size_t n=0; n < rowsRef.size(); n++)
+        {
+            msg->returnRows[n].row = rowsRef[n];
+        }
+
+        sqlcmdstate.eventwaitcount++;
+        sendTransaction(NEWROWS, PAYLOADSUBTRANSACTION, 1, it->first, msg);
+    }
+
+    if (!sqlcmdstate.eventwaitcount)
+    {
+        reenter(APISTATUS_OK);
+    }
+}
+
+void Transaction::continueInsertRows(int64_t entrypoint)
+{
+    class MessageSubtransactionCmd &msgrcvRef =
+        *(static_cast<MessageSubtransactionCmd *>(msgrcv));
+
+    switch (entrypoint)
+    {
+    case 1:
+    {
+        int64_t engineid = msgrcvRef.transactionStruct.engineinstance;
+        insertBatch_s &batchRef = insertBatches[engineid];
+
+        if (msgrcvRef.rowids.size() != batchRef.rows.size())
+        {
+            fprintf(logfile, "anomaly: %lu %lu %s %i\n",
+                    (unsigned long)msgrcvRef.rowids.size(),
+                    (unsigned long)batchRef.rows.size(), __FILE__, __LINE__);
+            insertRowsStatus = APISTATUS_NOTOK;
+            break;
+        }
+
+        class Table &tableRef = *schemaPtr->tables[sqlcmdstate.tableid];
+
+        for (size_t n=0; n < batchRef.rows.size(); n++)
+        {
+            uuRecord_s uur = { msgrcvRef.rowids[n], sqlcmdstate.tableid,
+                               engineid };
+            stagedRow_s newStagedRow = {};
+            newStagedRow.newRow = batchRef.rows[n];
+            newStagedRow.newrowid = msgrcvRef.rowids[n];
+            newStagedRow.newengineid = engineid;
+            newStagedRow.locktype = WRITELOCK;
+            newStagedRow.cmd=INSERT;
+
+            vector<fieldValue_s> &fieldValuesRef = batchRef.fieldValues[n];
+
+            for (size_t f=0; f < tableRef.fields.size(); f++)
+            {
+                // nonunique indices are handled in commit
+                if (tableRef.fields[f].index.isunique != true ||
+                    fieldValuesRef[f].isnull==true)
+                {
+                    continue;
+                }
+
+                lockFieldValue_s lockFieldValue = {};
+                lockFieldValue.engineid = getengine(tableRef.fields[f].type,
+                                                    fieldValuesRef[f]);
+                lockFieldValue.locktype = INDEXLOCK;
+                lockFieldValue.fieldVal = fieldValuesRef[f];
+                newStagedRow.uniqueIndices[f]=lockFieldValue;
+
+                sqlcmdstate.eventwaitcount++;
+                class MessageSubtransactionCmd *msg =
+                    new class MessageSubtransactionCmd();
+                msg->subtransactionStruct.tableid = sqlcmdstate.tableid;
+                msg->subtransactionStruct.rowid = uur.rowid;
+                msg->subtransactionStruct.engineid = engineid;
+                msg->subtransactionStruct.fieldid = f;
+                msg->fieldVal = fieldValuesRef[f];
+
+                sendTransaction(UNIQUEINDEX, PAYLOADSUBTRANSACTION, 2,
+                                lockFieldValue.engineid, msg);
+            }
+
+            stagedRows[uur] = newStagedRow;
+        }
+    }
+    break;
+
+    case 2:
+        switch (msgrcvRef.subtransactionStruct.locktype)
+        {
+        case INDEXLOCK:
+            break;
+
+        case NOLOCK: // constraint violation
+            if (insertRowsStatus==APISTATUS_OK)
+            {
+                insertRowsStatus = APISTATUS_UNIQUECONSTRAINT;
+            }
+
+            break;
+
+        default:
+            fprintf(logfile, "anomaly: %i %s %i\n",
+                    msgrcvRef.subtransactionStruct.locktype, __FILE__, __LINE__);
+            insertRowsStatus = APISTATUS_NOTOK;
+        }
+
+        break;
+
+    default:
+        printf("%s %i anomaly %li\n", __FILE__, __LINE__, entrypoint);
+        insertRowsStatus = APISTATUS_NOTOK;
+    }
+
+    // every new row has to be staged before reentry so rollback finds them
+    if (--sqlcmdstate.eventwaitcount)
+    {
+        return;
+    }
+
+    insertBatches.clear();
+    reenter(insertRowsStatus);
+}
+
 void Transaction::checkSqlLock(deadlockchange_e changetype, bool isrow,
                                int64_t rowid, int64_t tableid, int64_t engineid,
                                int64_t fieldid, fieldValue_s *fieldVal)
@@ -77,6 +77,40 @@ public:
         std::vector<indexEntry_s> indexHits;
         void *continuationData;
         bool ispossibledeadlock;
+        // for SELECTROWS, from Statement::pushdown()
+        std::vector<residualPredicate_s> residuals;
+        std::vector<int64_t> projection;
+    };
+
+    /** 
+     * @brief SELECT of a whole table whose rows are fetched in chunks
+     *
+     * index hits are kept, rows are retrieved from Engines by fetchRows()
+     *
+     */
+    struct cursor_s
+    {
+        bool isopen;
+        int64_t owner; /**< Statement::cursorowner that opened it */
+        int64_t tableid;
+        locktype_e locktype;
+        std::vector<int64_t> fieldids; /**< fields of each returned row */
+        std::vector<indexEntry_s> hits; /**< rows not yet fetched */
+        size_t nexthit; /**< hits[nexthit] is fetched next */
+        int64_t eventwaitcount;
+        int64_t status; /**< status to reenter with */
+
+        /** 
+         * @brief whether open, and opened by execution ownerarg
+         *
+         * @param ownerarg Statement::cursorowner of the execution
+         *
+         * @return true if that execution may fetch or close it
+         */
+        bool isownedby(int64_t ownerarg) const
+        {
+            return isopen==true && owner==ownerarg;
+        }
     };
 
     /** 
@@ -167,8 +201,23 @@ public:
      *
      * @return engine/partitionid
      */
-    int64_t getEngineid(class Table *tablePtr, int64_t fieldid,
-                        fieldValue_s *val);
+    static int64_t getEngineid(class Table *tablePtr, int64_t fieldid,
+                               fieldValue_s *val);
+    /** 
+     * @brief group IN list values by the engine/partition whose index
+     * holds them, so each Engine is asked only for its own values
+     *
+     * NULL values are dropped, as IN never matches them.
+     *
+     * @param tablePtr Table
+     * @param fieldid fieldid
+     * @param values IN list values
+     * @param enginevalues engine/partitionid to values for it
+     */
+    static void partitionValues(class Table *tablePtr, int64_t fieldid,
+                                vector<fieldValue_s> &values,
+                                boost::unordered_map< int64_t,
+                                vector<fieldValue_s> > &enginevalues);
     /** 
      * @brief get engine/partitionid based on hash of input
      *
@@ -406,9 +455,9 @@ public:
      */
     void continueSelectRows(int64_t entrypoint);
     /** 
-     * @brief deprecated
+     * @brief continuation of fetchRows()
      *
-     * @param entrypoint 
+     * @param entrypoint entry point from which to continue
      */
     void continueFetchRows(int64_t entrypoint);
     /** 
@@ -559,6 +608,38 @@ public:
      * @param entrypoint entry point from which to continue
      */
     void continueSqlReplace(int64_t entrypoint);
+    /** 
+     * @brief insert many rows, each engine gets its rows in 1 message
+     *
+     * reenters when every row and unique index entry is staged, or
+     * with the first failure once all replies are in
+     *
+     * @param tableidarg tableid
+     * @param batches rows per destination engineid, emptied
+     */
+    void insertRows(int64_t tableidarg,
+                    boost::unordered_map<int64_t, insertBatch_s> &batches);
+    /** 
+     * @brief continuation of batched insert
+     *
+     * @param entrypoint entry point from which to continue
+     */
+    void continueInsertRows(int64_t entrypoint);
+    /** 
+     * @brief fetch next rows of the open cursor
+     *
+     * reenters with the rows, cursor fields only, in reentryObject's
+     * results.selectResults, which is empty once the cursor is exhausted
+     *
+     * @param maxrows most rows to fetch
+     */
+    void fetchRows(size_t maxrows);
+    /** 
+     * @brief whether the open cursor has hits left to fetch
+     *
+     * @return true if fetchRows() may return more rows
+     */
+    bool iscursorpending();
     /** 
      * @brief orphan
      *
@@ -634,6 +715,11 @@ public:
     boost::unordered_map< int64_t, fieldValue_s > fieldsToUpdate;
 
     sqlcmdstate_s sqlcmdstate;
+    // for insertRows(), batches awaiting rowids and status to reenter with
+    boost::unordered_map<int64_t, insertBatch_s> insertBatches;
+    int64_t insertRowsStatus;
+    // for PRIMITIVE_SQLSELECTALLCURSOR and fetchRows()
+    cursor_s cursor;
 
     int waitfordispatched;
 };
@@ -28,26 +28,35 @@
 
 #include "TransactionAgent.h"
 #include "Pg.h"
+#include "Listener.h"
 #line 32 "TransactionAgent.cc"
 
 TransactionAgent::TransactionAgent(Topology::actorIdentity *myIdentityArg) :
-    nexttransactionid(0), nextapplierid(0), myreplica(-1), mymember(-1)
+    listenersockfd(-1), pglistenersockfd(-1), loadsampled(0), loadcpu(0),
+    loaddepth(0), nexttransactionid(0),
+    nextapplierid(0), myreplica(-1), mymember(-1),
+    statementCache(STATEMENTCACHESIZE)
 {
     init(myIdentityArg);
 //    delete myIdentityArg;
-    epollfd = myIdentity.epollfd;
     instance = myIdentity.instance;
+    // client sockets are read in this thread, so sleep in epoll_wait and
+    // have producers wake us through the mbox eventfd
+    epollfd = epoll_create(1);
+    myIdentity.mbox->wakefd = eventfd(0, EFD_NONBLOCK);
+    struct epoll_event wakeev;
+    wakeev.events = EPOLLIN;
+    wakeev.data.fd = myIdentity.mbox->wakefd;
+
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, myIdentity.mbox->wakefd, &wakeev)
+        == -1)
+    {
+        fprintf(logfile, "%s %i epoll_ctl errno %i\n", __FILE__, __LINE__, errno);
+    }
+    startListening();
 //    mboxes.nodeid = myIdentity.address.nodeid;
 
     builtincmds_e cmd = NOCMD;
-    spclasscreate spC;
-    spclassdestroy spD;
-    uint32_t events = 0;
-
-    typedef boost::unordered_map<std::string,
-                                 void (TransactionAgent::*)(builtincmds_e)>
-        builtinsMap;
-    builtinsMap builtins;
     builtins["ping"] = &TransactionAgent::ping;
     builtins["login"] = &TransactionAgent::login;
     builtins["logout"] = &TransactionAgent::logout;
@@ -64,9 +73,11 @@ TransactionAgent::TransactionAgent(Topology::actorIdentity *myIdentityArg) :
     builtins["deleteschema"] = &TransactionAgent::deleteschema;
     builtins["loadprocedure"] = &TransactionAgent::loadprocedure;
     builtins["compile"] = &TransactionAgent::compile;
+    builtins["multiplex"] = &TransactionAgent::multiplex;
 
     operationid=0;
     int waitfor = 100;
+    struct epoll_event events[TAEPOLLEVENTS];
 
     while (1)
     {
@@ -75,21 +86,73 @@ TransactionAgent::TransactionAgent(Topology::actorIdentity *myIdentityArg) :
         userid=-1;
         argsize=-1;
         sockfd=-1;
+        requestid=0;
 
         mboxes.sendObBatch();
+        publishLoad();
+
+        if (!pgsToResume.empty())
+        {
+            vector<int> resumefds;
+            resumefds.swap(pgsToResume);
+
+            for (size_t n=0; n < resumefds.size(); n++)
+            {
+                boost::unordered_map<int, class Pg *>::iterator it =
+                    Pgs.find(resumefds[n]);
+
+                if (it != Pgs.end())
+                {
+                    it->second->resume();
+                }
+            }
+        }
+
+        int eventcount = myIdentity.mbox->pollwait(epollfd, events,
+                                                   TAEPOLLEVENTS, waitfor);
+
+        for (int n=0; n < eventcount; n++)
+        {
+            // clear data from previous socket
+            domainid=-1;
+            userid=-1;
+            argsize=-1;
+
+            if (events[n].data.fd==listenersockfd)
+            {
+                acceptSockets(listenersockfd, LISTENER_RAW);
+            }
+            else if (events[n].data.fd==pglistenersockfd)
+            {
+                acceptSockets(pglistenersockfd, LISTENER_PG);
+            }
+            else
+            {
+                socketEvent(events[n].data.fd, events[n].events);
+            }
+        }
+
+        waitfor = eventcount ? 0 : 100;
+        sockfd=-1;
+        requestid=0;
+
         for (size_t inmsg=0; inmsg < MSGRECEIVEBATCHSIZE; inmsg++)
         {
 //            GETMSG(msgrcv, myIdentity.mbox, waitfor)
-            getmsg(waitfor);
+            getmsg(0);
 
                 if (msgrcv==NULL)
                 {
-                    waitfor = 100;
                     break;
                 }
 
             waitfor = 0;
 
+            if (msgbatchsize > loaddepth)
+            {
+                loaddepth = msgbatchsize;
+            }
+
             if (msgrcv->messageStruct.payloadtype==PAYLOADUSERSCHEMA)
             {
                 class MessageUserSchema &msgref =
@@ -107,6 +170,7 @@ TransactionAgent::TransactionAgent(Topology::actorIdentity *myIdentityArg) :
                     else
                     {
                         sockfd = pendingOperations[msgref.userschemaStruct.operationid]->sockfd;
+                        requestid = pendingOperations[msgref.userschemaStruct.operationid]->requestid;
                         userid = pendingOperations[msgref.userschemaStruct.operationid]->userid;
                         domainid = pendingOperations[msgref.userschemaStruct.operationid]->domainid;
                     }
@@ -117,186 +181,13 @@ TransactionAgent::TransactionAgent(Topology::actorIdentity *myIdentityArg) :
 
             switch (msgrcv->messageStruct.topic)
             {
-            case TOPIC_SOCKET:
-            {
-                switch (((class MessageSocket *)msgrcv)->socketStruct.listenertype)
-                {
-                case LISTENER_RAW:
-                {
-                    sockfd=((class MessageSocket *)msgrcv)->socketStruct.socket;
-                    events=((class MessageSocket *)msgrcv)->socketStruct.events;
-
-                    if ((events & EPOLLERR) || (events & EPOLLHUP))
-                    {
-                        endConnection();
-                        break;
-                    }
-
-                    if (events & EPOLLIN)
-                    {
-                        operation = (string *)new string;
-                        argsize = readSocket();
-
-                        if (argsize < 0)
-                        {
-                            delete operation;
-                            endConnection();
-                            break;
-                        }
-
-                        // ok, if no user logged in, then can only login, else
-                        // break connection exit
-                        // if user logged in, then cannot login but everything
-                        // else
-                        // login shouldn't be in binFunctions map therefore
-                        socketAuthInfo::iterator loggedInUsersIterator;
-                        loggedInUsersIterator = loggedInUsers.find(sockfd);
-
-                        if (loggedInUsersIterator == loggedInUsers.end())
-                        {
-                            // this means not logged in
-                            if (operation->compare("login")==0)
-                            {
-                                // so, login
-                                login(STARTCMD);
-                            }
-                            else if (operation->compare("ping")==0 &&
-                                     __sync_add_and_fetch(&cfgs.anonymousping,
-                                                          0))
-                            {
-                                ping(STARTCMD);
-                            }
-                            else     // gtfo
-                            {
-                                endConnection();
-                                break;
-                            }
-                        }
-                        else
-                        {
-                            // get my domainid & userid
-                            domainid = loggedInUsersIterator->second.domainid;
-                            userid = loggedInUsersIterator->second.userid;
-                            domainName =
-                                loggedInUsersIterator->second.domainName;
-
-                            // first, check domain operations, when those are
-                            // built
-                            if (domainidsToProcedures.count(domainid))
-                            {
-                                if (domainidsToProcedures[domainid].count(*operation))
-                                {
-                                    spC=(spclasscreate)domainidsToProcedures[domainid][*operation].procedurecreator;
-                                    spD=(spclassdestroy)domainidsToProcedures[domainid][*operation].proceduredestroyer;
-                                    spC(this, NULL, (void *)spD);
-                                    continue;
-//                                    break;
-                                }
-                            }
-
-                            builtinsMap::iterator builtinsIterator;
-                            builtinsIterator = builtins.find(*operation);
-
-                            if (builtinsIterator != builtins.end())
-                            {
-                                (this->*(builtinsIterator->second))(STARTCMD);
-                            }
-                            else
-                            {
-                                // terminate with extreme prejudice
-                                endConnection();
-                            }
-                        }
-
-                        delete operation;
-                    }
-
-                    if (events & EPOLLOUT)
-                    {
-                        struct epoll_event ev;
-                        ev.events = EPOLLIN | EPOLLHUP | EPOLLET;
-                        ev.data.fd = sockfd;
-
-                        if (epoll_ctl(epollfd, EPOLL_CTL_MOD, sockfd, &ev))
-                        {
-                            endConnection();
-                            break;
-                        }
-
-                        // write data that's waiting
-                        sendLaterMap::iterator waitingToSendIterator;
-                        waitingToSendIterator = waitingToSend.find(sockfd);
-
-                        if (waitingToSendIterator != waitingToSend.end())
-                        {
-                            responseData response =
-                                waitingToSendIterator->second;
-                            sendResponse(true, response.resultCode,
-                                         response.sbuf);
-                        }
-                    }
-                }
-                break;
-
-                case LISTENER_PG:
-                {
-                    class MessageSocket &msgrcvref =
-                        *(class MessageSocket *)msgrcv;
-
-                    if (!Pgs.count(msgrcvref.socketStruct.socket))
-                    {
-                        if ((msgrcvref.socketStruct.events & EPOLLERR) ||
-                            (msgrcvref.socketStruct.events & EPOLLHUP))
-                        {
-                            fprintf(logfile, "\t%s %i hanging it up\n",
-                                    __FILE__, __LINE__);
-                            Pg::pgclosesocket(*this,
-                                              msgrcvref.socketStruct.socket);
-                            break;
-                        }
-                        break;
-                    }
-
-                    Pgs[msgrcvref.socketStruct.socket]->cont();
-                }
-                break;
-
-                default:
-                    printf("%s %i anomaly listenertype %i\n", __FILE__, __LINE__,
-                           ((class MessageSocket *)msgrcv)->socketStruct.listenertype);
-                }
-            }
-            break;
-        
             case TOPIC_SOCKETCONNECTED:
             {
-                switch (((class MessageSocket *)msgrcv)->socketStruct.listenertype)
-                {
-                case LISTENER_RAW:
-                    break;
-              
-                case LISTENER_PG:
-                {
-                    class MessageSocket &msgrcvref =
-                        *(class MessageSocket *)msgrcv;
-                    if (!Pgs.count(msgrcvref.socketStruct.socket))
-                    {
-                        new class Pg(this, msgrcvref.socketStruct.socket);
-                    }
-                    else
-                    {
-                        fprintf(logfile, "%s %i sockfd %i already mapped\n",
-                                __FILE__, __LINE__,
-                                msgrcvref.socketStruct.socket);
-                    }
-                }
-                break;
-            
-                default:
-                    printf("%s %i anomaly listenertype %i\n", __FILE__, __LINE__,
-                           ((class MessageSocket *)msgrcv)->socketStruct.listenertype);
-                }
-          
+                class MessageSocket &msgrcvref =
+                    *(class MessageSocket *)msgrcv;
+                adoptSocket(msgrcvref.socketStruct.socket,
+                            msgrcvref.socketStruct.listenertype,
+                            msgrcvref.pgPtr);
             }
             break;
 
@@ -422,6 +313,8 @@ TransactionAgent::TransactionAgent(Topology::actorIdentity *myIdentityArg) :
                 class MessageUserSchema &msgref =
                     *(class MessageUserSchema *)msgrcv;
                 tainstance = msgref.userschemaStruct.instance;
+                // cached Statements are resolved against the old schema
+                statementCache.invalidate(msgref.userschemaStruct.domainid);
 
                 switch (msgref.userschemaStruct.builtincmd)
                 {
@@ -495,6 +388,7 @@ TransactionAgent::TransactionAgent(Topology::actorIdentity *myIdentityArg) :
             case TOPIC_TOPOLOGY:
                 mboxes.update(myTopology, instance);
                 updateReplicas();
+                startListening();
                 break;
 
             case TOPIC_ACKDISPATCH:
@@ -590,8 +484,365 @@ TransactionAgent::~TransactionAgent()
 void TransactionAgent::endConnection()
 {
     epoll_ctl(epollfd, EPOLL_CTL_DEL, sockfd, NULL);
+    if ((size_t)sockfd < socketTypes.size())
+    {
+        socketTypes[sockfd]=LISTENER_NONE;
+    }
     close(sockfd);
     loggedInUsers.erase(sockfd);
+    multiplexed.erase(sockfd);
+}
+
+void TransactionAgent::startListening()
+{
+    if (listenersockfd >= 0 || myTopology.listenerNodes.size() < 2 ||
+        myTopology.listenerServices.size() < 2)
+    {
+        return;
+    }
+
+    listenersockfd = Listener::startsocket(myTopology.listenerNodes[0],
+                                           myTopology.listenerServices[0]);
+    pglistenersockfd = Listener::startsocket(myTopology.listenerNodes[1],
+                                             myTopology.listenerServices[1]);
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLHUP | EPOLLET;
+    ev.data.fd = listenersockfd;
+
+    if (listenersockfd >= 0 &&
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, listenersockfd, &ev) == -1)
+    {
+        fprintf(logfile, "%s %i epoll_ctl errno %i\n", __FILE__, __LINE__, errno);
+    }
+
+    ev.data.fd = pglistenersockfd;
+
+    if (pglistenersockfd >= 0 &&
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, pglistenersockfd, &ev) == -1)
+    {
+        fprintf(logfile, "%s %i epoll_ctl errno %i\n", __FILE__, __LINE__, errno);
+    }
+}
+
+void TransactionAgent::acceptSockets(int listenfd, listenertype_e listenertype)
+{
+    struct sockaddr_in their_addr; // connector's address information
+
+    // edge triggered, so accept until there are no more
+    while (1)
+    {
+        socklen_t sin_size = sizeof(their_addr);
+        int newfd = accept(listenfd, (struct sockaddr *)&their_addr,
+                           &sin_size);
+
+        if (newfd == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                printf("%s %i accept errno %i\n", __FILE__, __LINE__, errno);
+            }
+            if (errno==EINTR || errno==ECONNABORTED)
+            {
+                continue;
+            }
+
+            return;
+        }
+        if (newfd > NUMSOCKETS)
+        {
+            fprintf(logfile, "%s %i fd %i > %i\n", __FILE__, __LINE__, newfd,
+                    NUMSOCKETS);
+            close(newfd);
+            continue;
+        }
+
+        fcntl(newfd, F_SETFL, O_NONBLOCK);
+        int optval = 1;
+        setsockopt(newfd, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
+
+        int64_t tainstance = lightestTa();
+
+        if (tainstance != instance)
+        {
+            // count it there until that one publishes its next sample, so
+            // a burst of accepts doesn't all land on it
+            class MboxProducer *producer =
+                mboxes.transactionAgentPtrs[tainstance];
+            __atomic_add_fetch(&producer->mbox->load, TALOADCONNECTION,
+                               __ATOMIC_RELAXED);
+            producer->sendMsg(*(new class MessageSocket(newfd, 0, listenertype,
+                                                        myIdentity.address.nodeid,
+                                                        TOPIC_SOCKETCONNECTED)));
+            continue;
+        }
+
+        adoptSocket(newfd, listenertype, NULL);
+    }
+}
+
+void TransactionAgent::adoptSocket(int fd, listenertype_e listenertype,
+                                   class Pg *pgPtr)
+{
+    if ((size_t)fd >= socketTypes.size())
+    {
+        socketTypes.resize(fd+1, LISTENER_NONE);
+    }
+    socketTypes[fd]=listenertype;
+
+    if (listenertype==LISTENER_PG)
+    {
+        if (pgPtr != NULL)
+        {
+            pgPtr->rebind(this);
+        }
+        else if (!Pgs.count(fd))
+        {
+            new class Pg(this, fd);
+        }
+        else
+        {
+            fprintf(logfile, "%s %i sockfd %i already mapped\n", __FILE__,
+                    __LINE__, fd);
+        }
+    }
+
+    // reports input that arrived before the add, so none is missed
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLHUP | EPOLLET;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+        fprintf(logfile, "%s %i epoll_ctl errno %i\n", __FILE__, __LINE__,
+                errno);
+
+        if (Pgs.count(fd))
+        {
+            Pgs[fd]->closesocket(*this);
+        }
+        else
+        {
+            socketTypes[fd]=LISTENER_NONE;
+            close(fd);
+        }
+    }
+}
+
+void TransactionAgent::publishLoad()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+    if (now - loadsampled < TALOADINTERVAL)
+    {
+        return;
+    }
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    int64_t cpu = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    int64_t load = loaddepth + TALOADTRANSACTION * Transactions.size() +
+        TALOADCONNECTION * (Pgs.size() + loggedInUsers.size());
+
+    if (loadsampled)
+    {
+        load += (cpu - loadcpu) * 1000 / (now - loadsampled);
+    }
+
+    __atomic_store_n(&myIdentity.mbox->load, load, __ATOMIC_RELAXED);
+    loadsampled = now;
+    loadcpu = cpu;
+    loaddepth = 0;
+
+    if (__atomic_load_n(&cfgs.tamigrate, __ATOMIC_RELAXED)==true)
+    {
+        int64_t tainstance = lightestTa();
+
+        if (tainstance != instance)
+        {
+            migrateConnection(tainstance);
+        }
+    }
+}
+
+int64_t TransactionAgent::lightestTa()
+{
+    int64_t margin = __atomic_load_n(&cfgs.taplacementmargin,
+                                     __ATOMIC_RELAXED);
+
+    if (margin < 0)
+    {
+        return instance;
+    }
+
+    int64_t lightest = instance;
+    int64_t lightestload =
+        __atomic_load_n(&myIdentity.mbox->load, __ATOMIC_RELAXED) - margin;
+
+    for (size_t n=0; n < mboxes.transactionAgentPtrs.size(); n++)
+    {
+        if (mboxes.transactionAgentPtrs[n]==NULL || (int64_t)n==instance)
+        {
+            continue;
+        }
+
+        int64_t load = __atomic_load_n(&mboxes.transactionAgentPtrs[n]->mbox->load,
+                                       __ATOMIC_RELAXED);
+
+        if (load < lightestload)
+        {
+            lightest = n;
+            lightestload = load;
+        }
+    }
+
+    return lightest;
+}
+
+void TransactionAgent::migrateConnection(int64_t tainstance)
+{
+    class Pg *busiest = NULL;
+    int64_t busiestactivity = 0;
+    boost::unordered_map<int, class Pg *>::iterator it;
+
+    for (it = Pgs.begin(); it != Pgs.end(); ++it)
+    {
+        class Pg &pgRef = *it->second;
+
+        if (pgRef.activity > busiestactivity && pgRef.ismigratable()==true)
+        {
+            busiest = &pgRef;
+            busiestactivity = pgRef.activity;
+        }
+
+        pgRef.activity = 0;
+    }
+
+    // idle connections cost nothing where they are
+    if (busiest==NULL)
+    {
+        return;
+    }
+
+    int fd = busiest->sockfd;
+    epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, NULL);
+    socketTypes[fd]=LISTENER_NONE;
+    Pgs.erase(fd);
+
+    class MboxProducer *producer = mboxes.transactionAgentPtrs[tainstance];
+    __atomic_add_fetch(&producer->mbox->load, TALOADCONNECTION,
+                       __ATOMIC_RELAXED);
+    class MessageSocket *msg =
+        new class MessageSocket(fd, 0, LISTENER_PG, myIdentity.address.nodeid,
+                                TOPIC_SOCKETCONNECTED);
+    msg->pgPtr = busiest;
+    producer->sendMsg(*msg);
+}
+
+void TransactionAgent::socketEvent(int fd, uint32_t events)
+{
+    listenertype_e listenertype = LISTENER_NONE;
+
+    if ((size_t)fd < socketTypes.size())
+    {
+        listenertype = socketTypes[fd];
+    }
+
+    switch (listenertype)
+    {
+    case LISTENER_RAW:
+    {
+        sockfd=fd;
+
+        if ((events & EPOLLERR) || (events & EPOLLHUP))
+        {
+            endConnection();
+            break;
+        }
+
+        if (events & EPOLLIN)
+        {
+            if (multiplexed.count(sockfd))
+            {
+                readMultiplexed();
+            }
+            else
+            {
+                argsize = readSocket();
+
+                if (argsize < 0)
+                {
+                    endConnection();
+                    break;
+                }
+
+                requestid = 0;
+                rawRequest();
+            }
+
+            if (socketTypes[fd] != LISTENER_RAW)
+            {
+                // request ended the connection
+                break;
+            }
+        }
+
+        if (events & EPOLLOUT)
+        {
+            sockfd=fd;
+
+            if (multiplexed.count(sockfd))
+            {
+                flushMultiplexed();
+                break;
+            }
+
+            struct epoll_event ev;
+            ev.events = EPOLLIN | EPOLLHUP | EPOLLET;
+            ev.data.fd = sockfd;
+
+            if (epoll_ctl(epollfd, EPOLL_CTL_MOD, sockfd, &ev))
+            {
+                endConnection();
+                break;
+            }
+
+            // write data that's waiting
+            sendLaterMap::iterator waitingToSendIterator;
+            waitingToSendIterator = waitingToSend.find(sockfd);
+
+            if (waitingToSendIterator != waitingToSend.end())
+            {
+                responseData response =
+                    waitingToSendIterator->second;
+                sendResponse(true, response.resultCode,
+                             response.sbuf);
+            }
+        }
+    }
+    break;
+
+
+    case LISTENER_PG:
+    {
+        if (!Pgs.count(fd))
+        {
+            if ((events & EPOLLERR) || (events & EPOLLHUP))
+            {
+                fprintf(logfile, "\t%s %i hanging it up\n", __FILE__, __LINE__);
+                Pg::pgclosesocket(*this, fd);
+            }
+            break;
+        }
+
+        Pgs[fd]->cont();
+    }
+    break;
+
+    default:
+        fprintf(logfile, "%s %i event %i on spurious sockfd %i\n", __FILE__,
+                __LINE__, events, fd);
+    }
 }
 
 int64_t TransactionAgent::readSocket()
@@ -623,13 +874,286 @@ int64_t TransactionAgent::readSocket()
     }
 
     int64_t localargsize = msgsize - 1 - (int)operationlength;
-    operation->assign(inbuf+9, (int)operationlength);
-    memset(&args, 0, PAYLOADSIZE);
+    operation.assign(inbuf+9, (int)operationlength);
     memcpy(args, inbuf+9+(int)operationlength, localargsize);
 
     return localargsize;
 }
 
+void TransactionAgent::rawRequest()
+{
+    // ok, if no user logged in, then can only login, else
+    // break connection exit
+    // if user logged in, then cannot login but everything
+    // else
+    // login shouldn't be in binFunctions map therefore
+    socketAuthInfo::iterator loggedInUsersIterator;
+    loggedInUsersIterator = loggedInUsers.find(sockfd);
+
+    if (loggedInUsersIterator == loggedInUsers.end())
+    {
+        // this means not logged in
+        if (operation.compare("login")==0)
+        {
+            // so, login
+            login(STARTCMD);
+        }
+        else if (operation.compare("ping")==0 &&
+                 __sync_add_and_fetch(&cfgs.anonymousping, 0))
+        {
+            ping(STARTCMD);
+        }
+        else     // gtfo
+        {
+            endConnection();
+        }
+
+        return;
+    }
+
+    // get my domainid & userid
+    domainid = loggedInUsersIterator->second.domainid;
+    userid = loggedInUsersIterator->second.userid;
+    domainName = loggedInUsersIterator->second.domainName;
+
+    // first, check domain operations, when those are
+    // built
+    boost::unordered_map<int64_t, domainProceduresMap>::iterator
+        domainIt = domainidsToProcedures.find(domainid);
+
+    if (domainIt != domainidsToProcedures.end())
+    {
+        domainProceduresMap::iterator procIt =
+            domainIt->second.find(operation);
+
+        if (procIt != domainIt->second.end())
+        {
+            spclasscreate spC=(spclasscreate)procIt->second.procedurecreator;
+            spclassdestroy spD=(spclassdestroy)procIt->second.proceduredestroyer;
+            ApiInterface::setRequest(sockfd, requestid);
+            spC(this, NULL, (void *)spD);
+            ApiInterface::setRequest(-1, 0);
+            return;
+        }
+    }
+
+    builtinsMap::iterator builtinsIterator;
+    builtinsIterator = builtins.find(operation);
+
+    if (builtinsIterator != builtins.end())
+    {
+        (this->*(builtinsIterator->second))(STARTCMD);
+    }
+    else
+    {
+        // terminate with extreme prejudice
+        endConnection();
+    }
+}
+
+void TransactionAgent::readMultiplexed()
+{
+    int fd = sockfd;
+    char inbuf[MULTIPLEXREADSIZE];
+
+    while (1)
+    {
+        ssize_t bytesread = read(fd, inbuf, MULTIPLEXREADSIZE);
+
+        if (bytesread == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesread == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return;
+        }
+        if (bytesread <= 0)
+        {
+            endConnection();
+            return;
+        }
+
+        multiplexedMap::iterator it = multiplexed.find(fd);
+        it->second.inbuf.append(inbuf, bytesread);
+        size_t pos = 0;
+
+        // every complete request: msgsize, requestid, operation length,
+        // operation, arguments
+        while (it->second.inbuf.size() - pos >= sizeof(uint64_t))
+        {
+            const char *frame = it->second.inbuf.data() + pos;
+            uint64_t a;
+            memcpy(&a, frame, sizeof(a));
+            int64_t msgsize = be64toh(a);
+
+            if (msgsize < (int64_t)sizeof(a) + 1 ||
+                msgsize > (int64_t)sizeof(a) + 1 + 255 + PAYLOADSIZE)
+            {
+                printf("%s %i msgsize %li sockfd %i\n", __FILE__, __LINE__,
+                       msgsize, fd);
+                endConnection();
+                return;
+            }
+            if (it->second.inbuf.size() - pos - sizeof(a) < (size_t)msgsize)
+            {
+                break;
+            }
+
+            memcpy(&a, frame + sizeof(a), sizeof(a));
+            int operationlength = (unsigned char)frame[2*sizeof(a)];
+            int64_t localargsize = msgsize - sizeof(a) - 1 - operationlength;
+
+            if (localargsize < 0 || localargsize > PAYLOADSIZE)
+            {
+                endConnection();
+                return;
+            }
+
+            requestid = be64toh(a);
+            operation.assign(frame + 2*sizeof(a) + 1, operationlength);
+            memcpy(args, frame + 2*sizeof(a) + 1 + operationlength,
+                   localargsize);
+            argsize = localargsize;
+            pos += sizeof(a) + msgsize;
+
+            sockfd = fd;
+            rawRequest();
+            it = multiplexed.find(fd);
+
+            if (it == multiplexed.end())
+            {
+                // request ended the connection
+                return;
+            }
+        }
+
+        it->second.inbuf.erase(0, pos);
+    }
+}
+
+void TransactionAgent::queueResponse(int64_t resultCode, const char *data,
+                                     size_t size)
+{
+    std::string &outbuf = multiplexed[sockfd].outbuf;
+    bool isidle = outbuf.empty();
+    frameResponse(outbuf, resultCode, requestid, data, size);
+
+    if (isidle)
+    {
+        // else EPOLLOUT is armed and will flush it
+        flushMultiplexed();
+    }
+}
+
+void TransactionAgent::frameResponse(std::string &outbuf,
+                                     int64_t resultCode, int64_t requestidarg,
+                                     const char *data, size_t size)
+{
+    uint64_t x = htobe64((uint64_t)(3*sizeof(x) + size));
+    outbuf.append((const char *)&x, sizeof(x));
+    x = htobe64((uint64_t)resultCode);
+    outbuf.append((const char *)&x, sizeof(x));
+    x = htobe64((uint64_t)requestidarg);
+    outbuf.append((const char *)&x, sizeof(x));
+    outbuf.append(data, size);
+}
+
+void TransactionAgent::flushMultiplexed()
+{
+    multiplexedConnection_s &conn = multiplexed[sockfd];
+    size_t written = 0;
+
+    while (written < conn.outbuf.size())
+    {
+        ssize_t n = write(sockfd, conn.outbuf.data() + written,
+                          conn.outbuf.size() - written);
+
+        if (n > 0)
+        {
+            written += n;
+        }
+        else if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else
+        {
+            printf("%s %i endConnection written %li errno %i\n", __FILE__,
+                   __LINE__, n, errno);
+            endConnection();
+            return;
+        }
+    }
+
+    conn.outbuf.erase(0, written);
+
+    if (conn.outbuf.empty() == !conn.iswaiting)
+    {
+        return;
+    }
+
+    // arm EPOLLOUT while responses are backed up, disarm once drained
+    conn.iswaiting = !conn.outbuf.empty();
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLHUP | EPOLLET;
+    if (conn.iswaiting)
+    {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.fd = sockfd;
+
+    if (epoll_ctl(epollfd, EPOLL_CTL_MOD, sockfd, &ev))
+    {
+        endConnection();
+    }
+}
+
+void TransactionAgent::sendResponse(bool resending, int64_t resultCode,
+                                    vector<string> *response)
+{
+    if (multiplexed.count(sockfd))
+    {
+        responsebuf.clear();
+        vector2Msgpack(*response, responsebuf);
+        queueResponse(resultCode, responsebuf.data(), responsebuf.size());
+        return;
+    }
+
+    responsebuf.resize(2*sizeof(uint64_t));
+    vector2Msgpack(*response, responsebuf);
+    uint64_t x = htobe64((uint64_t)responsebuf.size());
+    memcpy(&responsebuf[0], &x, sizeof(x));
+    x = htobe64((uint64_t)resultCode);
+    memcpy(&responsebuf[sizeof(x)], &x, sizeof(x));
+    ssize_t totalwritten = write(sockfd, responsebuf.data(),
+                                 responsebuf.size());
+
+    if (totalwritten == (ssize_t)responsebuf.size())
+    {
+        return;
+    }
+
+    if (totalwritten == -1 && (errno==EAGAIN || errno==EWOULDBLOCK))
+    {
+        // keep a copy until the socket drains
+        msgpack::sbuffer *sbuf = new msgpack::sbuffer;
+        sbuf->write(responsebuf.data() + 2*sizeof(x),
+                    responsebuf.size() - 2*sizeof(x));
+        sendResponse(resending, resultCode, sbuf);
+        return;
+    }
+
+    // partial response can't be resumed
+    printf("%s %i endConnection written %li errno %i\n", __FILE__, __LINE__,
+           totalwritten, errno);
+    endConnection();
+}
+
 // launcher, regular function
 void *transactionAgent(void *identity)
 {
@@ -644,18 +1168,55 @@ void TransactionAgent::ping(builtincmds_e cmd)
     sendResponse(false, STATUS_OK, &rv);
 }
 
+void TransactionAgent::multiplex(builtincmds_e cmd)
+{
+    // acknowledged in the old framing, requests after it carry IDs
+    vector<string> rv;
+    sendResponse(false, STATUS_OK, &rv);
+
+    if (socketTypes[sockfd] != LISTENER_RAW)
+    {
+        return;
+    }
+
+    multiplexedConnection_s &conn = multiplexed[sockfd];
+    conn.iswaiting = false;
+    sendLaterMap::iterator waitingToSendIterator =
+        waitingToSend.find(sockfd);
+
+    if (waitingToSendIterator != waitingToSend.end())
+    {
+        // acknowledgement backed up, goes out ahead of framed responses
+        // with EPOLLOUT already armed
+        msgpack::sbuffer *sbuf = waitingToSendIterator->second.sbuf;
+        uint64_t x = htobe64((uint64_t)(2*sizeof(x) + sbuf->size()));
+        conn.outbuf.append((const char *)&x, sizeof(x));
+        x = htobe64((uint64_t)waitingToSendIterator->second.resultCode);
+        conn.outbuf.append((const char *)&x, sizeof(x));
+        conn.outbuf.append(sbuf->data(), sbuf->size());
+        conn.iswaiting = true;
+        delete sbuf;
+        waitingToSend.erase(waitingToSendIterator);
+    }
+}
+
 void TransactionAgent::login(builtincmds_e cmd)
 {
     switch (cmd)
     {
     case STARTCMD:
     {
+        if (msgpack2ArgViews(argViews, args, argsize)==false ||
+            argViews.size() < 1)
+        {
+            endConnection();
+            return;
+        }
+
         operationPtr = new class Operation(OP_AUTH, this, -1, -1);
         operationid = operationPtr->getid();
-
-        vector<string> v;
-        msgpack2Vector(&v, args, argsize);
-        operationPtr->setDomainName(v[0]);
+        operationPtr->setDomainName(string(argViews[0].data,
+                                           argViews[0].size));
         class MessageUserSchema *msg = new class MessageUserSchema(TOPIC_LOGIN);
         class MessageUserSchema &msgref = *msg;
         msgref.messageStruct.topic = TOPIC_LOGIN;
@@ -663,7 +1224,7 @@ void TransactionAgent::login(builtincmds_e cmd)
         msgref.userschemaStruct.argsize = argsize;
         msgref.userschemaStruct.instance = instance;
         msgref.userschemaStruct.operationid = operationid;
-        msgref.argstring.assign(args, 0, argsize);
+        msgref.argstring.assign(args, argsize);
         mboxes.toUserSchemaMgr(this->myIdentity.address, msgref);
     }
     break;
@@ -729,7 +1290,7 @@ void TransactionAgent::changepassword(builtincmds_e cmd)
         msgref.userschemaStruct.operationid = operationid;
         msgref.userschemaStruct.domainid = domainid;
         msgref.userschemaStruct.userid = userid;
-        msgref.argstring.assign(args, 0, argsize);
+        msgref.argstring.assign(args, argsize);
         mboxes.toUserSchemaMgr(this->myIdentity.address, msgref);
     }
     break;
@@ -773,7 +1334,7 @@ void TransactionAgent::createdomain(builtincmds_e cmd)
         msgref.userschemaStruct.operationid = operationid;
         msgref.userschemaStruct.domainid = domainid;
         msgref.userschemaStruct.userid = userid;
-        msgref.argstring.assign(args, 0, argsize);
+        msgref.argstring.assign(args, argsize);
         //      mboxes.userSchemaMgr.send(msgsnd, true);
         mboxes.toUserSchemaMgr(this->myIdentity.address, msgref);
     }
@@ -824,7 +1385,7 @@ void TransactionAgent::createuser(builtincmds_e cmd)
         msgref.userschemaStruct.operationid = operationid;
         msgref.userschemaStruct.domainid = domainid;
         msgref.userschemaStruct.userid = userid;
-        msgref.argstring.assign(args, 0, argsize);
+        msgref.argstring.assign(args, argsize);
         mboxes.toUserSchemaMgr(this->myIdentity.address, msgref);
     }
     break;
@@ -874,7 +1435,7 @@ void TransactionAgent::deleteuser(builtincmds_e cmd)
         msgref.userschemaStruct.operationid = operationid;
         msgref.userschemaStruct.domainid = domainid;
         msgref.userschemaStruct.userid = userid;
-        msgref.argstring.assign(args, 0, argsize);
+        msgref.argstring.assign(args, argsize);
         //      mboxes.userSchemaMgr.send(msgsnd, true);
         mboxes.toUserSchemaMgr(this->myIdentity.address, msgref);
     }
@@ -920,7 +1481,7 @@ void TransactionAgent::deletedomain(builtincmds_e cmd)
         msgref.userschemaStruct.operationid = operationid;
         msgref.userschemaStruct.domainid = domainid;
         msgref.userschemaStruct.userid = userid;
-        msgref.argstring.assign(args, 0, argsize);
+        msgref.argstring.assign(args, argsize);
         //      mboxes.userSchemaMgr.send(msgsnd, true);
         mboxes.toUserSchemaMgr(this->myIdentity.address, msgref);
     }
@@ -1220,7 +1781,7 @@ void TransactionAgent::schemaBoilerplate(builtincmds_e cmd, int builtin)
         msgref.userschemaStruct.operationid = operationid;
         msgref.userschemaStruct.userid = userid;
         msgref.userschemaStruct.domainid = domainid;
-        msgref.argstring.assign(args, 0, argsize);
+        msgref.argstring.assign(args, argsize);
         mboxes.toUserSchemaMgr(this->myIdentity.address, msgref);
     }
     break;
@@ -1251,7 +1812,7 @@ void TransactionAgent::schemaBoilerplate(builtincmds_e cmd, int builtin)
         if (msgrcvref.userschemaStruct.argsize)
         {
             msg.userschemaStruct.argsize = msgrcvref.userschemaStruct.argsize;
-            msg.argstring.assign(args, 0, argsize);
+            msg.argstring.assign(args, argsize);
         }
         else
         {
@@ -1311,11 +1872,17 @@ void TransactionAgent::loadprocedure(builtincmds_e cmd)
 
 void TransactionAgent::compile(builtincmds_e cmd)
 {
-    vector<string> resultVector;
-    msgpack2Vector(&resultVector, args, argsize);
+    if (msgpack2ArgViews(argViews, args, argsize)==false ||
+        argViews.size() < 2)
+    {
+        vector<string> rv;
+        sendResponse(false, STATUS_NOTOK, &rv);
+        return;
+    }
+
     //  int64_t sid = atol(resultVector[0].c_str());
-    string statementname(resultVector[0]);
-    string sqlstatement(resultVector[1]);
+    string statementname(argViews[0].data, argViews[0].size);
+    string sqlstatement(argViews[1].data, argViews[1].size);
     class Larxer lx2((char *)sqlstatement.c_str(), this,
                      domainidsToSchemata[domainid]);
 
@@ -1442,18 +2009,23 @@ void TransactionAgent::newprocedure(int64_t entrypoint)
     {
     case 1: // client sends loadprocedure command
     {
-        vector<string> resultVector;
-        msgpack2Vector(&resultVector, args, argsize);
+        if (msgpack2ArgViews(argViews, args, argsize)==false ||
+            argViews.size() < 2)
+        {
+            vector<string> rv;
+            sendResponse(false, STATUS_NOTOK, &rv);
+            return;
+        }
 
         class MessageUserSchema msg;
         msg.messageStruct.topic = TOPIC_PROCEDURE1;
         msg.messageStruct.payloadtype = PAYLOADUSERSCHEMA;
         msg.userschemaStruct.domainid = domainid;
-        msg.pathname = resultVector[0];
+        msg.pathname.assign(argViews[0].data, argViews[0].size);
         msg.procname = storedprocprefix;
         msg.procname += domainName;
         msg.procname += "_";
-        msg.procname.append(resultVector[1]);
+        msg.procname.append(argViews[1].data, argViews[1].size);
 
         // get 1 ta from each node and send a copy of that message
         for (size_t n=0; n < myTopology.allActors.size(); n++)
@@ -34,6 +34,7 @@
 #include "Table.h"
 #include "Schema.h"
 #include "Larxer.h"
+#include "StatementCache.h"
 #include "Actor.h"
 
 /** 
@@ -122,12 +123,32 @@ typedef struct
 } authInfo;
 
 typedef boost::unordered_map<int, responseData> sendLaterMap;
+
+/** 
+ * @brief raw interface connection switched to request ID framing
+ *
+ * requests can be pipelined and responses go out in completion order
+ */
+typedef struct
+{
+    // bytes read that don't yet make a whole request
+    std::string inbuf;
+    // responses the socket hasn't taken yet
+    std::string outbuf;
+    // EPOLLOUT armed
+    bool iswaiting;
+} multiplexedConnection_s;
+typedef boost::unordered_map<int, multiplexedConnection_s> multiplexedMap;
 // there is apparently a bug in boost::unordered_map that causes
 // this thing to dump core when trying to count or erase a key under
 // some circumstances. no time presently to figure it out
 //typedef boost::unordered_map<int, authInfo> socketAuthInfo;
 typedef std::map<int, authInfo> socketAuthInfo;
 typedef boost::unordered_map<int64_t, class Operation *> operationMap;
+class TransactionAgent;
+typedef boost::unordered_map<std::string,
+                             void (TransactionAgent::*)(builtincmds_e)>
+    builtinsMap;
 
 msgpack::sbuffer *makeSbuf(msgpack::sbuffer *);
 msgpack::sbuffer *makeSbuf(vector<string> *);
@@ -263,6 +284,15 @@ public:
      * @param cmd continuation entry point
      */
     void compile(builtincmds_e cmd);
+    /** 
+     * @brief switch connection to request ID framing
+     *
+     * acknowledged in the unframed format, client sends framed requests
+     * after reading it
+     *
+     * @param cmd continuation entry point
+     */
+    void multiplex(builtincmds_e cmd);
     /** 
      * @brief common code for many operations, such as login, create table, etc
      *
@@ -324,6 +354,100 @@ public:
      * @return 
      */
     int64_t readSocket();
+    /** 
+     * @brief route request in operation and args on raw interface
+     *
+     * login or ping if not logged in, else stored procedure or builtin
+     */
+    void rawRequest();
+    /** 
+     * @brief read multiplexed connection until EAGAIN, running each whole
+     * request
+     *
+     * request: 8 byte msgsize, 8 byte request ID, 1 byte operation length,
+     * operation, msgpack arguments. msgsize counts what follows it
+     */
+    void readMultiplexed();
+    /** 
+     * @brief append framed response to multiplexed connection's output
+     *
+     * response: 8 byte totalsize, 8 byte resultCode, 8 byte request ID,
+     * msgpack payload
+     *
+     * @param resultCode result code
+     * @param data msgpack payload
+     * @param size payload size
+     */
+    void queueResponse(int64_t resultCode, const char *data, size_t size);
+    /** 
+     * @brief append framed response, as queueResponse() does
+     *
+     * @param outbuf output
+     * @param resultCode result code
+     * @param requestidarg request ID
+     * @param data msgpack payload
+     * @param size payload size
+     */
+    static void frameResponse(std::string &outbuf, int64_t resultCode,
+                              int64_t requestidarg, const char *data,
+                              size_t size);
+    /** 
+     * @brief write what the socket takes of multiplexed connection's
+     * output, EPOLLOUT armed for the rest
+     *
+     */
+    void flushMultiplexed();
+    /** 
+     * @brief open this TransactionAgent's listening sockets
+     *
+     * once the Listener addresses are in myTopology. They are
+     * SO_REUSEPORT, so the kernel spreads connections across all
+     * TransactionAgents
+     */
+    void startListening();
+    /** 
+     * @brief accept pending connections into this TransactionAgent's epoll
+     *
+     * @param listenfd listening socket
+     * @param listenertype LISTENER_RAW or LISTENER_PG
+     */
+    void acceptSockets(int listenfd, listenertype_e listenertype);
+    /** 
+     * @brief handle epoll event on connected client socket
+     *
+     * @param fd socket
+     * @param events epoll events
+     */
+    void socketEvent(int fd, uint32_t events);
+    /** 
+     * @brief take over connection accepted or moved here
+     *
+     * @param fd socket
+     * @param listenertype LISTENER_RAW or LISTENER_PG
+     * @param pgPtr Pg moved from another TransactionAgent, NULL if new
+     */
+    void adoptSocket(int fd, listenertype_e listenertype, class Pg *pgPtr);
+    /** 
+     * @brief sample load into myIdentity.mbox->load every TALOADINTERVAL
+     *
+     * score is CPU per mille since the last sample, plus deepest mailbox
+     * batch, plus TALOADTRANSACTION per Transaction and TALOADCONNECTION per
+     * connection. Migrates one connection per sample if cfgs.tamigrate
+     */
+    void publishLoad();
+    /** 
+     * @brief least loaded TransactionAgent on this node
+     *
+     * @return its instance, or this one's unless another is lighter by more
+     * than cfgs.taplacementmargin
+     */
+    int64_t lightestTa();
+    /** 
+     * @brief move the busiest Pg that is between transactions
+     *
+     * @param tainstance destination TransactionAgent
+     */
+    void migrateConnection(int64_t tainstance);
     /** 
      * @brief generate unique, constantly increasing Transaction identifier
      *
@@ -363,6 +487,18 @@ public:
      *
      */
     void handledispatch();
+    /** 
+     * @brief send raw protocol response made of strings
+     *
+     * packs into responsebuf, reused for every request, and only allocates
+     * if the socket is full and the response has to wait for EPOLLOUT
+     *
+     * @param resending 
+     * @param resultCode 
+     * @param response 
+     */
+    void sendResponse(bool resending, int64_t resultCode,
+                      vector<string> *response);
 
     /** 
      * @brief send raw protocol TCP responses to builtins, ping, login, logout,
@@ -376,6 +512,14 @@ public:
         void sendResponse(bool resending, int64_t resultCode, T response)
     {
         msgpack::sbuffer *sbuf = makeSbuf(response);
+
+        if (!resending && multiplexed.count(sockfd))
+        {
+            queueResponse(resultCode, sbuf->data(), sbuf->size());
+            delete sbuf;
+            return;
+        }
+
         int64_t totalsize = 2*sizeof(uint64_t) + sbuf->size();
         char payload[PAYLOADSIZE];
         uint64_t x = htobe64((uint64_t)totalsize);
@@ -466,10 +610,29 @@ public:
 //    class Mboxes mboxes;
 //    class Topology myTopology;
     int64_t instance;
+    // own epoll set: listening and client sockets plus mbox wakefd
     int epollfd;
+    int listenersockfd;
+    int pglistenersockfd;
+    // socketTypes[sockfd] = listener that accepted it
+    std::vector<listenertype_e> socketTypes;
+    // CLOCK_MONOTONIC and thread CPU ns at last load sample
+    int64_t loadsampled;
+    int64_t loadcpu;
+    // most messages received at once since last load sample
+    size_t loaddepth;
+    builtinsMap builtins;
     int sockfd;
+    // request ID being answered on multiplexed connection
+    int64_t requestid;
+    // multiplexed[sockfd]
+    multiplexedMap multiplexed;
     char payload[PAYLOADSIZE];
-    std::string *operation;
+    std::string operation;
+    // request arguments, views over args
+    std::vector<argView_s> argViews;
+    // raw protocol response being written
+    std::string responsebuf;
     socketAuthInfo loggedInUsers;
     int64_t argsize;
     char args[PAYLOADSIZE]; // get rid of this when possible
@@ -487,6 +650,8 @@ public:
     boost::unordered_map<int64_t, class Applier *> Appliers;
     // Pgs[socket] = *Pg
     boost::unordered_map<int, class Pg *> Pgs;
+    // sockets of Pgs holding input until their statement finished
+    std::vector<int> pgsToResume;
     int64_t nexttransactionid;
     int64_t nextapplierid;
     int batchSendCount;
@@ -500,6 +665,8 @@ public:
     // user submits statementname
     boost::unordered_map< int64_t,
         boost::unordered_map<std::string, class Statement> > statements;
+    // simple query protocol Statements by normalized text
+    class StatementCache statementCache;
 };
 
 class ApiInterface;
@@ -33,6 +33,22 @@
 #include "Asts.h"
 #line 35 "api.cc"
 
+/* request routed to stored procedures created by this thread's
+ * TransactionAgent */
+static __thread int requestsockfd = -1;
+static __thread int64_t requestrequestid = 0;
+
+ApiInterface::ApiInterface() : sockfd(requestsockfd),
+    requestid(requestrequestid)
+{
+}
+
+void ApiInterface::setRequest(int sockfdarg, int64_t requestidarg)
+{
+    requestsockfd = sockfdarg;
+    requestrequestid = requestidarg;
+}
+
 void ApiInterface::deserialize2Vector()
 {
     msgpack::unpacked msg;
@@ -41,6 +57,11 @@ void ApiInterface::deserialize2Vector()
     obj.convert(&inputVector);
 }
 
+bool ApiInterface::deserialize2ArgViews()
+{
+    return msgpack2ArgViews(inputArgViews, taPtr->args, taPtr->argsize);
+}
+
 void ApiInterface::beginTransaction()
 {
     transactionPtr = new class Transaction(taPtr, domainid);
@@ -202,15 +223,7 @@ void ApiInterface::replaceRow(apifPtr re, int64_t recmd, void *reptr)
 void ApiInterface::fetchRows(apifPtr re, int64_t recmd, void *reptr)
 {
     setReEntry(re, recmd, reptr);
-
-    if (transactionPtr->pendingcmd != NOCOMMAND)
-    {
-        transactionPtr->reenter(APISTATUS_PENDING);
-        return;
-    }
-
-    transactionPtr->pendingcmdid = transactionPtr->getnextpendingcmdid();
-    transactionPtr->pendingcmd = FETCH;
+    transactionPtr->fetchRows(CURSORFETCHROWS);
 }
 
 void ApiInterface::unlock(apifPtr re, int64_t recmd, void *reptr, int64_t rowid,
@@ -640,6 +653,7 @@ void ApiInterface::selectRows(apifPtr re, int64_t recmd, void *reptr,
 void ApiInterface::sendResponse(int64_t resultCode, vector<string> *v)
 {
     taPtr->sockfd = sockfd;
+    taPtr->requestid = requestid;
     taPtr->sendResponse(false, resultCode, v);
 }
 
@@ -41,9 +41,35 @@
  */
 #define RTPRIO 30
 #define MSGRECEIVEBATCHSIZE 500
+/** epoll events a TransactionAgent takes per wait on its own sockets */
+#define TAEPOLLEVENTS 256
+/** bytes read per call from a multiplexed native connection */
+#define MULTIPLEXREADSIZE 16384
+/** normalized statements each TransactionAgent keeps parsed */
+#define STATEMENTCACHESIZE 1024
+/** index entries filtered per ColumnBatch kernel pass */
+#define COLUMNBATCHSIZE 4096
+/** longest IN list ColumnBatch compares against value by value */
+#define COLUMNBATCHINSCAN 16
+/** ns between TransactionAgent load samples, and connection migrations */
+#define TALOADINTERVAL 10000000
+/** load score per active Transaction */
+#define TALOADTRANSACTION 20
+/** load score per connection */
+#define TALOADCONNECTION 10
+/** default load score gap before a TA hands a new connection off */
+#define TAPLACEMENTMARGINDEFAULT 200
 #define OBGWMSGBATCHSIZE 5000
+// segments gathered per ObGateway sendmsg, and written buffers kept for reuse
+#define OBGWIOVMAX 256
+#define OBGWSPAREBUFFERS 16
+/** epoll events an ObGateway takes per wait on its peer sockets */
+#define OBGWEPOLLEVENTS 64
+/** bytes queued to one peer before ObGateway stops taking messages */
+#define OBGWMAXQUEUEDBYTES 67108864
 
 #include "infinisql.h"
+#include "cfgenum.h"
 
 /** 
  * @brief type of network listener
@@ -293,7 +319,9 @@ enum __attribute__ ((__packed__)) pendingprimitive_e
         PRIMITIVE_SQLDELETE,
         PRIMITIVE_SQLINSERT,
         PRIMITIVE_SQLUPDATE,
-        PRIMITIVE_SQLREPLACE
+        PRIMITIVE_SQLREPLACE,
+        INSERTROWS,
+        PRIMITIVE_SQLSELECTALLCURSOR
         };
 
 /** 
@@ -314,11 +342,42 @@ enum enginecmd_e
     ROLLBACKCMD,
     REVERTCMD,
     UNLOCKCMD,
-    SEARCHRETURN1
+    SEARCHRETURN1,
+    NEWROWS
 };
 
 /** Global configs */
 #define SERIALIZEDMAXSIZE   1048576
+/** default number of empty polls before Mbox::receive parks on futex */
+#define MBOXSPINDEFAULT     2000
+/** bytes of padding between Mbox fields written by different threads */
+#define CACHELINESIZE       64
+/** gateway frame size flag: payload is [rawsize, lz4 block] */
+#define GWFRAMECOMPRESSED   ((size_t)1 << 63)
+/** history shared by per-connection lz4 streams */
+#define GWLZ4DICTSIZE       65536
+/** compressed frames per peer between compression policy decisions */
+#define GWCOMPRESSWINDOW    64
+/** frames sent raw to a peer before compression is tried again */
+#define GWCOMPRESSPROBE     1024
+/** rows bound for 1 engine that end a COPY FROM batch */
+#define COPYBATCHROWS       8192
+/** bytes of rows bound for 1 engine that also end a COPY FROM batch */
+#define COPYBATCHBYTES      524288
+/** rows a SELECT cursor fetches from Engines at a time */
+#define CURSORFETCHROWS     4096
+/** input Pg holds while a statement executes before it stops reading */
+#define PGINPUTHOLDMAX      1048576
+/** pipelined responses Pg coalesces in outbuf before sending */
+#define PGCOALESCEMAX       65536
+/** bytes per Pg outbound chunk */
+#define PGOUTCHUNKSIZE      16384
+/** sent chunks each Pg keeps for reuse */
+#define PGOUTFREECHUNKS     4
+/** chunks per writev */
+#define PGOUTIOVMAX         64
+/** unsent result bytes at which Pg sends, and pauses if the socket is full */
+#define PGOUTHIGHWATER      262144
 /** 
  * @brief global config parameters
  *
@@ -328,6 +387,13 @@ typedef struct
     int anonymousping;
     int badloginmessages;
     bool compressgw;
+    size_t compressgwthreshold; // smaller gateway frames go uncompressed
+    int64_t compressgwminsaving; // percent, peers saving less go raw
+    int64_t compressgwnsperbyte; // link ns/byte, max cpu per saved byte
+    bool messagepool; // Message variants from MessagePool, else malloc
+    int64_t mboxspin[NUMACTORTYPES]; // spin budget per actor type
+    int64_t taplacementmargin; // TA load gap to hand a connection off, <0 off
+    bool tamigrate; // move idle pg connections off loaded TAs
 } cfg_s;
 extern cfg_s cfgs;
 
@@ -388,6 +454,18 @@ typedef struct
     fieldValue_s fieldVal;
 } rowOrField_s;
 
+/** 
+ * @brief comparison of a field to a constant, checked by the Engine against
+ * each row before returning it
+ *
+ */
+typedef struct
+{
+    int64_t fieldid;
+    operatortypes_e op;
+    fieldValue_s value;
+} residualPredicate_s;
+
 /** 
  * @brief describes how to perform an SQL search expression predicate
  *
@@ -397,6 +475,10 @@ typedef struct
     operatortypes_e op;
     std::vector <fieldValue_s> values;
     std::string regexString;
+    // AND conjuncts rows must also satisfy, for SELECTROWS & SEARCHRETURN1
+    std::vector<residualPredicate_s> residuals;
+    // fields returned, the rest returned null. empty for all fields
+    std::vector<int64_t> projection;
 } searchParams_s;
 
 /** 
@@ -497,6 +579,18 @@ typedef struct
     boost::unordered_map< int64_t, lockFieldValue_s > uniqueIndices;
 } stagedRow_s;
 
+/** 
+ * @brief rows bound for 1 engine in a batched insert
+ *
+ */
+typedef struct
+{
+    std::vector<std::string> rows;
+    // fieldValues[n] are the fields of rows[n], for unique indices
+    std::vector< std::vector<fieldValue_s> > fieldValues;
+    size_t rowbytes; // sum of rows' sizes
+} insertBatch_s;
+
 typedef boost::unordered_map<int64_t, class Schema *> domainidToSchemaMap;
 
 void debug(char *, int, char *);
@@ -526,9 +620,6 @@ enum deadlockchange_e
 class Topology;
 extern class Topology nodeTopology;
 extern pthread_mutex_t nodeTopologyMutex;
-extern pthread_mutex_t connectionsMutex;
-extern std::vector<class MboxProducer *> socketAffinity;
-extern std::vector<listenertype_e> listenerTypes;
 
 /** 
  * @brief convert msgpack to a vector of strings
@@ -539,6 +630,26 @@ extern std::vector<listenertype_e> listenerTypes;
  */
 void msgpack2Vector(vector<string> *resultvector, char *payload,
                     int64_t length);
+/** 
+ * @brief decode msgpack array of strings as views over payload
+ *
+ * no allocation once views has grown to the request's argument count
+ *
+ * @param views output, cleared first
+ * @param payload msgpack data
+ * @param length msgpack length
+ *
+ * @return false if payload is not an array of raw, str or bin items
+ */
+bool msgpack2ArgViews(vector<argView_s> &views, const char *payload,
+                      int64_t length);
+/** 
+ * @brief append msgpack array of strings, as msgpack::pack would
+ *
+ * @param v strings
+ * @param out output
+ */
+void vector2Msgpack(const vector<string> &v, string &out);
 /** 
  * @brief for delete operations on row
  *
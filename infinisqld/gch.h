@@ -53,11 +53,14 @@
 #include <map>
 #include <set>
 #include <queue>
+#include <deque>
+#include <list>
 #include <ctime>
 #include <utility>
 #include <algorithm>
 #include <sstream>
 #include <stack>
+#include <memory>
 // sys C
 #include <stdint.h>
 #include <pthread.h>
@@ -67,6 +70,7 @@
 #endif
 #include <endian.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <poll.h>
 #include <netdb.h>
 #include <fcntl.h>
@@ -80,6 +84,7 @@
 #include <mcheck.h>
 #include <sys/stat.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <sched.h>
 
 // project headers
@@ -10,11 +10,8 @@ cfg_s cfgs;
 std::string zmqsocket;
 class Topology nodeTopology;
 pthread_mutex_t nodeTopologyMutex;
-pthread_mutex_t connectionsMutex;
 void *zmqcontext;
 std::string storedprocprefix = "InfiniSQL_";
-std::vector<class MboxProducer *> socketAffinity;
-std::vector<listenertype_e> listenerTypes;
 
 // global functions
 void msgpack2Vector(vector<string> *resultvector, char *payload, int64_t length)
@@ -25,6 +22,142 @@ void msgpack2Vector(vector<string> *resultvector, char *payload, int64_t length)
     obj.convert(resultvector);
 }
 
+bool msgpack2ArgViews(vector<argView_s> &views, const char *payload,
+                      int64_t length)
+{
+    views.clear();
+    const unsigned char *p = (const unsigned char *)payload;
+    const unsigned char *end = p + length;
+    uint16_t u16;
+    uint32_t u32;
+    size_t nelem;
+
+    if (length < 1)
+    {
+        return false;
+    }
+
+    if ((*p & 0xf0)==0x90)
+    {
+        nelem = *p++ & 0x0f;
+    }
+    else if (*p==0xdc && end-p >= 3)
+    {
+        memcpy(&u16, p+1, sizeof(u16));
+        nelem = be16toh(u16);
+        p += 3;
+    }
+    else if (*p==0xdd && end-p >= 5)
+    {
+        memcpy(&u32, p+1, sizeof(u32));
+        nelem = be32toh(u32);
+        p += 5;
+    }
+    else
+    {
+        return false;
+    }
+
+    for (size_t n=0; n < nelem; n++)
+    {
+        size_t len;
+
+        if (p >= end)
+        {
+            return false;
+        }
+
+        if ((*p & 0xe0)==0xa0)
+        {
+            len = *p++ & 0x1f;
+        }
+        else if ((*p==0xd9 || *p==0xc4) && end-p >= 2)
+        {
+            len = p[1];
+            p += 2;
+        }
+        else if ((*p==0xda || *p==0xc5) && end-p >= 3)
+        {
+            memcpy(&u16, p+1, sizeof(u16));
+            len = be16toh(u16);
+            p += 3;
+        }
+        else if ((*p==0xdb || *p==0xc6) && end-p >= 5)
+        {
+            memcpy(&u32, p+1, sizeof(u32));
+            len = be32toh(u32);
+            p += 5;
+        }
+        else
+        {
+            return false;
+        }
+
+        if ((size_t)(end-p) < len)
+        {
+            return false;
+        }
+
+        views.push_back({(const char *)p, len});
+        p += len;
+    }
+
+    return true;
+}
+
+void vector2Msgpack(const vector<string> &v, string &out)
+{
+    char hdr[5];
+    uint16_t u16;
+    uint32_t u32;
+
+    if (v.size() < 16)
+    {
+        out.push_back((char)(0x90 | v.size()));
+    }
+    else if (v.size() < 65536)
+    {
+        hdr[0] = (char)0xdc;
+        u16 = htobe16((uint16_t)v.size());
+        memcpy(hdr+1, &u16, sizeof(u16));
+        out.append(hdr, 3);
+    }
+    else
+    {
+        hdr[0] = (char)0xdd;
+        u32 = htobe32((uint32_t)v.size());
+        memcpy(hdr+1, &u32, sizeof(u32));
+        out.append(hdr, 5);
+    }
+
+    // raw family, which older msgpack peers also read
+    for (size_t n=0; n < v.size(); n++)
+    {
+        size_t len = v[n].size();
+
+        if (len < 32)
+        {
+            out.push_back((char)(0xa0 | len));
+        }
+        else if (len < 65536)
+        {
+            hdr[0] = (char)0xda;
+            u16 = htobe16((uint16_t)len);
+            memcpy(hdr+1, &u16, sizeof(u16));
+            out.append(hdr, 3);
+        }
+        else
+        {
+            hdr[0] = (char)0xdb;
+            u32 = htobe32((uint32_t)len);
+            memcpy(hdr+1, &u32, sizeof(u32));
+            out.append(hdr, 5);
+        }
+
+        out.append(v[n]);
+    }
+}
+
 void debug(char *description, int line, char *file)
 {
     fprintf(logfile, "DEBUG %i %s %s\n", line, file, description);
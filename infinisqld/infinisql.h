@@ -230,6 +230,18 @@ typedef struct
     msgpack::sbuffer *sbuf;
 } procedureResponse_s;
 
+/** 
+ * @brief one argument of a native protocol request
+ *
+ * points into TransactionAgent::args, so only valid until the next request
+ * is read
+ */
+typedef struct
+{
+    const char *data;
+    size_t size;
+} argView_s;
+
 size_t hash_value(uuRecord_s const &);
 bool operator==(uuRecord_s const &, uuRecord_s const &);
 
@@ -261,10 +273,12 @@ public:
                               std::vector<fieldValue_s> > selectResults;
     };
 
-    ApiInterface()
-    {
-        ;
-    }
+    /** 
+     * @brief takes sockfd and request ID of the request being routed to
+     * a stored procedure, see setRequest()
+     *
+     */
+    ApiInterface();
     virtual ~ApiInterface()
     {
         ;
@@ -352,6 +366,12 @@ public:
      *
      */
     void deserialize2Vector();
+    /** 
+     * @brief decode request arguments into inputArgViews without copying
+     *
+     * @return false if arguments are not a msgpack array of strings
+     */
+    bool deserialize2ArgViews();
     /** 
      * @brief start Transaction
      *
@@ -531,8 +551,14 @@ public:
                     int64_t fieldid, locktype_e locktype, operatortypes_e op,
                     string *lower, string *upper);
     /** 
-     * @brief deprecated
+     * @brief fetch next rows of a SELECT executed as a cursor
+     *
+     * up to CURSORFETCHROWS rows replace results.selectResults, which
+     * is empty once the cursor is exhausted
      *
+     * @param re continuation function
+     * @param recmd continuation entrypoint
+     * @param reptr continuation state
      */
     void fetchRows(apifPtr re, int64_t recmd, void *reptr);
     /** 
@@ -727,11 +753,20 @@ public:
      */
     void getStoredProcedureArgs(Statement *stmtPtr,
                                 std::vector<std::string> &argsRef);
+    /** 
+     * @brief set request that stored procedures created next by this
+     * thread answer, so replies on multiplexed connections carry its ID
+     *
+     * @param sockfdarg client socket
+     * @param requestidarg request ID, 0 if unframed
+     */
+    static void setRequest(int sockfdarg, int64_t requestidarg);
 
     class TransactionAgent *taPtr;
     class ApiInterface *pgPtr;
     class Statement *statementPtr;
     std::vector<std::string> inputVector;
+    std::vector<argView_s> inputArgViews;
     class Transaction *transactionPtr;
     procedureResponse_s response;
     std::vector<std::string> responseVector;
@@ -740,6 +775,8 @@ public:
     apifPtr continueFunc2Ptr;
     apifPtr continuePgFuncPtr;
     int sockfd;
+    // request ID on multiplexed connections, taken with sockfd
+    int64_t requestid;
     int64_t domainid;
 
     results_s results;
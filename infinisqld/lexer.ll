@@ -282,6 +282,8 @@ LOCK { return LARX_LOCK; }
     return LARX_stringval; }
 ":"[0-9]+ { yylval->integer = atol(yytext+1);
     return LARX_parameter; }
+"$"[1-9][0-9]* { yylval->integer = atol(yytext+1)-1;
+    return LARX_parameter; }
 [0-9]+ { yylval->integer = atol(yytext); return LARX_intval; }
 [0-9]*"."[0-9]+ { yylval->floating = strtold(yytext, NULL);
     return LARX_floatval; }
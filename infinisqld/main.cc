@@ -86,7 +86,6 @@ int main(int argc, char **argv)
     pthread_mutexattr_t attr;
     attr.__align = PTHREAD_MUTEX_ADAPTIVE_NP;
     pthread_mutex_init(&nodeTopologyMutex, &attr);
-    pthread_mutex_init(&connectionsMutex, &attr);
     pthread_t topologyMgrThread;
     Topology::actorIdentity *arg = new Topology::actorIdentity();
     arg->type = ACTOR_TOPOLOGYMGR;
@@ -96,6 +95,16 @@ int main(int argc, char **argv)
     arg->instance = -1;
   
     cfgs.compressgw=true;
+    cfgs.compressgwthreshold=1024;
+    cfgs.compressgwminsaving=10;
+    cfgs.compressgwnsperbyte=8; // 1Gb/s
+    cfgs.messagepool=true;
+    for (size_t n=0; n < NUMACTORTYPES; n++)
+    {
+        cfgs.mboxspin[n]=MBOXSPINDEFAULT;
+    }
+    cfgs.taplacementmargin=TAPLACEMENTMARGINDEFAULT;
+    cfgs.tamigrate=false;
 
     int rv=pthread_create(&topologyMgrThread, NULL, topologyMgr, arg);
     if (rv)
@@ -42,6 +42,9 @@ ACTOR_DEADLOCKMGR = 'ACTOR_DEADLOCKMGR'
 ACTOR_USERSCHEMAMGR = 'ACTOR_USERSCHEMAMGR'
 ACTOR_LISTENER = 'ACTOR_LISTENER'
 
+# same as infinisqld's defs.h
+MBOXSPINDEFAULT = 2000
+
 CMD_SET = 'CMDSET'
 CMD_GET = 'CMDGET'
 CMD_START = 'CMDSTART'
@@ -57,6 +60,8 @@ CMD_PGHANDLER = 'CMDPGHANDLER'
 CMD_LISTENER = 'CMDLISTENER'
 CMD_BADLOGINMESSAGES = 'CMDBADLOGINMESSAGES'
 CMD_ANONYMOUSPING = 'CMDANONYMOUSPING'
+CMD_MBOXSPIN = 'CMDMBOXSPIN'
+CMD_TAPLACEMENT = 'CMDTAPLACEMENT'
 CMD_GETTOPOLOGYMGRMBOXPTR = 'CMDGETTOPOLOGYMGRMBOXPTR'
 CMD_LOCALCONFIG = 'CMDLOCALCONFIG'
 CMD_GLOBALCONFIG = 'CMDGLOBALCONFIG'
@@ -139,6 +144,11 @@ class node:
       print 'node ' + str(self.id) + ' problem setanonymousping'
     if self.setbadloginmessages():
       print 'node ' + str(self.id) + ' problem setbadloginmessages'
+    for actortype in self.mboxspin:
+      if self.setmboxspin(actortype, self.mboxspin[actortype]):
+        print 'node ' + str(self.id) + ' problem setmboxspin ' + actortype
+    if self.settaplacement():
+      print 'node ' + str(self.id) + ' problem settaplacement'
     if topo.userschemamgrnode==self.id:
       if self.startuserschemamgr():
         print 'node ' + str(self.id) + ' problem startuserschemamgr'
@@ -207,6 +217,22 @@ class node:
       return 1
     return 0
 
+  def setmboxspin(self, actortype, spins):
+    returnit = sendcmd(self, serialize( [cfgenum.cfgforwarddict['CMDSET'],
+      cfgenum.cfgforwarddict['CMDMBOXSPIN'],
+      cfgenum.actortypesforwarddict[actortype], spins] ))
+    if cfgenum.cfgreversedict[returnit.next()] != 'CMDOK':
+      return 1
+    return 0
+
+  def settaplacement(self):
+    returnit = sendcmd(self, serialize( [cfgenum.cfgforwarddict['CMDSET'],
+      cfgenum.cfgforwarddict['CMDTAPLACEMENT'], self.taplacementmargin,
+      self.tamigrate] ))
+    if cfgenum.cfgreversedict[returnit.next()] != 'CMDOK':
+      return 1
+    return 0
+
   def startlistener(self):
     returnit = sendcmd(self, serialize( [cfgenum.cfgforwarddict['CMDSTART'],
       cfgenum.cfgforwarddict['CMDLISTENER'], 4, self.listenhost,
@@ -398,8 +424,23 @@ def cfg(cfgfile):
       n.engines = config.getint(s, 'engines')
       n.ibgateways = config.getint(s, 'ibgateways')
       n.obgateways = config.getint(s, 'obgateways')
+      if config.has_option(s, 'gatewaylanes'):
+        n.ibgateways = n.obgateways = config.getint(s, 'gatewaylanes')
       n.anonymousping = config.getint(s, 'anonymousping')
       n.badloginmessages = config.getint(s, 'badloginmessages')
+      n.mboxspin = {}
+      for actortype in [ACTOR_TRANSACTIONAGENT, ACTOR_ENGINE,
+                        ACTOR_USERSCHEMAMGR, ACTOR_OBGATEWAY]:
+        key = 'mboxspin_' + actortype.split('_')[1].lower()
+        n.mboxspin[actortype] = MBOXSPINDEFAULT
+        if config.has_option(s, key):
+          n.mboxspin[actortype] = config.getint(s, key)
+      n.taplacementmargin = 200
+      if config.has_option(s, 'taplacementmargin'):
+        n.taplacementmargin = config.getint(s, 'taplacementmargin')
+      n.tamigrate = 0
+      if config.has_option(s, 'tamigrate'):
+        n.tamigrate = config.getint(s, 'tamigrate')
       n.replica = config.getint(s, 'replica')
       n.member = config.getint(s, 'member')
       n.pghost = config.get(s, 'pghost')
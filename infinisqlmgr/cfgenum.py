@@ -22,7 +22,9 @@ cfgforwarddict = {
   'CMDLISTENER': 9,
   'CMDIBGATEWAY': 16,
   'CMDSET': 4,
-  'CMDPGHANDLER': 21
+  'CMDPGHANDLER': 21,
+  'CMDMBOXSPIN': 22,
+  'CMDTAPLACEMENT': 23
 }
 
 cfgreversedict = {
@@ -45,7 +47,9 @@ cfgreversedict = {
   9: 'CMDLISTENER',
   16: 'CMDIBGATEWAY',
   4: 'CMDSET',
-  21: 'CMDPGHANDLER'
+  21: 'CMDPGHANDLER',
+  22: 'CMDMBOXSPIN',
+  23: 'CMDTAPLACEMENT'
 }
 
 actortypesforwarddict = {
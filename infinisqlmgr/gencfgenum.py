@@ -40,7 +40,9 @@ cfgdict = {
     'CMDLOCALCONFIG': 18,
     'CMDGETTOPOLOGYMGRMBOXPTR': 19,
     'CMDOBGATEWAY': 20,
-    'CMDPGHANDLER': 21
+    'CMDPGHANDLER': 21,
+    'CMDMBOXSPIN': 22,
+    'CMDTAPLACEMENT': 23
 }
 
 actortypesdict = {
@@ -92,6 +94,8 @@ for k in actortypesdict.keys():
 cheader.write('\n};\n\n')
 
 cheader.write('#define FIRSTACTORID ' + str(firstactorid + 1))
+cheader.write('\n#define NUMACTORTYPES ' +
+              str(max(actortypesdict.values()) + 1))
 
 cheader.write('\n\
 \n\
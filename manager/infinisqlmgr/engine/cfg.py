@@ -22,6 +22,8 @@ CMD_LOCALCONFIG=18
 CMD_GETTOPOLOGYMGRMBOXPTR=19
 CMD_OBGATEWAY=20
 CMD_PGHANDLER=21
+CMD_MBOXSPIN=22
+CMD_TAPLACEMENT=23
 
 ACTOR_NONE=0
 ACTOR_TOPOLOGYMGR=1
@@ -66,7 +66,9 @@ cfg_dict = {
     'CMDLOCALCONFIG': 18,
     'CMDGETTOPOLOGYMGRMBOXPTR': 19,
     'CMDOBGATEWAY': 20,
-    'CMDPGHANDLER': 21
+    'CMDPGHANDLER': 21,
+    'CMDMBOXSPIN': 22,
+    'CMDTAPLACEMENT': 23
 }
 
 actor_types_dict = {
@@ -99,6 +101,8 @@ with open('infinisql_cfgenum.h', 'w') as cheader:
     cheader.write(actor_body)
     cheader.write('\n};\n\n')
     cheader.write('#define FIRSTACTORID ' + str(firstactorid + 1))
+    cheader.write('\n#define NUMACTORTYPES ' +
+                  str(max(actor_types_dict.values()) + 1))
     cheader.write(cheader_bot)
 
 cfg_path = os.path.join(os.path.dirname(__file__), "engine", "cfg.py")
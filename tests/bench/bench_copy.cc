@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "Pg.h"
+#include "Table.h"
+#include "src/test_copy.h"
+#include "src/timing.h"
+
+#define COPYROWS 1000000
+#define COPYDATASIZE 65536
+
+/* rows/s through COPY FROM parsing and row assembly, as Pg does
+ * before batching rows by engine */
+static void loadThroughput(const char *name, const char *stmt,
+		const std::string &data) {
+	Table table(1);
+	table.addfield(INT, 0, "id", UNIQUENOTNULL);
+	table.addfield(VARCHAR, 0, "name", NONE);
+	table.addfield(FLOAT, 0, "score", NONE);
+	table.addfield(BOOL, 0, "flag", NONE);
+
+	Pg::copy_s copy = copyOf(stmt);
+	std::vector<std::vector<fieldValue_s> > rows;
+	std::string row;
+	size_t nrows = 0;
+	uint64_t start = nowns();
+	for (size_t pos = 0; pos <= data.size(); pos += COPYDATASIZE) {
+		copy.buf.append(data, pos, COPYDATASIZE);
+		bool isfinal = pos + COPYDATASIZE > data.size();
+		ASSERT_TRUE(Pg::parseCopyData(copy, isfinal, rows));
+		for (size_t n = 0; n < rows.size(); n++) {
+			ASSERT_TRUE(table.makerow(&rows[n], &row));
+		}
+		nrows += rows.size();
+		rows.clear();
+	}
+	uint64_t elapsed = nowns() - start;
+
+	printf("copy %s %lu rows %lu MB %lu rows/s\n", name, (unsigned long)nrows,
+			(unsigned long)(data.size() >> 20),
+			(unsigned long)(nrows * 1000000000 / elapsed));
+	EXPECT_EQ((size_t)COPYROWS, nrows);
+}
+
+TEST(CopyBench, LoadThroughput) {
+	std::string text, csv, binary("PGCOPY\n\377\r\n", 11);
+	putInt32(binary, 0);
+	putInt32(binary, 0);
+	char line[128];
+	for (int64_t n = 0; n < COPYROWS; n++) {
+		text.append(line, sprintf(line, "%li\tname %li\t%li.5\t%c\n", n, n, n,
+				n % 2 ? 't' : 'f'));
+		csv.append(line, sprintf(line, "%li,\"name, %li\",%li.5,%s\n", n, n,
+				n, n % 2 ? "true" : "false"));
+		sprintf(line, "name %li", n);
+		putBinaryRow(binary, n, line, n + 0.5, n % 2);
+	}
+	putInt16(binary, -1);
+
+	loadThroughput("text", "COPY t FROM STDIN", text);
+	loadThroughput("csv", "COPY t FROM STDIN CSV", csv);
+	loadThroughput("binary", "COPY t FROM STDIN BINARY", binary);
+}
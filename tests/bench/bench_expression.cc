@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+#include "src/test_expression.h"
+#include "src/timing.h"
+
+class ExpressionBench: public ExpressionTest {
+};
+
+/* SET score = score * 1.5 + id for every row of an UPDATE */
+TEST_F(ExpressionBench, RowThroughput) {
+	Ast *ast = op(OPERATOR_ADDITION,
+			op(OPERATOR_MULTIPLICATION, field(2), floating(1.5)), field(0));
+	Expression expr;
+	ASSERT_TRUE(expr.compile(ast, table));
+	delete ast;
+
+	fieldValue_s result = {};
+	long double sum = 0;
+	size_t n;
+	uint64_t start = nowns();
+	for (n = 0; n < 1000000; n++) {
+		setRow(n, "", 2);
+		ASSERT_TRUE(expr.evaluate(row, parameters, FLOAT, result));
+		sum += result.value.floating;
+	}
+	uint64_t elapsed = nowns() - start;
+	printf("expression %lu ns/row\n", (unsigned long)(elapsed / n));
+	EXPECT_EQ((long double)n * 3 + (long double)n * (n - 1) / 2, sum);
+}
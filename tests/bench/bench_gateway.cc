@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include "Mbox.h"
+#include "ObGateway.h"
+#include "IbGateway.h"
+#include "src/timing.h"
+
+/* two processes on localhost, node 1 sending to node 2 through running
+ * ObGateway and IbGateway actors. Lane n is ObGateway n connected to
+ * IbGateway n, picked by Mboxes::obGatewayFor() from the destination
+ * actorid, with one producer thread and one consuming actor per lane */
+
+#define LANEMSGS 2000000
+#define SENDERNODE 1
+#define RECEIVERNODE 2
+
+struct laneArgs {
+	int16_t actorid; /* consumer on the receiving node */
+	size_t nmsgs;
+	class Mbox *mbox;
+};
+
+static void *laneSend(void *arg) {
+	laneArgs &args = *(laneArgs *)arg;
+	class Mboxes mboxes(SENDERNODE);
+	class Topology top;
+	mboxes.update(top);
+	Topology::addressStruct source = { SENDERNODE, args.actorid };
+	Topology::addressStruct dest = { RECEIVERNODE, args.actorid };
+
+	for (size_t n = 0; n < args.nmsgs; n++) {
+		MessageSubtransactionCmd *msg = new MessageSubtransactionCmd;
+		msg->messageStruct.payloadtype = PAYLOADSUBTRANSACTION;
+		msg->row = std::string(100, 'r');
+		msg->returnRows.push_back({ 42, 7, WRITELOCK, std::string(100, 'r') });
+		mboxes.toActor(source, dest, *msg);
+	}
+	mboxes.sendObBatch();
+	return NULL;
+}
+
+/* consuming actor, the Mbox deletes what it handed out */
+static void *laneReceive(void *arg) {
+	laneArgs &args = *(laneArgs *)arg;
+	class Message *batch[MSGRECEIVEBATCHSIZE];
+	size_t received = 0;
+
+	while (received < args.nmsgs) {
+		size_t n = args.mbox->receiveBatch(batch, MSGRECEIVEBATCHSIZE, 100);
+		for (size_t m = 0; m < n; m++)
+			delete Message::des(((class MessageSerialized *)batch[m])->data);
+		received += n;
+	}
+	return NULL;
+}
+
+static void launch(void *(*actor)(void *), actortypes_e type, int64_t instance,
+		int16_t actorid, const std::string &argstring) {
+	Topology::actorIdentity *identity = nodeTopology.newActor(type,
+			nodeTopology.actorList[actorid].mbox, -1, argstring, actorid,
+			std::vector<std::string>(), std::vector<std::string>());
+	identity->instance = instance;
+	pthread_t tid;
+	pthread_create(&tid, NULL, actor, identity);
+}
+
+static void addActor(actortypes_e type, int64_t instance) {
+	Topology::actor_s actor = { type, instance, new class Mbox };
+	nodeTopology.actorList.push_back(actor);
+}
+
+/* free loopback port for an IbGateway */
+static std::string freePort() {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addrlen = sizeof(addr);
+	bind(fd, (struct sockaddr *)&addr, addrlen);
+	getsockname(fd, (struct sockaddr *)&addr, &addrlen);
+	close(fd);
+	char hostport[32];
+	snprintf(hostport, sizeof(hostport), "127.0.0.1:%u", ntohs(addr.sin_port));
+	return hostport;
+}
+
+static bool listening(const std::string &hostport) {
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(atoi(hostport.c_str() + hostport.find(':') + 1));
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	bool rv = connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+	close(fd);
+	return rv;
+}
+
+/* IbGateways at actorids 0..nlanes-1, consumers after them, so that the
+ * consumer of lane n is n modulo nlanes. Writes to readyfd once every
+ * IbGateway listens, exits once every message is consumed */
+static void receiverNode(const std::vector<std::string> &hostports,
+		size_t lanemsgs, int readyfd) {
+	size_t nlanes = hostports.size();
+	nodeTopology.nodeid = RECEIVERNODE;
+	nodeTopology.numengines = nlanes;
+	for (size_t n = 0; n < nlanes; n++)
+		addActor(ACTOR_IBGATEWAY, n);
+	for (size_t n = 0; n < nlanes; n++)
+		addActor(ACTOR_ENGINE, n);
+	for (size_t n = 0; n < nlanes; n++)
+		launch(ibGateway, ACTOR_IBGATEWAY, n, n, hostports[n]);
+	for (size_t n = 0; n < nlanes; n++)
+		while (!listening(hostports[n]))
+			usleep(1000);
+
+	std::vector<pthread_t> tids(nlanes);
+	std::vector<laneArgs> args(nlanes);
+	for (size_t n = 0; n < nlanes; n++) {
+		int16_t actorid = nlanes + n;
+		args[n] = { actorid, lanemsgs, nodeTopology.actorList[actorid].mbox };
+		pthread_create(&tids[n], NULL, laneReceive, &args[n]);
+	}
+	char ready = 1;
+	if (write(readyfd, &ready, 1) != 1)
+		_exit(1);
+	for (size_t n = 0; n < nlanes; n++)
+		pthread_join(tids[n], NULL);
+	_exit(0);
+}
+
+/* ObGateways at actorids 0..nlanes-1, each connecting to its IbGateway,
+ * stays up writing until killed */
+static void senderNode(const std::vector<std::string> &hostports,
+		size_t lanemsgs) {
+	size_t nlanes = hostports.size();
+	nodeTopology.nodeid = SENDERNODE;
+	nodeTopology.numobgateways = nlanes;
+	nodeTopology.ibGateways[RECEIVERNODE] = hostports;
+	for (size_t n = 0; n < nlanes; n++)
+		addActor(ACTOR_OBGATEWAY, n);
+	for (size_t n = 0; n < nlanes; n++)
+		launch(obGateway, ACTOR_OBGATEWAY, n, n, std::string());
+
+	std::vector<pthread_t> tids(nlanes);
+	std::vector<laneArgs> args(nlanes);
+	for (size_t n = 0; n < nlanes; n++) {
+		args[n] = { (int16_t)(nlanes + n), lanemsgs, NULL };
+		pthread_create(&tids[n], NULL, laneSend, &args[n]);
+	}
+	for (size_t n = 0; n < nlanes; n++)
+		pthread_join(tids[n], NULL);
+	while (1)
+		pause();
+}
+
+/* returns msgs/s from first send until receiver consumed every message */
+static uint64_t runLanes(size_t nlanes) {
+	std::vector<std::string> hostports(nlanes);
+	for (size_t n = 0; n < nlanes; n++)
+		hostports[n] = freePort();
+	size_t lanemsgs = LANEMSGS / nlanes;
+	int readyfds[2];
+	if (pipe(readyfds))
+		return 0;
+
+	logfile = stderr;
+	pid_t receiver = fork();
+	if (receiver == 0) {
+		/* a lane that loses messages fails rather than hangs */
+		alarm(120);
+		receiverNode(hostports, lanemsgs, readyfds[1]);
+	}
+	char ready;
+	bool isready = read(readyfds[0], &ready, 1) == 1;
+	close(readyfds[0]);
+	close(readyfds[1]);
+
+	uint64_t start = nowns();
+	pid_t sender = fork();
+	if (sender == 0)
+		senderNode(hostports, lanemsgs);
+	int status;
+	waitpid(receiver, &status, 0);
+	uint64_t elapsed = nowns() - start;
+	kill(sender, SIGKILL);
+	waitpid(sender, NULL, 0);
+
+	EXPECT_TRUE(isready);
+	EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	return nlanes * lanemsgs * 1000000000 / elapsed;
+}
+
+/* throughput against lane count */
+TEST(GatewayBench, LaneScaling) {
+	for (size_t nlanes = 1; nlanes <= 8; nlanes *= 2) {
+		printf("lanes %lu %lu msgs/s\n", (unsigned long)nlanes,
+				(unsigned long)runLanes(nlanes));
+	}
+}
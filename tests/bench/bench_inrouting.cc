@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "src/test_inrouting.h"
+#include "src/timing.h"
+
+class InRoutingBench: public InRoutingTest {
+};
+
+/* 100 value IN lookup on 64 partitions, each holding 10000 rows, against
+ * sending the whole list to every partition */
+TEST_F(InRoutingBench, HundredValueLookup) {
+	const int64_t partitions = 64;
+	const int64_t rows = 640000;
+	std::vector<Index> indices(partitions);
+	for (int64_t n = 0; n < partitions; n++)
+		indices[n].makeindex(UNIQUENOTNULL, INT);
+
+	for (int64_t rowid = 0; rowid < rows; rowid++) {
+		fieldValue_s val = {};
+		val.value.integer = rowid * 7919;
+		int64_t engineid = Transaction::getEngineid(&table, 0, &val);
+		lockingIndexEntry entry = {rowid, engineid, 0, 0};
+		(*indices[engineid].uniqueIntIndex)[val.value.integer] = entry;
+	}
+
+	std::vector<fieldValue_s> values = intValues(100);
+	const int lookups = 200;
+
+	uint64_t start = nowns();
+	size_t broadcasthits = 0, broadcastbytes = 0, broadcastmsgs = 0;
+	for (int l = 0; l < lookups; l++) {
+		for (int64_t n = 0; n < partitions; n++) {
+			MessageSubtransactionCmd msg;
+			msg.searchParameters.op = OPERATOR_IN;
+			msg.searchParameters.values = values;
+			broadcastbytes += msg.size();
+			broadcastmsgs++;
+			std::vector<indexEntry_s> hits;
+			for (size_t v = 0; v < values.size(); v++)
+				indices[n].getequal(values[v].value.integer, &hits);
+			broadcasthits += hits.size();
+		}
+	}
+	uint64_t broadcast = nowns() - start;
+
+	start = nowns();
+	size_t routedhits = 0, routedbytes = 0, routedmsgs = 0;
+	for (int l = 0; l < lookups; l++) {
+		std::vector<fieldValue_s> list = values;
+		enginevalues_t enginevalues;
+		Transaction::partitionValues(&table, 0, list, enginevalues);
+		enginevalues_t::iterator it;
+		for (it = enginevalues.begin(); it != enginevalues.end(); it++) {
+			MessageSubtransactionCmd msg;
+			msg.searchParameters.op = OPERATOR_IN;
+			msg.searchParameters.values.swap(it->second);
+			routedbytes += msg.size();
+			routedmsgs++;
+			std::vector<indexEntry_s> hits;
+			std::vector<fieldValue_s> &mine = msg.searchParameters.values;
+			for (size_t v = 0; v < mine.size(); v++)
+				indices[it->first].getequal(mine[v].value.integer, &hits);
+			routedhits += hits.size();
+		}
+	}
+	uint64_t routed = nowns() - start;
+
+	EXPECT_EQ((size_t)lookups * 100, broadcasthits);
+	EXPECT_EQ(broadcasthits, routedhits);
+	EXPECT_EQ((size_t)lookups * partitions, broadcastmsgs);
+	EXPECT_LE(routedmsgs, broadcastmsgs);
+	EXPECT_LT(routedbytes * 10, broadcastbytes);
+	printf("100 value IN on 64 partitions: routed %lu msgs %lu bytes %lu us, "
+	       "broadcast %lu msgs %lu bytes %lu us\n",
+	       (unsigned long)(routedmsgs / lookups),
+	       (unsigned long)(routedbytes / lookups),
+	       (unsigned long)(routed / 1000 / lookups),
+	       (unsigned long)(broadcastmsgs / lookups),
+	       (unsigned long)(broadcastbytes / lookups),
+	       (unsigned long)(broadcast / 1000 / lookups));
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "src/test_mbox.h"
+
+class MboxBench: public MboxTest {
+
+protected:
+	void report(const char *name, const std::vector<uint64_t> &latencies) {
+		printf("%s spin %li hops %lu p50 %lu ns p99 %lu ns\n", name,
+				(long)cfgs.mboxspin[ACTOR_ENGINE],
+				(unsigned long)latencies.size(),
+				(unsigned long)latencies[latencies.size() / 2],
+				(unsigned long)latencies[latencies.size() * 99 / 100]);
+	}
+};
+
+/* idle producer leaves consumer parked between messages,
+ * saturated producers keep the queue non-empty */
+TEST_F(MboxBench, HopLatency) {
+	int64_t spins[] = { 0, MBOXSPINDEFAULT };
+	for (size_t n = 0; n < sizeof(spins) / sizeof(*spins); n++) {
+		cfgs.mboxspin[ACTOR_ENGINE] = spins[n];
+		std::vector<uint64_t> idle = hop(1, 2000, 200);
+		report("idle", idle);
+		std::vector<uint64_t> saturated = hop(4, 50000, 0);
+		report("saturated", saturated);
+		EXPECT_EQ(2000U, idle.size());
+		EXPECT_EQ(200000U, saturated.size());
+	}
+	cfgs.mboxspin[ACTOR_ENGINE] = MBOXSPINDEFAULT;
+}
+
+/* A/B: pooled Message allocation vs plain malloc/free */
+TEST_F(MboxBench, PoolThroughput) {
+	cfgs.mboxspin[ACTOR_ENGINE] = MBOXSPINDEFAULT;
+	bool modes[] = { false, true };
+	for (size_t n = 0; n < sizeof(modes) / sizeof(*modes); n++) {
+		cfgs.messagepool = modes[n];
+		MessagePool::stats_s before, after;
+		MessagePool::getStats(before);
+		uint64_t start = nowns();
+		std::vector<uint64_t> latencies = hop(4, 50000, 0);
+		uint64_t elapsed = nowns() - start;
+		MessagePool::getStats(after);
+		printf("messagepool %i %lu ns/msg hits %lu misses %lu bypasses %lu\n",
+				modes[n], (unsigned long)(elapsed / latencies.size()),
+				(unsigned long)(after.hits - before.hits),
+				(unsigned long)(after.misses - before.misses),
+				(unsigned long)(after.bypasses - before.bypasses));
+		EXPECT_EQ(200000U, latencies.size());
+	}
+	cfgs.messagepool = true;
+}
+
+/* producer contention, build with -DMBOXVYUKOV to compare queues */
+TEST_F(MboxBench, ProducerContention) {
+	cfgs.mboxspin[ACTOR_ENGINE] = MBOXSPINDEFAULT;
+#ifdef MBOXVYUKOV
+	const char *queue = "vyukov";
+#else
+	const char *queue = "michael-scott";
+#endif
+	for (size_t nproducers = 2; nproducers <= 64; nproducers *= 2) {
+		size_t nmsgs = 256000 / nproducers;
+		uint64_t start = nowns();
+		std::vector<uint64_t> latencies = hop(nproducers, nmsgs, 0);
+		uint64_t elapsed = nowns() - start;
+		printf("%s producers %lu %lu ns/msg\n", queue,
+				(unsigned long)nproducers,
+				(unsigned long)(elapsed / latencies.size()));
+		EXPECT_EQ(nproducers * nmsgs, latencies.size());
+	}
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "Message.h"
+#include "src/test_message.h"
+#include "src/timing.h"
+
+/* pgbench-style: one row in, one row out */
+static MessageSubtransactionCmd *smallSubtransaction() {
+	MessageSubtransactionCmd *msg = new MessageSubtransactionCmd;
+	msg->messageStruct.payloadtype = PAYLOADSUBTRANSACTION;
+	msg->row = std::string(100, 'r');
+	msg->indexHits.push_back({ 42, 1 });
+	msg->returnRows.push_back({ 42, 7, WRITELOCK, std::string(100, 'r') });
+	return msg;
+}
+
+/* string per message then copied into the send buffer, as
+ * ObGateway used to, vs sized once and packaged in place in an arena */
+static void serThroughput(const char *name, Message &msg, size_t iterations) {
+	std::string sendbuf;
+	uint64_t start = nowns();
+	for (size_t n = 0; n < iterations; n++) {
+		std::string *serstr = msg.sermsg();
+		size_t ms = serstr->size();
+		sendbuf.append((const char *)&ms, sizeof(ms));
+		sendbuf.append(*serstr);
+		delete serstr;
+		if (sendbuf.size() > SERIALIZEDMAXSIZE) {
+			sendbuf.clear();
+		}
+	}
+	uint64_t perstring = nowns() - start;
+
+	std::string arena;
+	start = nowns();
+	for (size_t n = 0; n < iterations; n++) {
+		msg.sermsg(arena);
+		if (arena.size() > SERIALIZEDMAXSIZE) {
+			arena.clear();
+		}
+	}
+	uint64_t inarena = nowns() - start;
+
+	std::string *serstr = msg.sermsg();
+	size_t bytes = serstr->size();
+	start = nowns();
+	for (size_t n = 0; n < iterations; n++) {
+		delete Message::des(new std::string(*serstr));
+	}
+	uint64_t des = nowns() - start;
+	delete serstr;
+
+	printf("%s %lu bytes ser string %lu ns arena %lu ns (%lu MB/s) des %lu ns\n",
+			name, (unsigned long)bytes,
+			(unsigned long)(perstring / iterations),
+			(unsigned long)(inarena / iterations),
+			(unsigned long)(bytes * iterations * 1000 / (inarena + 1)),
+			(unsigned long)(des / iterations));
+}
+
+TEST(MessageBench, SerializationThroughput) {
+	MessageSubtransactionCmd *small = smallSubtransaction();
+	serThroughput("subtransaction small", *small, 200000);
+	delete small;
+
+	MessageSubtransactionCmd *large = largeSubtransaction(5000);
+	serThroughput("subtransaction large", *large, 200);
+	delete large;
+
+	MessageCommitRollback *rollback = commitRollback(5000);
+	serThroughput("commitrollback large", *rollback, 200);
+	delete rollback;
+}
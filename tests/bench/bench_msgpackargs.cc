@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "defs.h"
+#include "src/timing.h"
+
+/* decode a login-sized request and pack its reply, as the native
+ * protocol fast path does per request */
+TEST(MsgpackArgsBench, Throughput) {
+	std::vector<std::string> request;
+	request.push_back("benchmark");
+	request.push_back("12345");
+	request.push_back("payload value");
+	std::string buf, out;
+	vector2Msgpack(request, buf);
+	std::vector<argView_s> views;
+	std::vector<std::string> response(1);
+	size_t total = 0;
+	uint64_t start = nowns();
+	for (int n = 0; n < 1000000; n++) {
+		ASSERT_TRUE(msgpack2ArgViews(views, buf.data(), buf.size()));
+		response[0].assign(views[1].data, views[1].size);
+		out.resize(16);
+		vector2Msgpack(response, out);
+		total += out.size();
+	}
+	uint64_t elapsed = nowns() - start;
+	printf("native args decode+pack %lu ns/request\n",
+			(unsigned long)(elapsed / 1000000));
+	EXPECT_EQ(1000000U * 23, total);
+}
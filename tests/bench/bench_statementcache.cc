@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "StatementCache.h"
+#include "src/timing.h"
+
+/* normalize and look up a repeated OLTP query, the work a cache
+ * hit does instead of flex/bison and name resolution */
+TEST(StatementCacheBench, HitThroughput) {
+	StatementCache cache(STATEMENTCACHESIZE);
+	std::string key;
+	std::vector<std::string> params;
+	class Statement *stmtPtr;
+	char query[128];
+	size_t hits = 0;
+	size_t n;
+	uint64_t start = nowns();
+	for (n = 0; n < 1000000; n++) {
+		sprintf(query, "SELECT id, name, score FROM t WHERE id = %lu", (unsigned long)n);
+		ASSERT_TRUE(StatementCache::normalize(query, key, params));
+		if (cache.get(1, key, &stmtPtr)) {
+			hits++;
+		} else {
+			cache.put(1, key, NULL);
+		}
+	}
+	uint64_t elapsed = nowns() - start;
+	printf("statement cache %lu ns/query hit ratio %.6f\n",
+			(unsigned long)(elapsed / n), (double)hits / n);
+	EXPECT_EQ(n - 1, hits);
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "Index.h"
+
+static bool scalar(operatortypes_e op, int64_t x, int64_t a, int64_t b) {
+	switch (op) {
+	case OPERATOR_EQ: return x == a;
+	case OPERATOR_NE: return x != a;
+	case OPERATOR_LT: return x < a;
+	case OPERATOR_GT: return x > a;
+	case OPERATOR_LTE: return x <= a;
+	case OPERATOR_GTE: return x >= a;
+	case OPERATOR_BETWEEN: return x >= a && x <= b;
+	case OPERATOR_NOTBETWEEN: return x < a || x > b;
+	default: return false;
+	}
+}
+
+static std::set<int64_t> rowids(const std::vector<indexEntry_s> &entries) {
+	std::set<int64_t> s;
+	for (size_t n = 0; n < entries.size(); n++)
+		s.insert(entries[n].rowid);
+	return s;
+}
+
+TEST(ColumnBatchTest, Kernels) {
+	const operatortypes_e ops[] = {OPERATOR_EQ, OPERATOR_NE, OPERATOR_LT,
+		OPERATOR_GT, OPERATOR_LTE, OPERATOR_GTE, OPERATOR_BETWEEN,
+		OPERATOR_NOTBETWEEN};
+
+	/* sizes straddling bitmap words */
+	const size_t sizes[] = {0, 1, 63, 64, 65, 1000};
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		ColumnBatch<int64_t> batch;
+		for (size_t n = 0; n < sizes[s]; n++)
+			batch.append((int64_t)(n * 7919 % 101) - 50, n, n % 4);
+
+		for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+			ASSERT_TRUE(batch.select(ops[o], -10, 20));
+			std::vector<indexEntry_s> out;
+			batch.emit(&out);
+			std::vector<int64_t> expected;
+			for (size_t n = 0; n < batch.size(); n++)
+				if (scalar(ops[o], batch.values[n], -10, 20))
+					expected.push_back(n);
+			ASSERT_EQ(expected.size(), out.size());
+			EXPECT_EQ(expected.size(), batch.count());
+			for (size_t n = 0; n < out.size(); n++) {
+				EXPECT_EQ(expected[n], out[n].rowid);
+				EXPECT_EQ(expected[n] % 4, out[n].engineid);
+			}
+		}
+	}
+
+	ColumnBatch<int64_t> batch;
+	EXPECT_FALSE(batch.select(OPERATOR_LIKE, 0, 0));
+}
+
+TEST(ColumnBatchTest, In) {
+	ColumnBatch<char> batch;
+	for (int n = 0; n < 200; n++)
+		batch.append((char)(n % 50), n, 0);
+
+	/* short list compared inline, long list binary searched */
+	std::vector<char> shortList;
+	shortList.push_back(3);
+	shortList.push_back(47);
+	std::vector<char> longList;
+	for (char c = 0; c < 40; c += 2)
+		longList.push_back(c);
+
+	batch.selectIn(shortList, false);
+	EXPECT_EQ(8U, batch.count());
+	batch.selectIn(shortList, true);
+	EXPECT_EQ(192U, batch.count());
+	batch.selectIn(longList, false);
+	EXPECT_EQ(80U, batch.count());
+	batch.selectIn(longList, true);
+	EXPECT_EQ(120U, batch.count());
+
+	ColumnBatch<long double> floats;
+	floats.append(1.5, 1, 0);
+	floats.append(2.5, 2, 0);
+	floats.append(-3.25, 3, 0);
+	ASSERT_TRUE(floats.select(OPERATOR_GT, 0, 0));
+	std::vector<indexEntry_s> out;
+	floats.emit(&out);
+	EXPECT_EQ((std::set<int64_t>{1, 2}), rowids(out));
+}
+
+/* unordered indices used to return nothing for <, >, and BETWEEN */
+TEST(ColumnBatchTest, UnorderedIndex) {
+	Index index;
+	index.makeindex(UNORDERED, INT);
+	Index ordered;
+	ordered.makeindex(UNIQUE, INT);
+	for (int64_t n = 0; n < 10000; n++) {
+		lockingIndexEntry entry = {n, (int16_t)(n % 8), 0, 0};
+		(*index.unorderedIntIndex)[n - 5000] = entry;
+		(*ordered.uniqueIntIndex)[n - 5000] = entry;
+	}
+
+	std::vector<indexEntry_s> out, expected;
+	index.comparison((int64_t)100, OPERATOR_LT, &out);
+	ordered.comparison((int64_t)100, OPERATOR_LT, &expected);
+	EXPECT_EQ(5100U, out.size());
+	EXPECT_EQ(rowids(expected), rowids(out));
+
+	out.clear();
+	expected.clear();
+	index.between((int64_t)-20, (int64_t)20, &out);
+	ordered.between((int64_t)-20, (int64_t)20, &expected);
+	EXPECT_EQ(41U, out.size());
+	EXPECT_EQ(rowids(expected), rowids(out));
+
+	out.clear();
+	expected.clear();
+	index.notbetween((int64_t)-4000, (int64_t)4000, &out);
+	ordered.notbetween((int64_t)-4000, (int64_t)4000, &expected);
+	EXPECT_EQ(1999U, out.size());
+	EXPECT_EQ(rowids(expected), rowids(out));
+
+	std::vector<int64_t> list;
+	list.push_back(-5000);
+	list.push_back(0);
+	list.push_back(123456);
+	out.clear();
+	expected.clear();
+	index.getnotin(list, &out);
+	ordered.getnotin(list, &expected);
+	EXPECT_EQ(9998U, out.size());
+	EXPECT_EQ(rowids(expected), rowids(out));
+
+	out.clear();
+	index.getnotequal((int64_t)0, &out);
+	EXPECT_EQ(9999U, out.size());
+	EXPECT_EQ(0U, rowids(out).count(5000));
+}
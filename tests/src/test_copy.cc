@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "Pg.h"
+#include "Table.h"
+#include "test_copy.h"
+
+TEST(CopyTest, ParseStatement) {
+	Pg::copy_s copy = Pg::copy_s();
+	std::string tablename, query;
+	std::vector<std::string> columns;
+	ASSERT_TRUE(Pg::parseCopy("COPY t (a, \"B\") FROM STDIN WITH (FORMAT csv, HEADER, DELIMITER ';');",
+			copy, tablename, columns, query));
+	EXPECT_TRUE(copy.isfrom);
+	EXPECT_EQ('c', copy.format);
+	EXPECT_EQ(';', copy.delimiter);
+	EXPECT_EQ('"', copy.quote);
+	EXPECT_TRUE(copy.isheader);
+	EXPECT_EQ("", copy.nullstr);
+	EXPECT_EQ("t", tablename);
+	ASSERT_EQ(2U, columns.size());
+	EXPECT_EQ("B", columns[1]);
+
+	copy = Pg::copy_s();
+	columns.clear();
+	ASSERT_TRUE(Pg::parseCopy("copy t from stdin binary", copy, tablename,
+			columns, query));
+	EXPECT_EQ('b', copy.format);
+
+	copy = Pg::copy_s();
+	ASSERT_TRUE(Pg::parseCopy("COPY (SELECT a FROM t WHERE b = ')') TO STDOUT WITH CSV",
+			copy, tablename, columns, query));
+	EXPECT_FALSE(copy.isfrom);
+	EXPECT_EQ("SELECT a FROM t WHERE b = ')'", query);
+
+	copy = Pg::copy_s();
+	query.clear();
+	ASSERT_TRUE(Pg::parseCopy("COPY t TO STDOUT DELIMITER AS E'\\t' NULL AS 'nil'",
+			copy, tablename, columns, query));
+	EXPECT_EQ('t', copy.format);
+	EXPECT_EQ('\t', copy.delimiter);
+	EXPECT_EQ("nil", copy.nullstr);
+
+	copy = Pg::copy_s();
+	EXPECT_FALSE(Pg::parseCopy("COPY t FROM '/etc/passwd'", copy, tablename,
+			columns, query));
+	EXPECT_FALSE(Pg::parseCopy("COPY (SELECT 1) FROM STDIN", copy, tablename,
+			columns, query));
+}
+
+TEST(CopyTest, TextRows) {
+	Pg::copy_s copy = copyOf("COPY t FROM STDIN");
+	std::vector<std::vector<fieldValue_s> > rows;
+	copy.buf = "1\tone\\ttab\t1.5\tt\n2\t\\N\t-3\tf\r\n3\tpart";
+	ASSERT_TRUE(Pg::parseCopyData(copy, false, rows));
+	ASSERT_EQ(2U, rows.size());
+	EXPECT_EQ(1, rows[0][0].value.integer);
+	EXPECT_EQ("one\ttab", rows[0][1].str);
+	EXPECT_EQ(1.5, rows[0][2].value.floating);
+	EXPECT_TRUE(rows[0][3].value.boolean);
+	EXPECT_TRUE(rows[1][1].isnull);
+	EXPECT_FALSE(rows[1][3].value.boolean);
+	EXPECT_EQ("3\tpart", copy.buf);
+
+	/* rest of the row arrives in the next CopyData */
+	rows.clear();
+	copy.buf.append("ial\\x41\\101\t0\t1\n\\.\nignored");
+	ASSERT_TRUE(Pg::parseCopyData(copy, false, rows));
+	ASSERT_EQ(1U, rows.size());
+	EXPECT_EQ("partialAA", rows[0][1].str);
+	EXPECT_TRUE(copy.isdone);
+
+	copy = copyOf("COPY t FROM STDIN");
+	copy.buf = "x\ty\t1\tt\n";
+	EXPECT_FALSE(Pg::parseCopyData(copy, false, rows));
+	copy = copyOf("COPY t FROM STDIN");
+	copy.buf = "1\ty\t1\n";
+	EXPECT_FALSE(Pg::parseCopyData(copy, false, rows));
+}
+
+TEST(CopyTest, CsvRows) {
+	Pg::copy_s copy = copyOf("COPY t FROM STDIN CSV HEADER");
+	std::vector<std::vector<fieldValue_s> > rows;
+	copy.buf = "id,name,score,flag\n1,\"multi\nline, \"\"quoted\"\"\",2.5,true\n2,,3,f\n3,\"\",4,t";
+	ASSERT_TRUE(Pg::parseCopyData(copy, false, rows));
+	ASSERT_EQ(2U, rows.size());
+	EXPECT_EQ("multi\nline, \"quoted\"", rows[0][1].str);
+	EXPECT_TRUE(rows[1][1].isnull);
+	EXPECT_EQ("3,\"\",4,t", copy.buf);
+
+	/* CopyDone, so the last row needs no newline */
+	rows.clear();
+	ASSERT_TRUE(Pg::parseCopyData(copy, true, rows));
+	ASSERT_EQ(1U, rows.size());
+	EXPECT_FALSE(rows[0][1].isnull);
+	EXPECT_EQ("", rows[0][1].str);
+	EXPECT_TRUE(copy.buf.empty());
+
+	copy = copyOf("COPY t FROM STDIN CSV");
+	copy.buf = "1,\"unterminated,2,t";
+	EXPECT_FALSE(Pg::parseCopyData(copy, true, rows));
+}
+
+TEST(CopyTest, BinaryRows) {
+	Pg::copy_s copy = copyOf("COPY t FROM STDIN (FORMAT binary)");
+	std::vector<std::vector<fieldValue_s> > rows;
+	std::string data("PGCOPY\n\377\r\n", 11);
+	putInt32(data, 0);
+	putInt32(data, 0);
+	putBinaryRow(data, 7, "seven", 7.5, true);
+	putBinaryRow(data, -8, NULL, -0.25, false);
+	putInt16(data, -1);
+
+	/* tuples split across CopyData messages */
+	for (size_t n = 0; n < data.size(); n += 5) {
+		copy.buf.append(data, n, 5);
+		ASSERT_TRUE(Pg::parseCopyData(copy, false, rows));
+	}
+	ASSERT_EQ(2U, rows.size());
+	EXPECT_EQ(7, rows[0][0].value.integer);
+	EXPECT_EQ("seven", rows[0][1].str);
+	EXPECT_EQ(7.5, rows[0][2].value.floating);
+	EXPECT_EQ(-8, rows[1][0].value.integer);
+	EXPECT_TRUE(rows[1][1].isnull);
+	EXPECT_FALSE(rows[1][3].value.boolean);
+	EXPECT_TRUE(copy.isdone);
+}
@@ -0,0 +1,48 @@
+#ifndef INFINISQLTESTCOPY_H
+#define INFINISQLTESTCOPY_H
+
+#include <gtest/gtest.h>
+#include "Pg.h"
+
+/* id INT, name VARCHAR, score FLOAT, flag BOOL */
+inline Pg::copy_s copyOf(const char *stmt) {
+	Pg::copy_s copy = Pg::copy_s();
+	std::string tablename, query;
+	std::vector<std::string> columns;
+	EXPECT_TRUE(Pg::parseCopy(stmt, copy, tablename, columns, query));
+	copy.types = { INT, VARCHAR, FLOAT, BOOL };
+	return copy;
+}
+
+inline void putInt16(std::string &buf, int16_t val) {
+	val = htobe16(val);
+	buf.append((const char *)&val, sizeof(val));
+}
+
+inline void putInt32(std::string &buf, int32_t val) {
+	val = htobe32(val);
+	buf.append((const char *)&val, sizeof(val));
+}
+
+inline void putBinaryRow(std::string &buf, int64_t id, const char *name,
+		double score, bool flag) {
+	putInt16(buf, 4);
+	putInt32(buf, sizeof(id));
+	id = htobe64(id);
+	buf.append((const char *)&id, sizeof(id));
+	if (name == NULL) {
+		putInt32(buf, -1);
+	} else {
+		putInt32(buf, strlen(name));
+		buf.append(name);
+	}
+	uint64_t bits;
+	memcpy(&bits, &score, sizeof(bits));
+	bits = htobe64(bits);
+	putInt32(buf, sizeof(bits));
+	buf.append((const char *)&bits, sizeof(bits));
+	putInt32(buf, 1);
+	buf.append(1, flag ? 1 : 0);
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "Transaction.h"
+#include "Asts.h"
+
+/* what Statement::continueSelect does for a whole table SELECT */
+static bool openCursor(Transaction::cursor_s &cursor, Statement &statement,
+		size_t hits) {
+	if (statement.iscursor == false || cursor.isopen == true)
+		return false;
+	cursor = Transaction::cursor_s();
+	cursor.isopen = true;
+	cursor.owner = statement.cursorowner;
+	cursor.hits.resize(hits);
+	return true;
+}
+
+TEST(CursorTest, InterleavedPortals) {
+	Transaction::cursor_s cursor = Transaction::cursor_s();
+	int64_t lastcursorowner = 0;
+
+	/* portal A selects a whole table, and is suspended at max rows */
+	Statement a;
+	a.iscursor = true;
+	a.cursorowner = ++lastcursorowner;
+	ASSERT_TRUE(openCursor(cursor, a, 100));
+	cursor.nexthit = 10;
+	bool ahascursor = cursor.isownedby(a.cursorowner);
+	EXPECT_TRUE(ahascursor);
+
+	/* portal B, same transaction, searches without the cursor, and its
+	 * selectRows neither fetches nor resets A's */
+	Statement b;
+	b.iscursor = true;
+	b.cursorowner = ++lastcursorowner;
+	EXPECT_FALSE(openCursor(cursor, b, 50));
+	EXPECT_FALSE(cursor.isownedby(b.cursorowner));
+	EXPECT_EQ(a.cursorowner, cursor.owner);
+	EXPECT_EQ(100U, cursor.hits.size());
+	EXPECT_EQ(10U, cursor.nexthit);
+
+	/* closing B leaves A's cursor */
+	bool bhascursor = cursor.isownedby(b.cursorowner);
+	EXPECT_FALSE(bhascursor);
+
+	/* A resumes with its own cursor, and closes it when exhausted */
+	ASSERT_TRUE(cursor.isownedby(a.cursorowner));
+	cursor.nexthit = cursor.hits.size();
+	cursor = Transaction::cursor_s();
+	EXPECT_FALSE(cursor.isownedby(a.cursorowner));
+
+	/* then a later execution may open one */
+	Statement c;
+	c.iscursor = true;
+	c.cursorowner = ++lastcursorowner;
+	EXPECT_TRUE(openCursor(cursor, c, 5));
+	EXPECT_TRUE(cursor.isownedby(c.cursorowner));
+	EXPECT_FALSE(cursor.isownedby(a.cursorowner));
+}
+
+TEST(CursorTest, ClosedCursorHasNoOwner) {
+	Transaction::cursor_s cursor = Transaction::cursor_s();
+	EXPECT_FALSE(cursor.isownedby(0));
+	Statement statement;
+	EXPECT_EQ(0, statement.cursorowner);
+	Statement copy(statement);
+	EXPECT_EQ(0, copy.cursorowner);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "test_expression.h"
+
+TEST_F(ExpressionTest, ReevaluatedPerRow) {
+	/* id * 2 + 1, tree left intact */
+	Ast *ast = op(OPERATOR_ADDITION,
+			op(OPERATOR_MULTIPLICATION, field(0), integer(2)), integer(1));
+	Expression expr;
+	ASSERT_TRUE(expr.compile(ast, table));
+	EXPECT_EQ(5U, expr.program.size());
+	EXPECT_TRUE(ast->isoperator);
+
+	fieldValue_s result = {};
+	for (int64_t id = 0; id < 10; id++) {
+		setRow(id, "", 0);
+		ASSERT_TRUE(expr.evaluate(row, parameters, INT, result));
+		EXPECT_FALSE(result.isnull);
+		EXPECT_EQ(id * 2 + 1, result.value.integer);
+	}
+
+	/* INTEGER becomes FLOAT next to FLOAT, -score / 4 */
+	Expression expr2;
+	Ast *ast2 = op(OPERATOR_DIVISION,
+			op(OPERATOR_NEGATION, NULL, field(2)), integer(4));
+	ASSERT_TRUE(expr2.compile(ast2, table));
+	setRow(1, "", 10);
+	ASSERT_TRUE(expr2.evaluate(row, parameters, FLOAT, result));
+	EXPECT_EQ(-2.5, result.value.floating);
+	ASSERT_TRUE(expr2.evaluate(row, parameters, INT, result));
+	EXPECT_EQ(-2, result.value.integer);
+
+	delete ast;
+	delete ast2;
+}
+
+TEST_F(ExpressionTest, ConcatenateAndParameters) {
+	/* name || '-' || $1 */
+	Ast *ast = op(OPERATOR_CONCATENATION,
+			op(OPERATOR_CONCATENATION, field(1), str("-")), parameter(0));
+	Expression *exprPtr = new Expression;
+	ASSERT_TRUE(exprPtr->compile(ast, table));
+	delete ast;
+	/* copies don't point into the original */
+	Expression expr = *exprPtr;
+	delete exprPtr;
+
+	parameters.push_back(std::string(1, OPERAND_STRING) + "x");
+	fieldValue_s result = {};
+	setRow(1, "abc", 0);
+	ASSERT_TRUE(expr.evaluate(row, parameters, VARCHAR, result));
+	EXPECT_EQ("abc-x", result.str);
+	setRow(2, "de", 0);
+	ASSERT_TRUE(expr.evaluate(row, parameters, VARCHAR, result));
+	EXPECT_EQ("de-x", result.str);
+
+	/* NULL in, NULL out */
+	row[1].isnull = true;
+	ASSERT_TRUE(expr.evaluate(row, parameters, VARCHAR, result));
+	EXPECT_TRUE(result.isnull);
+
+	/* strings don't go in INT fields, missing parameter */
+	row[1].isnull = false;
+	EXPECT_FALSE(expr.evaluate(row, parameters, INT, result));
+	parameters.clear();
+	EXPECT_FALSE(expr.evaluate(row, parameters, VARCHAR, result));
+}
+
+TEST_F(ExpressionTest, Errors) {
+	fieldValue_s result = {};
+	Expression expr;
+
+	Ast *ast = op(OPERATOR_DIVISION, field(0), integer(0));
+	ASSERT_TRUE(expr.compile(ast, table));
+	setRow(1, "", 0);
+	EXPECT_FALSE(expr.evaluate(row, parameters, INT, result));
+	delete ast;
+
+	/* as for INTEGER, not inf or NaN stored in the row */
+	ast = op(OPERATOR_DIVISION, field(2), floating(0));
+	ASSERT_TRUE(expr.compile(ast, table));
+	setRow(1, "", 2.5);
+	EXPECT_FALSE(expr.evaluate(row, parameters, FLOAT, result));
+	delete ast;
+
+	ast = op(OPERATOR_DIVISION, floating(1), field(0));
+	ASSERT_TRUE(expr.compile(ast, table));
+	setRow(0, "", 0);
+	EXPECT_FALSE(expr.evaluate(row, parameters, FLOAT, result));
+	delete ast;
+
+	ast = op(OPERATOR_ADDITION, field(1), floating(1.5));
+	ASSERT_TRUE(expr.compile(ast, table));
+	EXPECT_FALSE(expr.evaluate(row, parameters, FLOAT, result));
+	delete ast;
+
+	/* comparison isn't an assignment */
+	ast = op(OPERATOR_EQ, field(0), integer(1));
+	EXPECT_FALSE(expr.compile(ast, table));
+	delete ast;
+}
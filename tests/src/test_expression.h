@@ -0,0 +1,71 @@
+#ifndef INFINISQLTESTEXPRESSION_H
+#define INFINISQLTESTEXPRESSION_H
+
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "Table.h"
+#include "Asts.h"
+
+inline Ast *leaf(char type, const void *val, size_t size) {
+	std::string operand(1, type);
+	operand.append((const char *)val, size);
+	return new Ast(NULL, operand);
+}
+
+inline Ast *field(int64_t fieldid) {
+	return leaf(OPERAND_FIELDID, &fieldid, sizeof(fieldid));
+}
+
+inline Ast *integer(int64_t val) {
+	return leaf(OPERAND_INTEGER, &val, sizeof(val));
+}
+
+inline Ast *floating(long double val) {
+	return leaf(OPERAND_FLOAT, &val, sizeof(val));
+}
+
+inline Ast *str(const char *val) {
+	return leaf(OPERAND_STRING, val, strlen(val));
+}
+
+inline Ast *parameter(int64_t paramnum) {
+	return leaf(OPERAND_PARAMETER, &paramnum, sizeof(paramnum));
+}
+
+inline Ast *op(operatortypes_e type, Ast *left, Ast *right) {
+	Ast *ast = new Ast(NULL, type);
+	if (left != NULL) {
+		ast->leftchild = left;
+		left->parent = ast;
+	}
+	ast->rightchild = right;
+	right->parent = ast;
+	return ast;
+}
+
+class ExpressionTest: public ::testing::Test {
+
+protected:
+	Table table;
+	std::vector<fieldValue_s> row;
+	std::vector<std::string> parameters;
+
+	ExpressionTest() : table(1) {
+	}
+
+	virtual void SetUp() {
+		/* id INT, name VARCHAR, score FLOAT */
+		table.addfield(INT, 0, "id", UNIQUENOTNULL);
+		table.addfield(VARCHAR, 0, "name", NONE);
+		table.addfield(FLOAT, 0, "score", NONE);
+		row.resize(3);
+	}
+
+	void setRow(int64_t id, const char *name, long double score) {
+		row[0].value.integer = id;
+		row[1].str = name;
+		row[2].value.floating = score;
+	}
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "Mbox.h"
+
+#define LANES 4
+#define REMOTEACTORS 10
+
+class GatewayTest : public ::testing::Test {
+protected:
+	GatewayTest() : mboxes(1) {
+	}
+
+	virtual void SetUp() {
+		for (size_t n = 0; n < LANES; n++) {
+			lanes[n].actortype = ACTOR_OBGATEWAY;
+			producers[n] = MboxProducer(&lanes[n], 1);
+			mboxes.obGatewayPtrs.push_back(&producers[n]);
+		}
+	}
+
+	/* what each ObGateway would write to its peer, as (actorid, seq) */
+	void drainLane(size_t lane,
+			std::vector< std::pair<int16_t, int> > &out) {
+		Message *msg;
+		while ((msg = lanes[lane].receive(0)) != NULL) {
+			ASSERT_EQ(TOPIC_BATCHSERIALIZED, msg->messageStruct.topic);
+			MessageBatchSerialized &batch = *(MessageBatchSerialized *)msg;
+			for (short m = 0; m < batch.nmsgs; m++) {
+				size_t pos = batch.msgbatch[m].offset;
+				size_t s;
+				memcpy(&s, batch.arena.data() + pos, sizeof(s));
+				Message *rcv = Message::des(new std::string(batch.arena,
+							pos + sizeof(s), s));
+				ASSERT_EQ(2, rcv->messageStruct.destAddr.nodeid);
+				int16_t actorid = rcv->messageStruct.destAddr.actorid;
+				ASSERT_EQ(PAYLOADSUBTRANSACTION,
+						rcv->messageStruct.payloadtype);
+				int seq = atoi(((MessageSubtransactionCmd *)rcv)->row.c_str());
+				out.push_back(std::make_pair(actorid, seq));
+				delete rcv;
+			}
+		}
+	}
+
+	Mboxes mboxes;
+	Mbox lanes[LANES];
+	MboxProducer producers[LANES];
+};
+
+/* every message to one remote actor goes out on one lane, in order, even
+ * across full batches */
+TEST_F(GatewayTest, OneActorOneLane) {
+	const int permsgs = OBGWMSGBATCHSIZE / 2;
+	Topology::addressStruct source = {1, 3};
+	for (int seq = 0; seq < permsgs; seq++) {
+		for (int16_t actorid = 0; actorid < REMOTEACTORS; actorid++) {
+			Topology::addressStruct dest = {2, actorid};
+			MessageSubtransactionCmd *msg = new MessageSubtransactionCmd;
+			msg->messageStruct.payloadtype = PAYLOADSUBTRANSACTION;
+			msg->row = std::to_string(seq);
+			mboxes.toActor(source, dest, *msg);
+		}
+	}
+	mboxes.sendObBatch();
+
+	std::vector<int> laneof(REMOTEACTORS, -1);
+	std::vector<int> next(REMOTEACTORS, 0);
+	size_t usedlanes = 0;
+	for (size_t lane = 0; lane < LANES; lane++) {
+		std::vector< std::pair<int16_t, int> > out;
+		drainLane(lane, out);
+		if (!out.empty())
+			usedlanes++;
+		for (size_t n = 0; n < out.size(); n++) {
+			int16_t actorid = out[n].first;
+			ASSERT_GE(actorid, 0);
+			ASSERT_LT(actorid, REMOTEACTORS);
+			if (laneof[actorid] == -1)
+				laneof[actorid] = lane;
+			ASSERT_EQ((int)lane, laneof[actorid]) << "actor " << actorid;
+			ASSERT_EQ(next[actorid]++, out[n].second) << "actor " << actorid;
+		}
+	}
+
+	for (int16_t actorid = 0; actorid < REMOTEACTORS; actorid++)
+		EXPECT_EQ(permsgs, next[actorid]) << "actor " << actorid;
+	EXPECT_EQ((size_t)LANES, usedlanes);
+}
+
+TEST_F(GatewayTest, LaneByActorid) {
+	Mboxes single(1);
+	EXPECT_TRUE(single.obGatewayFor(5) == NULL);
+	EXPECT_EQ(&producers[5 % LANES], mboxes.obGatewayFor(5));
+	EXPECT_EQ(mboxes.obGatewayFor(5), mboxes.obGatewayFor(5 + LANES));
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "IbGateway.h"
+
+class IbGatewayTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		conn.capacity = 64;
+		conn.data = new char[conn.capacity];
+	}
+
+	virtual void TearDown() {
+		delete[] conn.data;
+	}
+
+	static std::string frame(size_t size, char c) {
+		std::string f(size, c);
+		size_t header = size;
+		memcpy(&f[0], &header, sizeof(header));
+		return f;
+	}
+
+	/* what readv would put in the ring, at most len bytes */
+	size_t arrive(const std::string &stream, size_t pos, size_t len) {
+		struct iovec iov[2];
+		int iovcnt = IbGateway::ringspace(conn, iov);
+		size_t total = 0;
+		for (int n = 0; n < iovcnt && total < len && pos < stream.size();
+				n++) {
+			size_t chunk = std::min(std::min(iov[n].iov_len, len - total),
+					stream.size() - pos);
+			memcpy(iov[n].iov_base, stream.data() + pos, chunk);
+			pos += chunk;
+			total += chunk;
+		}
+		conn.used += total;
+		return total;
+	}
+
+	/* what parseconnection hands to inbufhandler */
+	int parse(std::vector<std::string> &frames) {
+		const char *f;
+		size_t size;
+		int rv;
+		while ((rv = IbGateway::nextframe(conn, wrapbuf, &f, &size)) == 1)
+			frames.push_back(std::string(f, size));
+		return rv;
+	}
+
+	IbGateway::connection_s conn;
+	std::string wrapbuf;
+};
+
+/* frames of assorted sizes, some bigger than the ring, read in chunks that
+ * split headers and wrap around the end */
+TEST_F(IbGatewayTest, FramesSurviveWrapAndGrow) {
+	std::vector<std::string> expected;
+	std::string stream;
+	for (int n = 0; n < 200; n++) {
+		std::string f = frame(sizeof(size_t) + (n * 37) % 150,
+				(char)('a' + n % 26));
+		expected.push_back(f);
+		stream.append(f);
+	}
+
+	std::vector<std::string> frames;
+	size_t pos = 0;
+	int n = 0;
+	bool wrapped = false;
+	while (pos < stream.size()) {
+		pos += arrive(stream, pos, (n++ * 13) % 41 + 1);
+		if (conn.start + conn.used > conn.capacity)
+			wrapped = true;
+		ASSERT_EQ(0, parse(frames));
+		ASSERT_LE(conn.used, conn.capacity);
+	}
+
+	EXPECT_TRUE(wrapped);
+	EXPECT_GT(conn.capacity, 64U);
+	EXPECT_EQ(0U, conn.used);
+	/* emptied ring starts over at the beginning */
+	EXPECT_EQ(0U, conn.start);
+	ASSERT_EQ(expected.size(), frames.size());
+	for (size_t f = 0; f < frames.size(); f++)
+		EXPECT_TRUE(expected[f] == frames[f]) << "frame " << f;
+}
+
+TEST_F(IbGatewayTest, FrameSpansEnd) {
+	std::string first = frame(48, 'a');
+	std::string second = frame(40, 'b');
+	std::vector<std::string> frames;
+	arrive(first, 0, first.size());
+	ASSERT_EQ(0, parse(frames));
+	ASSERT_EQ(1U, frames.size());
+	EXPECT_EQ(0U, conn.start);
+
+	/* leave start mid ring, so next frame wraps */
+	arrive(first, 0, first.size());
+	arrive(second, 0, 8);
+	ASSERT_EQ(0, parse(frames));
+	EXPECT_EQ(48U, conn.start);
+	arrive(second, 8, second.size() - 8);
+	EXPECT_EQ(40U, conn.used);
+	ASSERT_EQ(0, parse(frames));
+	ASSERT_EQ(3U, frames.size());
+	EXPECT_TRUE(second == frames[2]);
+	EXPECT_TRUE(second == wrapbuf);
+	EXPECT_EQ(64U, conn.capacity);
+}
+
+TEST_F(IbGatewayTest, RingGrowsToFrame) {
+	std::string big = frame(1000, 'x');
+	std::vector<std::string> frames;
+	size_t pos = 0;
+	while (pos < big.size()) {
+		pos += arrive(big, pos, big.size());
+		ASSERT_EQ(0, parse(frames));
+	}
+	ASSERT_EQ(1U, frames.size());
+	EXPECT_TRUE(big == frames[0]);
+	EXPECT_GE(conn.capacity, big.size());
+}
+
+/* would loop forever, as start and used never advance */
+TEST_F(IbGatewayTest, UndersizedHeader) {
+	const size_t sizes[] = {0, 1, sizeof(size_t) - 1,
+		GWFRAMECOMPRESSED | 3};
+	for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+		conn.start = 0;
+		conn.used = 0;
+		std::string f(sizeof(size_t), 0);
+		memcpy(&f[0], &sizes[n], sizeof(size_t));
+		arrive(f, 0, f.size());
+		std::vector<std::string> frames;
+		EXPECT_EQ(-1, parse(frames)) << sizes[n];
+		EXPECT_TRUE(frames.empty());
+	}
+
+	/* a bare header is a valid, empty frame */
+	conn.start = 0;
+	conn.used = 0;
+	std::string empty = frame(sizeof(size_t), 0);
+	arrive(empty, 0, empty.size());
+	std::vector<std::string> frames;
+	EXPECT_EQ(0, parse(frames));
+	EXPECT_EQ(1U, frames.size());
+}
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include "test_inrouting.h"
+
+TEST_F(InRoutingTest, EachValueToItsPartition) {
+	std::vector<fieldValue_s> values = intValues(100);
+	enginevalues_t enginevalues;
+	Transaction::partitionValues(&table, 0, values, enginevalues);
+
+	size_t routed = 0;
+	enginevalues_t::iterator it;
+	for (it = enginevalues.begin(); it != enginevalues.end(); it++) {
+		ASSERT_GE(it->first, 0);
+		ASSERT_LT(it->first, 64);
+		ASSERT_FALSE(it->second.empty());
+		for (size_t n = 0; n < it->second.size(); n++)
+			EXPECT_EQ(it->first, Transaction::getEngineid(&table, 0,
+						&it->second[n]));
+		routed += it->second.size();
+	}
+	EXPECT_EQ(100U, routed);
+	EXPECT_LE(enginevalues.size(), 64U);
+}
+
+TEST_F(InRoutingTest, NullsAndStrings) {
+	std::vector<fieldValue_s> values(3, fieldValue_s());
+	values[0].isnull = true;
+	values[1].str = "bob  ";
+	values[2].str = "bob";
+	enginevalues_t enginevalues;
+	Transaction::partitionValues(&table, 1, values, enginevalues);
+
+	/* NULL never matches IN, trailing space hashes like EQ does */
+	ASSERT_EQ(1U, enginevalues.size());
+	ASSERT_EQ(2U, enginevalues.begin()->second.size());
+	EXPECT_EQ("bob", enginevalues.begin()->second[0].str);
+
+	enginevalues.clear();
+	std::vector<fieldValue_s> none;
+	Transaction::partitionValues(&table, 0, none, enginevalues);
+	EXPECT_TRUE(enginevalues.empty());
+}
@@ -0,0 +1,34 @@
+#ifndef INFINISQLTESTINROUTING_H
+#define INFINISQLTESTINROUTING_H
+
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "Transaction.h"
+
+typedef boost::unordered_map< int64_t, std::vector<fieldValue_s> > enginevalues_t;
+
+class InRoutingTest : public ::testing::Test {
+protected:
+	InRoutingTest() : table(1) {
+		table.addfield(INT, 0, "id", UNIQUENOTNULL);
+		table.addfield(VARCHAR, 0, "name", NONUNIQUE);
+		numpartitions = nodeTopology.numpartitions;
+		nodeTopology.numpartitions = 64;
+	}
+
+	~InRoutingTest() {
+		nodeTopology.numpartitions = numpartitions;
+	}
+
+	static std::vector<fieldValue_s> intValues(size_t n) {
+		std::vector<fieldValue_s> values(n, fieldValue_s());
+		for (size_t i = 0; i < n; i++)
+			values[i].value.integer = (int64_t)(i * 7919);
+		return values;
+	}
+
+	Table table;
+	int16_t numpartitions;
+};
+
+#endif
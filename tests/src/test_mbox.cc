@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "test_mbox.h"
+
+TEST_F(MboxTest, EmptyNoWait) {
+	cfgs.mboxspin[ACTOR_ENGINE] = 0;
+	EXPECT_EQ(nullptr, mbox->receive(0));
+}
+
+TEST_F(MboxTest, EmptyTimesOut) {
+	cfgs.mboxspin[ACTOR_ENGINE] = 0;
+	uint64_t start = nowns();
+	EXPECT_EQ(nullptr, mbox->receive(1000));
+	EXPECT_LE(1000000U, nowns() - start);
+}
+
+TEST_F(MboxTest, ParkedConsumerIsWoken) {
+	cfgs.mboxspin[ACTOR_ENGINE] = 0;
+	producerArgs args = { mbox, 1, 0 };
+	pthread_t tid;
+	pthread_create(&tid, NULL, produce, &args);
+	/* wait forever, so only a producer wakeup can return */
+	EXPECT_NE(nullptr, mbox->receive(-1));
+	pthread_join(tid, NULL);
+}
+
+TEST_F(MboxTest, ReceiveBatch) {
+	cfgs.mboxspin[ACTOR_ENGINE] = 0;
+	producerArgs args = { mbox, 10, 0 };
+	produce(&args);
+	Message *batch[4];
+	EXPECT_EQ(4U, mbox->receiveBatch(batch, 4, 0));
+	EXPECT_EQ(4U, mbox->receiveBatch(batch, 4, 0));
+	EXPECT_NE(nullptr, mbox->receive(0));
+	EXPECT_EQ(1U, mbox->receiveBatch(batch, 4, 0));
+	EXPECT_EQ(0U, mbox->receiveBatch(batch, 4, 0));
+}
+
+TEST_F(MboxTest, PoolReusesLocalBlocks) {
+	cfgs.messagepool = true;
+	MessagePool::stats_s before, after;
+	MessagePool::getStats(before);
+	Message *msg = new MessageSubtransactionCmd;
+	delete msg;
+	msg = new MessageSubtransactionCmd;
+	delete msg;
+	MessagePool::getStats(after);
+	EXPECT_LE(before.hits + 1, after.hits);
+}
+
+TEST_F(MboxTest, PoolReturnsAcrossThreads) {
+	cfgs.messagepool = true;
+	cfgs.mboxspin[ACTOR_ENGINE] = MBOXSPINDEFAULT;
+	MessagePool::stats_s before, after;
+	MessagePool::getStats(before);
+	hop(1, 1000, 0);
+	MessagePool::getStats(after);
+	/* consumer freed producer's blocks onto its return list */
+	EXPECT_LE(before.returns + 999, after.returns);
+}
@@ -0,0 +1,83 @@
+#ifndef INFINISQLTESTMBOX_H
+#define INFINISQLTESTMBOX_H
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "Mbox.h"
+#include "timing.h"
+
+extern cfg_s cfgs;
+
+/* carries its send time so the consumer can compute hop latency,
+ * never serialized */
+class TimedMessage: public Message {
+public:
+	uint64_t sentns;
+};
+
+struct producerArgs {
+	Mbox *mbox;
+	size_t nmsgs;
+	useconds_t gap;
+};
+
+inline void *produce(void *arg) {
+	producerArgs &args = *(producerArgs *)arg;
+	MboxProducer producer(args.mbox, 1);
+
+	for (size_t n = 0; n < args.nmsgs; n++) {
+		TimedMessage *msg = new TimedMessage;
+		msg->messageStruct.payloadtype = PAYLOADMESSAGE;
+		msg->messageStruct.topic = TOPIC_NONE;
+		msg->messageStruct.destAddr = {1, 0};
+		msg->sentns = nowns();
+		producer.sendMsg(*msg);
+		if (args.gap) {
+			usleep(args.gap);
+		}
+	}
+
+	return NULL;
+}
+
+class MboxTest: public ::testing::Test {
+
+protected:
+	Mbox *mbox = nullptr;
+
+	virtual void SetUp() {
+		mbox = new Mbox;
+		mbox->actortype = ACTOR_ENGINE;
+	}
+
+	virtual void TearDown() {
+		delete mbox;
+	}
+
+	/* consume until nmsgs arrive, return per-hop latencies in ns */
+	std::vector<uint64_t> hop(size_t nproducers, size_t nmsgs,
+			useconds_t gap) {
+		std::vector<pthread_t> tids(nproducers);
+		producerArgs args = { mbox, nmsgs, gap };
+		for (size_t n = 0; n < nproducers; n++) {
+			pthread_create(&tids[n], NULL, produce, &args);
+		}
+
+		std::vector<uint64_t> latencies;
+		while (latencies.size() < nproducers * nmsgs) {
+			/* actors loop on 100us timeouts */
+			Message *msg = mbox->receive(100);
+			if (msg != NULL) {
+				latencies.push_back(nowns() - ((TimedMessage *)msg)->sentns);
+			}
+		}
+
+		for (size_t n = 0; n < nproducers; n++) {
+			pthread_join(tids[n], NULL);
+		}
+		std::sort(latencies.begin(), latencies.end());
+		return latencies;
+	}
+};
+
+#endif
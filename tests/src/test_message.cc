@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "Message.h"
+#include "test_message.h"
+
+/* decode each [size, msg] frame in arena */
+static std::vector<Message *> unframe(const std::string &arena) {
+	std::vector<Message *> msgs;
+	for (size_t pos = 0; pos < arena.size();) {
+		size_t s;
+		memcpy(&s, arena.c_str() + pos, sizeof(s));
+		pos += sizeof(s);
+		msgs.push_back(Message::des(new std::string(arena, pos, s)));
+		pos += s;
+	}
+	return msgs;
+}
+
+TEST(MessageTest, ArenaRoundTrip) {
+	MessageSubtransactionCmd *large = largeSubtransaction(10);
+	MessageCommitRollback *rollback = commitRollback(10);
+	std::string arena;
+	large->sermsg(arena);
+	rollback->sermsg(arena);
+
+	std::vector<Message *> msgs = unframe(arena);
+	ASSERT_EQ(2U, msgs.size());
+	MessageSubtransactionCmd &subRef = *(MessageSubtransactionCmd *)msgs[0];
+	ASSERT_EQ(10U, subRef.returnRows.size());
+	for (size_t n = 0; n < 10; n++) {
+		EXPECT_EQ(large->returnRows[n].rowid, subRef.returnRows[n].rowid);
+		EXPECT_EQ(large->returnRows[n].row, subRef.returnRows[n].row);
+	}
+	EXPECT_EQ(10U, subRef.indexHits.size());
+	MessageCommitRollback &crRef = *(MessageCommitRollback *)msgs[1];
+	ASSERT_EQ(10U, crRef.rofs.size());
+	for (size_t n = 0; n < 10; n++) {
+		EXPECT_EQ(rollback->rofs[n].isrow, crRef.rofs[n].isrow);
+		EXPECT_EQ(rollback->rofs[n].newrowid, crRef.rofs[n].newrowid);
+		EXPECT_EQ(rollback->rofs[n].fieldVal.value.integer,
+				crRef.rofs[n].fieldVal.value.integer);
+		EXPECT_EQ(rollback->rofs[n].fieldVal.str, crRef.rofs[n].fieldVal.str);
+	}
+
+	/* arena and per-message paths produce the same bytes */
+	std::string *serstr = large->sermsg();
+	size_t s;
+	memcpy(&s, arena.c_str(), sizeof(s));
+	EXPECT_EQ(*serstr, arena.substr(sizeof(s), s));
+
+	delete serstr;
+	delete large;
+	delete rollback;
+	for (size_t n = 0; n < msgs.size(); n++) {
+		delete msgs[n];
+	}
+}
+
+TEST(MessageTest, SubtransactionCmdUnpackView) {
+	MessageSubtransactionCmd msg;
+	msg.messageStruct.payloadtype = PAYLOADSUBTRANSACTION;
+	msg.row = "row";
+	msg.indexHits.push_back({ 5, 2 });
+	msg.indexHits.push_back({ 6, 3 });
+	returnRow_s returnRow = { 7, 8, NOLOCK, "returned" };
+	msg.returnRows.push_back(returnRow);
+	msg.rowids.push_back(9);
+
+	std::string *serstr = msg.ser();
+	std::string original = *serstr;
+	SerializedMessage serobj(serstr);
+	MessageSubtransactionCmd view;
+	view.unpackView(serobj);
+	EXPECT_EQ(nullptr, serobj.data);
+	EXPECT_EQ(1U, view.rowids.size());
+	EXPECT_EQ("row", view.getRow());
+	ASSERT_EQ(2U, view.getIndexHits().size());
+	EXPECT_EQ(6, view.getIndexHits()[1].rowid);
+	EXPECT_EQ(3, view.getIndexHits()[1].engineid);
+	ASSERT_EQ(1U, view.getReturnRows().size());
+	EXPECT_EQ("returned", view.getReturnRows()[0].row);
+
+	/* nothing lost on the way back out */
+	std::string *reserstr = view.ser();
+	EXPECT_EQ(original, *reserstr);
+	delete reserstr;
+
+	view.clear();
+	EXPECT_EQ("", view.getRow());
+	EXPECT_EQ(0U, view.getIndexHits().size());
+}
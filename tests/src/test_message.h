@@ -0,0 +1,38 @@
+#ifndef INFINISQLTESTMESSAGE_H
+#define INFINISQLTESTMESSAGE_H
+
+#include "Message.h"
+
+/* multi-thousand-row SELECT reply */
+inline MessageSubtransactionCmd *largeSubtransaction(size_t nrows) {
+	MessageSubtransactionCmd *msg = new MessageSubtransactionCmd;
+	msg->messageStruct.payloadtype = PAYLOADSUBTRANSACTION;
+	for (size_t n = 0; n < nrows; n++) {
+		msg->indexHits.push_back({ (int64_t)n, 1 });
+		/* empty rows must survive the offset table too */
+		msg->returnRows.push_back({ (int64_t)n, 7, NOLOCK,
+				std::string(n % 5 ? 120 : 0, 'r') });
+	}
+	return msg;
+}
+
+inline MessageCommitRollback *commitRollback(size_t nrofs) {
+	MessageCommitRollback *msg = new MessageCommitRollback;
+	msg->messageStruct.payloadtype = PAYLOADCOMMITROLLBACK;
+	for (size_t n = 0; n < nrofs; n++) {
+		rowOrField_s rof = {};
+		rof.isrow = n % 2;
+		rof.tableid = 3;
+		rof.rowid = n;
+		rof.fieldid = 2;
+		rof.engineid = 1;
+		rof.isreplace = true;
+		rof.newrowid = n + 1;
+		rof.fieldVal.value.integer = n;
+		rof.fieldVal.str = n % 3 ? "" : "field";
+		msg->rofs.push_back(rof);
+	}
+	return msg;
+}
+
+#endif
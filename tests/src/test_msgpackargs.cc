@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "defs.h"
+
+static std::string viewString(const argView_s &view) {
+	return std::string(view.data, view.size);
+}
+
+TEST(MsgpackArgsTest, Views) {
+	/* fixraw, str8, raw16, bin8 */
+	std::string buf("\x94\xa3one\xd9\x03two\xda\x00\x05three\xc4\x01\x00", 21);
+	std::vector<argView_s> views;
+	ASSERT_TRUE(msgpack2ArgViews(views, buf.data(), buf.size()));
+	ASSERT_EQ(4U, views.size());
+	EXPECT_EQ("one", viewString(views[0]));
+	EXPECT_EQ("two", viewString(views[1]));
+	EXPECT_EQ("three", viewString(views[2]));
+	EXPECT_EQ(std::string(1, '\0'), viewString(views[3]));
+	/* views point into the buffer, nothing copied */
+	EXPECT_EQ(buf.data() + 2, views[0].data);
+
+	/* truncated item, wrong item type, not an array */
+	EXPECT_FALSE(msgpack2ArgViews(views, buf.data(), buf.size() - 1));
+	EXPECT_FALSE(msgpack2ArgViews(views, "\x91\x01", 2));
+	EXPECT_FALSE(msgpack2ArgViews(views, "\xa3one", 4));
+	EXPECT_FALSE(msgpack2ArgViews(views, "", 0));
+}
+
+TEST(MsgpackArgsTest, PackRoundTrip) {
+	std::vector<std::string> v;
+	v.push_back("");
+	v.push_back(std::string(31, 'a'));
+	v.push_back(std::string(32, 'b'));
+	v.push_back(std::string(70000, 'c'));
+	std::string out;
+	vector2Msgpack(v, out);
+	EXPECT_EQ('\x94', out[0]);
+	EXPECT_EQ('\xa0', out[1]);
+	EXPECT_EQ('\xbf', out[2]);
+	EXPECT_EQ('\xda', out[34]);
+	std::vector<argView_s> views;
+	ASSERT_TRUE(msgpack2ArgViews(views, out.data(), out.size()));
+	ASSERT_EQ(v.size(), views.size());
+	for (size_t n = 0; n < v.size(); n++) {
+		EXPECT_EQ(v[n], viewString(views[n]));
+	}
+
+	std::vector<std::string> many(20, "x");
+	out.clear();
+	vector2Msgpack(many, out);
+	EXPECT_EQ(std::string("\xdc\x00\x14", 3), out.substr(0, 3));
+	ASSERT_TRUE(msgpack2ArgViews(views, out.data(), out.size()));
+	EXPECT_EQ(20U, views.size());
+}
@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "ObGateway.h"
+
+class ObGatewayTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+		int bufsize = 4096;
+		setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+		setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+		fcntl(fds[1], F_SETFL, O_NONBLOCK);
+	}
+
+	virtual void TearDown() {
+		close(fds[0]);
+		if (fds[1] != -1)
+			close(fds[1]);
+		while (!q.segments.empty()) {
+			ObGateway::releaseSegment(spares, q.segments.front());
+			q.segments.pop_front();
+		}
+		for (size_t n = 0; n < spares.size(); n++)
+			delete spares[n];
+	}
+
+	ObGateway::buffer_s *buffer(const std::string &data) {
+		ObGateway::buffer_s *b = new ObGateway::buffer_s;
+		b->data = data;
+		b->refs = 0;
+		return b;
+	}
+
+	void queue(ObGateway::buffer_s *b, size_t start, size_t len) {
+		b->refs++;
+		ObGateway::segment_s segment = {b, b->data.data() + start, len, 0};
+		q.segments.push_back(segment);
+		q.queuedbytes += len;
+	}
+
+	void queue(const std::string &frame) {
+		queue(buffer(frame), 0, frame.size());
+	}
+
+	void queueHeader(size_t header) {
+		ObGateway::segment_s segment = {NULL, NULL, sizeof(header), header};
+		q.segments.push_back(segment);
+		q.queuedbytes += sizeof(header);
+	}
+
+	/* read what is waiting, as the remote IbGateway would */
+	size_t drain(std::string &received) {
+		char buf[65536];
+		size_t total = 0;
+		ssize_t n;
+		while ((n = read(fds[1], buf, sizeof(buf))) > 0) {
+			received.append(buf, n);
+			total += n;
+		}
+		return total;
+	}
+
+	/* bytes still owed to the peer */
+	size_t unsent() {
+		size_t bytes = 0;
+		for (size_t n = 0; n < q.segments.size(); n++)
+			bytes += q.segments[n].len;
+		return bytes - q.headpos;
+	}
+
+	int fds[2];
+	ObGateway::peerQueue_s q;
+	std::vector<ObGateway::buffer_s *> spares;
+};
+
+/* more frames than OBGWIOVMAX, of sizes that split across writes */
+TEST_F(ObGatewayTest, PartialWrites) {
+	std::string expected;
+	for (int n = 0; n < 3 * OBGWIOVMAX; n++) {
+		std::string frame((n * 7919) % 20000 + 1, (char)('a' + n % 26));
+		expected.append(frame);
+		queue(frame);
+	}
+
+	std::string received;
+	int wouldblock = 0;
+	int rv;
+	while ((rv = ObGateway::writeQueue(q, fds[0], spares)) != 1) {
+		ASSERT_EQ(0, rv);
+		wouldblock++;
+		/* everything is either received, or still queued past headpos */
+		drain(received);
+		ASSERT_EQ(expected.size(), received.size() + unsent());
+		ASSERT_TRUE(expected.compare(0, received.size(), received) == 0);
+		ASSERT_EQ(q.queuedbytes, unsent());
+		ASSERT_LE(spares.size(), (size_t)OBGWSPAREBUFFERS);
+	}
+	drain(received);
+
+	EXPECT_GT(wouldblock, 0);
+	EXPECT_TRUE(q.segments.empty());
+	EXPECT_EQ(0U, q.headpos);
+	EXPECT_EQ(0U, q.queuedbytes);
+	EXPECT_EQ((size_t)OBGWSPAREBUFFERS, spares.size());
+	EXPECT_TRUE(expected == received);
+}
+
+TEST_F(ObGatewayTest, ResumesInsideFrame) {
+	std::string frame(100000, 'x');
+	for (size_t n = 0; n < frame.size(); n++)
+		frame[n] = (char)(n % 251);
+	queue(frame);
+
+	ASSERT_EQ(0, ObGateway::writeQueue(q, fds[0], spares));
+	ASSERT_EQ(1U, q.segments.size());
+	ASSERT_GT(q.headpos, 0U);
+	ASSERT_LT(q.headpos, frame.size());
+	EXPECT_EQ(frame.size() - q.headpos, q.queuedbytes);
+
+	std::string received;
+	while (ObGateway::writeQueue(q, fds[0], spares) != 1)
+		drain(received);
+	drain(received);
+	EXPECT_TRUE(frame == received);
+}
+
+TEST_F(ObGatewayTest, PeerGone) {
+	close(fds[1]);
+	fds[1] = -1;
+	queue("frame");
+	EXPECT_EQ(-1, ObGateway::writeQueue(q, fds[0], spares));
+	/* left for flush() to drop */
+	EXPECT_EQ(1U, q.segments.size());
+	EXPECT_EQ(0U, q.headpos);
+	EXPECT_EQ(5U, q.queuedbytes);
+}
+
+/* every queue added at once knows its node, not only the last */
+/* size headers and runs of a shared message buffer go out as they are,
+ * the buffer released with its last segment */
+TEST_F(ObGatewayTest, GathersSegments) {
+	ObGateway::buffer_s *arena = buffer(std::string(100000, 'a') +
+	                                    std::string(100000, 'b'));
+	queueHeader(sizeof(size_t) + 100000);
+	queue(arena, 0, 100000);
+	queueHeader(sizeof(size_t) + 100000);
+	queue(arena, 100000, 100000);
+	ASSERT_EQ(2U, arena->refs);
+
+	std::string received;
+	bool halfway = false;
+	while (ObGateway::writeQueue(q, fds[0], spares) != 1) {
+		drain(received);
+		if (q.segments.size() <= 2) {
+			/* first run written, the buffer still held by the second */
+			halfway = true;
+			EXPECT_EQ(1U, arena->refs);
+			EXPECT_TRUE(spares.empty());
+		}
+	}
+	drain(received);
+
+	EXPECT_TRUE(halfway);
+	ASSERT_EQ(1U, spares.size());
+	EXPECT_EQ(arena, spares[0]);
+	EXPECT_TRUE(arena->data.empty());
+	ASSERT_EQ(2 * (sizeof(size_t) + 100000), received.size());
+	for (size_t n = 0, pos = 0; n < 2; n++) {
+		size_t header;
+		memcpy(&header, &received[pos], sizeof(header));
+		EXPECT_EQ(sizeof(size_t) + 100000, header);
+		EXPECT_EQ(std::string(100000, n ? 'b' : 'a'),
+		          received.substr(pos + sizeof(header), 100000));
+		pos += header;
+	}
+}
+
+TEST(ObGatewayStatsTest, PeersTaggedWithNodeid) {
+	std::vector<ObGateway::peerQueue_s> peers;
+	ObGateway::addPeers(peers, 3);
+	ObGateway::addPeers(peers, 6);
+	ASSERT_EQ(7U, peers.size());
+	for (size_t n = 0; n < peers.size(); n++)
+		EXPECT_EQ((int64_t)n, peers[n].stats.nodeid);
+}
+
+TEST(ObGatewayStatsTest, Savings) {
+	extern cfg_s cfgs;
+	cfg_s saved = cfgs;
+	cfgs.compressgw = true;
+	cfgs.compressgwthreshold = 1024;
+	cfgs.compressgwminsaving = 0;
+	cfgs.compressgwnsperbyte = 1000000;
+
+	std::vector<ObGateway::peerQueue_s> peers;
+	ObGateway::addPeers(peers, 4);
+	std::string frame(65536, 'a'), small(100, 'b'), out;
+	for (int n = 0; n < 3; n++)
+		ASSERT_TRUE(ObGateway::compress(peers[2], frame, out));
+	EXPECT_FALSE(ObGateway::compress(peers[2], small, out));
+	EXPECT_FALSE(ObGateway::compress(peers[4], small, out));
+
+	std::vector<ObGateway::compressStats_s> stats;
+	ObGateway::peerStats(peers, stats);
+	/* nodes never sent to are left out */
+	ASSERT_EQ(2U, stats.size());
+	EXPECT_EQ(2, stats[0].nodeid);
+	EXPECT_TRUE(stats[0].iscompressing);
+	EXPECT_EQ(3U * frame.size(), stats[0].rawbytes);
+	EXPECT_GT(stats[0].compressedbytes, 0U);
+	EXPECT_LT(stats[0].compressedbytes * 10, stats[0].rawbytes);
+	EXPECT_EQ(small.size(), stats[0].uncompressedbytes);
+	EXPECT_EQ(4, stats[1].nodeid);
+	EXPECT_EQ(0U, stats[1].rawbytes);
+	EXPECT_EQ(small.size(), stats[1].uncompressedbytes);
+
+	for (size_t n = 0; n < peers.size(); n++)
+		if (peers[n].lz4stream != NULL) {
+			LZ4_freeStream(peers[n].lz4stream);
+			delete[] peers[n].lz4dict;
+		}
+	cfgs = saved;
+}
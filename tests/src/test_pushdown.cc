@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "Table.h"
+#include "Message.h"
+
+class PushdownTest : public ::testing::Test {
+protected:
+	PushdownTest() : table(1) {
+		table.addfield(INT, 0, "id", UNIQUENOTNULL);
+		table.addfield(VARCHAR, 0, "name", NONUNIQUE);
+		table.addfield(CHAR, 0, "grade", NONUNIQUE);
+		table.addfield(INT, 0, "score", NONUNIQUE);
+	}
+
+	std::string row(int64_t id, const std::string &name, char grade,
+			int64_t score, bool scoreisnull = false) {
+		std::vector<fieldValue_s> fields(4, fieldValue_s());
+		fields[0].value.integer = id;
+		fields[1].str = name;
+		fields[2].value.character = grade;
+		fields[3].value.integer = score;
+		fields[3].isnull = scoreisnull;
+		std::string r;
+		EXPECT_TRUE(table.makerow(&fields, &r));
+		return r;
+	}
+
+	static residualPredicate_s intResidual(int64_t fieldid,
+			operatortypes_e op, int64_t val) {
+		residualPredicate_s residual = {};
+		residual.fieldid = fieldid;
+		residual.op = op;
+		residual.value.value.integer = val;
+		return residual;
+	}
+
+	Table table;
+};
+
+TEST_F(PushdownTest, Qualifies) {
+	std::string r = row(1, "alice", 'b', 70);
+	std::vector<residualPredicate_s> residuals;
+	EXPECT_TRUE(table.qualifies(&r, residuals));
+
+	residuals.push_back(intResidual(3, OPERATOR_GTE, 70));
+	EXPECT_TRUE(table.qualifies(&r, residuals));
+	residuals.push_back(intResidual(3, OPERATOR_LT, 70));
+	EXPECT_FALSE(table.qualifies(&r, residuals));
+
+	residuals.clear();
+	residualPredicate_s name = {};
+	name.fieldid = 1;
+	name.op = OPERATOR_GT;
+	name.value.str = "al";
+	residuals.push_back(name);
+	residualPredicate_s grade = {};
+	grade.fieldid = 2;
+	grade.op = OPERATOR_NE;
+	grade.value.value.character = 'a';
+	residuals.push_back(grade);
+	EXPECT_TRUE(table.qualifies(&r, residuals));
+	residuals[1].value.value.character = 'b';
+	EXPECT_FALSE(table.qualifies(&r, residuals));
+
+	/* NULL compares as unknown */
+	std::string nullscore = row(2, "bob", 'c', 0, true);
+	residuals.clear();
+	residuals.push_back(intResidual(3, OPERATOR_NE, 5));
+	EXPECT_FALSE(table.qualifies(&nullscore, residuals));
+}
+
+TEST_F(PushdownTest, Project) {
+	std::string r = row(7, std::string(200, 'n'), 'a', 99);
+	std::string projected = r;
+	std::vector<int64_t> projection;
+	projection.push_back(3);
+	projection.push_back(0);
+	table.project(&projected, projection);
+	EXPECT_LT(projected.size(), r.size());
+
+	std::vector<fieldValue_s> fields;
+	ASSERT_TRUE(table.unmakerow(&projected, &fields));
+	ASSERT_EQ(4U, fields.size());
+	EXPECT_FALSE(fields[0].isnull);
+	EXPECT_EQ(7, fields[0].value.integer);
+	EXPECT_TRUE(fields[1].isnull);
+	EXPECT_EQ("", fields[1].str);
+	EXPECT_TRUE(fields[2].isnull);
+	EXPECT_FALSE(fields[3].isnull);
+	EXPECT_EQ(99, fields[3].value.integer);
+}
+
+TEST_F(PushdownTest, SearchParamsRoundTrip) {
+	MessageSubtransactionCmd msg;
+	msg.messageStruct.payloadtype = PAYLOADSUBTRANSACTION;
+	msg.rowids.push_back(3);
+	msg.searchParameters.residuals.push_back(intResidual(3, OPERATOR_GT, -4));
+	residualPredicate_s name = {};
+	name.fieldid = 1;
+	name.op = OPERATOR_EQ;
+	name.value.str = "carol";
+	msg.searchParameters.residuals.push_back(name);
+	msg.searchParameters.projection.push_back(1);
+	msg.searchParameters.projection.push_back(3);
+
+	std::string *serstr = msg.ser();
+	SerializedMessage serobj(serstr);
+	MessageSubtransactionCmd out;
+	out.unpack(serobj);
+	searchParams_s &params = out.searchParameters;
+	ASSERT_EQ(2U, params.residuals.size());
+	EXPECT_EQ(3, params.residuals[0].fieldid);
+	EXPECT_EQ(OPERATOR_GT, params.residuals[0].op);
+	EXPECT_EQ(-4, params.residuals[0].value.value.integer);
+	EXPECT_EQ(OPERATOR_EQ, params.residuals[1].op);
+	EXPECT_EQ("carol", params.residuals[1].value.str);
+	EXPECT_EQ((std::vector<int64_t>{1, 3}), params.projection);
+	ASSERT_EQ(1U, out.rowids.size());
+}
+
+/* reply bytes for 10000 candidate rows, 10% satisfying the conjunct,
+ * returning one narrow column */
+TEST_F(PushdownTest, ReplyBytes) {
+	std::vector<residualPredicate_s> residuals;
+	residuals.push_back(intResidual(3, OPERATOR_GTE, 90));
+	std::vector<int64_t> projection(1, 0);
+
+	MessageSubtransactionCmd full, pushed;
+	for (int64_t n = 0; n < 10000; n++) {
+		std::string r = row(n, std::string(100, 'x'), 'a', n % 100);
+		full.returnRows.push_back({ n, 0, NOLOCK, r });
+		if (table.qualifies(&r, residuals)) {
+			table.project(&r, projection);
+			pushed.returnRows.push_back({ n, 0, NOLOCK, r });
+		}
+	}
+	EXPECT_EQ(1000U, pushed.returnRows.size());
+	size_t fullbytes = full.size();
+	size_t pushedbytes = pushed.size();
+	EXPECT_LT(pushedbytes * 20, fullbytes);
+	printf("pushdown reply %lu bytes, without %lu bytes\n",
+	       (unsigned long)pushedbytes, (unsigned long)fullbytes);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "TransactionAgent.h"
+#include "infinisql.h"
+
+/* stored procedure that answers later, as one waiting on Engines does */
+class DeferredProc : public ApiInterface {
+public:
+	DeferredProc(class TransactionAgent *taPtrarg,
+			class ApiInterface *pgPtrarg, void *destructorPtrarg) {
+		taPtr = taPtrarg;
+		pgPtr = pgPtrarg;
+	}
+	void doit() {}
+	void continueFunc1(int64_t entrypoint, void *statePtr) {}
+	void continueFunc2(int64_t entrypoint, void *statePtr) {}
+	void continuePgFunc(int64_t entrypoint, void *statePtr) {}
+	void continuePgCommitimplicit(int64_t entrypoint, void *statePtr) {}
+	void continuePgCommitexplicit(int64_t entrypoint, void *statePtr) {}
+	void continuePgRollbackimplicit(int64_t entrypoint, void *statePtr) {}
+	void continuePgRollbackexplicit(int64_t entrypoint, void *statePtr) {}
+};
+
+static int64_t getInt64(const std::string &buf, size_t pos) {
+	uint64_t x;
+	memcpy(&x, buf.data() + pos, sizeof(x));
+	return (int64_t)be64toh(x);
+}
+
+/* two procedure calls pipelined on one connection, answered out of order */
+TEST(RequestIdTest, PipelinedProcedures) {
+	ApiInterface::setRequest(5, 7);
+	DeferredProc *first = new DeferredProc(NULL, NULL, NULL);
+	ApiInterface::setRequest(5, 8);
+	DeferredProc *second = new DeferredProc(NULL, NULL, NULL);
+	ApiInterface::setRequest(-1, 0);
+
+	EXPECT_EQ(5, first->sockfd);
+	EXPECT_EQ(7, first->requestid);
+	EXPECT_EQ(5, second->sockfd);
+	EXPECT_EQ(8, second->requestid);
+
+	std::string outbuf;
+	TransactionAgent::frameResponse(outbuf, STATUS_OK, second->requestid,
+			"b", 1);
+	TransactionAgent::frameResponse(outbuf, STATUS_NOTOK, first->requestid,
+			"aa", 2);
+
+	/* totalsize counts the whole frame */
+	ASSERT_EQ(3 * sizeof(uint64_t) + 1 + 3 * sizeof(uint64_t) + 2,
+			outbuf.size());
+	size_t pos = 0;
+	EXPECT_EQ((int64_t)(3 * sizeof(uint64_t) + 1), getInt64(outbuf, pos));
+	EXPECT_EQ(STATUS_OK, getInt64(outbuf, pos + sizeof(uint64_t)));
+	EXPECT_EQ(8, getInt64(outbuf, pos + 2 * sizeof(uint64_t)));
+	EXPECT_EQ('b', outbuf[pos + 3 * sizeof(uint64_t)]);
+	pos += getInt64(outbuf, pos);
+	EXPECT_EQ(STATUS_NOTOK, getInt64(outbuf, pos + sizeof(uint64_t)));
+	EXPECT_EQ(7, getInt64(outbuf, pos + 2 * sizeof(uint64_t)));
+	EXPECT_EQ("aa", outbuf.substr(pos + 3 * sizeof(uint64_t)));
+
+	delete first;
+	delete second;
+}
+
+TEST(RequestIdTest, NoRequest) {
+	DeferredProc proc(NULL, NULL, NULL);
+	EXPECT_EQ(-1, proc.sockfd);
+	EXPECT_EQ(0, proc.requestid);
+}
@@ -179,3 +179,14 @@ TEST_F(SqlTest, CreateTableLikeOtherTableExplicitIncludeExclude) {
 	Larxer l("CREATE TABLE test LIKE test2 INCLUDING ALL EXCLUDING STORAGE;", nullptr, schema);
 	EXPECT_NE(nullptr, l.statementPtr);
 }
+
+TEST_F(SqlTest, SelectWithParameter) {
+	Larxer l("SELECT a FROM t WHERE b = $1", nullptr, schema);
+	EXPECT_NE(nullptr, l.statementPtr);
+}
+
+TEST_F(SqlTest, SelectWithParameterZero) {
+	// parameters number from $1
+	Larxer l("SELECT a FROM t WHERE b = $0", nullptr, schema);
+	EXPECT_EQ(nullptr, l.statementPtr);
+}
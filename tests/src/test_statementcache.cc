@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "gch.h"
+#include "StatementCache.h"
+#include "Asts.h"
+
+static int64_t intParameter(const std::string &operand) {
+	EXPECT_EQ(OPERAND_INTEGER, operand[0]);
+	int64_t val;
+	memcpy(&val, &operand[1], sizeof(val));
+	return val;
+}
+
+static long double floatParameter(const std::string &operand) {
+	EXPECT_EQ(OPERAND_FLOAT, operand[0]);
+	long double val;
+	memcpy(&val, &operand[1], sizeof(val));
+	return val;
+}
+
+TEST(StatementCacheTest, Normalize) {
+	std::string key;
+	std::vector<std::string> params;
+	ASSERT_TRUE(StatementCache::normalize(
+			"SELECT a1, b FROM t2 WHERE a1 = 42 AND b = 'it''s' -- 7\n",
+			key, params));
+	EXPECT_EQ("SELECT a1, b FROM t2 WHERE a1 = $1 AND b = $2 -- 7\n", key);
+	ASSERT_EQ(2U, params.size());
+	EXPECT_EQ(42, intParameter(params[0]));
+	EXPECT_EQ(std::string(1, OPERAND_STRING) + "it''s", params[1]);
+
+	/* same shape, same key */
+	std::string key2;
+	ASSERT_TRUE(StatementCache::normalize(
+			"SELECT a1, b FROM t2 WHERE a1 = 9 AND b = 'x' -- 7\n",
+			key2, params));
+	EXPECT_EQ(key, key2);
+
+	/* signs the number rule takes, floats, LIKE patterns kept */
+	ASSERT_TRUE(StatementCache::normalize(
+			"UPDATE t SET a = -5, b = (a) - 2, c = (+.25) WHERE d LIKE 'x%' AND e IN (1,-1.5)",
+			key, params));
+	EXPECT_EQ("UPDATE t SET a = $1, b = (a) - $2, c = ($3) WHERE d LIKE 'x%' AND e IN ($4,$5)",
+			key);
+	ASSERT_EQ(5U, params.size());
+	EXPECT_EQ(-5, intParameter(params[0]));
+	EXPECT_EQ(2, intParameter(params[1]));
+	EXPECT_EQ(0.25, floatParameter(params[2]));
+	EXPECT_EQ(1, intParameter(params[3]));
+	EXPECT_EQ(-1.5, floatParameter(params[4]));
+
+	/* sign after a word, keyword or identifier, is left alone */
+	ASSERT_TRUE(StatementCache::normalize("SELECT -3, a - 2 FROM t", key,
+			params));
+	EXPECT_EQ("SELECT -3, a - 2 FROM t", key);
+	EXPECT_TRUE(params.empty());
+
+	EXPECT_FALSE(StatementCache::normalize("SELECT a FROM t WHERE b = $1",
+			key, params));
+	EXPECT_FALSE(StatementCache::normalize("SELECT a FROM t WHERE b = :1",
+			key, params));
+	EXPECT_FALSE(StatementCache::normalize("SELECT a FROM t WHERE b = 'x",
+			key, params));
+}
+
+TEST(StatementCacheTest, Lru) {
+	StatementCache cache(2);
+	StatementCache::stats_s before;
+	StatementCache::getStats(before);
+	class Statement *stmtPtr;
+
+	EXPECT_FALSE(cache.get(1, "a", &stmtPtr));
+	cache.put(1, "a", new class Statement);
+	cache.put(1, "b", NULL);
+	ASSERT_TRUE(cache.get(1, "a", &stmtPtr));
+	EXPECT_TRUE(stmtPtr != NULL);
+	ASSERT_TRUE(cache.get(1, "b", &stmtPtr));
+	EXPECT_TRUE(stmtPtr == NULL);
+	EXPECT_FALSE(cache.get(2, "a", &stmtPtr));
+
+	/* a is least recently used */
+	cache.put(2, "a", new class Statement);
+	EXPECT_EQ(2U, cache.size());
+	EXPECT_FALSE(cache.get(1, "a", &stmtPtr));
+	EXPECT_TRUE(cache.get(1, "b", &stmtPtr));
+
+	cache.invalidate(1);
+	EXPECT_EQ(1U, cache.size());
+	EXPECT_FALSE(cache.get(1, "b", &stmtPtr));
+	EXPECT_TRUE(cache.get(2, "a", &stmtPtr));
+
+	StatementCache::stats_s after;
+	StatementCache::getStats(after);
+	EXPECT_EQ(4U, after.hits - before.hits);
+	EXPECT_EQ(4U, after.misses - before.misses);
+	EXPECT_EQ(1U, after.evictions - before.evictions);
+	EXPECT_EQ(1U, after.invalidations - before.invalidations);
+}
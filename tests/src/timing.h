@@ -0,0 +1,14 @@
+#ifndef INFINISQLTESTTIMING_H
+#define INFINISQLTESTTIMING_H
+
+#include <stdint.h>
+#include <time.h>
+
+/* monotonic clock in ns */
+inline uint64_t nowns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif